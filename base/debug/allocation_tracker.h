@@ -0,0 +1,394 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_debug_allocation_tracker_h)
+#define INCLUDE_base_debug_allocation_tracker_h
+
+// Define |ENABLE_ALLOCATION_HOOKS| before including this header, in the
+// program, to replace global operator new and delete by ones counting
+// allocations. On Linux with glibc, define |ENABLE_MALLOC_HOOKS| instead to
+// interpose malloc(), calloc(), realloc() and free(), which also counts C
+// code and libraries; operator new of libstdc++ calls malloc(). Aligned
+// allocations, e.g. posix_memalign(), aren't counted.
+
+namespace base {
+
+struct AllocationCounts {
+  uint64_t num_allocations;
+  uint64_t num_bytes;
+  uint64_t num_frees;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// AllocationTracker
+// Counts allocations and bytes of each thread, and stacks of allocations
+// by site, when stacks are captured or allocations are disallowed, in a
+// table allocated at start, so hooks never allocate themselves.
+//
+// |ScopedDisallowAllocation| marks code which shouldn't allocate, e.g.
+// steady state frames; allocations in it are counted as disallowed, with
+// their stacks, or break into the debugger.
+//
+class AllocationTracker final {
+  public: static const int kMaxFrames = 16;
+  private: static const int kMaxSites = 1024;
+
+  private: struct Site {
+    void* frames[kMaxFrames];
+    uint32_t hash;
+    uint64_t num_allocations;
+    uint64_t num_bytes;
+    uint64_t num_disallowed;
+    int num_frames;
+  };
+
+  // Trivial, so hooks can use it before and after constructors of a
+  // thread run.
+  private: struct ThreadState {
+    AllocationCounts counts;
+    int disallow_depth;
+    bool in_hook;
+  };
+
+  private: std::atomic<bool> break_on_disallowed_;
+  private: std::atomic<bool> capture_stacks_;
+  // Guards |sites_| and |num_dropped_stacks_|.
+  private: mutable std::atomic_flag lock_;
+  private: std::atomic<uint64_t> num_disallowed_;
+  private: uint64_t num_dropped_stacks_;
+  private: Site sites_[kMaxSites];
+
+  private: AllocationTracker();
+  public: ~AllocationTracker() = default;
+
+  public: void set_break_on_disallowed(bool value) {
+    break_on_disallowed_.store(value, std::memory_order_relaxed);
+  }
+  // Capturing a stack costs a microsecond or more.
+  public: void set_capture_stacks(bool value);
+  public: uint64_t num_disallowed_allocations() const {
+    return num_disallowed_.load(std::memory_order_relaxed);
+  }
+
+  public: static void AllowAllocation();
+  public: void ClearSites();
+  // Returns counts of the calling thread.
+  public: static AllocationCounts counts();
+  // Called by hooks.
+  public: static void DidAllocate(size_t size);
+  public: static void DidFree();
+  public: static void DisallowAllocation();
+  // Returns true if hooks are compiled in.
+  public: static bool enabled();
+  public: static AllocationTracker* instance();
+  private: void Lock() const;
+  private: void RecordStack(size_t size, bool disallowed);
+  private: static ThreadState* thread_state();
+  private: void Unlock() const;
+  private: static void WriteFrame(std::ostream* stream, void* frame);
+  // Writes |max_sites| sites of the most disallowed allocations, then of
+  // the most allocations.
+  public: void WriteSites(std::ostream* stream, size_t max_sites) const;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationTracker);
+};
+
+AllocationTracker::AllocationTracker()
+    : break_on_disallowed_(false), capture_stacks_(false),
+      num_disallowed_(0), num_dropped_stacks_(0) {
+  lock_.clear();
+  ClearSites();
+}
+
+void AllocationTracker::set_capture_stacks(bool value) {
+#if defined(__linux__)
+  // The first backtrace() loads the unwinder, which allocates.
+  void* frames[1];
+  ::backtrace(frames, 1);
+#endif
+  capture_stacks_.store(value, std::memory_order_relaxed);
+}
+
+void AllocationTracker::AllowAllocation() {
+  --thread_state()->disallow_depth;
+}
+
+void AllocationTracker::ClearSites() {
+  Lock();
+  ::memset(sites_, 0, sizeof(sites_));
+  num_dropped_stacks_ = 0;
+  Unlock();
+  num_disallowed_.store(0, std::memory_order_relaxed);
+}
+
+AllocationCounts AllocationTracker::counts() {
+  return thread_state()->counts;
+}
+
+void AllocationTracker::DidAllocate(size_t size) {
+  auto const state = thread_state();
+  ++state->counts.num_allocations;
+  state->counts.num_bytes += size;
+  // Allocations of capturing a stack are counted only.
+  if (state->in_hook)
+    return;
+  auto const tracker = instance();
+  auto const disallowed = state->disallow_depth > 0;
+  if (!disallowed &&
+      !tracker->capture_stacks_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  state->in_hook = true;
+  if (disallowed)
+    tracker->num_disallowed_.fetch_add(1, std::memory_order_relaxed);
+  tracker->RecordStack(size, disallowed);
+  state->in_hook = false;
+  if (disallowed &&
+      tracker->break_on_disallowed_.load(std::memory_order_relaxed)) {
+    NOTREACHED();
+  }
+}
+
+void AllocationTracker::DidFree() {
+  ++thread_state()->counts.num_frees;
+}
+
+void AllocationTracker::DisallowAllocation() {
+  ++thread_state()->disallow_depth;
+}
+
+bool AllocationTracker::enabled() {
+#if defined(ENABLE_ALLOCATION_HOOKS) || defined(ENABLE_MALLOC_HOOKS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+AllocationTracker* AllocationTracker::instance() {
+  static AllocationTracker instance;
+  return &instance;
+}
+
+void AllocationTracker::Lock() const {
+  while (lock_.test_and_set(std::memory_order_acquire)) {
+    // Spin, since a lock may allocate.
+  }
+}
+
+void AllocationTracker::RecordStack(size_t size, bool disallowed) {
+  void* frames[kMaxFrames + 2];
+  // Skips this function and |DidAllocate()|, or a hook if it is inlined.
+#if defined(_WIN32)
+  auto const num_frames = static_cast<int>(
+      ::CaptureStackBackTrace(2, kMaxFrames, frames, nullptr));
+  auto const stack = frames;
+#elif defined(__linux__)
+  auto const num_frames = std::max(::backtrace(frames, kMaxFrames + 2) - 2,
+                                   0);
+  auto const stack = frames + 2;
+#else
+  auto const num_frames = 0;
+  auto const stack = frames;
+#endif
+  // FNV-1a of return addresses.
+  auto hash = static_cast<uint32_t>(2166136261u);
+  for (auto index = 0; index < num_frames; ++index) {
+    hash ^= static_cast<uint32_t>(reinterpret_cast<uintptr_t>(stack[index]));
+    hash *= 16777619u;
+  }
+  Lock();
+  for (auto probe = 0; probe < kMaxSites; ++probe) {
+    auto& site = sites_[(hash + probe) % kMaxSites];
+    if (site.num_allocations &&
+        (site.hash != hash || site.num_frames != num_frames ||
+         ::memcmp(site.frames, stack, sizeof(void*) * num_frames))) {
+      continue;
+    }
+    if (!site.num_allocations) {
+      ::memcpy(site.frames, stack, sizeof(void*) * num_frames);
+      site.hash = hash;
+      site.num_frames = num_frames;
+    }
+    ++site.num_allocations;
+    site.num_bytes += size;
+    if (disallowed)
+      ++site.num_disallowed;
+    Unlock();
+    return;
+  }
+  ++num_dropped_stacks_;
+  Unlock();
+}
+
+AllocationTracker::ThreadState* AllocationTracker::thread_state() {
+  static thread_local ThreadState state;
+  return &state;
+}
+
+void AllocationTracker::Unlock() const {
+  lock_.clear(std::memory_order_release);
+}
+
+// Writes function and offset if symbols are available, or module and
+// offset for symbol files.
+void AllocationTracker::WriteFrame(std::ostream* stream, void* frame) {
+  auto const address = reinterpret_cast<uintptr_t>(frame);
+#if defined(_WIN32)
+  HMODULE module;
+  char file_name[MAX_PATH];
+  if (::GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                               GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           static_cast<LPCSTR>(frame), &module) &&
+      ::GetModuleFileNameA(module, file_name, sizeof(file_name))) {
+    auto const slash = ::strrchr(file_name, '\\');
+    *stream << (slash ? slash + 1 : file_name) << "+0x" << std::hex <<
+        address - reinterpret_cast<uintptr_t>(module) << std::dec;
+    return;
+  }
+#elif defined(__linux__)
+  Dl_info info;
+  if (::dladdr(frame, &info) && info.dli_fname) {
+    if (info.dli_sname) {
+      auto status = 0;
+      auto const demangled = abi::__cxa_demangle(info.dli_sname, nullptr,
+                                                 nullptr, &status);
+      *stream << (demangled ? demangled : info.dli_sname) << "+0x" <<
+          std::hex << address - reinterpret_cast<uintptr_t>(info.dli_saddr) <<
+          std::dec;
+      ::free(demangled);
+      return;
+    }
+    auto const slash = ::strrchr(info.dli_fname, '/');
+    *stream << (slash ? slash + 1 : info.dli_fname) << "+0x" << std::hex <<
+        address - reinterpret_cast<uintptr_t>(info.dli_fbase) << std::dec;
+    return;
+  }
+#endif
+  *stream << frame;
+}
+
+void AllocationTracker::WriteSites(std::ostream* stream,
+                                   size_t max_sites) const {
+  std::vector<Site> sites;
+  Lock();
+  for (auto const& site : sites_) {
+    if (site.num_allocations)
+      sites.push_back(site);
+  }
+  auto const num_dropped_stacks = num_dropped_stacks_;
+  Unlock();
+  std::sort(sites.begin(), sites.end(), [](const Site& a, const Site& b) {
+    if (a.num_disallowed != b.num_disallowed)
+      return a.num_disallowed > b.num_disallowed;
+    return a.num_allocations > b.num_allocations;
+  });
+  if (sites.size() > max_sites)
+    sites.resize(max_sites);
+  *stream << num_disallowed_allocations() << " disallowed allocations, " <<
+      num_dropped_stacks << " stacks dropped" << std::endl;
+  for (auto const& site : sites) {
+    *stream << site.num_allocations << " allocations, " << site.num_bytes <<
+        " bytes, " << site.num_disallowed << " disallowed" << std::endl;
+    for (auto index = 0; index < site.num_frames; ++index) {
+      *stream << "  #" << index << " ";
+      WriteFrame(stream, site.frames[index]);
+      *stream << std::endl;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ScopedDisallowAllocation
+// Allocations of the calling thread in the scope are disallowed.
+//
+class ScopedDisallowAllocation final {
+  public: ScopedDisallowAllocation();
+  public: ~ScopedDisallowAllocation();
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDisallowAllocation);
+};
+
+ScopedDisallowAllocation::ScopedDisallowAllocation() {
+  AllocationTracker::DisallowAllocation();
+}
+
+ScopedDisallowAllocation::~ScopedDisallowAllocation() {
+  AllocationTracker::AllowAllocation();
+}
+
+}  // namespace base
+
+#if defined(ENABLE_MALLOC_HOOKS)
+extern "C" {
+void* __libc_calloc(size_t count, size_t size);
+void __libc_free(void* pointer);
+void* __libc_malloc(size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+
+void* calloc(size_t count, size_t size) {
+  base::AllocationTracker::DidAllocate(count * size);
+  return __libc_calloc(count, size);
+}
+
+void free(void* pointer) {
+  if (pointer)
+    base::AllocationTracker::DidFree();
+  __libc_free(pointer);
+}
+
+void* malloc(size_t size) {
+  base::AllocationTracker::DidAllocate(size);
+  return __libc_malloc(size);
+}
+
+// Counted as an allocation of |size| bytes, since it may move.
+void* realloc(void* pointer, size_t size) {
+  base::AllocationTracker::DidAllocate(size);
+  return __libc_realloc(pointer, size);
+}
+}  // extern "C"
+#elif defined(ENABLE_ALLOCATION_HOOKS)
+void* operator new(size_t size) {
+  base::AllocationTracker::DidAllocate(size);
+  if (auto const pointer = ::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  base::AllocationTracker::DidAllocate(size);
+  return ::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept {
+  return operator new(size, nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer)
+    base::AllocationTracker::DidFree();
+  ::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  operator delete(pointer);
+}
+#endif
+
+#endif //!defined(INCLUDE_base_debug_allocation_tracker_h)
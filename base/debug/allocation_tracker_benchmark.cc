@@ -0,0 +1,241 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Reports cost of allocations with |base::AllocationTracker| hooks,
+// counting only and capturing stacks, against malloc(). Then runs steady
+// state frames, which format a HUD text and collect positions, with
+// allocations disallowed: one with a string stream and a vector per frame,
+// as |StatusLayer| does, and one reusing buffers, with allocations per
+// frame and phase of |ui::FrameTimingRecorder|.
+//
+// Returns EXIT_FAILURE if counts per phase are wrong, the reusing frame
+// allocates, or allocations of the other frame aren't caught with their
+// stacks.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\debug\allocation_tracker_benchmark.cc
+//  g++ -std=c++11 -O2 -rdynamic -I. base/debug/allocation_tracker_benchmark.cc
+//      -ldl
+//
+// Usage: allocation_tracker_benchmark [num_frames]
+
+#define ENABLE_ALLOCATION_HOOKS
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#undef max
+#undef min
+#else
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/debug/allocation_tracker.h"
+#include "base/debug/perf_counters.h"
+#include "ui/frame_timing_recorder.h"
+
+namespace {
+
+const int kNumBalls = 64;
+const int kNumAllocations = 1000000;
+
+// Keeps the compiler from removing work and allocations.
+std::atomic<uint64_t> sink;
+
+void Allocate(size_t size) {
+  auto const pointer = new char[size];
+  sink += reinterpret_cast<uintptr_t>(pointer);
+  delete[] pointer;
+}
+
+// Returns nanoseconds of an allocation and a free of 32 bytes.
+double MeasureNew() {
+  auto const start = base::TimeTicks::Now();
+  for (auto count = 0; count < kNumAllocations; ++count) {
+    auto const pointer = new char[32];
+    pointer[0] = static_cast<char>(count);
+    sink += static_cast<uint64_t>(pointer[0]);
+    delete[] pointer;
+  }
+  return (base::TimeTicks::Now() - start).InMillisecondsF() * 1e6 /
+         kNumAllocations;
+}
+
+double MeasureMalloc() {
+  auto const start = base::TimeTicks::Now();
+  for (auto count = 0; count < kNumAllocations; ++count) {
+    auto const pointer = static_cast<char*>(::malloc(32));
+    pointer[0] = static_cast<char>(count);
+    sink += static_cast<uint64_t>(pointer[0]);
+    ::free(pointer);
+  }
+  return (base::TimeTicks::Now() - start).InMillisecondsF() * 1e6 /
+         kNumAllocations;
+}
+
+// A frame which formats HUD text into a new stream, and collects positions
+// of balls into a new vector.
+void AllocatingFrame(ui::FrameTimingRecorder* recorder,
+                     ui::FrameTimingRecorder::LayerId layer_id) {
+  {
+    ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Physics);
+    std::vector<float> positions;
+    for (auto index = 0; index < kNumBalls; ++index)
+      positions.push_back(static_cast<float>(index));
+    sink += positions.size();
+  }
+  ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::TextLayout);
+  std::ostringstream stream;
+  stream << "frame " << recorder->frame_number() << " fps " << 59.9;
+  sink += stream.str().size();
+}
+
+// A frame which does the same in buffers allocated before.
+void ReusingFrame(ui::FrameTimingRecorder* recorder,
+                  ui::FrameTimingRecorder::LayerId layer_id,
+                  std::vector<float>* positions, char* text,
+                  size_t text_size) {
+  {
+    ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Physics);
+    positions->clear();
+    for (auto index = 0; index < kNumBalls; ++index)
+      positions->push_back(static_cast<float>(index));
+    sink += positions->size();
+  }
+  ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::TextLayout);
+  auto const length = ::snprintf(
+      text, text_size, "frame %llu fps %.1f",
+      static_cast<unsigned long long>(recorder->frame_number()), 59.9);
+  sink += static_cast<uint64_t>(length);
+}
+
+// Checks that allocations of a phase nested in paint are counted in the
+// nested phase only.
+bool VerifyPhases() {
+  ui::FrameTimingRecorder recorder(4);
+  auto const layer_id = recorder.AddLayer("layer");
+  recorder.BeginFrame(base::TimeTicks::Now());
+  {
+    ui::ScopedFramePhase paint(&recorder, layer_id, ui::FramePhase::Paint);
+    Allocate(4);
+    {
+      ui::ScopedFramePhase text(&recorder, layer_id,
+                                ui::FramePhase::TextLayout);
+      Allocate(100);
+      Allocate(200);
+    }
+  }
+  auto const& paint = recorder.AllocationsOf(0, ui::FramePhase::Paint);
+  auto const& text = recorder.AllocationsOf(0, ui::FramePhase::TextLayout);
+  std::ostringstream csv;
+  recorder.WriteCsv(&csv);
+  return paint.num_allocations == 1 && paint.num_bytes == 4 &&
+         paint.num_frees == 1 && text.num_allocations == 2 &&
+         text.num_bytes == 300 && text.num_frees == 2 &&
+         csv.str().find(",total,allocations,allocated_bytes\n") !=
+             std::string::npos &&
+         csv.str().find(",3,304\n") != std::string::npos;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_frames = argc >= 2 ? atoi(argv[1]) : 100000;
+  auto const tracker = base::AllocationTracker::instance();
+  auto failed = false;
+  if (!VerifyPhases()) {
+    printf("FAILED: wrong allocations of phases\n");
+    failed = true;
+  }
+
+  printf("%-20s %10s\n", "allocation", "ns");
+  printf("%-20s %10.1f\n", "malloc", MeasureMalloc());
+  printf("%-20s %10.1f\n", "new, counting", MeasureNew());
+  tracker->set_capture_stacks(true);
+  printf("%-20s %10.1f\n", "new, with stacks", MeasureNew());
+  tracker->set_capture_stacks(false);
+  tracker->ClearSites();
+
+  std::cout << num_frames << " steady state frames" << std::endl;
+  ui::FrameTimingRecorder recorder(4096);
+  auto const layer_id = recorder.AddLayer("hud");
+  std::vector<float> positions;
+  char text[100];
+  // Warms up, so buffers have their sizes.
+  recorder.BeginFrame(base::TimeTicks::Now());
+  AllocatingFrame(&recorder, layer_id);
+  ReusingFrame(&recorder, layer_id, &positions, text, sizeof(text));
+
+  printf("%-20s %10s %10s %12s %10s %10s\n", "frame", "ns", "allocs",
+         "bytes", "physics", "disallowed");
+  uint64_t num_disallowed[2];
+  for (auto reusing = 0; reusing < 2; ++reusing) {
+    auto const disallowed_before = tracker->num_disallowed_allocations();
+    auto const counts_before = base::AllocationTracker::counts();
+    auto const start = base::TimeTicks::Now();
+    for (auto frame = 0; frame < num_frames; ++frame) {
+      recorder.BeginFrame(base::TimeTicks::Now());
+      base::ScopedDisallowAllocation disallow_allocation;
+      if (reusing)
+        ReusingFrame(&recorder, layer_id, &positions, text, sizeof(text));
+      else
+        AllocatingFrame(&recorder, layer_id);
+    }
+    auto const frame_ns = (base::TimeTicks::Now() - start)
+        .InMillisecondsF() * 1e6 / num_frames;
+    auto const counts_after = base::AllocationTracker::counts();
+    num_disallowed[reusing] = tracker->num_disallowed_allocations() -
+                              disallowed_before;
+    // Allocations of physics phase of the last frame.
+    auto const& physics = recorder.AllocationsOf(recorder.size() - 1,
+                                                 ui::FramePhase::Physics);
+    printf("%-20s %10.0f %10.1f %12.1f %10llu %10llu\n",
+           reusing ? "reusing buffers" : "stream and vector", frame_ns,
+           static_cast<double>(counts_after.num_allocations -
+                               counts_before.num_allocations) / num_frames,
+           static_cast<double>(counts_after.num_bytes -
+                               counts_before.num_bytes) / num_frames,
+           static_cast<unsigned long long>(physics.num_allocations),
+           static_cast<unsigned long long>(num_disallowed[reusing]));
+  }
+  std::ostringstream sites;
+  tracker->WriteSites(&sites, 3);
+  std::cout << sites.str();
+  if (num_disallowed[1]) {
+    printf("FAILED: steady state frame allocates\n");
+    failed = true;
+  }
+  // Functions in an anonymous namespace have no dynamic symbols.
+#if defined(__linux__)
+  auto const has_stack = sites.str().find("  #1 std::") != std::string::npos;
+#else
+  auto const has_stack = sites.str().find("  #1 ") != std::string::npos;
+#endif
+  if (!num_disallowed[0] || !has_stack) {
+    printf("FAILED: allocations of frame aren't caught\n");
+    failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
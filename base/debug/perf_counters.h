@@ -0,0 +1,179 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_debug_perf_counters_h)
+#define INCLUDE_base_debug_perf_counters_h
+
+namespace base {
+
+enum class PerfCounter {
+  Cycles,
+  Instructions,
+  CacheMisses,
+  BranchMisses,
+};
+
+const int kNumPerfCounters = static_cast<int>(PerfCounter::BranchMisses) + 1;
+
+struct PerfCounts {
+  uint64_t values[kNumPerfCounters];
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// PerfCounters
+// Hardware counters of the thread calling |Open()|, in a perf_event_open
+// group, counting user mode only, as perf_event_paranoid 2 allows. Counters
+// of a group are scheduled together, so ratios of them, e.g. instructions
+// per cycle, are meaningful. When the kernel multiplexes more groups than
+// the PMU has counters, counts are scaled by time the group ran.
+//
+// Counters which can't be opened, e.g. in a virtual machine without PMU,
+// without permission or on Windows, read as zero; |IsAvailable()| tells
+// which ones. Last level cache misses are counted as "cache misses".
+//
+// A read is a system call, about a microsecond.
+//
+class PerfCounters final {
+  // Index of each counter in values of a read, or -1.
+  private: int indexes_[kNumPerfCounters];
+  private: int error_number_;
+  private: int fds_[kNumPerfCounters];
+  private: int num_counters_;
+
+  public: PerfCounters();
+  public: ~PerfCounters();
+
+  public: bool available() const { return num_counters_ > 0; }
+  // errno of the first counter which can't be opened, or 0.
+  public: int error_number() const { return error_number_; }
+
+  public: void Close();
+  public: bool IsAvailable(PerfCounter counter) const;
+  public: static const char* NameOf(PerfCounter counter);
+  // Returns false if no counter is available.
+  public: bool Open();
+  // Sets counts since |Open()|, or zero if not available.
+  public: bool Read(PerfCounts* counts) const;
+
+  DISALLOW_COPY_AND_ASSIGN(PerfCounters);
+};
+
+PerfCounters::PerfCounters() : error_number_(0), num_counters_(0) {
+  for (auto index = 0; index < kNumPerfCounters; ++index) {
+    fds_[index] = -1;
+    indexes_[index] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+void PerfCounters::Close() {
+#if defined(__linux__)
+  for (auto& fd : fds_) {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+#endif
+  for (auto& index : indexes_)
+    index = -1;
+  num_counters_ = 0;
+}
+
+bool PerfCounters::IsAvailable(PerfCounter counter) const {
+  return indexes_[static_cast<int>(counter)] >= 0;
+}
+
+const char* PerfCounters::NameOf(PerfCounter counter) {
+  static const char* const kNames[] = {
+    "cycles", "instructions", "cache_misses", "branch_misses",
+  };
+  return kNames[static_cast<int>(counter)];
+}
+
+bool PerfCounters::Open() {
+  Close();
+  error_number_ = 0;
+#if defined(__linux__)
+  static const uint64_t kConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+  };
+  // The first counter opened leads the group.
+  auto leader_fd = -1;
+  for (auto counter = 0; counter < kNumPerfCounters; ++counter) {
+    perf_event_attr attr;
+    ::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = kConfigs[counter];
+    attr.disabled = leader_fd < 0;
+    attr.exclude_hv = 1;
+    attr.exclude_kernel = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    auto const fd = static_cast<int>(::syscall(__NR_perf_event_open, &attr,
+                                               0, -1, leader_fd, 0));
+    if (fd < 0) {
+      if (!error_number_)
+        error_number_ = errno;
+      continue;
+    }
+    if (leader_fd < 0)
+      leader_fd = fd;
+    fds_[counter] = fd;
+    indexes_[counter] = num_counters_++;
+  }
+  if (leader_fd < 0)
+    return false;
+  ::ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool PerfCounters::Read(PerfCounts* counts) const {
+  for (auto& value : counts->values)
+    value = 0;
+  if (!available())
+    return false;
+#if defined(__linux__)
+  // nr, time_enabled, time_running and values of counters.
+  uint64_t data[3 + kNumPerfCounters];
+  auto leader_fd = -1;
+  for (auto const fd : fds_) {
+    if (fd >= 0) {
+      leader_fd = fd;
+      break;
+    }
+  }
+  if (::read(leader_fd, data, sizeof(data)) <
+      static_cast<ssize_t>(sizeof(uint64_t) * (3 + num_counters_))) {
+    return false;
+  }
+  auto const enabled = data[1];
+  auto const running = data[2];
+  if (!running)
+    return true;
+  for (auto counter = 0; counter < kNumPerfCounters; ++counter) {
+    auto const index = indexes_[counter];
+    if (index < 0)
+      continue;
+    auto const value = data[3 + index];
+    counts->values[counter] = running == enabled ? value :
+        static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_debug_perf_counters_h)
@@ -0,0 +1,565 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_debug_sampling_profiler_linux_h)
+#define INCLUDE_base_debug_sampling_profiler_linux_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// CallTree
+// Stacks of functions merged into a tree, written as CSV of the call tree
+// view of the Visual Studio profiler, which profiling/calltree2dot.py
+// reads:
+//  Level,Function Name,Inclusive Samples,Exclusive Samples,
+//  Inclusive Samples %,Exclusive Samples %,Module Name
+// Level 0 is the root, e.g. the program, and callees follow their caller
+// one level deeper, in order of inclusive samples.
+//
+class CallTree final {
+  public: typedef int FunctionId;
+
+  private: struct Function {
+    std::string module;
+    std::string name;
+  };
+
+  private: struct Node {
+    std::vector<int> children;
+    FunctionId function_id;
+    uint64_t exclusive;
+    uint64_t inclusive;
+  };
+
+  // Node of a function called by a node.
+  private: std::map<std::pair<int, FunctionId>, int> callees_;
+  private: std::vector<Function> functions_;
+  private: std::vector<Node> nodes_;
+
+  // |name| and |module| are written in level 0 row.
+  public: CallTree(const std::string& name, const std::string& module);
+  public: ~CallTree() = default;
+
+  public: uint64_t num_samples() const { return nodes_[0].inclusive; }
+
+  public: FunctionId AddFunction(const std::string& name,
+                                 const std::string& module);
+  // Adds a sample of |function_ids| from the outermost caller to the
+  // function where the sample was taken.
+  public: void AddStack(const FunctionId* function_ids, size_t size);
+  public: void WriteCsv(std::ostream* stream) const;
+
+  private: void WriteNode(std::ostream* stream, int node_index,
+                          int level) const;
+
+  DISALLOW_COPY_AND_ASSIGN(CallTree);
+};
+
+CallTree::CallTree(const std::string& name, const std::string& module) {
+  functions_.push_back(Function{module, name});
+  nodes_.push_back(Node{std::vector<int>(), 0, 0, 0});
+}
+
+CallTree::FunctionId CallTree::AddFunction(const std::string& name,
+                                           const std::string& module) {
+  functions_.push_back(Function{module, name});
+  return static_cast<FunctionId>(functions_.size() - 1);
+}
+
+void CallTree::AddStack(const FunctionId* function_ids, size_t size) {
+  auto node_index = 0;
+  ++nodes_[0].inclusive;
+  for (auto index = 0u; index < size; ++index) {
+    auto const key = std::make_pair(node_index, function_ids[index]);
+    auto const it = callees_.find(key);
+    if (it != callees_.end()) {
+      node_index = it->second;
+    } else {
+      auto const callee_index = static_cast<int>(nodes_.size());
+      nodes_.push_back(Node{std::vector<int>(), function_ids[index], 0, 0});
+      nodes_[node_index].children.push_back(callee_index);
+      callees_[key] = callee_index;
+      node_index = callee_index;
+    }
+    ++nodes_[node_index].inclusive;
+  }
+  ++nodes_[node_index].exclusive;
+}
+
+void CallTree::WriteCsv(std::ostream* stream) const {
+  *stream << "Level,Function Name,Inclusive Samples,Exclusive Samples," <<
+      "Inclusive Samples %,Exclusive Samples %,Module Name" << std::endl;
+  auto const flags = stream->flags();
+  auto const precision = stream->precision();
+  stream->setf(std::ios::fixed, std::ios::floatfield);
+  stream->precision(2);
+  WriteNode(stream, 0, 0);
+  stream->flags(flags);
+  stream->precision(precision);
+}
+
+void CallTree::WriteNode(std::ostream* stream, int node_index,
+                         int level) const {
+  auto const& node = nodes_[node_index];
+  auto const& function = functions_[node.function_id];
+  auto const total = static_cast<double>(std::max(num_samples(),
+                                                  static_cast<uint64_t>(1)));
+  *stream << level << ",";
+  WriteCsvField(stream, function.name);
+  *stream << "," << node.inclusive << "," << node.exclusive << "," <<
+      node.inclusive * 100 / total << "," << node.exclusive * 100 / total <<
+      ",";
+  WriteCsvField(stream, function.module);
+  *stream << std::endl;
+  auto children = node.children;
+  std::stable_sort(children.begin(), children.end(), [this](int a, int b) {
+    return nodes_[a].inclusive > nodes_[b].inclusive;
+  });
+  for (auto const child : children)
+    WriteNode(stream, child, level + 1);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ElfSymbolTable
+// Function symbols in .symtab of an ELF file, or .dynsym if it is
+// stripped, since dladdr() only knows exported symbols and doesn't know
+// functions of an executable linked without -rdynamic.
+//
+class ElfSymbolTable final {
+  public: struct Symbol {
+    std::string name;
+    // Addresses in the file, which are relative to the load address for
+    // shared libraries and position independent executables.
+    uintptr_t start;
+    uintptr_t end;
+  };
+
+  private: bool is_relocatable_;
+  // Sorted by |start|.
+  private: std::vector<Symbol> symbols_;
+
+  public: ElfSymbolTable();
+  public: ~ElfSymbolTable() = default;
+
+  // Returns address of |symbol| in the file loaded at |base|.
+  public: uintptr_t AddressOf(uintptr_t base, const Symbol& symbol) const {
+    return is_relocatable_ ? base + symbol.start : symbol.start;
+  }
+  // Returns the function at |address| of the file loaded at |base|, or
+  // null.
+  public: const Symbol* Find(uintptr_t base, uintptr_t address) const;
+  public: bool Load(const char* file_name);
+
+  private: void LoadSymbols(const uint8_t* data, size_t size,
+                            const ElfW(Shdr)& section,
+                            const ElfW(Shdr)& strings);
+
+  DISALLOW_COPY_AND_ASSIGN(ElfSymbolTable);
+};
+
+ElfSymbolTable::ElfSymbolTable() : is_relocatable_(true) {
+}
+
+const ElfSymbolTable::Symbol* ElfSymbolTable::Find(uintptr_t base,
+                                                   uintptr_t address) const {
+  auto const offset = is_relocatable_ ? address - base : address;
+  auto const it = std::upper_bound(
+      symbols_.begin(), symbols_.end(), offset,
+      [](uintptr_t offset, const Symbol& symbol) {
+        return offset < symbol.start;
+      });
+  if (it == symbols_.begin())
+    return nullptr;
+  auto const symbol = &*(it - 1);
+  return offset < symbol->end ? symbol : nullptr;
+}
+
+bool ElfSymbolTable::Load(const char* file_name) {
+  auto const fd = ::open(file_name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat stat_buffer;
+  auto const mapped = ::fstat(fd, &stat_buffer) ? MAP_FAILED :
+      ::mmap(nullptr, static_cast<size_t>(stat_buffer.st_size), PROT_READ,
+             MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return false;
+  auto const data = static_cast<const uint8_t*>(mapped);
+  auto const size = static_cast<size_t>(stat_buffer.st_size);
+  auto const header = reinterpret_cast<const ElfW(Ehdr)*>(data);
+  if (size < sizeof(*header) || ::memcmp(header->e_ident, ELFMAG, SELFMAG) ||
+      header->e_shoff + header->e_shnum * sizeof(ElfW(Shdr)) > size) {
+    ::munmap(mapped, size);
+    return false;
+  }
+  is_relocatable_ = header->e_type == ET_DYN;
+  auto const sections = reinterpret_cast<const ElfW(Shdr)*>(
+      data + header->e_shoff);
+  for (auto const type : {SHT_SYMTAB, SHT_DYNSYM}) {
+    for (auto index = 0; index < header->e_shnum; ++index) {
+      auto const& section = sections[index];
+      if (section.sh_type != static_cast<ElfW(Word)>(type) ||
+          section.sh_link >= header->e_shnum) {
+        continue;
+      }
+      LoadSymbols(data, size, section, sections[section.sh_link]);
+    }
+    if (!symbols_.empty())
+      break;
+  }
+  ::munmap(mapped, size);
+  std::sort(symbols_.begin(), symbols_.end(),
+            [](const Symbol& a, const Symbol& b) {
+              return a.start < b.start;
+            });
+  return !symbols_.empty();
+}
+
+void ElfSymbolTable::LoadSymbols(const uint8_t* data, size_t size,
+                                 const ElfW(Shdr)& section,
+                                 const ElfW(Shdr)& strings) {
+  if (section.sh_offset + section.sh_size > size ||
+      strings.sh_offset + strings.sh_size > size) {
+    return;
+  }
+  auto const elf_symbols = reinterpret_cast<const ElfW(Sym)*>(
+      data + section.sh_offset);
+  auto const num_symbols = section.sh_size / sizeof(ElfW(Sym));
+  auto const string_data = reinterpret_cast<const char*>(
+      data + strings.sh_offset);
+  for (auto index = 0u; index < num_symbols; ++index) {
+    auto const& elf_symbol = elf_symbols[index];
+    if (ELF64_ST_TYPE(elf_symbol.st_info) != STT_FUNC ||
+        !elf_symbol.st_value || elf_symbol.st_name >= strings.sh_size) {
+      continue;
+    }
+    Symbol symbol;
+    symbol.name.assign(string_data + elf_symbol.st_name,
+                       ::strnlen(string_data + elf_symbol.st_name,
+                                 strings.sh_size - elf_symbol.st_name));
+    symbol.start = static_cast<uintptr_t>(elf_symbol.st_value);
+    symbol.end = symbol.start + std::max(
+        static_cast<uintptr_t>(elf_symbol.st_size), static_cast<uintptr_t>(1));
+    symbols_.push_back(symbol);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SamplingProfiler
+// Samples stacks of running threads by SIGPROF of ITIMER_PROF, which ticks
+// by CPU time of the process, and keeps them in a buffer allocated at
+// construction. The signal handler only walks frame pointers and copies
+// return addresses, since it must be async-signal-safe. |WriteCsv()|
+// symbolizes and merges samples into |CallTree|.
+//
+// Code should be compiled with -fno-omit-frame-pointer, and with
+// -fno-optimize-sibling-calls to keep callers of tail calls. The caller of
+// a sampled function without frame, e.g. a leaf function, is taken from
+// the return address if it calls the function directly. A stack ends at
+// a library built without frame pointers, e.g. libc.
+//
+// The kernel checks ITIMER_PROF at its tick, so samples are at most
+// CONFIG_HZ a second, e.g. 250 or 1000, of each CPU.
+//
+// Only one profiler can run at a time, on x86-64 or ARM64.
+//
+class SamplingProfiler final {
+  public: static const int kMaxDepth = 64;
+#if defined(__x86_64__)
+  private: static const uintptr_t kCallSize = 5;
+#else
+  private: static const uintptr_t kCallSize = 4;
+#endif
+
+  private: struct Sample {
+    int depth;
+    // Address of the sampled instruction, then return addresses.
+    uintptr_t frames[kMaxDepth];
+    // Return address if the sampled function has no frame, e.g. a leaf
+    // function or a function in its prologue: the top of the stack on
+    // x86-64, or the link register on ARM64. |MergeTo()| takes it if it
+    // follows a call of the sampled function.
+    uintptr_t leaf_return;
+  };
+
+  private: static std::atomic<SamplingProfiler*> current_;
+  // Number of signal handlers running.
+  private: static std::atomic<int> num_handlers_;
+  // Stack of the current thread, cached by |RegisterCurrentThread()|, since
+  // signal handlers can't ask pthread for it. Frames are walked only in
+  // it, so garbage in the frame pointer of code built without frame
+  // pointers isn't dereferenced.
+  private: static thread_local uintptr_t stack_end_;
+  private: static thread_local uintptr_t stack_start_;
+
+  private: std::atomic<uint64_t> num_dropped_;
+  private: std::atomic<size_t> num_samples_;
+  private: std::vector<Sample> samples_;
+
+  // |capacity| is number of samples to keep, e.g. one minute at 1 kHz.
+  public: explicit SamplingProfiler(size_t capacity);
+  public: ~SamplingProfiler();
+
+  // Number of samples dropped after the buffer is full.
+  public: uint64_t num_dropped() const { return num_dropped_.load(); }
+  public: size_t num_samples() const;
+
+  // Clears samples taken before.
+  public: void Clear();
+  // Returns true if the instruction before |return_address| calls |target|.
+  private: static bool IsCallTo(uintptr_t return_address, uintptr_t target);
+  // Merges samples into |call_tree|.
+  public: void MergeTo(CallTree* call_tree) const;
+  private: static void OnSignal(int signal, siginfo_t* info, void* context);
+  private: void RecordSample(const void* context);
+  // Lets samples of the current thread have callers. |Start()| registers
+  // its thread, and other threads to profile register themselves. Samples
+  // of unregistered threads have the sampled function and its caller only.
+  public: static void RegisterCurrentThread();
+  // Starts sampling |frequency| times a second of CPU time.
+  public: void Start(int frequency);
+  // Stops sampling, and waits for running signal handlers.
+  public: void Stop();
+  // Writes samples as CSV of |CallTree|, of which level 0 is |root_name|.
+  public: void WriteCsv(std::ostream* stream,
+                        const std::string& root_name) const;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+std::atomic<SamplingProfiler*> SamplingProfiler::current_;
+std::atomic<int> SamplingProfiler::num_handlers_;
+thread_local uintptr_t SamplingProfiler::stack_end_;
+thread_local uintptr_t SamplingProfiler::stack_start_;
+
+SamplingProfiler::SamplingProfiler(size_t capacity)
+    : num_dropped_(0), num_samples_(0), samples_(capacity) {
+  DCHECK(capacity);
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  if (current_.load() == this)
+    Stop();
+}
+
+size_t SamplingProfiler::num_samples() const {
+  return std::min(num_samples_.load(), samples_.size());
+}
+
+void SamplingProfiler::Clear() {
+  DCHECK(current_.load() != this);
+  num_dropped_ = 0;
+  num_samples_ = 0;
+}
+
+bool SamplingProfiler::IsCallTo(uintptr_t return_address, uintptr_t target) {
+  auto const call = reinterpret_cast<const uint8_t*>(return_address -
+                                                     kCallSize);
+#if defined(__x86_64__)
+  // CALL rel32
+  int32_t offset;
+  ::memcpy(&offset, call + 1, sizeof(offset));
+  return call[0] == 0xE8 &&
+         return_address + static_cast<intptr_t>(offset) == target;
+#else
+  // BL imm26
+  uint32_t instruction;
+  ::memcpy(&instruction, call, sizeof(instruction));
+  auto const offset = static_cast<int32_t>(instruction << 6) >> 6;
+  return (instruction & 0xFC000000) == 0x94000000 &&
+         reinterpret_cast<uintptr_t>(call) +
+             static_cast<intptr_t>(offset) * 4 == target;
+#endif
+}
+
+void SamplingProfiler::MergeTo(CallTree* call_tree) const {
+  struct Location {
+    CallTree::FunctionId function_id;
+    // Address of the function, or |address| if it is unknown.
+    uintptr_t start;
+  };
+  std::unordered_map<uintptr_t, Location> address_map;
+  std::unordered_map<uintptr_t, CallTree::FunctionId> function_map;
+  std::unordered_map<std::string, std::unique_ptr<ElfSymbolTable>> tables;
+  auto const symbolize = [&](uintptr_t address) {
+    auto const it = address_map.find(address);
+    if (it != address_map.end())
+      return it->second;
+    Dl_info info = Dl_info();
+    ::dladdr(reinterpret_cast<void*>(address), &info);
+    auto const base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+    std::string file_name(info.dli_fname ? info.dli_fname : "");
+    auto const slash = file_name.rfind('/');
+    auto const module = file_name.empty() ? std::string("[unknown]") :
+        slash == std::string::npos ? file_name : file_name.substr(slash + 1);
+    auto& table = tables[file_name];
+    if (!table) {
+      table.reset(new ElfSymbolTable());
+      // The main program may be named relative to the working directory
+      // at start.
+      if (!table->Load(file_name.c_str()) && base)
+        table->Load("/proc/self/exe");
+    }
+    std::string name;
+    Location location = {0, address};
+    if (auto const symbol = table->Find(base, address)) {
+      name = symbol->name;
+      location.start = table->AddressOf(base, *symbol);
+    } else if (info.dli_sname) {
+      name = info.dli_sname;
+      location.start = reinterpret_cast<uintptr_t>(info.dli_saddr);
+    } else {
+      std::ostringstream stream;
+      stream << module << "+0x" << std::hex << address - base;
+      name = stream.str();
+    }
+    auto const function_it = function_map.find(location.start);
+    if (function_it != function_map.end()) {
+      location.function_id = function_it->second;
+    } else {
+      auto status = 0;
+      auto const demangled = abi::__cxa_demangle(name.c_str(), nullptr,
+                                                 nullptr, &status);
+      if (demangled) {
+        name = demangled;
+        ::free(demangled);
+      }
+      location.function_id = call_tree->AddFunction(name, module);
+      function_map[location.start] = location.function_id;
+    }
+    address_map[address] = location;
+    return location;
+  };
+
+  std::vector<CallTree::FunctionId> function_ids;
+  for (auto index = 0u; index < num_samples(); ++index) {
+    auto const& sample = samples_[index];
+    function_ids.clear();
+    for (auto depth = sample.depth - 1; depth > 0; --depth)
+      function_ids.push_back(symbolize(sample.frames[depth]).function_id);
+    // The caller of a function without frame, which |frames| skips.
+    auto const leaf = symbolize(sample.frames[0]);
+    if (sample.leaf_return) {
+      auto const caller = symbolize(sample.leaf_return - 1);
+      if (caller.start + kCallSize <= sample.leaf_return &&
+          IsCallTo(sample.leaf_return, leaf.start) &&
+          (function_ids.empty() ||
+           function_ids.back() != caller.function_id)) {
+        function_ids.push_back(caller.function_id);
+      }
+    }
+    function_ids.push_back(leaf.function_id);
+    call_tree->AddStack(function_ids.data(), function_ids.size());
+  }
+}
+
+void SamplingProfiler::OnSignal(int, siginfo_t*, void* context) {
+  // |Stop()| waits for |num_handlers_| after resetting |current_|.
+  num_handlers_.fetch_add(1);
+  if (auto const profiler = current_.load())
+    profiler->RecordSample(context);
+  num_handlers_.fetch_sub(1);
+}
+
+// Called in the signal handler. Return addresses point after calls; we
+// take one before, to stay in the caller.
+void SamplingProfiler::RecordSample(const void* context) {
+  auto const index = num_samples_.fetch_add(1, std::memory_order_relaxed);
+  if (index >= samples_.size()) {
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto const& machine = static_cast<const ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+  auto const pc = static_cast<uintptr_t>(machine.gregs[REG_RIP]);
+  auto fp = static_cast<uintptr_t>(machine.gregs[REG_RBP]);
+  auto const sp = static_cast<uintptr_t>(machine.gregs[REG_RSP]);
+  auto const leaf_return = *reinterpret_cast<const uintptr_t*>(sp);
+#elif defined(__aarch64__)
+  auto const pc = static_cast<uintptr_t>(machine.pc);
+  auto fp = static_cast<uintptr_t>(machine.regs[29]);
+  auto const sp = static_cast<uintptr_t>(machine.sp);
+  auto const leaf_return = static_cast<uintptr_t>(machine.regs[30]);
+#else
+#error "SamplingProfiler doesn't know registers of this CPU."
+#endif
+  auto& sample = samples_[index];
+  sample.frames[0] = pc;
+  sample.leaf_return = leaf_return;
+  auto depth = 1;
+  // A frame has the caller's frame pointer and the return address. Frames
+  // are aligned and go up the stack toward |stack_end_|.
+  auto const low = std::max(sp, stack_start_);
+  while (depth < kMaxDepth && fp >= low && !(fp % sizeof(uintptr_t)) &&
+         fp < stack_end_ && stack_end_ - fp >= 2 * sizeof(uintptr_t)) {
+    auto const frame = reinterpret_cast<const uintptr_t*>(fp);
+    if (!frame[1])
+      break;
+    sample.frames[depth++] = frame[1] - 1;
+    if (frame[0] <= fp)
+      break;
+    fp = frame[0];
+  }
+  sample.depth = depth;
+}
+
+void SamplingProfiler::RegisterCurrentThread() {
+  pthread_attr_t attributes;
+  if (::pthread_getattr_np(::pthread_self(), &attributes))
+    return;
+  void* address = nullptr;
+  size_t size = 0;
+  if (!::pthread_attr_getstack(&attributes, &address, &size)) {
+    stack_start_ = reinterpret_cast<uintptr_t>(address);
+    stack_end_ = stack_start_ + size;
+  }
+  ::pthread_attr_destroy(&attributes);
+}
+
+// The signal handler stays installed after |Stop()|, since SIGPROF of a
+// pending tick would terminate the process by default action.
+void SamplingProfiler::Start(int frequency) {
+  DCHECK(frequency > 0);
+  SamplingProfiler* expected = nullptr;
+  auto const started = current_.compare_exchange_strong(expected, this);
+  DCHECK(started);
+  RegisterCurrentThread();
+  struct sigaction action = {};
+  action.sa_sigaction = &SamplingProfiler::OnSignal;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  auto const result = ::sigaction(SIGPROF, &action, nullptr);
+  DCHECK_EQ(result, 0);
+  auto const interval = std::max(1000000 / frequency, 1);
+  itimerval timer = {};
+  timer.it_interval.tv_sec = interval / 1000000;
+  timer.it_interval.tv_usec = interval % 1000000;
+  timer.it_value = timer.it_interval;
+  auto const timer_result = ::setitimer(ITIMER_PROF, &timer, nullptr);
+  DCHECK_EQ(timer_result, 0);
+}
+
+void SamplingProfiler::Stop() {
+  itimerval timer = {};
+  auto const result = ::setitimer(ITIMER_PROF, &timer, nullptr);
+  DCHECK_EQ(result, 0);
+  current_.store(nullptr);
+  while (num_handlers_.load())
+    std::this_thread::yield();
+}
+
+void SamplingProfiler::WriteCsv(std::ostream* stream,
+                                const std::string& root_name) const {
+  CallTree call_tree(root_name, root_name);
+  MergeTo(&call_tree);
+  call_tree.WriteCsv(stream);
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_debug_sampling_profiler_linux_h)
@@ -0,0 +1,307 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Profiles frames which paint three times as long as they step physics,
+// on two threads, with |base::SamplingProfiler| at 100 Hz and 1 kHz, and
+// reports cost of a sample and frames run with and without profiling.
+// Writes the call tree of 1 kHz for profiling/calltree2dot.py if a file
+// name is given.
+//
+// Returns EXIT_FAILURE if CSV of a known call tree is wrong, or samples
+// don't attribute about three quarters of frames to painting, in a call
+// tree which doesn't add up. Crashes if the profiler walks a garbage frame
+// pointer out of the stack.
+//
+// Compile by using:
+//  g++ -std=c++11 -O2 -fno-omit-frame-pointer -fno-optimize-sibling-calls
+//      -pthread -I. base/debug/sampling_profiler_linux_benchmark.cc -ldl
+//
+// Usage: sampling_profiler_linux_benchmark [milliseconds] [csv_file]
+//  python profiling/calltree2dot.py csv_file sampling_profiler_linux_benchmark
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cxxabi.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/strings/csv.h"
+#include "base/debug/sampling_profiler_linux.h"
+#include "base/test/random.h"
+
+namespace {
+
+const int kWorkPerFrame = 4000;
+
+// Keeps the compiler from removing work.
+std::atomic<uint32_t> sink;
+
+__attribute__((noinline)) uint32_t Work(uint32_t seed, int count) {
+  for (auto index = 0; index < count; ++index)
+    base::NextRandom(&seed);
+  return seed;
+}
+
+__attribute__((noinline)) uint32_t PaintFrame(uint32_t seed) {
+  return Work(seed, kWorkPerFrame * 3);
+}
+
+__attribute__((noinline)) uint32_t StepPhysics(uint32_t seed) {
+  return Work(seed, kWorkPerFrame);
+}
+
+__attribute__((noinline)) uint32_t RunFrame(uint32_t seed) {
+  return PaintFrame(StepPhysics(seed));
+}
+
+// Runs frames for |milliseconds| on each of |num_threads| threads, and
+// returns number of frames.
+uint64_t RunFrames(int milliseconds, int num_threads) {
+  std::atomic<uint64_t> num_frames(0);
+  std::vector<std::thread> threads;
+  for (auto index = 0; index < num_threads; ++index) {
+    threads.push_back(std::thread([milliseconds, &num_frames, index]() {
+      base::SamplingProfiler::RegisterCurrentThread();
+      auto const end = base::TimeTicks::Now() +
+          base::TimeDelta::FromMilliseconds(milliseconds);
+      auto seed = static_cast<uint32_t>(index);
+      uint64_t count = 0;
+      while (base::TimeTicks::Now() < end) {
+        seed = RunFrame(seed);
+        ++count;
+      }
+      sink += seed;
+      num_frames += count;
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  return num_frames;
+}
+
+// Takes a sample while the frame pointer points 4 MB above the stack
+// pointer, beyond the stack, as code built without frame pointers may
+// leave it. The profiler crashes if it walks there.
+__attribute__((noinline)) void RaiseWithGarbageFramePointer() {
+#if defined(__x86_64__)
+  asm volatile(
+      "mov %%rsp, %%r12\n"
+      "and $-16, %%rsp\n"
+      "push %%rbp\n"
+      "sub $8, %%rsp\n"
+      "lea 0x400000(%%rsp), %%rbp\n"
+      "and $-16, %%rbp\n"
+      "mov %0, %%edi\n"
+      "call raise@PLT\n"
+      "add $8, %%rsp\n"
+      "pop %%rbp\n"
+      "mov %%r12, %%rsp\n"
+      : : "i"(SIGPROF)
+      : "rax", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12",
+        "memory", "cc");
+#endif
+}
+
+struct Row {
+  int level;
+  std::string name;
+  uint64_t inclusive;
+  uint64_t exclusive;
+};
+
+// Parses CSV of |base::CallTree|, which quotes names and modules only.
+bool ParseCsv(const std::string& text, std::vector<Row>* rows) {
+  std::istringstream stream(text);
+  std::string line;
+  std::getline(stream, line);
+  if (line != "Level,Function Name,Inclusive Samples,Exclusive Samples,"
+              "Inclusive Samples %,Exclusive Samples %,Module Name") {
+    return false;
+  }
+  while (std::getline(stream, line)) {
+    Row row;
+    auto const comma = line.find(',');
+    if (comma == std::string::npos || line[comma + 1] != '"')
+      return false;
+    row.level = atoi(line.substr(0, comma).c_str());
+    auto position = comma + 2;
+    for (;;) {
+      auto const quote = line.find('"', position);
+      if (quote == std::string::npos)
+        return false;
+      row.name += line.substr(position, quote - position);
+      if (line[quote + 1] != '"') {
+        position = quote + 2;
+        break;
+      }
+      row.name += '"';
+      position = quote + 2;
+    }
+    std::istringstream numbers(line.substr(position));
+    char comma1, comma2;
+    numbers >> row.inclusive >> comma1 >> row.exclusive >> comma2;
+    if (!numbers || comma1 != ',' || comma2 != ',')
+      return false;
+    rows->push_back(row);
+  }
+  return !rows->empty();
+}
+
+// Checks CSV of a known call tree, with a recursive function and a name to
+// quote.
+bool VerifyCallTree() {
+  base::CallTree call_tree("root", "root.exe");
+  auto const main_id = call_tree.AddFunction("main", "root.exe");
+  auto const paint_id = call_tree.AddFunction("Paint", "root.exe");
+  auto const map_id = call_tree.AddFunction("std::map<int, \"a\">::find",
+                                            "libc.so");
+  const base::CallTree::FunctionId stacks[][3] = {
+    {main_id, paint_id, paint_id},
+    {main_id, paint_id, map_id},
+    {main_id, paint_id, paint_id},
+    {main_id, map_id, -1},
+  };
+  for (auto const& stack : stacks)
+    call_tree.AddStack(stack, stack[2] < 0 ? 2 : 3);
+  std::ostringstream csv;
+  call_tree.WriteCsv(&csv);
+  return csv.str() ==
+      "Level,Function Name,Inclusive Samples,Exclusive Samples,"
+      "Inclusive Samples %,Exclusive Samples %,Module Name\n"
+      "0,\"root\",4,0,100.00,0.00,\"root.exe\"\n"
+      "1,\"main\",4,0,100.00,0.00,\"root.exe\"\n"
+      "2,\"Paint\",3,0,75.00,0.00,\"root.exe\"\n"
+      "3,\"Paint\",2,2,50.00,50.00,\"root.exe\"\n"
+      "3,\"std::map<int, \"\"a\"\">::find\",1,1,25.00,25.00,\"libc.so\"\n"
+      "2,\"std::map<int, \"\"a\"\">::find\",1,1,25.00,25.00,\"libc.so\"\n";
+}
+
+// Checks that |rows| add up, and paint takes about three quarters of
+// frames under |RunFrame()|.
+bool VerifySamples(const std::vector<Row>& rows) {
+  if (rows.front().level)
+    return false;
+  uint64_t paint = 0;
+  uint64_t step = 0;
+  uint64_t exclusive = 0;
+  // Names of callers of the current row.
+  std::vector<std::string> callers;
+  for (auto index = 0u; index < rows.size(); ++index) {
+    auto const& row = rows[index];
+    exclusive += row.exclusive;
+    if (index && (row.level <= 0 || row.level > rows[index - 1].level + 1))
+      return false;
+    callers.resize(static_cast<size_t>(row.level));
+    // Inclusive samples are exclusive samples and samples of callees.
+    auto callees = row.exclusive;
+    for (auto child = index + 1;
+         child < rows.size() && rows[child].level > row.level; ++child) {
+      if (rows[child].level == row.level + 1)
+        callees += rows[child].inclusive;
+    }
+    if (callees != row.inclusive)
+      return false;
+    auto const in_frame = !callers.empty() &&
+        callers.back().find("RunFrame") != std::string::npos;
+    if (in_frame && row.name.find("PaintFrame") != std::string::npos)
+      paint += row.inclusive;
+    if (in_frame && row.name.find("StepPhysics") != std::string::npos)
+      step += row.inclusive;
+    callers.push_back(row.name);
+  }
+  if (exclusive != rows.front().inclusive || !paint || !step)
+    return false;
+  auto const ratio = static_cast<double>(paint) / (paint + step);
+  printf("paint %llu step %llu samples, paint %.1f%%\n",
+         static_cast<unsigned long long>(paint),
+         static_cast<unsigned long long>(step), ratio * 100);
+  return ratio > 0.65 && ratio < 0.85;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const milliseconds = argc >= 2 ? atoi(argv[1]) : 2000;
+  auto const num_threads = 2;
+  std::cout << milliseconds << " ms of frames on " << num_threads <<
+      " threads" << std::endl;
+
+  auto failed = false;
+  if (!VerifyCallTree()) {
+    printf("FAILED: wrong CSV of call tree\n");
+    failed = true;
+  }
+
+  // Cost of a sample is a signal and a walk of frames.
+  auto const kNumSignals = 100000;
+  base::SamplingProfiler profiler(kNumSignals);
+  profiler.Start(1);
+  auto const signal_start = base::TimeTicks::Now();
+  for (auto count = 0; count < kNumSignals; ++count)
+    ::raise(SIGPROF);
+  auto const signal_ns = (base::TimeTicks::Now() - signal_start)
+      .InMillisecondsF() * 1e6 / kNumSignals;
+  profiler.Stop();
+  printf("%-20s %10.0f ns\n", "cost of sample", signal_ns);
+  profiler.Clear();
+  profiler.Start(1);
+  RaiseWithGarbageFramePointer();
+  profiler.Stop();
+
+  auto const base_frames = RunFrames(milliseconds, num_threads);
+  printf("%-20s %10s %10s %10s\n", "profiler", "frames", "samples",
+         "dropped");
+  printf("%-20s %10llu\n", "none",
+         static_cast<unsigned long long>(base_frames));
+  std::string csv_text;
+  for (auto const frequency : {100, 1000}) {
+    profiler.Clear();
+    profiler.Start(frequency);
+    auto const num_frames = RunFrames(milliseconds, num_threads);
+    profiler.Stop();
+    printf("%-17d Hz %10llu %10u %10llu\n", frequency,
+           static_cast<unsigned long long>(num_frames),
+           static_cast<unsigned>(profiler.num_samples()),
+           static_cast<unsigned long long>(profiler.num_dropped()));
+    std::ostringstream csv;
+    profiler.WriteCsv(&csv, "sampling_profiler_linux_benchmark");
+    csv_text = csv.str();
+  }
+
+  std::vector<Row> rows;
+  if (!ParseCsv(csv_text, &rows) || !VerifySamples(rows)) {
+    printf("FAILED: samples don't match frames\n");
+    failed = true;
+  }
+  if (argc >= 3) {
+    std::ofstream stream(argv[2]);
+    stream << csv_text;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
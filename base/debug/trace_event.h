@@ -0,0 +1,270 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_debug_trace_event_h)
+#define INCLUDE_base_debug_trace_event_h
+
+// Records the enclosing scope as a complete event of |category| and |name|,
+// which must be string literals, while tracing is enabled:
+//  void Compositor::Commit() {
+//    TRACE_EVENT0("ui", "Compositor::Commit");
+//    ...
+//  }
+// Define |DISABLE_TRACE_EVENTS| to compile out trace events.
+#if defined(DISABLE_TRACE_EVENTS)
+#define TRACE_EVENT0(category, name)
+#else
+#define TRACE_EVENT_CONCAT_(a, b) a ## b
+#define TRACE_EVENT_CONCAT(a, b) TRACE_EVENT_CONCAT_(a, b)
+#define TRACE_EVENT0(category, name) \
+  ::base::ScopedTraceEvent TRACE_EVENT_CONCAT(trace_event_, __LINE__)( \
+      category, name)
+#endif
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// TraceEvent
+// Complete event, "ph":"X" in Chrome trace format.
+//
+struct TraceEvent {
+  const char* category;
+  // In units of |TraceLog::Now()|.
+  uint64_t duration;
+  const char* name;
+  uint64_t start;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// TraceBuffer
+// Ring buffer of the last |kCapacity| - 1 events of a thread. Only the
+// owner thread writes, and a reader copies events without locks; it reads
+// |num_events_| before and after copying, and drops events which the
+// writer may have overwritten meanwhile. The slot of the next event may be
+// being written, so it isn't read.
+//
+class TraceBuffer final {
+  public: static const size_t kCapacity = 1 << 16;
+
+  private: std::vector<TraceEvent> events_;
+  private: std::atomic<uint64_t> num_events_;
+  private: int thread_id_;
+
+  public: explicit TraceBuffer(int thread_id);
+  public: ~TraceBuffer() = default;
+
+  public: int thread_id() const { return thread_id_; }
+
+  public: void Add(const TraceEvent& event);
+  // Appends the last |kCapacity| - 1 events at most to |events| in order
+  // of recording.
+  public: void CopyTo(std::vector<TraceEvent>* events) const;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBuffer);
+};
+
+TraceBuffer::TraceBuffer(int thread_id)
+    : events_(kCapacity), num_events_(0), thread_id_(thread_id) {
+}
+
+void TraceBuffer::Add(const TraceEvent& event) {
+  auto const index = num_events_.load(std::memory_order_relaxed);
+  events_[index & (kCapacity - 1)] = event;
+  num_events_.store(index + 1, std::memory_order_release);
+}
+
+void TraceBuffer::CopyTo(std::vector<TraceEvent>* events) const {
+  auto const end = num_events_.load(std::memory_order_acquire);
+  auto const start = end + 1 > kCapacity ? end + 1 - kCapacity : 0;
+  auto const size = events->size();
+  for (auto index = start; index < end; ++index)
+    events->push_back(events_[index & (kCapacity - 1)]);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  // Events before |overwritten| may be overwritten while copying, including
+  // the event in the slot of |new_end|, which the writer may be writing.
+  auto const new_end = num_events_.load(std::memory_order_relaxed);
+  auto const overwritten = new_end + 1 > kCapacity ? new_end + 1 - kCapacity :
+                                                     0;
+  if (overwritten <= start)
+    return;
+  auto const num_dropped = static_cast<size_t>(
+      std::min(overwritten, end) - start);
+  events->erase(events->begin() + size, events->begin() + size + num_dropped);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// TraceLog
+// Owns |TraceBuffer| of each thread which recorded events. A thread takes
+// the lock only to create its buffer at its first event. Buffers live
+// until exit, so threads can exit while tracing.
+//
+// A disabled trace event costs a relaxed load and a branch. Enabled events
+// take time stamps from the CPU time stamp counter, and are converted to
+// |TimeTicks| at export, by the rate of the counter since tracing was
+// enabled. The counter is the cheapest clock with sub-microsecond
+// resolution; on a 2.1 GHz Xeon VM, a read takes 24 ns against 42 ns of
+// |clock_gettime()|, and an enabled event adds 50-60 ns, mostly for its
+// two reads.
+//
+class TraceLog final {
+  private: std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+  private: std::atomic<bool> enabled_;
+  private: std::mutex mutex_;
+  // |Now()| and |TimeTicks::Now()| when tracing was enabled.
+  private: uint64_t origin_timestamp_;
+  private: TimeTicks origin_time_;
+
+  private: TraceLog();
+  public: ~TraceLog() = default;
+
+  public: static TraceLog* instance();
+  public: bool enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  public: void Add(const TraceEvent& event);
+  // Returns CPU time stamp counter, or microseconds of |TimeTicks| on CPUs
+  // without it.
+  public: static uint64_t Now();
+  public: void SetEnabled(bool enabled);
+  // Writes recorded events in Chrome trace JSON, which chrome://tracing and
+  // Perfetto load. Can be called while other threads record.
+  public: void WriteJson(std::ostream* stream);
+
+  private: TraceBuffer* CreateBuffer();
+  private: static void WriteString(std::ostream* stream, const char* string);
+
+  DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+TraceLog::TraceLog() : enabled_(false), origin_timestamp_(0) {
+}
+
+TraceLog* TraceLog::instance() {
+  static TraceLog instance;
+  return &instance;
+}
+
+void TraceLog::Add(const TraceEvent& event) {
+  static thread_local TraceBuffer* buffer;
+  if (!buffer)
+    buffer = CreateBuffer();
+  buffer->Add(event);
+}
+
+TraceBuffer* TraceLog::CreateBuffer() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffers_.push_back(std::unique_ptr<TraceBuffer>(
+      new TraceBuffer(static_cast<int>(buffers_.size() + 1))));
+  return buffers_.back().get();
+}
+
+uint64_t TraceLog::Now() {
+#if defined(_M_X64) || defined(_M_IX86)
+  return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return static_cast<uint64_t>(
+      (TimeTicks::Now() - TimeTicks()).InMicroseconds());
+#endif
+}
+
+void TraceLog::SetEnabled(bool enabled) {
+  if (enabled && !origin_timestamp_) {
+    origin_time_ = TimeTicks::Now();
+    origin_timestamp_ = Now();
+  }
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceLog::WriteJson(std::ostream* stream) {
+  std::vector<std::pair<int, std::vector<TraceEvent>>> threads;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto const& buffer : buffers_) {
+      threads.push_back(std::make_pair(buffer->thread_id(),
+                                       std::vector<TraceEvent>()));
+      buffer->CopyTo(&threads.back().second);
+    }
+  }
+  auto const elapsed = static_cast<double>(
+      (TimeTicks::Now() - origin_time_).InMicroseconds());
+  auto const num_ticks = static_cast<double>(Now() - origin_timestamp_);
+  auto const microseconds_per_tick = num_ticks > 0 ? elapsed / num_ticks :
+                                                     1.0;
+  auto const origin = static_cast<double>(
+      (origin_time_ - TimeTicks()).InMicroseconds());
+  auto const flags = stream->flags();
+  auto const precision = stream->precision();
+  stream->setf(std::ios::fixed, std::ios::floatfield);
+  stream->precision(3);
+  *stream << "{\"traceEvents\":[";
+  auto separator = "\n";
+  for (auto const& thread : threads) {
+    for (auto const& event : thread.second) {
+      *stream << separator << "{\"cat\":";
+      WriteString(stream, event.category);
+      *stream << ",\"name\":";
+      WriteString(stream, event.name);
+      auto const start = origin + microseconds_per_tick *
+          (static_cast<double>(event.start) -
+           static_cast<double>(origin_timestamp_));
+      *stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.first <<
+          ",\"ts\":" << start << ",\"dur\":" <<
+          microseconds_per_tick * static_cast<double>(event.duration) << "}";
+      separator = ",\n";
+    }
+  }
+  *stream << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+  stream->flags(flags);
+  stream->precision(precision);
+}
+
+void TraceLog::WriteString(std::ostream* stream, const char* string) {
+  *stream << '"';
+  for (auto runner = string; *runner; ++runner) {
+    if (*runner == '"' || *runner == '\\')
+      *stream << '\\';
+    *stream << *runner;
+  }
+  *stream << '"';
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ScopedTraceEvent
+// Used by |TRACE_EVENT0()|.
+//
+class ScopedTraceEvent final {
+  private: TraceEvent event_;
+
+  public: ScopedTraceEvent(const char* category, const char* name);
+  public: ~ScopedTraceEvent();
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+ScopedTraceEvent::ScopedTraceEvent(const char* category, const char* name) {
+  event_.name = nullptr;
+  if (!TraceLog::instance()->enabled())
+    return;
+  event_.category = category;
+  event_.name = name;
+  event_.start = TraceLog::Now();
+}
+
+ScopedTraceEvent::~ScopedTraceEvent() {
+  if (!event_.name)
+    return;
+  event_.duration = TraceLog::Now() - event_.start;
+  TraceLog::instance()->Add(event_);
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_debug_trace_event_h)
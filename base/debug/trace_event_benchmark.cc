@@ -0,0 +1,209 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures cost of |TRACE_EVENT0()| per event while tracing is disabled
+// and enabled, on several threads, against events appended to a shared
+// vector under a mutex. Then exports JSON while threads record.
+//
+// Returns EXIT_FAILURE if a buffer doesn't keep its last events in order,
+// events being overwritten while copying are exported,
+// or exported JSON doesn't have an event per recorded event.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\debug\trace_event_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. base/debug/trace_event_benchmark.cc
+//
+// Usage: trace_event_benchmark [num_events] [num_threads]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/debug/trace_event.h"
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+//
+// MutexTraceLog
+// Appends events to a vector under a mutex.
+//
+class MutexTraceLog final {
+  private: std::vector<base::TraceEvent> events_;
+  private: std::mutex mutex_;
+
+  public: MutexTraceLog() = default;
+  public: ~MutexTraceLog() = default;
+
+  public: void Add(const char* category, const char* name,
+                   base::TimeTicks start);
+
+  DISALLOW_COPY_AND_ASSIGN(MutexTraceLog);
+};
+
+void MutexTraceLog::Add(const char* category, const char* name,
+                        base::TimeTicks start) {
+  base::TraceEvent event;
+  event.category = category;
+  event.name = name;
+  event.start = static_cast<uint64_t>(
+      (start - base::TimeTicks()).InMicroseconds());
+  event.duration = static_cast<uint64_t>(
+      (base::TimeTicks::Now() - start).InMicroseconds());
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back(event);
+}
+
+// Keeps the compiler from removing empty scopes.
+std::atomic<int> counter;
+
+// Returns nanoseconds per event of running |function| on |num_threads|
+// threads, |num_events| times each.
+template<typename Function>
+double Measure(int num_threads, int num_events, const Function& function) {
+  auto const start = base::TimeTicks::Now();
+  std::vector<std::thread> threads;
+  for (auto index = 0; index < num_threads; ++index) {
+    threads.push_back(std::thread([num_events, &function]() {
+      for (auto count = 0; count < num_events; ++count)
+        function();
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  return (base::TimeTicks::Now() - start).InMillisecondsF() * 1e6 /
+         num_threads / num_events;
+}
+
+size_t CountOf(const std::string& text, const std::string& pattern) {
+  auto count = 0u;
+  for (auto position = text.find(pattern); position != std::string::npos;
+       position = text.find(pattern, position + pattern.size())) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_events = argc >= 2 ? atoi(argv[1]) : 2000000;
+  auto const num_threads = argc >= 3 ? atoi(argv[2]) : 4;
+  std::cout << num_events << " events on " << num_threads << " threads" <<
+      std::endl;
+
+  auto const trace_log = base::TraceLog::instance();
+  auto const disabled = Measure(num_threads, num_events, []() {
+    TRACE_EVENT0("benchmark", "Disabled");
+    counter.fetch_add(1, std::memory_order_relaxed);
+  });
+  trace_log->SetEnabled(true);
+  auto const enabled = Measure(num_threads, num_events, []() {
+    TRACE_EVENT0("benchmark", "Enabled");
+    counter.fetch_add(1, std::memory_order_relaxed);
+  });
+  trace_log->SetEnabled(false);
+  MutexTraceLog mutex_log;
+  auto const mutex = Measure(num_threads, num_events, [&mutex_log]() {
+    auto const start = base::TimeTicks::Now();
+    counter.fetch_add(1, std::memory_order_relaxed);
+    mutex_log.Add("benchmark", "Mutex", start);
+  });
+  printf("%-20s %10s\n", "trace event", "ns/event");
+  printf("%-20s %10.1f\n", "disabled", disabled);
+  printf("%-20s %10.1f\n", "enabled", enabled);
+  printf("%-20s %10.1f\n", "mutex and vector", mutex);
+
+  auto failed = false;
+
+  // A buffer keeps the last |kCapacity| events in order.
+  base::TraceBuffer buffer(1);
+  auto const kCapacity = static_cast<uint64_t>(base::TraceBuffer::kCapacity);
+  for (auto index = static_cast<uint64_t>(0); index < kCapacity * 3 / 2;
+       ++index) {
+    base::TraceEvent event = {"test", 0, "Event", index};
+    buffer.Add(event);
+  }
+  std::vector<base::TraceEvent> events;
+  buffer.CopyTo(&events);
+  failed |= events.size() != base::TraceBuffer::kCapacity - 1;
+  for (auto index = 0u; index < events.size(); ++index)
+    failed |= events[index].start != kCapacity / 2 + 1 + index;
+  if (failed)
+    printf("FAILED: buffer doesn't keep the last events in order\n");
+
+  // Copy while another thread fills the buffer. Events have the same start
+  // and duration, and copied events follow each other, unless an event
+  // being overwritten is copied.
+  {
+    base::TraceBuffer shared(2);
+    std::atomic<bool> done(false);
+    std::thread writer([&shared, &done]() {
+      for (auto index = static_cast<uint64_t>(0); !done; ++index) {
+        base::TraceEvent event = {"test", index, "Event", index};
+        shared.Add(event);
+      }
+    });
+    auto torn = false;
+    for (auto count = 0; count < 200; ++count) {
+      events.clear();
+      shared.CopyTo(&events);
+      for (auto index = 0u; index < events.size(); ++index) {
+        torn |= events[index].start != events[index].duration ||
+                (index && events[index].start != events[index - 1].start + 1);
+      }
+    }
+    done = true;
+    writer.join();
+    if (torn) {
+      printf("FAILED: events being overwritten are copied\n");
+      failed = true;
+    }
+  }
+
+  // Export while other threads record. Exported events of a thread are in
+  // order, and a thread recording fewer events than a buffer loses none.
+  trace_log->SetEnabled(true);
+  std::atomic<bool> done(false);
+  std::thread writer([&done]() {
+    while (!done)
+      TRACE_EVENT0("benchmark", "Writer");
+  });
+  std::ostringstream concurrent;
+  trace_log->WriteJson(&concurrent);
+  done = true;
+  writer.join();
+  std::thread([]() {
+    for (auto count = 0; count < 1000; ++count)
+      TRACE_EVENT0("benchmark", "Last\"Thread\"");
+  }).join();
+  trace_log->SetEnabled(false);
+  std::ostringstream json;
+  trace_log->WriteJson(&json);
+  auto const text = json.str();
+  if (CountOf(text, "\"name\":\"Last\\\"Thread\\\"\"") != 1000 ||
+      CountOf(text, "{\"cat\"") != CountOf(text, "\"ph\":\"X\"") ||
+      text.compare(0, 16, "{\"traceEvents\":[") ||
+      CountOf(concurrent.str(), "\"ph\":\"X\"") < 1) {
+    printf("FAILED: exported JSON doesn't have recorded events\n");
+    failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
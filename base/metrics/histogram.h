@@ -0,0 +1,316 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_metrics_histogram_h)
+#define INCLUDE_base_metrics_histogram_h
+
+namespace base {
+
+class HistogramSnapshot;
+
+//////////////////////////////////////////////////////////////////////
+//
+// HistogramBuckets
+// Log-linear buckets, as HDR histogram. Values below |kNumSubBuckets| have
+// their own buckets, and each power of two above is split into
+// |kNumSubBuckets / 2| buckets, so a bucket is within 1/128 of its values
+// up to 2^|kMaxValueBits|, e.g. 12 days in microseconds. Larger values
+// are counted in the last bucket.
+//
+class HistogramBuckets final {
+  public: static const int kSubBucketBits = 8;
+  public: static const int kMaxValueBits = 40;
+  public: static const size_t kNumSubBuckets = 1 << kSubBucketBits;
+  public: static const size_t kNumBuckets =
+      kNumSubBuckets + (kMaxValueBits - kSubBucketBits) * kNumSubBuckets / 2;
+
+  public: static size_t BucketOf(int64_t value);
+  // Returns the largest value counted in |bucket|.
+  public: static int64_t HighestValueOf(size_t bucket);
+  public: static int64_t LowestValueOf(size_t bucket);
+
+  private: static int FindLastSet(uint64_t value);
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramBuckets);
+};
+
+size_t HistogramBuckets::BucketOf(int64_t value) {
+  if (value < static_cast<int64_t>(kNumSubBuckets))
+    return value < 0 ? 0 : static_cast<size_t>(value);
+  auto const shift = FindLastSet(static_cast<uint64_t>(value)) -
+                     kSubBucketBits + 1;
+  if (shift > kMaxValueBits - kSubBucketBits)
+    return kNumBuckets - 1;
+  auto const mantissa = static_cast<size_t>(value >> shift);
+  return kNumSubBuckets + (shift - 1) * kNumSubBuckets / 2 +
+         mantissa - kNumSubBuckets / 2;
+}
+
+int64_t HistogramBuckets::HighestValueOf(size_t bucket) {
+  if (bucket + 1 == kNumBuckets)
+    return std::numeric_limits<int64_t>::max();
+  return LowestValueOf(bucket + 1) - 1;
+}
+
+int64_t HistogramBuckets::LowestValueOf(size_t bucket) {
+  if (bucket < kNumSubBuckets)
+    return static_cast<int64_t>(bucket);
+  auto const shift = (bucket - kNumSubBuckets) / (kNumSubBuckets / 2) + 1;
+  auto const mantissa = (bucket - kNumSubBuckets) % (kNumSubBuckets / 2) +
+                        kNumSubBuckets / 2;
+  return static_cast<int64_t>(mantissa) << shift;
+}
+
+int HistogramBuckets::FindLastSet(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return static_cast<int>(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Histogram
+// Streaming quantiles of non-negative integer values, e.g. frame times in
+// microseconds, in fixed memory of |HistogramBuckets::kNumBuckets|
+// counters. |Record()| is lock-free and wait-free except for updating
+// minimum and maximum, so any thread can record into a shared histogram.
+//
+// Readers take a |HistogramSnapshot|, which can be merged with snapshots
+// of other threads and of previous runs. A snapshot taken while recording
+// sees each count, but sum, minimum and maximum may lag behind counts.
+//
+class Histogram final {
+  private: std::atomic<uint64_t> counts_[HistogramBuckets::kNumBuckets];
+  private: std::atomic<int64_t> maximum_;
+  private: std::atomic<int64_t> minimum_;
+  private: std::atomic<int64_t> sum_;
+
+  public: Histogram();
+  public: ~Histogram() = default;
+
+  public: void Merge(const HistogramSnapshot& snapshot);
+  public: void Record(int64_t value);
+  public: void Record(TimeDelta value) { Record(value.InMicroseconds()); }
+  public: void Reset();
+  public: HistogramSnapshot Snapshot() const;
+
+  DISALLOW_COPY_AND_ASSIGN(Histogram);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// HistogramSnapshot
+// Counts of a |Histogram| at a point, to compute quantiles, merge and
+// serialize. Serialized form is text, a header line and a line per
+// non-empty bucket:
+//  histogram <count> <sum> <minimum> <maximum>
+//  <bucket> <count>
+//  end
+//
+class HistogramSnapshot final {
+  private: uint64_t count_;
+  private: std::vector<uint64_t> counts_;
+  private: int64_t maximum_;
+  private: int64_t minimum_;
+  private: int64_t sum_;
+
+  public: HistogramSnapshot();
+  public: ~HistogramSnapshot() = default;
+
+  public: uint64_t count() const { return count_; }
+  public: uint64_t count_at(size_t bucket) const { return counts_[bucket]; }
+  public: bool empty() const { return !count_; }
+  public: int64_t maximum() const { return maximum_; }
+  public: double mean() const;
+  public: int64_t minimum() const { return minimum_; }
+  public: int64_t sum() const { return sum_; }
+
+  // Adds |count| values in |bucket|, for |Histogram::Snapshot()|.
+  public: void AddCount(size_t bucket, uint64_t count);
+  // Reads a snapshot written by |Serialize()|, and returns false on
+  // malformed input.
+  public: bool Deserialize(std::istream* stream);
+  public: void Merge(const HistogramSnapshot& other);
+  public: void Serialize(std::ostream* stream) const;
+  public: void SetSummary(int64_t sum, int64_t minimum, int64_t maximum);
+  // Returns the highest value of the bucket containing |quantile|, e.g.
+  // 0.99 for p99, clamped to minimum and maximum. Returns zero if empty.
+  public: int64_t ValueAtQuantile(double quantile) const;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Histogram
+//
+Histogram::Histogram() {
+  Reset();
+}
+
+void Histogram::Merge(const HistogramSnapshot& snapshot) {
+  if (snapshot.empty())
+    return;
+  for (auto bucket = 0u; bucket < HistogramBuckets::kNumBuckets; ++bucket) {
+    if (auto const count = snapshot.count_at(bucket))
+      counts_[bucket].fetch_add(count, std::memory_order_relaxed);
+  }
+  sum_.fetch_add(snapshot.sum(), std::memory_order_relaxed);
+  auto maximum = maximum_.load(std::memory_order_relaxed);
+  while (snapshot.maximum() > maximum &&
+         !maximum_.compare_exchange_weak(maximum, snapshot.maximum(),
+                                         std::memory_order_relaxed)) {
+  }
+  auto minimum = minimum_.load(std::memory_order_relaxed);
+  while (snapshot.minimum() < minimum &&
+         !minimum_.compare_exchange_weak(minimum, snapshot.minimum(),
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::Record(int64_t value) {
+  if (value < 0)
+    value = 0;
+  counts_[HistogramBuckets::BucketOf(value)].fetch_add(
+      1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  auto maximum = maximum_.load(std::memory_order_relaxed);
+  while (value > maximum &&
+         !maximum_.compare_exchange_weak(maximum, value,
+                                         std::memory_order_relaxed)) {
+  }
+  auto minimum = minimum_.load(std::memory_order_relaxed);
+  while (value < minimum &&
+         !minimum_.compare_exchange_weak(minimum, value,
+                                         std::memory_order_relaxed)) {
+  }
+}
+
+// Not safe while other threads record.
+void Histogram::Reset() {
+  for (auto& count : counts_)
+    count.store(0, std::memory_order_relaxed);
+  maximum_.store(std::numeric_limits<int64_t>::min(),
+                 std::memory_order_relaxed);
+  minimum_.store(std::numeric_limits<int64_t>::max(),
+                 std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  for (auto bucket = 0u; bucket < HistogramBuckets::kNumBuckets; ++bucket) {
+    if (auto const count = counts_[bucket].load(std::memory_order_relaxed))
+      snapshot.AddCount(bucket, count);
+  }
+  if (!snapshot.empty()) {
+    snapshot.SetSummary(sum_.load(std::memory_order_relaxed),
+                        minimum_.load(std::memory_order_relaxed),
+                        maximum_.load(std::memory_order_relaxed));
+  }
+  return snapshot;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// HistogramSnapshot
+//
+HistogramSnapshot::HistogramSnapshot()
+    : count_(0), counts_(HistogramBuckets::kNumBuckets), maximum_(0),
+      minimum_(0), sum_(0) {
+}
+
+double HistogramSnapshot::mean() const {
+  return count_ ? static_cast<double>(sum_) / count_ : 0;
+}
+
+void HistogramSnapshot::AddCount(size_t bucket, uint64_t count) {
+  counts_[bucket] += count;
+  count_ += count;
+}
+
+bool HistogramSnapshot::Deserialize(std::istream* stream) {
+  std::string keyword;
+  uint64_t count;
+  int64_t sum, minimum, maximum;
+  if (!(*stream >> keyword >> count >> sum >> minimum >> maximum) ||
+      keyword != "histogram") {
+    return false;
+  }
+  HistogramSnapshot snapshot;
+  for (;;) {
+    if (!(*stream >> keyword))
+      return false;
+    if (keyword == "end")
+      break;
+    auto const bucket = static_cast<size_t>(atoll(keyword.c_str()));
+    uint64_t bucket_count;
+    if (bucket >= HistogramBuckets::kNumBuckets ||
+        !(*stream >> bucket_count)) {
+      return false;
+    }
+    snapshot.AddCount(bucket, bucket_count);
+  }
+  if (snapshot.count_ != count)
+    return false;
+  if (count)
+    snapshot.SetSummary(sum, minimum, maximum);
+  *this = snapshot;
+  return true;
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other) {
+  if (other.empty())
+    return;
+  if (empty()) {
+    *this = other;
+    return;
+  }
+  for (auto bucket = 0u; bucket < counts_.size(); ++bucket)
+    counts_[bucket] += other.counts_[bucket];
+  count_ += other.count_;
+  maximum_ = std::max(maximum_, other.maximum_);
+  minimum_ = std::min(minimum_, other.minimum_);
+  sum_ += other.sum_;
+}
+
+void HistogramSnapshot::Serialize(std::ostream* stream) const {
+  *stream << "histogram " << count_ << " " << sum_ << " " << minimum_ <<
+      " " << maximum_ << std::endl;
+  for (auto bucket = 0u; bucket < counts_.size(); ++bucket) {
+    if (counts_[bucket])
+      *stream << bucket << " " << counts_[bucket] << std::endl;
+  }
+  *stream << "end" << std::endl;
+}
+
+void HistogramSnapshot::SetSummary(int64_t sum, int64_t minimum,
+                                   int64_t maximum) {
+  maximum_ = maximum;
+  minimum_ = minimum;
+  sum_ = sum;
+}
+
+int64_t HistogramSnapshot::ValueAtQuantile(double quantile) const {
+  if (!count_)
+    return 0;
+  auto const rank = std::min(std::max(
+      static_cast<uint64_t>(::ceil(quantile * count_)),
+      static_cast<uint64_t>(1)), count_);
+  auto seen = static_cast<uint64_t>(0);
+  for (auto bucket = 0u; bucket < counts_.size(); ++bucket) {
+    seen += counts_[bucket];
+    if (seen >= rank) {
+      return std::min(std::max(HistogramBuckets::HighestValueOf(bucket),
+                               minimum_), maximum_);
+    }
+  }
+  return maximum_;
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_metrics_histogram_h)
@@ -0,0 +1,198 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Records frame times with a long tail, a few milliseconds around 16.7 ms
+// and a slow frame in every hundred, from several threads. Compares
+// |base::Histogram| shared by all threads with a vector of samples under
+// a mutex, and reports time per record, memory and p50/p90/p99/p99.9 of
+// both.
+//
+// Returns EXIT_FAILURE if a quantile of the histogram is off by more than
+// 1/128 from the exact quantile, if merging per thread snapshots differs
+// from the shared histogram, or if a snapshot doesn't survive
+// serialization.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\metrics\histogram_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. base/metrics/histogram_benchmark.cc
+//
+// Usage: histogram_benchmark [num_samples] [num_threads]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/metrics/histogram.h"
+#include "base/test/random.h"
+
+namespace {
+
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// Returns frame time in microseconds.
+int64_t NextFrameTime(uint32_t* seed) {
+  auto const jitter = static_cast<int64_t>(base::NextRandom(seed) % 4000);
+  if (base::NextRandom(seed) % 100)
+    return 14667 + jitter;
+  return 33333 + static_cast<int64_t>(base::NextRandom(seed) % 200000);
+}
+
+std::vector<int64_t> MakeSamples(size_t num_samples, uint32_t seed) {
+  std::vector<int64_t> samples(num_samples);
+  for (auto& sample : samples)
+    sample = NextFrameTime(&seed);
+  return samples;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// VectorRecorder
+// Keeps all samples, as an exact baseline.
+//
+class VectorRecorder final {
+  private: std::mutex mutex_;
+  private: std::vector<int64_t> samples_;
+
+  public: VectorRecorder() = default;
+  public: ~VectorRecorder() = default;
+
+  public: size_t memory_size() const {
+    return samples_.capacity() * sizeof(int64_t);
+  }
+
+  public: void Record(int64_t value);
+  public: int64_t ValueAtQuantile(double quantile);
+
+  DISALLOW_COPY_AND_ASSIGN(VectorRecorder);
+};
+
+void VectorRecorder::Record(int64_t value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_.push_back(value);
+}
+
+int64_t VectorRecorder::ValueAtQuantile(double quantile) {
+  auto const rank = std::max(
+      static_cast<size_t>(::ceil(quantile * samples_.size())),
+      static_cast<size_t>(1));
+  std::nth_element(samples_.begin(), samples_.begin() + rank - 1,
+                   samples_.end());
+  return samples_[rank - 1];
+}
+
+// Returns seconds to record |samples| of each thread into |recorder|.
+template<typename Recorder>
+double Run(const std::vector<std::vector<int64_t>>& samples,
+           Recorder* recorder) {
+  auto const start = base::TimeTicks::Now();
+  std::vector<std::thread> threads;
+  for (auto const& thread_samples : samples) {
+    threads.push_back(std::thread([&thread_samples, recorder]() {
+      for (auto const sample : thread_samples)
+        recorder->Record(sample);
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  return (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_samples = argc >= 2 ?
+      static_cast<size_t>(atoi(argv[1])) : 4000000;
+  auto const num_threads = argc >= 3 ? atoi(argv[2]) : 4;
+  std::cout << num_samples << " samples from " << num_threads <<
+      " threads" << std::endl;
+
+  std::vector<std::vector<int64_t>> samples;
+  for (auto index = 0; index < num_threads; ++index) {
+    samples.push_back(MakeSamples(num_samples / num_threads,
+                                  static_cast<uint32_t>(index + 1)));
+  }
+  auto const total = samples.size() * samples.front().size();
+
+  std::unique_ptr<base::Histogram> histogram(new base::Histogram());
+  auto const histogram_seconds = Run(samples, histogram.get());
+  VectorRecorder vector;
+  auto const vector_seconds = Run(samples, &vector);
+
+  printf("%-10s %10s %10s", "recorder", "ns/record", "KB");
+  for (auto const quantile : kQuantiles)
+    printf(" %9.1f%%", quantile * 100);
+  printf("\n");
+  auto const snapshot = histogram->Snapshot();
+  printf("%-10s %10.1f %10u", "histogram", histogram_seconds * 1e9 / total,
+         static_cast<unsigned>(sizeof(base::Histogram) / 1024));
+  for (auto const quantile : kQuantiles) {
+    printf(" %10lld",
+           static_cast<long long>(snapshot.ValueAtQuantile(quantile)));
+  }
+  printf("\n");
+  printf("%-10s %10.1f %10u", "vector", vector_seconds * 1e9 / total,
+         static_cast<unsigned>(vector.memory_size() / 1024));
+  auto failed = false;
+  for (auto const quantile : kQuantiles) {
+    auto const exact = vector.ValueAtQuantile(quantile);
+    printf(" %10lld", static_cast<long long>(exact));
+    auto const error = static_cast<double>(
+        snapshot.ValueAtQuantile(quantile) - exact) / exact;
+    failed |= error < 0 || error > 1.0 / 128;
+  }
+  printf("\n");
+  if (failed)
+    printf("FAILED: quantile error is larger than 1/128\n");
+
+  // Merging per thread snapshots equals the shared histogram.
+  base::HistogramSnapshot merged;
+  for (auto const& thread_samples : samples) {
+    base::Histogram thread_histogram;
+    for (auto const sample : thread_samples)
+      thread_histogram.Record(sample);
+    merged.Merge(thread_histogram.Snapshot());
+  }
+  std::stringstream stream;
+  merged.Serialize(&stream);
+  base::HistogramSnapshot restored;
+  auto const restored_ok = restored.Deserialize(&stream);
+  for (auto bucket = 0u; bucket < base::HistogramBuckets::kNumBuckets;
+       ++bucket) {
+    failed |= merged.count_at(bucket) != snapshot.count_at(bucket) ||
+              restored.count_at(bucket) != snapshot.count_at(bucket);
+  }
+  if (!restored_ok || merged.count() != total ||
+      restored.count() != total || merged.sum() != snapshot.sum() ||
+      restored.sum() != snapshot.sum() ||
+      restored.minimum() != snapshot.minimum() ||
+      restored.maximum() != snapshot.maximum()) {
+    failed = true;
+  }
+  std::istringstream malformed("histogram 2 3 1 2\n1 1\nend\n");
+  failed |= base::HistogramSnapshot().Deserialize(&malformed);
+
+  if (failed) {
+    printf("FAILED: histogram differs from exact samples\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_metrics_sampling_h)
+#define INCLUDE_base_metrics_sampling_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// Sampling
+// Sliding window of the last |capacity| samples in a fixed size ring
+// buffer. Minimum and maximum are kept in monotonic queues of sample
+// positions, which drop samples which can never be minimum or maximum again,
+// so |AddSample()| is amortized O(1) and never allocates.
+//
+// Average and standard deviation are O(1) from running sums, which are
+// recomputed from samples once per |capacity| samples to bound rounding
+// error.
+//
+class Sampling final {
+  // Ring buffer of positions of samples in the window, whose values are
+  // monotonic from front to back, decreasing for maximum and increasing for
+  // minimum, so the front is the maximum or the minimum of the window.
+  private: class MonotonicQueue final {
+    private: size_t head_;
+    private: bool keeps_maximum_;
+    private: std::vector<size_t> positions_;
+    private: size_t size_;
+
+    public: MonotonicQueue(size_t capacity, bool keeps_maximum);
+    public: ~MonotonicQueue() = default;
+
+    public: size_t front() const { return positions_[head_]; }
+
+    // Removes |position| which leaves the window.
+    public: void Evict(size_t position);
+    public: void Push(size_t position, const std::vector<float>& samples);
+
+    DISALLOW_COPY_AND_ASSIGN(MonotonicQueue);
+  };
+
+  private: MonotonicQueue maximum_queue_;
+  private: MonotonicQueue minimum_queue_;
+  // Position of the next sample in |samples_|.
+  private: size_t position_;
+  private: std::vector<float> samples_;
+  private: size_t size_;
+  private: double sum_;
+  private: double sum_of_squares_;
+
+  public: explicit Sampling(size_t capacity);
+  public: ~Sampling() = default;
+
+  // Returns the |index|-th sample from the oldest.
+  public: float operator[](size_t index) const;
+
+  public: double average() const;
+  public: size_t capacity() const { return samples_.size(); }
+  public: bool empty() const { return !size_; }
+  public: float last() const;
+  public: float maximum() const;
+  public: float minimum() const;
+  public: size_t size() const { return size_; }
+  // Population standard deviation of samples in the window.
+  public: double standard_deviation() const;
+
+  public: void AddSample(float sample);
+
+  DISALLOW_COPY_AND_ASSIGN(Sampling);
+};
+
+Sampling::MonotonicQueue::MonotonicQueue(size_t capacity,
+                                         bool keeps_maximum)
+    : head_(0), keeps_maximum_(keeps_maximum), positions_(capacity),
+      size_(0) {
+}
+
+void Sampling::MonotonicQueue::Evict(size_t position) {
+  if (!size_ || positions_[head_] != position)
+    return;
+  head_ = head_ + 1 == positions_.size() ? 0 : head_ + 1;
+  --size_;
+}
+
+void Sampling::MonotonicQueue::Push(size_t position,
+                                    const std::vector<float>& samples) {
+  auto const capacity = positions_.size();
+  auto const sample = samples[position];
+  while (size_) {
+    auto tail = head_ + size_ - 1;
+    if (tail >= capacity)
+      tail -= capacity;
+    auto const back = samples[positions_[tail]];
+    if (keeps_maximum_ ? back > sample : back < sample)
+      break;
+    --size_;
+  }
+  auto tail = head_ + size_;
+  if (tail >= capacity)
+    tail -= capacity;
+  positions_[tail] = position;
+  ++size_;
+}
+
+Sampling::Sampling(size_t capacity)
+    : maximum_queue_(capacity, true), minimum_queue_(capacity, false),
+      position_(0), samples_(capacity), size_(0), sum_(0),
+      sum_of_squares_(0) {
+  DCHECK(capacity);
+}
+
+float Sampling::operator[](size_t index) const {
+  DCHECK(index < size_);
+  auto position = position_ + capacity() - size_ + index;
+  if (position >= capacity())
+    position -= capacity();
+  return samples_[position];
+}
+
+double Sampling::average() const {
+  return empty() ? 0 : sum_ / size_;
+}
+
+float Sampling::last() const {
+  DCHECK(!empty());
+  return samples_[position_ ? position_ - 1 : capacity() - 1];
+}
+
+float Sampling::maximum() const {
+  DCHECK(!empty());
+  return samples_[maximum_queue_.front()];
+}
+
+float Sampling::minimum() const {
+  DCHECK(!empty());
+  return samples_[minimum_queue_.front()];
+}
+
+double Sampling::standard_deviation() const {
+  if (empty())
+    return 0;
+  auto const average = this->average();
+  auto const variance = sum_of_squares_ / size_ - average * average;
+  return variance > 0 ? ::sqrt(variance) : 0;
+}
+
+void Sampling::AddSample(float sample) {
+  if (size_ == capacity()) {
+    auto const evicted = samples_[position_];
+    maximum_queue_.Evict(position_);
+    minimum_queue_.Evict(position_);
+    sum_ -= evicted;
+    sum_of_squares_ -= static_cast<double>(evicted) * evicted;
+  } else {
+    ++size_;
+  }
+  samples_[position_] = sample;
+  sum_ += sample;
+  sum_of_squares_ += static_cast<double>(sample) * sample;
+  maximum_queue_.Push(position_, samples_);
+  minimum_queue_.Push(position_, samples_);
+  if (++position_ != capacity())
+    return;
+  position_ = 0;
+  sum_ = sum_of_squares_ = 0;
+  for (auto const value : samples_) {
+    sum_ += value;
+    sum_of_squares_ += static_cast<double>(value) * value;
+  }
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_metrics_sampling_h)
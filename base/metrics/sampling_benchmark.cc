@@ -0,0 +1,198 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Adds samples to five windows, as the status layers of dtest do every
+// frame, and reads minimum, maximum and average after each sample. Compares
+// |base::Sampling| with the list based sampling it replaces, which rescans
+// all samples when the evicted sample was minimum or maximum, on random
+// samples and on decreasing samples, where every eviction rescans.
+//
+// Returns EXIT_FAILURE if minimum, maximum or average differ from a scan of
+// the window.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\metrics\sampling_benchmark.cc
+//  g++ -std=c++11 -O2 -I. base/metrics/sampling_benchmark.cc
+//
+// Usage: sampling_benchmark [num_samples] [window_size]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/metrics/sampling.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+
+namespace {
+
+const int kNumWindows = 5;
+
+//////////////////////////////////////////////////////////////////////
+//
+// ListSampling
+// |my::Sampling| before |base::Sampling|.
+//
+class ListSampling final {
+  private: float maximum_;
+  private: float minimum_;
+  private: std::list<float> samples_;
+
+  public: explicit ListSampling(size_t max_samples);
+  public: ~ListSampling() = default;
+
+  public: double average() const;
+  public: float maximum() const { return maximum_; }
+  public: float minimum() const { return minimum_; }
+
+  public: void AddSample(float sample);
+
+  DISALLOW_COPY_AND_ASSIGN(ListSampling);
+};
+
+ListSampling::ListSampling(size_t max_samples) : samples_(max_samples) {
+  maximum_ = minimum_ = samples_.front();
+}
+
+double ListSampling::average() const {
+  auto sum = 0.0;
+  for (auto const sample : samples_)
+    sum += sample;
+  return sum / samples_.size();
+}
+
+void ListSampling::AddSample(float sample) {
+  auto const discard_sample = samples_.front();
+  samples_.pop_front();
+  samples_.push_back(sample);
+  if (discard_sample != maximum_ && discard_sample != minimum_)
+    return;
+  maximum_ = minimum_ = samples_.front();
+  for (auto const sample : samples_) {
+    maximum_ = std::max(maximum_, sample);
+    minimum_ = std::min(minimum_, sample);
+  }
+}
+
+// Returns samples in milliseconds, e.g. frame durations.
+std::vector<float> MakeSamples(size_t num_samples, bool decreasing) {
+  uint32_t seed = 1;
+  std::vector<float> samples;
+  for (auto index = 0u; index < num_samples; ++index) {
+    auto const jitter =
+        static_cast<float>(base::NextRandom(&seed) % 1000) / 1000;
+    samples.push_back(decreasing ?
+        1000.0f - static_cast<float>(index % 100000) / 100 :
+        16.0f + jitter * 4);
+  }
+  return samples;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  double checksum;
+  double seconds;
+};
+
+// |average()| of |ListSampling| is a scan, as |my::Sampling::Paint()| did,
+// so it is read once per |window_size| samples, about once per paint.
+template<typename Sampling>
+Result Run(const std::vector<float>& samples, size_t window_size) {
+  std::vector<std::unique_ptr<Sampling>> windows;
+  for (auto index = 0; index < kNumWindows; ++index)
+    windows.push_back(std::unique_ptr<Sampling>(new Sampling(window_size)));
+  Result result = Result();
+  auto const start = base::TimeTicks::Now();
+  for (auto index = 0u; index < samples.size(); ++index) {
+    for (auto& window : windows) {
+      window->AddSample(samples[index]);
+      result.checksum += window->maximum() - window->minimum();
+    }
+    if (index % window_size)
+      continue;
+    for (auto& window : windows)
+      result.checksum += window->average();
+  }
+  result.seconds = (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  return result;
+}
+
+// Checks |base::Sampling| against a scan of the window after each sample.
+bool Verify(const std::vector<float>& samples, size_t window_size) {
+  base::Sampling sampling(window_size);
+  for (auto index = 0u; index < samples.size(); ++index) {
+    sampling.AddSample(samples[index]);
+    auto const begin = samples.begin() + (index + 1 > window_size ?
+                                          index + 1 - window_size : 0);
+    auto const end = samples.begin() + index + 1;
+    auto sum = 0.0;
+    for (auto it = begin; it != end; ++it)
+      sum += *it;
+    auto const average = sum / (end - begin);
+    if (sampling.size() != static_cast<size_t>(end - begin) ||
+        sampling.maximum() != *std::max_element(begin, end) ||
+        sampling.minimum() != *std::min_element(begin, end) ||
+        sampling.last() != samples[index] || sampling[0] != *begin ||
+        ::fabs(sampling.average() - average) > 1e-3) {
+      printf("sample %u: min %g max %g avg %g, expected %g %g %g\n", index,
+             sampling.minimum(), sampling.maximum(), sampling.average(),
+             *std::min_element(begin, end), *std::max_element(begin, end),
+             average);
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrintResult(const char* name, const Result& result,
+                 size_t num_samples) {
+  printf("%-24s %10.3f %10.1f\n", name, result.seconds,
+         result.seconds * 1e9 / num_samples / kNumWindows);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_samples = argc >= 2 ?
+      static_cast<size_t>(atoi(argv[1])) : 2000000;
+  auto const window_size = argc >= 3 ?
+      static_cast<size_t>(atoi(argv[2])) : 100;
+  std::cout << num_samples << " samples, " << kNumWindows << " windows of " <<
+      window_size << " samples" << std::endl;
+
+  printf("%-24s %10s %10s\n", "sampling", "seconds", "ns/sample");
+  auto failed = false;
+  for (auto const decreasing : {false, true}) {
+    auto const samples = MakeSamples(num_samples, decreasing);
+    auto const list_result = Run<ListSampling>(samples, window_size);
+    auto const ring_result = Run<base::Sampling>(samples, window_size);
+    PrintResult(decreasing ? "list, decreasing" : "list, random",
+                list_result, num_samples);
+    PrintResult(decreasing ? "ring, decreasing" : "ring, random",
+                ring_result, num_samples);
+    printf("speedup %.2fx\n", list_result.seconds / ring_result.seconds);
+    failed |= !Verify(std::vector<float>(samples.begin(),
+                                         samples.begin() +
+                                             std::min(num_samples,
+                                                      window_size * 20)),
+                      window_size);
+  }
+  if (failed) {
+    printf("FAILED: sampling differs from scan of window\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_strings_csv_h)
+#define INCLUDE_base_strings_csv_h
+
+namespace base {
+
+// Writes |field| in quotes, doubling quotes in it, as RFC 4180, since C++
+// function names, names of benchmarks and errors may have commas, quotes
+// and newlines.
+void WriteCsvField(std::ostream* stream, const std::string& field) {
+  *stream << '"';
+  for (auto const ch : field) {
+    if (ch == '"')
+      *stream << '"';
+    *stream << ch;
+  }
+  *stream << '"';
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_strings_csv_h)
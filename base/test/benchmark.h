@@ -0,0 +1,570 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_test_benchmark_h)
+#define INCLUDE_base_test_benchmark_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// BenchmarkState
+// Passed to a benchmark function, which runs its body while
+// |KeepRunning()| returns true, as Google benchmark does:
+//
+//   void BM_Foo(base::BenchmarkState* state) {
+//     auto const input = MakeInput(state->arg());
+//     while (state->KeepRunning())
+//       base::DoNotOptimize(Foo(input));
+//   }
+//   BENCHMARK(BM_Foo)->Arg(8)->Arg(64);
+//
+// Time is measured from the first |KeepRunning()| to the last one, so
+// setup before the loop isn't measured.
+//
+class BenchmarkState final {
+  private: int64_t arg_;
+  // Seconds of thread CPU time of iterations.
+  private: double cpu_time_;
+  private: double cpu_start_;
+  private: std::string error_;
+  private: int64_t items_processed_;
+  private: int64_t max_iterations_;
+  private: int64_t num_iterations_;
+  // Seconds of wall clock time of iterations.
+  private: double real_time_;
+  private: bool running_;
+  private: TimeTicks start_;
+
+  public: BenchmarkState(int64_t arg, int64_t max_iterations);
+  public: ~BenchmarkState() = default;
+
+  public: int64_t arg() const { return arg_; }
+  public: double cpu_time() const { return cpu_time_; }
+  public: const std::string& error() const { return error_; }
+  public: int64_t items_processed() const { return items_processed_; }
+  public: int64_t iterations() const { return max_iterations_; }
+  public: double real_time() const { return real_time_; }
+
+  public: bool KeepRunning();
+  // Excludes work between |PauseTiming()| and |ResumeTiming()|, e.g.
+  // resetting input, from time of iterations.
+  public: void PauseTiming();
+  public: void ResumeTiming();
+  public: void SetItemsProcessed(int64_t items_processed);
+  // Fails this benchmark, e.g. its result is wrong. |KeepRunning()|
+  // returns false after this.
+  public: void SkipWithError(const char* message);
+  private: static double ThreadCpuSeconds();
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkState);
+};
+
+BenchmarkState::BenchmarkState(int64_t arg, int64_t max_iterations)
+    : arg_(arg), cpu_time_(0), cpu_start_(0), items_processed_(0),
+      max_iterations_(max_iterations), num_iterations_(0), real_time_(0),
+      running_(false) {
+}
+
+bool BenchmarkState::KeepRunning() {
+  if (num_iterations_ == max_iterations_) {
+    PauseTiming();
+    return false;
+  }
+  if (!num_iterations_)
+    ResumeTiming();
+  ++num_iterations_;
+  return true;
+}
+
+void BenchmarkState::PauseTiming() {
+  if (!running_)
+    return;
+  real_time_ += (TimeTicks::Now() - start_).InMillisecondsF() / 1000;
+  cpu_time_ += ThreadCpuSeconds() - cpu_start_;
+  running_ = false;
+}
+
+void BenchmarkState::ResumeTiming() {
+  DCHECK(!running_);
+  running_ = true;
+  cpu_start_ = ThreadCpuSeconds();
+  start_ = TimeTicks::Now();
+}
+
+void BenchmarkState::SetItemsProcessed(int64_t items_processed) {
+  items_processed_ = items_processed;
+}
+
+void BenchmarkState::SkipWithError(const char* message) {
+  error_ = message;
+  max_iterations_ = num_iterations_;
+}
+
+double BenchmarkState::ThreadCpuSeconds() {
+#if defined(_WIN32)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  ::GetThreadTimes(::GetCurrentThread(), &creation_time, &exit_time,
+                   &kernel_time, &user_time);
+  ULARGE_INTEGER kernel, user;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  // FILETIME is in 100 nanoseconds.
+  return static_cast<double>(kernel.QuadPart + user.QuadPart) / 1e7;
+#else
+  timespec now;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<double>(now.tv_sec) +
+         static_cast<double>(now.tv_nsec) / 1e9;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Benchmark
+// A registered benchmark function, run once for each argument, or once
+// without argument.
+//
+class Benchmark final {
+  public: typedef void (*Function)(BenchmarkState* state);
+
+  private: std::vector<int64_t> args_;
+  private: Function function_;
+  private: std::string name_;
+
+  public: Benchmark(const char* name, Function function);
+  public: ~Benchmark() = default;
+
+  public: const std::vector<int64_t>& args() const { return args_; }
+  public: Function function() const { return function_; }
+  public: const std::string& name() const { return name_; }
+
+  public: Benchmark* Arg(int64_t arg);
+  public: static std::vector<Benchmark*>* benchmarks();
+  public: static Benchmark* Register(const char* name, Function function);
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+Benchmark::Benchmark(const char* name, Function function)
+    : function_(function), name_(name) {
+}
+
+Benchmark* Benchmark::Arg(int64_t arg) {
+  args_.push_back(arg);
+  return this;
+}
+
+// Registered benchmarks live until exit.
+std::vector<Benchmark*>* Benchmark::benchmarks() {
+  static std::vector<Benchmark*> benchmarks;
+  return &benchmarks;
+}
+
+Benchmark* Benchmark::Register(const char* name, Function function) {
+  auto const benchmark = new Benchmark(name, function);
+  benchmarks()->push_back(benchmark);
+  return benchmark;
+}
+
+#define BENCHMARK_NAME2(name, line) name ## line
+#define BENCHMARK_NAME(name, line) BENCHMARK_NAME2(name, line)
+#define BENCHMARK(function) \
+  static base::Benchmark* const BENCHMARK_NAME(benchmark_, __LINE__) = \
+      base::Benchmark::Register(#function, function)
+
+// Keeps the compiler from removing computation of |value|.
+template<typename T>
+void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  *reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// BenchmarkResult
+// Time per iteration of a repetition, or mean, median or standard
+// deviation of repetitions.
+//
+struct BenchmarkResult {
+  // "mean", "median" or "stddev", or empty for a repetition.
+  std::string aggregate;
+  // Other values, e.g. 99th percentile of frame times, written as more
+  // fields of JSON as user counters of Google benchmark.
+  std::vector<std::pair<std::string, double>> counters;
+  // Nanoseconds
+  double cpu_time;
+  std::string error;
+  double items_per_second;
+  int64_t iterations;
+  std::string name;
+  // Nanoseconds
+  double real_time;
+  int repetition;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// BenchmarkRunner
+// Runs registered benchmarks. Each runs as many iterations as take
+// --benchmark_min_time seconds, found by growing iterations up to ten times
+// a run. Results are written to stdout and to a file, in the JSON format of
+// Google benchmark, so tools which read it work on ours:
+//
+//  --benchmark_filter=<text>       runs benchmarks whose name contains it.
+//  --benchmark_format=console|csv|json
+//  --benchmark_list_tests          lists names of benchmarks.
+//  --benchmark_min_time=<seconds>  defaults to 0.5.
+//  --benchmark_out=<file>
+//  --benchmark_out_format=csv|json defaults to json.
+//  --benchmark_repetitions=<n>     adds mean, median and stddev for n > 1.
+//
+class BenchmarkRunner final {
+  private: static const int64_t kMaxIterations = 1000000000;
+
+  private: std::string executable_;
+  private: std::string filter_;
+  private: std::string format_;
+  private: bool list_tests_;
+  private: double min_time_;
+  private: std::string out_;
+  private: std::string out_format_;
+  private: int repetitions_;
+  private: std::vector<BenchmarkResult> results_;
+
+  public: BenchmarkRunner();
+  public: ~BenchmarkRunner() = default;
+
+  public: const std::string& format() const { return format_; }
+  public: int repetitions() const { return repetitions_; }
+  public: const std::vector<BenchmarkResult>& results() const {
+    return results_;
+  }
+
+  private: void AddAggregates(size_t start);
+  // Adds repetitions measured by the caller, e.g. frames of a scene, and
+  // their aggregates.
+  public: void AddResults(const std::vector<BenchmarkResult>& repetitions);
+  // Returns false for unknown flags.
+  public: bool Init(int argc, char** argv);
+  // Writes results in --benchmark_format to stdout, except console which is
+  // written while running, and to --benchmark_out. Returns EXIT_FAILURE if
+  // a benchmark fails.
+  public: int Report();
+  // Runs registered benchmarks and reports them.
+  public: int Run();
+  private: void RunBenchmark(const Benchmark& benchmark,
+                             const std::string& name, int64_t arg);
+  private: void WriteConsole(size_t start) const;
+  public: void WriteCsv(std::ostream* stream) const;
+  public: void WriteJson(std::ostream* stream) const;
+  private: static void WriteJsonString(std::ostream* stream,
+                                       const std::string& text);
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkRunner);
+};
+
+BenchmarkRunner::BenchmarkRunner()
+    : format_("console"), list_tests_(false), min_time_(0.5),
+      out_format_("json"), repetitions_(1) {
+}
+
+// Adds aggregates of repetitions from |results_[start]|.
+void BenchmarkRunner::AddAggregates(size_t start) {
+  auto const end = results_.size();
+  BenchmarkResult aggregates[3];
+  const char* const kNames[] = {"mean", "median", "stddev"};
+  for (auto index = 0; index < 3; ++index) {
+    aggregates[index] = results_[start];
+    aggregates[index].aggregate = kNames[index];
+    aggregates[index].repetition = -1;
+  }
+  // Sets aggregates of a value which |field| returns.
+  auto const aggregate = [&](
+      const std::function<double*(BenchmarkResult* result)>& field) {
+    std::vector<double> values;
+    for (auto index = start; index < end; ++index)
+      values.push_back(*field(&results_[index]));
+    std::sort(values.begin(), values.end());
+    auto const count = values.size();
+    auto sum = 0.0;
+    for (auto const value : values)
+      sum += value;
+    auto const mean = sum / count;
+    auto sum_of_squares = 0.0;
+    for (auto const value : values)
+      sum_of_squares += (value - mean) * (value - mean);
+    *field(&aggregates[0]) = mean;
+    *field(&aggregates[1]) = count % 2 ? values[count / 2] :
+        (values[count / 2 - 1] + values[count / 2]) / 2;
+    *field(&aggregates[2]) = ::sqrt(sum_of_squares / (count - 1));
+  };
+  aggregate([](BenchmarkResult* result) { return &result->cpu_time; });
+  aggregate([](BenchmarkResult* result) {
+    return &result->items_per_second;
+  });
+  aggregate([](BenchmarkResult* result) { return &result->real_time; });
+  for (auto counter = 0u; counter < aggregates[0].counters.size();
+       ++counter) {
+    aggregate([=](BenchmarkResult* result) {
+      return &result->counters[counter].second;
+    });
+  }
+  results_.insert(results_.end(), aggregates, aggregates + 3);
+}
+
+void BenchmarkRunner::AddResults(
+    const std::vector<BenchmarkResult>& repetitions) {
+  auto const start = results_.size();
+  results_.insert(results_.end(), repetitions.begin(), repetitions.end());
+  if (repetitions.size() < 2)
+    return;
+  for (auto const& result : repetitions) {
+    if (!result.error.empty())
+      return;
+  }
+  AddAggregates(start);
+}
+
+bool BenchmarkRunner::Init(int argc, char** argv) {
+  executable_ = argv[0];
+  for (auto index = 1; index < argc; ++index) {
+    std::string arg(argv[index]);
+    auto const equal = arg.find('=');
+    auto const name = arg.substr(0, equal);
+    auto const value = equal == std::string::npos ? std::string() :
+        arg.substr(equal + 1);
+    if (name == "--benchmark_filter") {
+      filter_ = value;
+    } else if (name == "--benchmark_format" &&
+               (value == "console" || value == "csv" || value == "json")) {
+      format_ = value;
+    } else if (name == "--benchmark_list_tests") {
+      list_tests_ = true;
+    } else if (name == "--benchmark_min_time" && ::atof(value.c_str()) > 0) {
+      min_time_ = ::atof(value.c_str());
+    } else if (name == "--benchmark_out" && !value.empty()) {
+      out_ = value;
+    } else if (name == "--benchmark_out_format" &&
+               (value == "csv" || value == "json")) {
+      out_format_ = value;
+    } else if (name == "--benchmark_repetitions" &&
+               ::atoi(value.c_str()) > 0) {
+      repetitions_ = ::atoi(value.c_str());
+    } else {
+      std::cerr << "Unknown or invalid flag: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int BenchmarkRunner::Report() {
+  if (format_ == "csv")
+    WriteCsv(&std::cout);
+  else if (format_ == "json")
+    WriteJson(&std::cout);
+  auto failed = false;
+  if (!out_.empty()) {
+    std::ofstream out(out_);
+    if (out_format_ == "csv")
+      WriteCsv(&out);
+    else
+      WriteJson(&out);
+    if (!out) {
+      std::cerr << "Can't write " << out_ << std::endl;
+      failed = true;
+    }
+  }
+  for (auto const& result : results_) {
+    if (!result.error.empty())
+      failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int BenchmarkRunner::Run() {
+  if (format_ == "console" && !list_tests_) {
+    std::cout << std::thread::hardware_concurrency() << " cpus, " <<
+#if defined(NDEBUG)
+        "release" <<
+#else
+        "debug" <<
+#endif
+        " build" << std::endl;
+    printf("%-32s %12s %12s %12s %14s\n", "benchmark", "iterations",
+           "real ns", "cpu ns", "items/s");
+  }
+  for (auto const benchmark : *Benchmark::benchmarks()) {
+    std::vector<int64_t> args(benchmark->args());
+    if (args.empty())
+      args.push_back(0);
+    for (auto const arg : args) {
+      std::ostringstream name;
+      name << benchmark->name();
+      if (!benchmark->args().empty())
+        name << "/" << arg;
+      if (name.str().find(filter_) == std::string::npos)
+        continue;
+      if (list_tests_) {
+        std::cout << name.str() << std::endl;
+        continue;
+      }
+      RunBenchmark(*benchmark, name.str(), arg);
+    }
+  }
+  return Report();
+}
+
+void BenchmarkRunner::RunBenchmark(const Benchmark& benchmark,
+                                   const std::string& name, int64_t arg) {
+  auto const start = results_.size();
+  std::vector<BenchmarkResult> repetitions;
+  auto iterations = static_cast<int64_t>(1);
+  for (auto repetition = 0; repetition < repetitions_; ++repetition) {
+    BenchmarkState state(arg, iterations);
+    benchmark.function()(&state);
+    if (!repetition && state.error().empty() &&
+        state.real_time() < min_time_ && iterations < kMaxIterations) {
+      // Tries more iterations until they take |min_time_|.
+      auto const multiplier = state.real_time() > 0 ?
+          std::min(min_time_ * 1.4 / state.real_time(), 10.0) : 10.0;
+      iterations = std::max(iterations + 1,
+                            static_cast<int64_t>(iterations * multiplier));
+      if (iterations > kMaxIterations)
+        iterations = kMaxIterations;
+      --repetition;
+      continue;
+    }
+    BenchmarkResult result;
+    result.cpu_time = state.cpu_time() * 1e9 / iterations;
+    result.error = state.error();
+    result.items_per_second = state.items_processed() && state.real_time() ?
+        state.items_processed() / state.real_time() : 0;
+    result.iterations = iterations;
+    result.name = name;
+    result.real_time = state.real_time() * 1e9 / iterations;
+    result.repetition = repetition;
+    repetitions.push_back(result);
+    if (!result.error.empty())
+      break;
+  }
+  AddResults(repetitions);
+  if (format_ == "console")
+    WriteConsole(start);
+}
+
+void BenchmarkRunner::WriteConsole(size_t start) const {
+  for (auto index = start; index < results_.size(); ++index) {
+    auto const& result = results_[index];
+    auto const name = result.aggregate.empty() ? result.name :
+        result.name + "_" + result.aggregate;
+    if (!result.error.empty()) {
+      printf("%-32s ERROR: %s\n", name.c_str(), result.error.c_str());
+      continue;
+    }
+    printf("%-32s %12lld %12.1f %12.1f %14.0f\n", name.c_str(),
+           static_cast<long long>(result.iterations), result.real_time,
+           result.cpu_time, result.items_per_second);
+  }
+}
+
+void BenchmarkRunner::WriteCsv(std::ostream* stream) const {
+  *stream << "name,iterations,real_time,cpu_time,time_unit," <<
+      "items_per_second,error_occurred,error_message\n";
+  for (auto const& result : results_) {
+    auto const name = result.aggregate.empty() ? result.name :
+        result.name + "_" + result.aggregate;
+    WriteCsvField(stream, name);
+    *stream << "," << result.iterations << "," << result.real_time << "," <<
+        result.cpu_time << ",ns," << result.items_per_second << "," <<
+        (result.error.empty() ? "false" : "true") << ",";
+    WriteCsvField(stream, result.error);
+    *stream << "\n";
+  }
+}
+
+void BenchmarkRunner::WriteJson(std::ostream* stream) const {
+  char date[32];
+  auto const now = ::time(nullptr);
+  tm local_time;
+#if defined(_WIN32)
+  ::localtime_s(&local_time, &now);
+#else
+  ::localtime_r(&now, &local_time);
+#endif
+  ::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local_time);
+  auto const precision = stream->precision(9);
+  *stream << "{\n\"context\":{\"date\":\"" << date <<
+      "\",\"executable\":";
+  WriteJsonString(stream, executable_);
+  *stream << ",\"num_cpus\":" << std::thread::hardware_concurrency() <<
+      ",\"library_build_type\":\"" <<
+#if defined(NDEBUG)
+      "release" <<
+#else
+      "debug" <<
+#endif
+      "\"},\n\"benchmarks\":[";
+  auto separator = "\n";
+  for (auto const& result : results_) {
+    auto const name = result.aggregate.empty() ? result.name :
+        result.name + "_" + result.aggregate;
+    *stream << separator << "{\"name\":";
+    WriteJsonString(stream, name);
+    *stream << ",\"run_name\":";
+    WriteJsonString(stream, result.name);
+    *stream << ",\"run_type\":\"" <<
+        (result.aggregate.empty() ? "iteration" : "aggregate") << "\",";
+    if (result.aggregate.empty()) {
+      *stream << "\"repetition_index\":" << result.repetition << ",";
+    } else {
+      *stream << "\"aggregate_name\":\"" << result.aggregate << "\",";
+    }
+    *stream << "\"repetitions\":" << repetitions_ << ",\"iterations\":" <<
+        result.iterations << ",\"real_time\":" << result.real_time <<
+        ",\"cpu_time\":" << result.cpu_time << ",\"time_unit\":\"ns\"";
+    if (result.items_per_second)
+      *stream << ",\"items_per_second\":" << result.items_per_second;
+    for (auto const& counter : result.counters) {
+      *stream << ",";
+      WriteJsonString(stream, counter.first);
+      *stream << ":" << counter.second;
+    }
+    if (!result.error.empty()) {
+      *stream << ",\"error_occurred\":true,\"error_message\":";
+      WriteJsonString(stream, result.error);
+    }
+    *stream << "}";
+    separator = ",\n";
+  }
+  *stream << "\n]\n}\n";
+  stream->precision(precision);
+}
+
+void BenchmarkRunner::WriteJsonString(std::ostream* stream,
+                                      const std::string& text) {
+  *stream << '"';
+  for (auto const ch : text) {
+    if (ch == '"' || ch == '\\') {
+      *stream << '\\' << ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      char escape[8];
+      ::snprintf(escape, sizeof(escape), "\\u%04x", ch);
+      *stream << escape;
+    } else {
+      *stream << ch;
+    }
+  }
+  *stream << '"';
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_test_benchmark_h)
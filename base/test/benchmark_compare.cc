@@ -0,0 +1,132 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Compares JSON results of |base::BenchmarkRunner| or Google benchmark
+// before and after a change, and prints a table of medians of metrics,
+// their change with a bootstrap confidence interval, p-value of the
+// Mann-Whitney U test and whether the change is a regression.
+//
+// Statistics are made from repetitions, so results need repetitions, e.g.
+// by --benchmark_repetitions=10, or several files of runs of a side, which
+// are joined by commas. Both sides need 4 or more repetitions for alpha of
+// 0.05. A change is a regression when its p-value is less than alpha and
+// its whole confidence interval is worse than threshold, larger for times
+// and smaller for metrics per second.
+//
+// Returns EXIT_FAILURE if a benchmark regresses, or results can't be read.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\test\benchmark_compare.cc
+//  g++ -std=c++11 -O2 -I. base/test/benchmark_compare.cc -o benchmark_compare
+//
+// Usage:
+//  benchmark_compare [options] before.json[,more.json] after.json[,more.json]
+// Options:
+//  --alpha=P         Significance level, 0.05 by default.
+//  --metrics=a,b     Metrics to compare, real_time by default, e.g.
+//                    cpu_time, items_per_second or p99_frame_ms.
+//  --resamples=N     Resamples of bootstrap, 10000 by default.
+//  --threshold=P     Percent of change ignored, 5 by default.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/test/benchmark_compare.h"
+
+namespace {
+
+bool StartsWith(const std::string& text, const char* prefix) {
+  return !text.compare(0, ::strlen(prefix), prefix);
+}
+
+std::vector<std::string> Split(const std::string& text) {
+  std::vector<std::string> parts;
+  std::istringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, ','))
+    parts.push_back(part);
+  return parts;
+}
+
+int Usage() {
+  std::cerr << "Usage: benchmark_compare [--alpha=P] [--metrics=a,b]" <<
+      " [--resamples=N] [--threshold=P] before.json[,more.json]" <<
+      " after.json[,more.json]" << std::endl;
+  return EXIT_FAILURE;
+}
+
+bool AddFiles(base::BenchmarkSamples* samples, const std::string& files) {
+  for (auto const& file_name : Split(files)) {
+    std::string error;
+    if (samples->AddFile(file_name, &error))
+      continue;
+    std::cerr << "Can't read benchmark results: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::BenchmarkCompareOptions options = {0.05, 10000, 0.05};
+  std::vector<std::string> metrics(1, "real_time");
+  std::vector<std::string> inputs;
+  for (auto index = 1; index < argc; ++index) {
+    std::string const arg = argv[index];
+    if (StartsWith(arg, "--alpha="))
+      options.alpha = ::atof(arg.c_str() + 8);
+    else if (StartsWith(arg, "--metrics="))
+      metrics = Split(arg.substr(10));
+    else if (StartsWith(arg, "--resamples="))
+      options.num_resamples = ::atoi(arg.c_str() + 12);
+    else if (StartsWith(arg, "--threshold="))
+      options.threshold = ::atof(arg.c_str() + 12) / 100;
+    else if (StartsWith(arg, "--"))
+      return Usage();
+    else
+      inputs.push_back(arg);
+  }
+  if (inputs.size() != 2 || metrics.empty() || options.alpha <= 0 ||
+      options.alpha >= 1 || options.num_resamples <= 0 ||
+      options.threshold < 0) {
+    return Usage();
+  }
+
+  base::BenchmarkSamples before;
+  base::BenchmarkSamples after;
+  if (!AddFiles(&before, inputs[0]) || !AddFiles(&after, inputs[1]))
+    return EXIT_FAILURE;
+  auto const comparisons = base::CompareBenchmarks(before, after, metrics,
+                                                   options);
+  if (comparisons.empty()) {
+    std::cerr << "No benchmark with " << metrics.front() <<
+        " in both results" << std::endl;
+    return EXIT_FAILURE;
+  }
+  base::WriteComparisons(comparisons, options.alpha, &std::cout);
+  auto num_regressions = 0;
+  for (auto const& comparison : comparisons) {
+    if (comparison.verdict == base::BenchmarkComparison::Verdict::Regressed)
+      ++num_regressions;
+  }
+  if (!num_regressions)
+    return EXIT_SUCCESS;
+  std::cout << num_regressions << " regressions" << std::endl;
+  return EXIT_FAILURE;
+}
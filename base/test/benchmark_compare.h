@@ -0,0 +1,621 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_test_benchmark_compare_h)
+#define INCLUDE_base_test_benchmark_compare_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// JsonValue
+// Value of JSON parsed by |JsonValue::Parse()|, enough to read results of
+// |BenchmarkRunner| and Google benchmark. Members of an object are kept in
+// order of the text.
+//
+class JsonValue final {
+  public: enum class Type {
+    Array,
+    Boolean,
+    Null,
+    Number,
+    Object,
+    String,
+  };
+
+  private: std::vector<JsonValue> elements_;
+  private: std::vector<std::pair<std::string, JsonValue>> members_;
+  private: double number_;
+  private: std::string string_;
+  private: Type type_;
+
+  public: JsonValue();
+  public: JsonValue(JsonValue&& other) = default;
+  public: ~JsonValue() = default;
+
+  public: JsonValue& operator=(JsonValue&& other) = default;
+
+  public: bool boolean() const { return type_ == Type::Boolean && number_; }
+  public: const std::vector<JsonValue>& elements() const {
+    return elements_;
+  }
+  public: const std::vector<std::pair<std::string, JsonValue>>&
+      members() const { return members_; }
+  public: double number() const { return number_; }
+  public: const std::string& string() const { return string_; }
+  public: Type type() const { return type_; }
+
+  // Returns a member named |name|, or nullptr if there is no such member.
+  public: const JsonValue* Find(const char* name) const;
+  // Returns false and sets |error| if |text| isn't JSON.
+  public: static bool Parse(const std::string& text, JsonValue* value,
+                            std::string* error);
+  private: static bool ParseString(const char** runner, const char* end,
+                                   std::string* string);
+  private: static bool ParseValue(const char** runner, const char* end,
+                                  int depth, JsonValue* value);
+
+  DISALLOW_COPY_AND_ASSIGN(JsonValue);
+};
+
+JsonValue::JsonValue() : number_(0), type_(Type::Null) {
+}
+
+const JsonValue* JsonValue::Find(const char* name) const {
+  for (auto const& member : members_) {
+    if (member.first == name)
+      return &member.second;
+  }
+  return nullptr;
+}
+
+bool JsonValue::Parse(const std::string& text, JsonValue* value,
+                      std::string* error) {
+  auto runner = text.data();
+  auto const end = runner + text.size();
+  if (ParseValue(&runner, end, 0, value)) {
+    while (runner < end && ::isspace(static_cast<unsigned char>(*runner)))
+      ++runner;
+    if (runner == end)
+      return true;
+  }
+  std::ostringstream message;
+  message << "invalid JSON at offset " << (runner - text.data());
+  *error = message.str();
+  return false;
+}
+
+// Non-ASCII characters of \u escapes are written in UTF-8.
+bool JsonValue::ParseString(const char** runner, const char* end,
+                            std::string* string) {
+  auto position = *runner + 1;
+  while (position < end && *position != '"') {
+    if (*position != '\\') {
+      string->push_back(*position++);
+      continue;
+    }
+    if (++position == end)
+      return false;
+    switch (auto const ch = *position++) {
+      case 'b': string->push_back('\b'); break;
+      case 'f': string->push_back('\f'); break;
+      case 'n': string->push_back('\n'); break;
+      case 'r': string->push_back('\r'); break;
+      case 't': string->push_back('\t'); break;
+      case 'u': {
+        if (end - position < 4)
+          return false;
+        char digits[5] = {0};
+        ::memcpy(digits, position, 4);
+        char* digits_end;
+        auto const code = ::strtoul(digits, &digits_end, 16);
+        if (digits_end != digits + 4)
+          return false;
+        position += 4;
+        if (code < 0x80) {
+          string->push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+          string->push_back(static_cast<char>(0xC0 | code >> 6));
+          string->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+          string->push_back(static_cast<char>(0xE0 | code >> 12));
+          string->push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+          string->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        break;
+      }
+      default:
+        string->push_back(ch);
+        break;
+    }
+  }
+  if (position == end)
+    return false;
+  *runner = position + 1;
+  return true;
+}
+
+bool JsonValue::ParseValue(const char** runner, const char* end, int depth,
+                           JsonValue* value) {
+  // Keeps malformed input from overflowing the stack.
+  const int kMaxDepth = 100;
+  auto const skip_spaces = [&]() {
+    while (*runner < end && ::isspace(static_cast<unsigned char>(**runner)))
+      ++*runner;
+  };
+  auto const match = [&](const char* word) {
+    auto const length = ::strlen(word);
+    if (static_cast<size_t>(end - *runner) < length ||
+        ::memcmp(*runner, word, length)) {
+      return false;
+    }
+    *runner += length;
+    return true;
+  };
+  skip_spaces();
+  if (*runner == end || depth > kMaxDepth)
+    return false;
+  switch (**runner) {
+    case '"':
+      value->type_ = Type::String;
+      return ParseString(runner, end, &value->string_);
+    case '[':
+      value->type_ = Type::Array;
+      ++*runner;
+      skip_spaces();
+      if (*runner < end && **runner == ']') {
+        ++*runner;
+        return true;
+      }
+      for (;;) {
+        value->elements_.push_back(JsonValue());
+        if (!ParseValue(runner, end, depth + 1, &value->elements_.back()))
+          return false;
+        skip_spaces();
+        if (*runner == end)
+          return false;
+        if (*(*runner)++ == ']')
+          return true;
+        if ((*runner)[-1] != ',')
+          return false;
+      }
+    case '{':
+      value->type_ = Type::Object;
+      ++*runner;
+      skip_spaces();
+      if (*runner < end && **runner == '}') {
+        ++*runner;
+        return true;
+      }
+      for (;;) {
+        skip_spaces();
+        if (*runner == end || **runner != '"')
+          return false;
+        value->members_.push_back(std::make_pair(std::string(),
+                                                 JsonValue()));
+        auto& member = value->members_.back();
+        if (!ParseString(runner, end, &member.first))
+          return false;
+        skip_spaces();
+        if (*runner == end || *(*runner)++ != ':')
+          return false;
+        if (!ParseValue(runner, end, depth + 1, &member.second))
+          return false;
+        skip_spaces();
+        if (*runner == end)
+          return false;
+        if (*(*runner)++ == '}')
+          return true;
+        if ((*runner)[-1] != ',')
+          return false;
+      }
+    case 'f':
+      value->type_ = Type::Boolean;
+      value->number_ = 0;
+      return match("false");
+    case 'n':
+      value->type_ = Type::Null;
+      return match("null");
+    case 't':
+      value->type_ = Type::Boolean;
+      value->number_ = 1;
+      return match("true");
+  }
+  // strtod() reads beyond JSON numbers, e.g. "inf", but they don't follow
+  // a number in valid JSON.
+  char* number_end;
+  value->number_ = ::strtod(*runner, &number_end);
+  if (number_end == *runner || number_end > end)
+    return false;
+  value->type_ = Type::Number;
+  *runner = number_end;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// BenchmarkSamples
+// Values of metrics of repetitions of benchmarks, read from JSON results of
+// |BenchmarkRunner| or Google benchmark. Metrics are real_time and cpu_time
+// in nanoseconds, items_per_second, and counters. Aggregates and failed
+// repetitions are skipped, since statistics are made from repetitions.
+//
+class BenchmarkSamples final {
+  // Values of metrics by names of metrics.
+  private: typedef std::unordered_map<std::string, std::vector<double>>
+      Metrics;
+
+  // Names of benchmarks in order of the first file.
+  private: std::vector<std::string> names_;
+  private: std::unordered_map<std::string, Metrics> samples_;
+
+  public: BenchmarkSamples() = default;
+  public: ~BenchmarkSamples() = default;
+
+  public: const std::vector<std::string>& names() const { return names_; }
+
+  // Returns false and sets |error| if |file_name| can't be read or isn't
+  // JSON of benchmark results.
+  public: bool AddFile(const std::string& file_name, std::string* error);
+  public: bool AddJson(const std::string& text, std::string* error);
+  // Returns values of |metric| of |name|, or nullptr if there is no value.
+  public: const std::vector<double>* Find(const std::string& name,
+                                          const std::string& metric) const;
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkSamples);
+};
+
+bool BenchmarkSamples::AddFile(const std::string& file_name,
+                               std::string* error) {
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file) {
+    *error = "can't open " + file_name;
+    return false;
+  }
+  std::ostringstream text;
+  text << file.rdbuf();
+  if (AddJson(text.str(), error))
+    return true;
+  *error = file_name + ": " + *error;
+  return false;
+}
+
+bool BenchmarkSamples::AddJson(const std::string& text, std::string* error) {
+  JsonValue root;
+  if (!JsonValue::Parse(text, &root, error))
+    return false;
+  auto const benchmarks = root.Find("benchmarks");
+  if (!benchmarks || benchmarks->type() != JsonValue::Type::Array) {
+    *error = "no benchmarks array";
+    return false;
+  }
+  for (auto const& benchmark : benchmarks->elements()) {
+    auto const run_type = benchmark.Find("run_type");
+    if (run_type && run_type->string() != "iteration")
+      continue;
+    auto const error_occurred = benchmark.Find("error_occurred");
+    if (error_occurred && error_occurred->boolean())
+      continue;
+    auto name = benchmark.Find("run_name");
+    if (!name)
+      name = benchmark.Find("name");
+    if (!name || name->type() != JsonValue::Type::String) {
+      *error = "benchmark without name";
+      return false;
+    }
+    auto const time_unit = benchmark.Find("time_unit");
+    auto time_scale = 1.0;
+    if (time_unit && time_unit->string() == "us")
+      time_scale = 1e3;
+    else if (time_unit && time_unit->string() == "ms")
+      time_scale = 1e6;
+    else if (time_unit && time_unit->string() == "s")
+      time_scale = 1e9;
+    auto const it = samples_.find(name->string());
+    if (it == samples_.end())
+      names_.push_back(name->string());
+    auto& metrics = samples_[name->string()];
+    for (auto const& member : benchmark.members()) {
+      if (member.second.type() != JsonValue::Type::Number ||
+          member.first == "iterations" || member.first == "repetitions" ||
+          member.first == "repetition_index" || member.first == "threads" ||
+          member.first == "family_index" ||
+          member.first == "per_family_instance_index") {
+        continue;
+      }
+      auto const is_time = member.first == "real_time" ||
+                           member.first == "cpu_time";
+      metrics[member.first].push_back(
+          member.second.number() * (is_time ? time_scale : 1.0));
+    }
+  }
+  return true;
+}
+
+const std::vector<double>* BenchmarkSamples::Find(
+    const std::string& name, const std::string& metric) const {
+  auto const metrics = samples_.find(name);
+  if (metrics == samples_.end())
+    return nullptr;
+  auto const values = metrics->second.find(metric);
+  if (values == metrics->second.end())
+    return nullptr;
+  return &values->second;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Statistics of two samples
+//
+double Median(std::vector<double> values) {
+  if (values.empty())
+    return 0;
+  auto const middle = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), middle, values.end());
+  if (values.size() % 2)
+    return *middle;
+  return (*middle + *std::max_element(values.begin(), middle)) / 2;
+}
+
+// Returns two-sided p-value of Mann-Whitney U test, the probability of
+// ranks of |after| among |before| as far from the middle as they are, if
+// both are from the same distribution. It is exact for samples without ties
+// of 20 or less, and of the normal approximation with correction of ties and
+// continuity for others.
+double MannWhitneyPValue(const std::vector<double>& before,
+                         const std::vector<double>& after) {
+  const size_t kMaxExactSize = 20;
+  auto const num_before = before.size();
+  auto const num_after = after.size();
+  if (!num_before || !num_after)
+    return 1;
+  auto const total = num_before + num_after;
+  std::vector<std::pair<double, bool>> values;
+  for (auto const value : before)
+    values.push_back(std::make_pair(value, false));
+  for (auto const value : after)
+    values.push_back(std::make_pair(value, true));
+  std::sort(values.begin(), values.end());
+
+  // Sum of ranks of |after|, where ties have their average rank.
+  auto rank_sum = 0.0;
+  auto tie_sum = 0.0;
+  for (size_t start = 0; start < total;) {
+    auto end = start + 1;
+    while (end < total && values[end].first == values[start].first)
+      ++end;
+    auto const rank = (start + 1 + end) / 2.0;
+    for (auto index = start; index < end; ++index) {
+      if (values[index].second)
+        rank_sum += rank;
+    }
+    auto const ties = static_cast<double>(end - start);
+    tie_sum += ties * ties * ties - ties;
+    start = end;
+  }
+  auto const u = rank_sum - num_after * (num_after + 1) / 2.0;
+  auto const mean = num_before * num_after / 2.0;
+
+  if (!tie_sum && num_before <= kMaxExactSize &&
+      num_after <= kMaxExactSize) {
+    // counts[k][s] is number of ways of choosing k of ranks 1 to |total|
+    // whose sum is s.
+    auto const max_sum = total * num_after;
+    std::vector<std::vector<double>> counts(
+        num_after + 1, std::vector<double>(max_sum + 1));
+    counts[0][0] = 1;
+    for (size_t rank = 1; rank <= total; ++rank) {
+      for (auto k = std::min(rank, num_after); k >= 1; --k) {
+        for (auto sum = max_sum; sum >= rank; --sum)
+          counts[k][sum] += counts[k - 1][sum - rank];
+      }
+    }
+    // Distribution of U is symmetric around |mean|.
+    auto const low_u = std::min(u, 2 * mean - u);
+    auto const offset = num_after * (num_after + 1) / 2;
+    auto tail = 0.0;
+    auto all = 0.0;
+    for (size_t sum = offset; sum <= max_sum; ++sum) {
+      all += counts[num_after][sum];
+      if (sum - offset <= low_u)
+        tail += counts[num_after][sum];
+    }
+    return std::min(1.0, 2 * tail / all);
+  }
+
+  auto const variance = num_before * num_after / 12.0 *
+      ((total + 1) - tie_sum / (total * (total - 1.0)));
+  if (variance <= 0)
+    return 1;
+  auto const z = std::max(0.0, ::fabs(u - mean) - 0.5) / ::sqrt(variance);
+  return std::min(1.0, ::erfc(z / ::sqrt(2.0)));
+}
+
+// Returns bounds of |confidence| interval of relative change of median of
+// |after| from median of |before| by bootstrap, resampling both samples
+// |num_resamples| times. Resamples are drawn from |seed|, so the same
+// samples have the same interval.
+std::pair<double, double> BootstrapChangeInterval(
+    const std::vector<double>& before, const std::vector<double>& after,
+    double confidence, int num_resamples, uint64_t seed) {
+  if (before.empty() || after.empty() || num_resamples <= 0)
+    return std::make_pair(0.0, 0.0);
+  // xorshift64*
+  auto state = seed | 1;
+  auto const next = [&](size_t size) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<size_t>((state * 2685821657736338717ull) >> 32) %
+           size;
+  };
+  std::vector<double> changes;
+  changes.reserve(num_resamples);
+  std::vector<double> before_resample(before.size());
+  std::vector<double> after_resample(after.size());
+  for (auto count = 0; count < num_resamples; ++count) {
+    for (auto& value : before_resample)
+      value = before[next(before.size())];
+    for (auto& value : after_resample)
+      value = after[next(after.size())];
+    auto const before_median = Median(before_resample);
+    if (before_median)
+      changes.push_back(Median(after_resample) / before_median - 1);
+  }
+  if (changes.empty())
+    return std::make_pair(0.0, 0.0);
+  std::sort(changes.begin(), changes.end());
+  auto const tail = (1 - confidence) / 2;
+  auto const last = changes.size() - 1;
+  return std::make_pair(
+      changes[static_cast<size_t>(tail * last + 0.5)],
+      changes[static_cast<size_t>((1 - tail) * last + 0.5)]);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// BenchmarkComparison
+// A metric of a benchmark in two results.
+//
+struct BenchmarkComparison {
+  enum class Verdict {
+    // Both results need more repetitions for the p-value to be less than
+    // alpha.
+    FewRepetitions,
+    Improved,
+    Regressed,
+    Same,
+  };
+
+  double after_median;
+  double before_median;
+  // Relative change of median, e.g. 0.05 for 5% larger.
+  double change;
+  double change_lower;
+  double change_upper;
+  std::string metric;
+  std::string name;
+  size_t num_after;
+  size_t num_before;
+  double p_value;
+  Verdict verdict;
+};
+
+struct BenchmarkCompareOptions {
+  // Significance level of p-values, and one minus confidence of intervals.
+  double alpha;
+  int num_resamples;
+  // Changes whose confidence interval reaches within it aren't regressions
+  // nor improvements, however significant they are.
+  double threshold;
+};
+
+// Returns true if larger values of |metric| are better, e.g. throughput.
+bool IsHigherBetter(const std::string& metric) {
+  auto const suffix = std::string("per_second");
+  return metric == "fps" || (metric.size() >= suffix.size() &&
+         !metric.compare(metric.size() - suffix.size(), suffix.size(),
+                         suffix));
+}
+
+// Compares |metrics| of benchmarks in both |before| and |after|, in order
+// of |before|.
+std::vector<BenchmarkComparison> CompareBenchmarks(
+    const BenchmarkSamples& before, const BenchmarkSamples& after,
+    const std::vector<std::string>& metrics,
+    const BenchmarkCompareOptions& options) {
+  std::vector<BenchmarkComparison> comparisons;
+  for (auto const& name : before.names()) {
+    for (auto const& metric : metrics) {
+      auto const before_values = before.Find(name, metric);
+      auto const after_values = after.Find(name, metric);
+      if (!before_values || !after_values)
+        continue;
+      BenchmarkComparison comparison;
+      comparison.after_median = Median(*after_values);
+      comparison.before_median = Median(*before_values);
+      comparison.change = comparison.before_median ?
+          comparison.after_median / comparison.before_median - 1 : 0;
+      auto const interval = BootstrapChangeInterval(
+          *before_values, *after_values, 1 - options.alpha,
+          options.num_resamples, std::hash<std::string>()(name + metric));
+      comparison.change_lower = interval.first;
+      comparison.change_upper = interval.second;
+      comparison.metric = metric;
+      comparison.name = name;
+      comparison.num_after = after_values->size();
+      comparison.num_before = before_values->size();
+      comparison.p_value = MannWhitneyPValue(*before_values, *after_values);
+
+      // The smallest p-value of repetitions is of all of |after| ranked
+      // above |before|, 2 / C(num_before + num_after, num_after).
+      auto min_p_value = 2.0;
+      for (size_t k = 1; k <= comparison.num_after; ++k)
+        min_p_value *= k / static_cast<double>(comparison.num_before + k);
+      // A change is beyond threshold only if the whole interval is, since
+      // medians of noisy repetitions often cross it by chance.
+      auto const higher_is_better = IsHigherBetter(metric);
+      auto const least_worse = higher_is_better ?
+          -comparison.change_upper : comparison.change_lower;
+      auto const least_better = higher_is_better ?
+          comparison.change_lower : -comparison.change_upper;
+      if (min_p_value >= options.alpha) {
+        comparison.verdict = BenchmarkComparison::Verdict::FewRepetitions;
+      } else if (comparison.p_value >= options.alpha) {
+        comparison.verdict = BenchmarkComparison::Verdict::Same;
+      } else if (least_worse > options.threshold) {
+        comparison.verdict = BenchmarkComparison::Verdict::Regressed;
+      } else if (least_better > options.threshold) {
+        comparison.verdict = BenchmarkComparison::Verdict::Improved;
+      } else {
+        comparison.verdict = BenchmarkComparison::Verdict::Same;
+      }
+      comparisons.push_back(comparison);
+    }
+  }
+  return comparisons;
+}
+
+// Writes a table of |comparisons|, a line for each, with medians, change,
+// its confidence interval, p-value and verdict.
+void WriteComparisons(const std::vector<BenchmarkComparison>& comparisons,
+                      double alpha, std::ostream* stream) {
+  size_t name_width = 9;
+  size_t metric_width = 6;
+  for (auto const& comparison : comparisons) {
+    name_width = std::max(name_width, comparison.name.size());
+    metric_width = std::max(metric_width, comparison.metric.size());
+  }
+  char interval[32];
+  ::snprintf(interval, sizeof(interval), "%g%% CI", (1 - alpha) * 100);
+  char line[256];
+  ::snprintf(line, sizeof(line), "%-*s %-*s %5s %12s %12s %8s %19s %7s %s\n",
+             static_cast<int>(name_width), "benchmark",
+             static_cast<int>(metric_width), "metric", "n", "before",
+             "after", "change", interval, "p", "verdict");
+  *stream << line;
+  for (auto const& comparison : comparisons) {
+    static const char* const kVerdicts[] = {
+      "few repetitions", "improved", "REGRESSED", "same",
+    };
+    char counts[16];
+    ::snprintf(counts, sizeof(counts), "%u/%u",
+               static_cast<unsigned>(comparison.num_before),
+               static_cast<unsigned>(comparison.num_after));
+    ::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]",
+               comparison.change_lower * 100, comparison.change_upper * 100);
+    ::snprintf(line, sizeof(line),
+               "%-*s %-*s %5s %12.6g %12.6g %+7.1f%% %19s %7.3f %s\n",
+               static_cast<int>(name_width), comparison.name.c_str(),
+               static_cast<int>(metric_width), comparison.metric.c_str(),
+               counts, comparison.before_median, comparison.after_median,
+               comparison.change * 100, interval, comparison.p_value,
+               kVerdicts[static_cast<int>(comparison.verdict)]);
+    *stream << line;
+  }
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_test_benchmark_compare_h)
@@ -0,0 +1,261 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Compares synthetic repetitions with noise and outliers like times of
+// benchmarks, before and after shifting them, and reports how often
+// |base::CompareBenchmarks()| flags regressions by repetitions and shift,
+// how often its confidence interval covers the shift, and time taken by a
+// comparison.
+//
+// Returns EXIT_FAILURE if JSON isn't parsed as expected, results written by
+// |base::BenchmarkRunner| aren't read back or quoted in CSV, p-values
+// differ from known values, unchanged benchmarks or shifts within the
+// threshold are flagged more often than alpha, or regressions of 20% are
+// missed in more than one of ten trials with 20 repetitions.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\test\benchmark_compare_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. base/test/benchmark_compare_benchmark.cc
+//
+// Usage: benchmark_compare_benchmark [num_trials]
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#undef max
+#undef min
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/strings/csv.h"
+#include "base/test/benchmark.h"
+#include "base/test/benchmark_compare.h"
+#include "base/test/random.h"
+
+namespace {
+
+const double kAlpha = 0.05;
+const int kNumResamples = 2000;
+const double kThreshold = 0.05;
+
+// Returns time of a repetition around |median|, with 5% of noise and an
+// outlier of 30% more in one of ten, as preemption makes.
+double RandomTime(uint32_t* seed, double median) {
+  auto noise = 0.0;
+  for (auto count = 0; count < 4; ++count)
+    noise += (base::NextRandom(seed) & 0xFFFF) / 65536.0 - 0.5;
+  auto const outlier = base::NextRandom(seed) % 10 ? 1.0 : 1.3;
+  return median * (1 + noise * 0.086) * outlier;
+}
+
+std::string MakeJson(const std::vector<double>& times) {
+  std::ostringstream json;
+  json << "{\"benchmarks\":[";
+  for (auto index = 0u; index < times.size(); ++index) {
+    json << (index ? "," : "") << "{\"name\":\"BM_Shift\",\"run_type\":" <<
+        "\"iteration\",\"real_time\":" << times[index] << "}";
+  }
+  json << "]}";
+  return json.str();
+}
+
+// Returns a comparison of |num_repetitions| before and after changing
+// their median by |shift|.
+base::BenchmarkComparison CompareShift(uint32_t* seed, int num_repetitions,
+                                       double shift, int num_resamples) {
+  std::vector<double> before_times;
+  std::vector<double> after_times;
+  for (auto count = 0; count < num_repetitions; ++count) {
+    before_times.push_back(RandomTime(seed, 1000));
+    after_times.push_back(RandomTime(seed, 1000 * (1 + shift)));
+  }
+  base::BenchmarkSamples before;
+  base::BenchmarkSamples after;
+  std::string error;
+  before.AddJson(MakeJson(before_times), &error);
+  after.AddJson(MakeJson(after_times), &error);
+  base::BenchmarkCompareOptions options = {kAlpha, num_resamples,
+                                           kThreshold};
+  auto const comparisons = base::CompareBenchmarks(
+      before, after, std::vector<std::string>(1, "real_time"), options);
+  return comparisons.front();
+}
+
+bool VerifyJson() {
+  base::JsonValue value;
+  std::string error;
+  if (!base::JsonValue::Parse(
+          " {\"a\": [1, -2.5e3, true, false, null], \"b\\\"\": \"x\\n\\u00e9\""
+          ", \"c\": {}}", &value, &error)) {
+    return false;
+  }
+  auto const array = value.Find("a");
+  auto const text = value.Find("b\"");
+  if (!array || array->elements().size() != 5 ||
+      array->elements()[1].number() != -2500 ||
+      !array->elements()[2].boolean() || array->elements()[3].boolean() ||
+      array->elements()[4].type() != base::JsonValue::Type::Null ||
+      !text || text->string() != "x\n\xC3\xA9" || !value.Find("c")) {
+    return false;
+  }
+  static const char* const kInvalids[] = {
+    "", "{", "[1,]", "{\"a\" 1}", "[1] 2", "\"abc", "tru", "[-]",
+  };
+  for (auto const invalid : kInvalids) {
+    base::JsonValue value;
+    if (base::JsonValue::Parse(invalid, &value, &error))
+      return false;
+  }
+  return true;
+}
+
+// Writes repetitions and aggregates by |base::BenchmarkRunner|, and reads
+// back the repetitions but not the aggregates nor failures. Names and
+// errors have characters to escape in JSON and to quote in CSV.
+bool VerifyRunnerJson() {
+  std::vector<base::BenchmarkResult> repetitions(3);
+  for (auto index = 0; index < 3; ++index) {
+    auto& result = repetitions[index];
+    result.counters.push_back(std::make_pair("p99_frame_ms", index + 10.0));
+    result.cpu_time = index + 100.0;
+    result.items_per_second = index + 1000.0;
+    result.iterations = 10;
+    result.name = "BM_Frame/\"a\\b\",c";
+    result.real_time = index + 200.0;
+    result.repetition = index;
+  }
+  base::BenchmarkRunner runner;
+  runner.AddResults(repetitions);
+  repetitions.resize(1);
+  repetitions[0].error = "failed\n\"here\"";
+  repetitions[0].name = "BM_Failed";
+  runner.AddResults(repetitions);
+  std::ostringstream json;
+  runner.WriteJson(&json);
+
+  base::BenchmarkSamples samples;
+  std::string error;
+  if (!samples.AddJson(json.str(), &error))
+    return false;
+  auto const real_times = samples.Find("BM_Frame/\"a\\b\",c", "real_time");
+  auto const p99s = samples.Find("BM_Frame/\"a\\b\",c", "p99_frame_ms");
+  std::ostringstream csv;
+  runner.WriteCsv(&csv);
+  return csv.str().find("\n\"BM_Frame/\"\"a\\b\"\",c\",10,") !=
+             std::string::npos &&
+         csv.str().find(",true,\"failed\n\"\"here\"\"\"\n") !=
+             std::string::npos &&
+         samples.names().size() == 1 && real_times && p99s &&
+         *real_times == std::vector<double>({200, 201, 202}) &&
+         *p99s == std::vector<double>({10, 11, 12});
+}
+
+// Checks p-values against the exact distribution of 4 and 4 and the normal
+// approximation with ties.
+bool VerifyPValues() {
+  auto const separated = base::MannWhitneyPValue({1, 2, 3, 4}, {5, 6, 7, 8});
+  auto const interleaved = base::MannWhitneyPValue({1, 3, 5, 7},
+                                                   {2, 4, 6, 8});
+  auto const tied = base::MannWhitneyPValue({1, 1, 2, 2, 3},
+                                            {2, 3, 3, 4, 4});
+  return ::fabs(separated - 2.0 / 70) < 1e-9 &&
+         ::fabs(interleaved - 48.0 / 70) < 1e-9 &&
+         ::fabs(tied - 0.0524116287) < 1e-6 &&
+         base::MannWhitneyPValue({1, 1}, {1, 1}) == 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_trials = argc >= 2 ? atoi(argv[1]) : 200;
+  auto failed = false;
+  if (!VerifyJson()) {
+    printf("FAILED: JSON isn't parsed as expected\n");
+    failed = true;
+  }
+  if (!VerifyRunnerJson()) {
+    printf("FAILED: results of BenchmarkRunner aren't read back\n");
+    failed = true;
+  }
+  if (!VerifyPValues()) {
+    printf("FAILED: p-values differ from known values\n");
+    failed = true;
+  }
+
+  std::cout << num_trials << " trials, alpha " << kAlpha << ", threshold " <<
+      kThreshold * 100 << "%, " << kNumResamples << " resamples" << std::endl;
+  printf("%-12s %8s %10s %10s %10s\n", "repetitions", "shift", "regressed",
+         "improved", "covered");
+  uint32_t seed = 1;
+  static const int kRepetitions[] = {5, 10, 20};
+  static const double kShifts[] = {-0.1, 0, 0.03, 0.1, 0.2};
+  for (auto const num_repetitions : kRepetitions) {
+    for (auto const shift : kShifts) {
+      auto num_covered = 0;
+      auto num_improved = 0;
+      auto num_regressed = 0;
+      for (auto trial = 0; trial < num_trials; ++trial) {
+        auto const comparison = CompareShift(&seed, num_repetitions, shift,
+                                             kNumResamples);
+        if (comparison.change_lower <= shift &&
+            shift <= comparison.change_upper) {
+          ++num_covered;
+        }
+        if (comparison.verdict ==
+            base::BenchmarkComparison::Verdict::Improved) {
+          ++num_improved;
+        }
+        if (comparison.verdict ==
+            base::BenchmarkComparison::Verdict::Regressed) {
+          ++num_regressed;
+        }
+      }
+      auto const regressed = static_cast<double>(num_regressed) / num_trials;
+      printf("%-12d %+7.0f%% %10.3f %10.3f %10.3f\n", num_repetitions,
+             shift * 100, regressed,
+             static_cast<double>(num_improved) / num_trials,
+             static_cast<double>(num_covered) / num_trials);
+      if (shift == 0 && num_regressed + num_improved > kAlpha * num_trials) {
+        printf("FAILED: flagged unchanged benchmarks\n");
+        failed = true;
+      }
+      // Shifts within threshold are real, but not regressions.
+      if (shift > 0 && shift < kThreshold && regressed > kAlpha) {
+        printf("FAILED: flagged shifts within threshold\n");
+        failed = true;
+      }
+      if (num_repetitions >= 20 && shift >= kThreshold * 4 &&
+          regressed < 0.9) {
+        printf("FAILED: missed regressions\n");
+        failed = true;
+      }
+    }
+  }
+
+  auto const num_comparisons = 100;
+  auto const start = base::TimeTicks::Now();
+  for (auto count = 0; count < num_comparisons; ++count)
+    CompareShift(&seed, 20, 0, 10000);
+  printf("%.3f ms a comparison of 20 repetitions by 10000 resamples\n",
+         (base::TimeTicks::Now() - start).InMillisecondsF() /
+         num_comparisons);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_test_random_h)
+#define INCLUDE_base_test_random_h
+
+namespace base {
+
+// Returns the next number of 24 bits of a linear congruential generator,
+// so benchmarks get the same inputs from |*seed| on every platform and
+// run, unlike rand().
+uint32_t NextRandom(uint32_t* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+// Returns a number in [minimum, maximum) in steps of 1/65536 of the range.
+float RandomFloat(uint32_t* seed, float minimum, float maximum) {
+  return minimum + (NextRandom(seed) & 0xFFFF) * (maximum - minimum) / 65536;
+}
+
+int64_t RandomInt(uint32_t* seed, int64_t minimum, int64_t maximum) {
+  return minimum + static_cast<int64_t>(NextRandom(seed) & 0xFFFF) *
+                   (maximum - minimum) / 65536;
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_test_random_h)
@@ -0,0 +1,263 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_threading_task_scheduler_h)
+#define INCLUDE_base_threading_task_scheduler_h
+
+namespace base {
+
+class SequencedTaskRunner;
+
+// Tasks of higher priority run before tasks of lower priority on every
+// worker. Tasks of the same priority run in order of posting on a worker.
+enum class TaskPriority {
+  Input,
+  Animation,
+  Raster,
+  Idle,
+};
+
+typedef std::function<void()> Task;
+
+//////////////////////////////////////////////////////////////////////
+//
+// TaskScheduler
+// Runs posted tasks on worker threads. Each worker has a deque of tasks per
+// priority. A task posted from a worker goes to the deque of the worker,
+// a task posted from other threads goes to workers in round robin. A
+// worker takes the oldest task of the highest priority from own deques,
+// or steals one from other workers, so a worker doesn't run a raster task
+// while an input task waits anywhere.
+//
+// Idle workers sleep on condition variable, posting a task wakes one of
+// them. The destructor waits for all posted tasks.
+//
+class TaskScheduler final {
+  public: static const int kNumPriorities =
+      static_cast<int>(TaskPriority::Idle) + 1;
+
+  private: struct Worker {
+    std::mutex mutex;
+    // Lengths of |tasks|, for checking emptiness without locking.
+    std::atomic<size_t> sizes[kNumPriorities];
+    std::deque<Task> tasks[kNumPriorities];
+    std::thread::id thread_id;
+  };
+
+  private: std::condition_variable condition_;
+  private: std::mutex mutex_;
+  private: std::atomic<size_t> next_worker_;
+  // Number of tasks in deques. It can be negative for a moment, since
+  // it is updated after pushing and taking.
+  private: std::atomic<int64_t> num_pending_tasks_;
+  private: std::atomic<int> num_sleeping_workers_;
+  private: std::atomic<uint64_t> num_steals_;
+  private: bool shutting_down_;
+  private: std::vector<std::thread> threads_;
+  private: std::vector<std::unique_ptr<Worker>> workers_;
+
+  public: explicit TaskScheduler(int num_threads);
+  public: ~TaskScheduler();
+
+  public: int num_threads() const { return static_cast<int>(workers_.size()); }
+  // Number of tasks taken from other workers, for statistics.
+  public: uint64_t num_steals() const { return num_steals_; }
+
+  // Tasks posted to the returned runner run one at a time in order of
+  // posting, on any worker.
+  public: std::shared_ptr<SequencedTaskRunner> CreateSequencedTaskRunner(
+      TaskPriority priority);
+  public: void PostTask(TaskPriority priority, const Task& task);
+
+  // Returns index of worker of the calling thread, or -1.
+  private: int CurrentWorker() const;
+  private: bool TakeTask(size_t worker_index, Task* task);
+  private: void WorkerMain(size_t worker_index);
+
+  DISALLOW_COPY_AND_ASSIGN(TaskScheduler);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// SequencedTaskRunner
+// Keeps tasks in own queue and posts one task at a time to
+// |TaskScheduler|, so tasks run in order without locks in tasks. Posted
+// tasks hold a reference to the runner.
+//
+class SequencedTaskRunner final
+    : public std::enable_shared_from_this<SequencedTaskRunner> {
+  private: std::mutex mutex_;
+  private: TaskPriority priority_;
+  // True while a task of this sequence is posted or running.
+  private: bool running_;
+  private: TaskScheduler* scheduler_;
+  private: std::deque<Task> tasks_;
+
+  public: SequencedTaskRunner(TaskScheduler* scheduler,
+                              TaskPriority priority);
+  public: ~SequencedTaskRunner() = default;
+
+  public: TaskPriority priority() const { return priority_; }
+
+  public: void PostTask(const Task& task);
+
+  private: void RunNextTask();
+
+  DISALLOW_COPY_AND_ASSIGN(SequencedTaskRunner);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// TaskScheduler
+//
+TaskScheduler::TaskScheduler(int num_threads)
+    : next_worker_(0), num_pending_tasks_(0), num_sleeping_workers_(0),
+      num_steals_(0), shutting_down_(false) {
+  num_threads = std::max(num_threads, 1);
+  for (auto index = 0; index < num_threads; ++index) {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (auto& size : workers_.back()->sizes)
+      size = 0;
+  }
+  // Workers wait for |thread_id| of all workers before taking tasks.
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto index = 0; index < num_threads; ++index) {
+    threads_.push_back(std::thread(&TaskScheduler::WorkerMain, this, index));
+    workers_[index]->thread_id = threads_.back().get_id();
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+std::shared_ptr<SequencedTaskRunner> TaskScheduler::CreateSequencedTaskRunner(
+    TaskPriority priority) {
+  return std::make_shared<SequencedTaskRunner>(this, priority);
+}
+
+int TaskScheduler::CurrentWorker() const {
+  auto const thread_id = std::this_thread::get_id();
+  for (auto index = 0u; index < workers_.size(); ++index) {
+    if (workers_[index]->thread_id == thread_id)
+      return static_cast<int>(index);
+  }
+  return -1;
+}
+
+void TaskScheduler::PostTask(TaskPriority priority, const Task& task) {
+  auto const current = CurrentWorker();
+  auto const worker_index = current >= 0 ? static_cast<size_t>(current) :
+      next_worker_++ % workers_.size();
+  auto const priority_index = static_cast<int>(priority);
+  {
+    auto& worker = *workers_[worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks[priority_index].push_back(task);
+    ++worker.sizes[priority_index];
+  }
+  ++num_pending_tasks_;
+  // A worker increments |num_sleeping_workers_| under |mutex_| before
+  // checking |num_pending_tasks_|, so we don't miss it.
+  if (!num_sleeping_workers_)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  condition_.notify_one();
+}
+
+// Takes the oldest task of the highest priority, from own deques first.
+bool TaskScheduler::TakeTask(size_t worker_index, Task* task) {
+  for (auto priority = 0; priority < kNumPriorities; ++priority) {
+    for (auto offset = 0u; offset < workers_.size(); ++offset) {
+      auto& worker = *workers_[(worker_index + offset) % workers_.size()];
+      if (!worker.sizes[priority])
+        continue;
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      auto& tasks = worker.tasks[priority];
+      if (tasks.empty())
+        continue;
+      task->swap(tasks.front());
+      tasks.pop_front();
+      --worker.sizes[priority];
+      --num_pending_tasks_;
+      if (offset)
+        ++num_steals_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::WorkerMain(size_t worker_index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+  }
+  Task task;
+  for (;;) {
+    while (TakeTask(worker_index, &task)) {
+      task();
+      task = nullptr;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_sleeping_workers_;
+    condition_.wait(lock, [this]() {
+      return shutting_down_ || num_pending_tasks_ > 0;
+    });
+    --num_sleeping_workers_;
+    // Tasks of a running sequence are posted by the running task, so a
+    // worker running a task sees them even if we exit here.
+    if (shutting_down_ && num_pending_tasks_ <= 0)
+      return;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SequencedTaskRunner
+//
+SequencedTaskRunner::SequencedTaskRunner(TaskScheduler* scheduler,
+                                         TaskPriority priority)
+    : priority_(priority), running_(false), scheduler_(scheduler) {
+}
+
+void SequencedTaskRunner::PostTask(const Task& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+    if (running_)
+      return;
+    running_ = true;
+  }
+  auto const self = shared_from_this();
+  scheduler_->PostTask(priority_, [self]() { self->RunNextTask(); });
+}
+
+void SequencedTaskRunner::RunNextTask() {
+  Task task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task.swap(tasks_.front());
+    tasks_.pop_front();
+  }
+  task();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+      running_ = false;
+      return;
+    }
+  }
+  auto const self = shared_from_this();
+  scheduler_->PostTask(priority_, [self]() { self->RunNextTask(); });
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_threading_task_scheduler_h)
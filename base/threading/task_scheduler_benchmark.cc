@@ -0,0 +1,337 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Compares |base::TaskScheduler| with a single global FIFO queue shared by
+// the same number of threads:
+//  - Mixed load: every millisecond an input task, raster tasks for 90% of
+//    the threads, and an animation task every 16 ms. Reports raster
+//    throughput and latency from posting to start per priority.
+//  - Spawn: each task posts two tasks until a million tasks run. Reports
+//    tasks per second.
+// Also checks tasks of sequenced task runners run in order and one at a
+// time, and returns EXIT_FAILURE if they don't or if tasks are lost.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\threading\task_scheduler_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. base/threading/task_scheduler_benchmark.cc
+//
+// Usage: task_scheduler_benchmark [num_threads] [milliseconds]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/threading/task_scheduler.h"
+#include "base/time/time.h"
+
+namespace {
+
+const int kAnimationInterval = 16;
+const int64_t kAnimationWork = 1000;
+const int64_t kInputWork = 20;
+const int64_t kRasterWork = 250;
+const int kSpawnDepth = 20;
+
+//////////////////////////////////////////////////////////////////////
+//
+// GlobalQueue
+// All threads take tasks from one FIFO queue, priorities are ignored.
+//
+class GlobalQueue final {
+  private: std::condition_variable condition_;
+  private: std::mutex mutex_;
+  private: bool shutting_down_;
+  private: std::deque<base::Task> tasks_;
+  private: std::vector<std::thread> threads_;
+
+  public: explicit GlobalQueue(int num_threads);
+  public: ~GlobalQueue();
+
+  public: void PostTask(base::TaskPriority priority, const base::Task& task);
+
+  private: void WorkerMain();
+
+  DISALLOW_COPY_AND_ASSIGN(GlobalQueue);
+};
+
+GlobalQueue::GlobalQueue(int num_threads) : shutting_down_(false) {
+  for (auto index = 0; index < num_threads; ++index)
+    threads_.push_back(std::thread(&GlobalQueue::WorkerMain, this));
+}
+
+GlobalQueue::~GlobalQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void GlobalQueue::PostTask(base::TaskPriority, const base::Task& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+  }
+  condition_.notify_one();
+}
+
+void GlobalQueue::WorkerMain() {
+  for (;;) {
+    base::Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() {
+        return shutting_down_ || !tasks_.empty();
+      });
+      if (tasks_.empty())
+        return;
+      task.swap(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MixedResult
+//
+struct MixedResult {
+  int64_t animation_p99;
+  int64_t input_p50;
+  int64_t input_p99;
+  size_t num_tasks;
+  int64_t raster_p99;
+  double seconds;
+};
+
+void Spin(int64_t microseconds) {
+  auto const end = base::TimeTicks::Now() +
+                   base::TimeDelta::FromMicroseconds(microseconds);
+  while (base::TimeTicks::Now() < end) {
+  }
+}
+
+int64_t Percentile(std::vector<int64_t> values, int percent) {
+  if (values.empty())
+    return 0;
+  auto const index = (values.size() - 1) * percent / 100;
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+void WaitFor(const std::atomic<size_t>& counter, size_t count) {
+  while (counter < count)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// Posts tasks from the calling thread, as UI thread does, and records
+// microseconds from posting to start of each task.
+template<typename Scheduler>
+MixedResult RunMixed(Scheduler* scheduler, int num_threads,
+                     int milliseconds) {
+  // Raster work per millisecond is 90% of threads.
+  auto const rasters_per_tick = std::max(
+      static_cast<int>(num_threads * 900 / kRasterWork), 1);
+  std::vector<int64_t> animation_latencies(
+      milliseconds / kAnimationInterval + 1);
+  std::vector<int64_t> input_latencies(milliseconds);
+  std::vector<int64_t> raster_latencies(
+      static_cast<size_t>(milliseconds) * rasters_per_tick);
+  std::atomic<size_t> num_done(0);
+  auto const post = [&](base::TaskPriority priority, int64_t* latency,
+                        int64_t work) {
+    auto const posted = base::TimeTicks::Now();
+    auto const done = &num_done;
+    scheduler->PostTask(priority, [posted, latency, work, done]() {
+      *latency = (base::TimeTicks::Now() - posted).InMicroseconds();
+      Spin(work);
+      ++*done;
+    });
+  };
+
+  auto num_posted = static_cast<size_t>(0);
+  auto const start = base::TimeTicks::Now();
+  auto const clock_start = std::chrono::steady_clock::now();
+  for (auto tick = 0; tick < milliseconds; ++tick) {
+    std::this_thread::sleep_until(clock_start +
+                                  std::chrono::milliseconds(tick));
+    post(base::TaskPriority::Input, &input_latencies[tick], kInputWork);
+    ++num_posted;
+    if (tick % kAnimationInterval == 0) {
+      post(base::TaskPriority::Animation,
+           &animation_latencies[tick / kAnimationInterval], kAnimationWork);
+      ++num_posted;
+    }
+    for (auto index = 0; index < rasters_per_tick; ++index) {
+      post(base::TaskPriority::Raster,
+           &raster_latencies[tick * rasters_per_tick + index], kRasterWork);
+      ++num_posted;
+    }
+  }
+  WaitFor(num_done, num_posted);
+
+  MixedResult result;
+  result.seconds = (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  result.num_tasks = num_done;
+  result.animation_p99 = Percentile(animation_latencies, 99);
+  result.input_p50 = Percentile(input_latencies, 50);
+  result.input_p99 = Percentile(input_latencies, 99);
+  result.raster_p99 = Percentile(raster_latencies, 99);
+  return result;
+}
+
+// Posts two tasks from each task, like recursive parallel work.
+template<typename Scheduler>
+void Spawn(Scheduler* scheduler, std::atomic<size_t>* num_done, int depth) {
+  ++*num_done;
+  if (!depth)
+    return;
+  for (auto count = 0; count < 2; ++count) {
+    scheduler->PostTask(base::TaskPriority::Raster,
+                        [scheduler, num_done, depth]() {
+      Spawn(scheduler, num_done, depth - 1);
+    });
+  }
+}
+
+template<typename Scheduler>
+double RunSpawn(Scheduler* scheduler, size_t* num_tasks) {
+  std::atomic<size_t> num_done(0);
+  auto const expected = (static_cast<size_t>(1) << (kSpawnDepth + 1)) - 1;
+  auto const start = base::TimeTicks::Now();
+  auto const done = &num_done;
+  scheduler->PostTask(base::TaskPriority::Raster, [scheduler, done]() {
+    Spawn(scheduler, done, kSpawnDepth);
+  });
+  WaitFor(num_done, expected);
+  *num_tasks = num_done;
+  return expected / ((base::TimeTicks::Now() - start).InMillisecondsF() /
+                     1000);
+}
+
+// Returns false if tasks of a sequence run out of order or at the same
+// time.
+bool CheckSequences(base::TaskScheduler* scheduler) {
+  const int kNumSequences = 8;
+  const int kNumTasks = 10000;
+  std::vector<std::shared_ptr<base::SequencedTaskRunner>> runners;
+  std::vector<int> next_numbers(kNumSequences);
+  std::unique_ptr<std::atomic<int>[]> num_running(
+      new std::atomic<int>[kNumSequences]);
+  std::atomic<size_t> num_done(0);
+  std::atomic<bool> failed(false);
+  for (auto sequence = 0; sequence < kNumSequences; ++sequence) {
+    runners.push_back(scheduler->CreateSequencedTaskRunner(
+        sequence % 2 ? base::TaskPriority::Raster :
+                       base::TaskPriority::Animation));
+    num_running[sequence] = 0;
+  }
+  for (auto number = 0; number < kNumTasks; ++number) {
+    for (auto sequence = 0; sequence < kNumSequences; ++sequence) {
+      auto const next_number = &next_numbers[sequence];
+      auto const running = &num_running[sequence];
+      auto const failed_pointer = &failed;
+      auto const done = &num_done;
+      runners[sequence]->PostTask(
+          [number, next_number, running, failed_pointer, done]() {
+        if (++*running != 1 || *next_number != number)
+          *failed_pointer = true;
+        ++*next_number;
+        --*running;
+        ++*done;
+      });
+    }
+  }
+  WaitFor(num_done, kNumSequences * kNumTasks);
+  return !failed;
+}
+
+void PrintMixed(const char* name, const MixedResult& result) {
+  printf("%-16s %10.0f %10lld %10lld %10lld %10lld\n", name,
+         result.num_tasks / result.seconds,
+         static_cast<long long>(result.input_p50),
+         static_cast<long long>(result.input_p99),
+         static_cast<long long>(result.animation_p99),
+         static_cast<long long>(result.raster_p99));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_threads = argc >= 2 ? atoi(argv[1]) :
+      std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+  auto const milliseconds = argc >= 3 ? atoi(argv[2]) : 2000;
+  std::cout << num_threads << " threads, " << milliseconds <<
+      " ms of mixed load" << std::endl;
+
+  printf("%-16s %10s %10s %10s %10s %10s\n", "mixed", "tasks/s",
+         "input p50", "input p99", "anim p99", "raster p99");
+  MixedResult global_mixed;
+  MixedResult priority_mixed;
+  {
+    GlobalQueue scheduler(num_threads);
+    global_mixed = RunMixed(&scheduler, num_threads, milliseconds);
+  }
+  PrintMixed("global queue", global_mixed);
+  {
+    base::TaskScheduler scheduler(num_threads);
+    priority_mixed = RunMixed(&scheduler, num_threads, milliseconds);
+  }
+  PrintMixed("task scheduler", priority_mixed);
+
+  auto const expected_spawns = (static_cast<size_t>(1) << (kSpawnDepth + 1)) -
+                               1;
+  size_t global_spawns;
+  size_t priority_spawns;
+  double global_rate;
+  double priority_rate;
+  {
+    GlobalQueue scheduler(num_threads);
+    global_rate = RunSpawn(&scheduler, &global_spawns);
+  }
+  uint64_t num_steals;
+  {
+    base::TaskScheduler scheduler(num_threads);
+    priority_rate = RunSpawn(&scheduler, &priority_spawns);
+    num_steals = scheduler.num_steals();
+  }
+  printf("%-16s %10s %10s\n", "spawn", "tasks/s", "steals");
+  printf("%-16s %10.0f %10s\n", "global queue", global_rate, "-");
+  printf("%-16s %10.0f %10llu\n", "task scheduler", priority_rate,
+         static_cast<unsigned long long>(num_steals));
+
+  bool sequences_ok;
+  {
+    base::TaskScheduler scheduler(num_threads);
+    sequences_ok = CheckSequences(&scheduler);
+  }
+  printf("sequences %s\n", sequences_ok ? "in order" : "OUT OF ORDER");
+
+  if (!sequences_ok || global_spawns != expected_spawns ||
+      priority_spawns != expected_spawns ||
+      global_mixed.num_tasks != priority_mixed.num_tasks) {
+    printf("FAILED\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
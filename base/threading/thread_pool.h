@@ -0,0 +1,179 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_threading_thread_pool_h)
+#define INCLUDE_base_threading_thread_pool_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// ThreadPool
+// Runs chunks of a loop on worker threads and the calling thread. Each
+// worker has its own deque of chunks, it takes chunks from back of own
+// deque and steals chunks from front of other deques when own deque is
+// empty.
+//
+// A pool with one thread runs everything on the calling thread.
+//
+class ThreadPool final {
+  public: typedef std::function<void(size_t begin, size_t end)> Function;
+
+  private: struct Chunk {
+    size_t begin;
+    size_t end;
+  };
+
+  private: struct Worker {
+    std::deque<Chunk> chunks;
+    std::mutex mutex;
+  };
+
+  private: std::condition_variable done_condition_;
+  private: const Function* function_;
+  private: uint64_t generation_;
+  private: std::mutex mutex_;
+  private: std::atomic<size_t> num_pending_chunks_;
+  private: bool shutting_down_;
+  private: std::atomic<uint64_t> num_steals_;
+  private: std::vector<std::thread> threads_;
+  private: std::condition_variable work_condition_;
+  // |workers_[0]| is for the calling thread.
+  private: std::vector<std::unique_ptr<Worker>> workers_;
+
+  // |num_threads| includes the calling thread.
+  public: explicit ThreadPool(int num_threads);
+  public: ~ThreadPool();
+
+  public: int num_threads() const { return static_cast<int>(workers_.size()); }
+  // Number of chunks taken from other workers, for statistics.
+  public: uint64_t num_steals() const { return num_steals_; }
+
+  // Calls |function| with chunks of [0, |count|), each chunk has |grain|
+  // indexes at most, and returns after all chunks are done.
+  public: void ParallelFor(size_t count, size_t grain,
+                           const Function& function);
+
+  private: bool RunChunk(size_t worker_index);
+  private: bool TakeChunk(size_t worker_index, Chunk* chunk);
+  private: void WorkerMain(size_t worker_index);
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+ThreadPool::ThreadPool(int num_threads)
+    : function_(nullptr), generation_(0), num_pending_chunks_(0),
+      shutting_down_(false), num_steals_(0) {
+  num_threads = std::max(num_threads, 1);
+  for (auto index = 0; index < num_threads; ++index)
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  for (auto index = 1; index < num_threads; ++index)
+    threads_.push_back(std::thread(&ThreadPool::WorkerMain, this, index));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  work_condition_.notify_all();
+  for (auto& thread : threads_)
+    thread.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain,
+                             const Function& function) {
+  DCHECK(!function_);
+  if (!count)
+    return;
+  grain = std::max(grain, static_cast<size_t>(1));
+  if (workers_.size() == 1 || count <= grain) {
+    function(0, count);
+    return;
+  }
+
+  // A worker still looking for chunks of the previous call may take a chunk
+  // as soon as we push it, so we set |function_| before dealing chunks.
+  auto const num_chunks = (count + grain - 1) / grain;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = &function;
+    num_pending_chunks_ = num_chunks;
+  }
+  // Deal chunks to workers in round robin.
+  for (auto index = 0u; index < num_chunks; ++index) {
+    auto& worker = *workers_[index % workers_.size()];
+    Chunk chunk = {index * grain, std::min((index + 1) * grain, count)};
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.chunks.push_back(chunk);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+  }
+  work_condition_.notify_all();
+
+  while (RunChunk(0)) {
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_condition_.wait(lock, [this]() { return !num_pending_chunks_; });
+  function_ = nullptr;
+}
+
+bool ThreadPool::RunChunk(size_t worker_index) {
+  Chunk chunk;
+  if (!TakeChunk(worker_index, &chunk))
+    return false;
+  (*function_)(chunk.begin, chunk.end);
+  if (--num_pending_chunks_)
+    return true;
+  std::lock_guard<std::mutex> lock(mutex_);
+  done_condition_.notify_all();
+  return true;
+}
+
+bool ThreadPool::TakeChunk(size_t worker_index, Chunk* chunk) {
+  {
+    auto& worker = *workers_[worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (!worker.chunks.empty()) {
+      *chunk = worker.chunks.back();
+      worker.chunks.pop_back();
+      return true;
+    }
+  }
+  for (auto offset = 1u; offset < workers_.size(); ++offset) {
+    auto& victim = *workers_[(worker_index + offset) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (victim.chunks.empty())
+      continue;
+    *chunk = victim.chunks.front();
+    victim.chunks.pop_front();
+    ++num_steals_;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::WorkerMain(size_t worker_index) {
+  uint64_t generation = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_condition_.wait(lock, [&]() {
+        return shutting_down_ || generation_ != generation;
+      });
+      if (shutting_down_)
+        return;
+      generation = generation_;
+    }
+    while (RunChunk(worker_index)) {
+    }
+  }
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_threading_thread_pool_h)
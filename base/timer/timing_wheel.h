@@ -0,0 +1,318 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_base_timer_timing_wheel_h)
+#define INCLUDE_base_timer_timing_wheel_h
+
+namespace base {
+
+//////////////////////////////////////////////////////////////////////
+//
+// TimingWheel
+// Hierarchical timing wheel of |kNumLevels| levels of |kNumSlots| slots,
+// each level is a digit of deadline in ticks of |resolution|. A timer is in
+// the level of the highest digit it differs from the current tick, and
+// moves to lower levels when the current tick reaches its slot, so adding
+// and canceling timers are O(1), and firing is O(1) per timer. Each slot
+// caches the earliest tick of its timers, so |NextDeadline()| is O(levels).
+// Canceling the earliest timer of a slot makes the next |NextDeadline()|
+// reaching the slot rescan it.
+//
+// Deadlines are rounded up to ticks, timers never fire before their
+// deadlines. Timers due at the same tick fire in order of adding.
+//
+// Timers live in a pool with free list, and slots are circular lists with
+// sentinel nodes in the same pool. |TimerId| has generation of pool entry,
+// so canceling a fired timer is harmless.
+//
+class TimingWheel final {
+  public: typedef std::function<void()> Callback;
+  // Zero is never used as timer id.
+  public: typedef uint64_t TimerId;
+
+  private: static const int kBitsPerLevel = 8;
+  private: static const int kNumLevels = 64 / kBitsPerLevel;
+  private: static const int kNumSlots = 1 << kBitsPerLevel;
+  private: static const uint32_t kFiringList = kNumLevels * kNumSlots;
+  private: static const uint32_t kFreeList = kFiringList + 1;
+  private: static const uint32_t kNumSentinels = kFreeList + 1;
+  private: static const int kWordsPerLevel = kNumSlots / 64;
+
+  private: struct Node {
+    Callback callback;
+    uint32_t generation;
+    // Index of sentinel of the list containing this node.
+    uint32_t list;
+    uint32_t next;
+    uint32_t previous;
+    uint64_t tick;
+  };
+
+  private: uint64_t current_tick_;
+  // Earliest tick of timers in each slot, ~0 for an empty slot, or zero
+  // if |NextTick()| should rescan the slot. Timers in levels above zero
+  // are never at tick zero, and timers in a slot of level zero share a
+  // tick.
+  private: mutable uint64_t min_ticks_[kNumLevels * kNumSlots];
+  private: std::vector<Node> nodes_;
+  // Bit per non-empty slot.
+  private: uint64_t occupied_[kNumLevels][kWordsPerLevel];
+  private: TimeTicks origin_;
+  private: int64_t resolution_;
+  private: size_t size_;
+
+  public: TimingWheel(TimeTicks now, TimeDelta resolution);
+  public: ~TimingWheel() = default;
+
+  // Number of pending timers.
+  public: size_t size() const { return size_; }
+
+  public: TimerId Add(TimeTicks deadline, const Callback& callback);
+  // Fires timers due at or before |now| and returns number of fired timers.
+  // Callbacks can add and cancel timers, timers added with past deadline
+  // fire in the same call.
+  public: size_t Advance(TimeTicks now);
+  // Returns false if |timer_id| is already fired or canceled.
+  public: bool Cancel(TimerId timer_id);
+  public: bool IsPending(TimerId timer_id) const;
+  // Returns false if there are no timers.
+  public: bool NextDeadline(TimeTicks* deadline) const;
+
+  private: static int CountTrailingZeros(uint64_t value);
+  private: uint32_t FindNode(TimerId timer_id) const;
+  private: int FindSlot(int level, int start) const;
+  private: void Insert(uint32_t index);
+  private: void LinkBefore(uint32_t list, uint32_t index);
+  private: void MoveTo(uint64_t tick);
+  private: uint64_t NextTick() const;
+  private: void Unlink(uint32_t index);
+  private: static int DigitOf(uint64_t tick, int level) {
+    return static_cast<int>(tick >> (level * kBitsPerLevel)) &
+           (kNumSlots - 1);
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(TimingWheel);
+};
+
+TimingWheel::TimingWheel(TimeTicks now, TimeDelta resolution)
+    : current_tick_(0), nodes_(kNumSentinels), occupied_(), origin_(now),
+      resolution_(std::max(resolution.InMicroseconds(),
+                           static_cast<int64_t>(1))),
+      size_(0) {
+  for (auto index = 0u; index < kNumSentinels; ++index) {
+    nodes_[index].list = index;
+    nodes_[index].next = index;
+    nodes_[index].previous = index;
+  }
+  std::fill(min_ticks_, min_ticks_ + kNumLevels * kNumSlots,
+            ~static_cast<uint64_t>(0));
+}
+
+TimingWheel::TimerId TimingWheel::Add(TimeTicks deadline,
+                                      const Callback& callback) {
+  auto index = nodes_[kFreeList].next;
+  if (index == kFreeList) {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(Node());
+  } else {
+    Unlink(index);
+  }
+  auto& node = nodes_[index];
+  node.callback = callback;
+  ++node.generation;
+  // Round up, so timers don't fire early.
+  auto const delta = (deadline - origin_).InMicroseconds();
+  auto const tick = delta <= 0 ? 0 : static_cast<uint64_t>(
+      (delta + resolution_ - 1) / resolution_);
+  node.tick = std::max(tick, current_tick_);
+  Insert(index);
+  ++size_;
+  return static_cast<TimerId>(node.generation) << 32 | index;
+}
+
+size_t TimingWheel::Advance(TimeTicks now) {
+  auto const delta = (now - origin_).InMicroseconds();
+  auto const target = delta <= 0 ? 0 : static_cast<uint64_t>(
+      delta / resolution_);
+  auto num_fired = static_cast<size_t>(0);
+  for (;;) {
+    auto const tick = NextTick();
+    if (tick > target)
+      break;
+    MoveTo(tick);
+
+    // We detach due timers into firing list, callbacks may cancel them.
+    auto const slot = static_cast<uint32_t>(DigitOf(tick, 0));
+    while (nodes_[slot].next != slot) {
+      auto const index = nodes_[slot].next;
+      Unlink(index);
+      LinkBefore(kFiringList, index);
+    }
+    while (nodes_[kFiringList].next != kFiringList) {
+      auto const index = nodes_[kFiringList].next;
+      Unlink(index);
+      LinkBefore(kFreeList, index);
+      --size_;
+      ++num_fired;
+      Callback callback;
+      callback.swap(nodes_[index].callback);
+      callback();
+    }
+  }
+  if (target > current_tick_)
+    MoveTo(target);
+  return num_fired;
+}
+
+bool TimingWheel::Cancel(TimerId timer_id) {
+  auto const index = FindNode(timer_id);
+  if (!index)
+    return false;
+  auto const list = nodes_[index].list;
+  Unlink(index);
+  if (list >= kNumSlots && list < kFiringList &&
+      nodes_[index].tick == min_ticks_[list] && nodes_[list].next != list) {
+    min_ticks_[list] = 0;
+  }
+  LinkBefore(kFreeList, index);
+  nodes_[index].callback = nullptr;
+  --size_;
+  return true;
+}
+
+int TimingWheel::CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+// Returns index of pending timer node, or zero if |timer_id| isn't
+// pending. Zero is a sentinel, never a timer.
+uint32_t TimingWheel::FindNode(TimerId timer_id) const {
+  auto const index = static_cast<uint32_t>(timer_id);
+  if (index < kNumSentinels || index >= nodes_.size())
+    return 0;
+  auto const& node = nodes_[index];
+  if (node.generation != static_cast<uint32_t>(timer_id >> 32) ||
+      node.list == kFreeList) {
+    return 0;
+  }
+  return index;
+}
+
+// Returns the first non-empty slot at or after |start| in |level|, or -1.
+int TimingWheel::FindSlot(int level, int start) const {
+  for (auto word_index = start / 64; word_index < kWordsPerLevel;
+       ++word_index) {
+    auto word = occupied_[level][word_index];
+    if (word_index == start / 64)
+      word &= ~static_cast<uint64_t>(0) << (start % 64);
+    if (word)
+      return word_index * 64 + CountTrailingZeros(word);
+  }
+  return -1;
+}
+
+// Puts a node into the level of the highest digit which differs from the
+// current tick.
+void TimingWheel::Insert(uint32_t index) {
+  auto const tick = nodes_[index].tick;
+  auto const diff = tick ^ current_tick_;
+  auto level = 0;
+  while (level < kNumLevels - 1 &&
+         (diff >> ((level + 1) * kBitsPerLevel))) {
+    ++level;
+  }
+  auto const slot = DigitOf(tick, level);
+  auto const list = static_cast<uint32_t>(level * kNumSlots + slot);
+  LinkBefore(list, index);
+  min_ticks_[list] = std::min(min_ticks_[list], tick);
+  occupied_[level][slot / 64] |= static_cast<uint64_t>(1) << (slot % 64);
+}
+
+bool TimingWheel::IsPending(TimerId timer_id) const {
+  return FindNode(timer_id) != 0;
+}
+
+void TimingWheel::LinkBefore(uint32_t list, uint32_t index) {
+  auto& node = nodes_[index];
+  auto& sentinel = nodes_[list];
+  node.list = list;
+  node.next = list;
+  node.previous = sentinel.previous;
+  nodes_[sentinel.previous].next = index;
+  sentinel.previous = index;
+}
+
+// Moves current tick to |tick|, no timer is due before |tick|. Timers in
+// slots reached by |tick| move to lower levels.
+void TimingWheel::MoveTo(uint64_t tick) {
+  auto const diff = tick ^ current_tick_;
+  current_tick_ = tick;
+  for (auto level = kNumLevels - 1; level > 0; --level) {
+    if (!(diff >> (level * kBitsPerLevel)))
+      continue;
+    auto const list = static_cast<uint32_t>(level * kNumSlots +
+                                            DigitOf(tick, level));
+    while (nodes_[list].next != list) {
+      auto const index = nodes_[list].next;
+      Unlink(index);
+      Insert(index);
+    }
+  }
+}
+
+bool TimingWheel::NextDeadline(TimeTicks* deadline) const {
+  if (!size_)
+    return false;
+  *deadline = origin_ + TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(NextTick()) * resolution_);
+  return true;
+}
+
+// Timers in lower levels are earlier than timers in higher levels, and
+// timers in level zero share a tick in a slot.
+uint64_t TimingWheel::NextTick() const {
+  for (auto level = 0; level < kNumLevels; ++level) {
+    auto const start = level ? DigitOf(current_tick_, level) + 1 :
+                               DigitOf(current_tick_, 0);
+    if (start >= kNumSlots)
+      continue;
+    auto const slot = FindSlot(level, start);
+    if (slot < 0)
+      continue;
+    auto const list = static_cast<uint32_t>(level * kNumSlots + slot);
+    auto& min_tick = min_ticks_[list];
+    if (min_tick)
+      return min_tick;
+    min_tick = ~static_cast<uint64_t>(0);
+    for (auto index = nodes_[list].next; index != list;
+         index = nodes_[index].next) {
+      min_tick = std::min(min_tick, nodes_[index].tick);
+    }
+    return min_tick;
+  }
+  return ~static_cast<uint64_t>(0);
+}
+
+void TimingWheel::Unlink(uint32_t index) {
+  auto& node = nodes_[index];
+  nodes_[node.previous].next = node.next;
+  nodes_[node.next].previous = node.previous;
+  auto const list = node.list;
+  if (list >= kFiringList || nodes_[list].next != list)
+    return;
+  auto const level = list / kNumSlots;
+  auto const slot = list % kNumSlots;
+  min_ticks_[list] = ~static_cast<uint64_t>(0);
+  occupied_[level][slot / 64] &= ~(static_cast<uint64_t>(1) << (slot % 64));
+}
+
+}  // namespace base
+
+#endif //!defined(INCLUDE_base_timer_timing_wheel_h)
@@ -0,0 +1,246 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Keeps one million pending timers with deadlines up to ten minutes, and
+// every millisecond cancels and re-adds a thousand random timers, fires due
+// timers and adds a new timer for each fired timer. Reports time per
+// operation of |base::TimingWheel| and of a multimap ordered by deadline,
+// and checks both fire the same timers in the same order at the same
+// ticks. Then reports time of |NextDeadline()| with only far timers.
+//
+// Returns EXIT_FAILURE if the timing wheel and the multimap fire timers
+// differently, or the next deadline of far timers is wrong.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. base\timer\timing_wheel_benchmark.cc
+//  g++ -std=c++11 -O2 -I. base/timer/timing_wheel_benchmark.cc
+//
+// Usage: timing_wheel_benchmark [num_timers] [num_ticks] [churn]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "base/timer/timing_wheel.h"
+
+namespace {
+
+// Longest delay of timers in milliseconds.
+const int kMaxDelay = 10 * 60 * 1000;
+
+base::TimeTicks ToTimeTicks(int64_t milliseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMilliseconds(milliseconds);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MultimapTimers
+// Timers ordered by deadline in |std::multimap|, O(log n) add and cancel.
+//
+class MultimapTimers final {
+  public: typedef std::function<void()> Callback;
+  public: typedef std::multimap<int64_t, Callback>::iterator TimerId;
+
+  private: std::multimap<int64_t, Callback> timers_;
+
+  public: MultimapTimers() = default;
+  public: ~MultimapTimers() = default;
+
+  public: TimerId Add(base::TimeTicks deadline, const Callback& callback);
+  public: void Advance(base::TimeTicks now);
+  public: void Cancel(TimerId timer_id) { timers_.erase(timer_id); }
+  public: bool NextDeadline(base::TimeTicks* deadline) const;
+
+  DISALLOW_COPY_AND_ASSIGN(MultimapTimers);
+};
+
+MultimapTimers::TimerId MultimapTimers::Add(base::TimeTicks deadline,
+                                            const Callback& callback) {
+  auto const key = (deadline - base::TimeTicks()).InMilliseconds();
+  return timers_.insert(std::make_pair(key, callback));
+}
+
+void MultimapTimers::Advance(base::TimeTicks now) {
+  auto const key = (now - base::TimeTicks()).InMilliseconds();
+  while (!timers_.empty() && timers_.begin()->first <= key) {
+    auto const callback = timers_.begin()->second;
+    timers_.erase(timers_.begin());
+    callback();
+  }
+}
+
+bool MultimapTimers::NextDeadline(base::TimeTicks* deadline) const {
+  if (timers_.empty())
+    return false;
+  *deadline = ToTimeTicks(timers_.begin()->first);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  uint64_t checksum;
+  double seconds;
+  uint64_t num_fired;
+  uint64_t num_operations;
+  // Checksum of next deadline at every tick.
+  uint64_t next_deadlines;
+};
+
+// Runs the same operations on |Timers| with the same seed.
+template<typename Timers>
+Result Run(Timers* timers, size_t num_timers, int num_ticks, int churn) {
+  Result result = Result();
+  std::vector<size_t> fired_slots;
+  std::vector<typename Timers::TimerId> timer_ids(num_timers);
+  uint32_t seed = 1;
+  auto now = static_cast<int64_t>(0);
+  // Callbacks capture a pointer and a slot, to fit in |std::function|
+  // without allocation.
+  auto const fired = [&](size_t slot) {
+    result.checksum = result.checksum * 1000003 + slot;
+    fired_slots.push_back(slot);
+  };
+  auto const add = [&](size_t slot) {
+    auto const deadline = now + 1 + base::NextRandom(&seed) % kMaxDelay;
+    auto const fired_pointer = &fired;
+    timer_ids[slot] = timers->Add(ToTimeTicks(deadline),
+                                  [fired_pointer, slot]() {
+      (*fired_pointer)(slot);
+    });
+  };
+
+  for (auto slot = 0u; slot < num_timers; ++slot)
+    add(slot);
+
+  auto const start = base::TimeTicks::Now();
+  for (auto tick = 0; tick < num_ticks; ++tick) {
+    ++now;
+    for (auto count = 0; count < churn; ++count) {
+      auto const slot = base::NextRandom(&seed) % num_timers;
+      timers->Cancel(timer_ids[slot]);
+      add(slot);
+    }
+    fired_slots.clear();
+    timers->Advance(ToTimeTicks(now));
+    result.num_fired += fired_slots.size();
+    for (auto const slot : fired_slots)
+      add(slot);
+    base::TimeTicks deadline;
+    if (timers->NextDeadline(&deadline)) {
+      result.next_deadlines = result.next_deadlines * 31 +
+                              (deadline - base::TimeTicks()).InMilliseconds();
+    }
+  }
+  result.seconds = (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  result.num_operations = static_cast<uint64_t>(num_ticks) * churn * 2 +
+                          result.num_fired * 2;
+  return result;
+}
+
+// Returns nanoseconds per |NextDeadline()| of |num_timers| timers a minute
+// or two later, as an idle event loop asks. Returns a negative value if
+// the next deadline is wrong, also after canceling the earliest timer.
+double MeasureNextDeadline(int num_timers) {
+  base::TimingWheel wheel(base::TimeTicks(),
+                          base::TimeDelta::FromMilliseconds(1));
+  std::vector<base::TimingWheel::TimerId> timer_ids;
+  uint32_t seed = 3;
+  auto earliest = static_cast<int64_t>(0);
+  auto earliest_id = static_cast<base::TimingWheel::TimerId>(0);
+  auto num_earliest = 0;
+  for (auto count = 0; count < num_timers; ++count) {
+    auto const deadline = 60000 + 1 + 2 * (base::NextRandom(&seed) % 30000);
+    timer_ids.push_back(wheel.Add(ToTimeTicks(deadline), []() {}));
+    if (!earliest || deadline < earliest) {
+      earliest = deadline;
+      earliest_id = timer_ids.back();
+      num_earliest = 0;
+    }
+    num_earliest += deadline == earliest;
+  }
+  wheel.Cancel(earliest_id);
+  wheel.Add(ToTimeTicks(earliest + 1), []() {});
+  auto const expected = ToTimeTicks(num_earliest > 1 ? earliest :
+                                                       earliest + 1);
+  auto const num_calls = 100000;
+  auto valid = true;
+  auto const start = base::TimeTicks::Now();
+  for (auto count = 0; count < num_calls; ++count) {
+    base::TimeTicks deadline;
+    valid &= wheel.NextDeadline(&deadline) &&
+             deadline == expected;
+  }
+  auto const nanoseconds = (base::TimeTicks::Now() - start).InMillisecondsF() *
+                           1e6 / num_calls;
+  return valid ? nanoseconds : -1;
+}
+
+void PrintResult(const char* name, const Result& result) {
+  printf("%-14s %10.3f %12.1f %10llu\n", name, result.seconds,
+         result.seconds * 1e9 / result.num_operations,
+         static_cast<unsigned long long>(result.num_fired));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_timers = argc >= 2 ?
+      static_cast<size_t>(atoi(argv[1])) : 1000000;
+  auto const num_ticks = argc >= 3 ? atoi(argv[2]) : 2000;
+  auto const churn = argc >= 4 ? atoi(argv[3]) : 1000;
+  std::cout << num_timers << " timers, " << num_ticks << " ticks, " <<
+      churn << " cancels per tick" << std::endl;
+
+  printf("%-14s %10s %12s %10s\n", "timers", "seconds", "ns/op", "fired");
+  base::TimingWheel wheel(base::TimeTicks(),
+                          base::TimeDelta::FromMilliseconds(1));
+  auto const wheel_result = Run(&wheel, num_timers, num_ticks, churn);
+  PrintResult("timing wheel", wheel_result);
+  auto const num_pending = wheel.size();
+
+  MultimapTimers multimap;
+  auto const multimap_result = Run(&multimap, num_timers, num_ticks, churn);
+  PrintResult("multimap", multimap_result);
+
+  printf("speedup %.2fx\n", multimap_result.seconds / wheel_result.seconds);
+
+  auto next_deadline_failed = false;
+  for (auto const num_far_timers : {100, 10000, 1000000}) {
+    auto const nanoseconds = MeasureNextDeadline(num_far_timers);
+    printf("next deadline of %d far timers %.1f ns\n", num_far_timers,
+           nanoseconds);
+    next_deadline_failed |= nanoseconds < 0;
+  }
+  if (next_deadline_failed) {
+    printf("FAILED: wrong next deadline of far timers\n");
+    return EXIT_FAILURE;
+  }
+  if (wheel_result.checksum != multimap_result.checksum ||
+      wheel_result.num_fired != multimap_result.num_fired ||
+      wheel_result.next_deadlines != multimap_result.next_deadlines ||
+      num_pending != num_timers) {
+    printf("FAILED: timing wheel fired timers differently\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
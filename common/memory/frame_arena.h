@@ -0,0 +1,323 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_common_memory_frame_arena_h)
+#define INCLUDE_common_memory_frame_arena_h
+
+namespace common {
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameArena
+// Bump allocator for objects which live in a frame, e.g. text of a HUD,
+// temporary geometry and sort keys. All of them are released at once by
+// |Reset()| at the end of the frame, so their destructors must not matter.
+// Each thread has its own arena, see |ForCurrentThread()|.
+//
+// Memory is a list of chunks. When a frame needs more than one chunk,
+// |Reset()| replaces them by one chunk of their total size, so steady state
+// frames don't allocate from the heap.
+//
+class FrameArena final {
+  // Memory of a chunk follows its header.
+  private: struct Chunk {
+    Chunk* next;
+    size_t size;
+  };
+
+  private: Chunk* chunk_;
+  private: char* end_;
+  private: size_t high_water_;
+  private: size_t last_high_water_;
+  private: uint64_t num_chunks_allocated_;
+  private: size_t peak_high_water_;
+  private: char* top_;
+  // Bytes used in chunks before |chunk_| in this frame.
+  private: size_t used_before_;
+
+  public: explicit FrameArena(size_t capacity);
+  public: FrameArena();
+  public: ~FrameArena();
+
+  public: size_t capacity() const;
+  // Bytes used by the last frame at most.
+  public: size_t last_high_water() const { return last_high_water_; }
+  public: uint64_t num_chunks_allocated() const {
+    return num_chunks_allocated_;
+  }
+  // Bytes used by a frame at most since construction.
+  public: size_t peak_high_water() const { return peak_high_water_; }
+  public: size_t used() const;
+
+  private: void AddChunk(size_t min_size);
+  public: void* Allocate(size_t size, size_t alignment);
+  private: static char* DataOf(Chunk* chunk);
+  // Releases memory of the last allocation, e.g. of a growing vector, and
+  // does nothing for others.
+  public: void Deallocate(void* pointer, size_t size);
+  public: static FrameArena* ForCurrentThread();
+  private: void FreeChunks();
+  private: static Chunk* NewChunk(size_t size);
+  public: void Reset();
+
+  DISALLOW_COPY_AND_ASSIGN(FrameArena);
+};
+
+FrameArena::FrameArena(size_t capacity)
+    : chunk_(NewChunk(capacity)), high_water_(0), last_high_water_(0),
+      num_chunks_allocated_(1), peak_high_water_(0), used_before_(0) {
+  top_ = DataOf(chunk_);
+  end_ = top_ + chunk_->size;
+}
+
+FrameArena::FrameArena() : FrameArena(64 * 1024) {
+}
+
+FrameArena::~FrameArena() {
+  FreeChunks();
+}
+
+size_t FrameArena::capacity() const {
+  size_t capacity = 0;
+  for (auto chunk = chunk_; chunk; chunk = chunk->next)
+    capacity += chunk->size;
+  return capacity;
+}
+
+size_t FrameArena::used() const {
+  return used_before_ + static_cast<size_t>(top_ - DataOf(chunk_));
+}
+
+void FrameArena::AddChunk(size_t min_size) {
+  used_before_ = used();
+  auto const chunk = NewChunk(std::max(min_size, chunk_->size * 2));
+  ++num_chunks_allocated_;
+  chunk->next = chunk_;
+  chunk_ = chunk;
+  top_ = DataOf(chunk_);
+  end_ = top_ + chunk_->size;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+  DCHECK(alignment && !(alignment & (alignment - 1)));
+  auto const mask = static_cast<uintptr_t>(alignment - 1);
+  auto start = reinterpret_cast<char*>(
+      (reinterpret_cast<uintptr_t>(top_) + mask) & ~mask);
+  if (start > end_ || size > static_cast<size_t>(end_ - start)) {
+    AddChunk(size + alignment);
+    start = reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(top_) + mask) & ~mask);
+  }
+  top_ = start + size;
+  high_water_ = std::max(high_water_, used());
+  return start;
+}
+
+char* FrameArena::DataOf(Chunk* chunk) {
+  return reinterpret_cast<char*>(chunk + 1);
+}
+
+void FrameArena::Deallocate(void* pointer, size_t size) {
+  if (static_cast<char*>(pointer) + size == top_)
+    top_ = static_cast<char*>(pointer);
+}
+
+FrameArena* FrameArena::ForCurrentThread() {
+  static thread_local FrameArena arena;
+  return &arena;
+}
+
+void FrameArena::FreeChunks() {
+  while (chunk_) {
+    auto const next = chunk_->next;
+    ::operator delete(chunk_);
+    chunk_ = next;
+  }
+}
+
+FrameArena::Chunk* FrameArena::NewChunk(size_t size) {
+  auto const chunk = static_cast<Chunk*>(
+      ::operator new(sizeof(Chunk) + size));
+  chunk->next = nullptr;
+  chunk->size = size;
+  return chunk;
+}
+
+void FrameArena::Reset() {
+  last_high_water_ = high_water_;
+  peak_high_water_ = std::max(peak_high_water_, high_water_);
+  if (chunk_->next) {
+    auto const size = capacity();
+    FreeChunks();
+    chunk_ = NewChunk(size);
+    ++num_chunks_allocated_;
+  }
+  high_water_ = 0;
+  top_ = DataOf(chunk_);
+  end_ = top_ + chunk_->size;
+  used_before_ = 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameAllocator
+// Allocator of standard containers in a |FrameArena|, of the current
+// thread by default. Not final, since containers derive from allocators.
+//
+template<typename T>
+class FrameAllocator {
+  public: typedef T value_type;
+
+  private: FrameArena* arena_;
+
+  public: FrameAllocator() : arena_(FrameArena::ForCurrentThread()) {}
+  public: explicit FrameAllocator(FrameArena* arena) : arena_(arena) {}
+  public: template<typename U>
+          FrameAllocator(const FrameAllocator<U>& other)
+      : arena_(other.arena()) {}
+
+  public: bool operator==(const FrameAllocator& other) const {
+    return arena_ == other.arena_;
+  }
+  public: bool operator!=(const FrameAllocator& other) const {
+    return arena_ != other.arena_;
+  }
+
+  public: FrameArena* arena() const { return arena_; }
+
+  public: T* allocate(size_t count) {
+    return static_cast<T*>(arena_->Allocate(sizeof(T) * count, alignof(T)));
+  }
+  public: void deallocate(T* pointer, size_t count) {
+    arena_->Deallocate(pointer, sizeof(T) * count);
+  }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+typedef std::basic_string<base::char16, std::char_traits<base::char16>,
+                          FrameAllocator<base::char16>> FrameString16;
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameStringBuilder
+// Builds text in a |FrameArena|, as |std::basic_ostringstream| does,
+// without allocating from the heap. Numbers are formatted as the stream
+// does by default.
+//
+class FrameStringBuilder final {
+  private: FrameString16 string_;
+
+  public: explicit FrameStringBuilder(FrameArena* arena);
+  public: FrameStringBuilder();
+  public: ~FrameStringBuilder() = default;
+
+  public: const base::char16* data() const { return string_.data(); }
+  public: size_t size() const { return string_.size(); }
+
+  public: FrameStringBuilder& operator<<(const base::char16* text);
+  public: FrameStringBuilder& operator<<(base::char16 ch);
+  public: FrameStringBuilder& operator<<(double value);
+  public: FrameStringBuilder& operator<<(int value);
+  public: FrameStringBuilder& operator<<(long value);
+  public: FrameStringBuilder& operator<<(long long value);
+  public: FrameStringBuilder& operator<<(unsigned value);
+  public: FrameStringBuilder& operator<<(unsigned long value);
+  public: FrameStringBuilder& operator<<(unsigned long long value);
+
+  private: void AppendAscii(const char* text);
+  private: void AppendSigned(long long value);
+  private: void AppendUnsigned(unsigned long long value);
+
+  DISALLOW_COPY_AND_ASSIGN(FrameStringBuilder);
+};
+
+FrameStringBuilder::FrameStringBuilder(FrameArena* arena)
+    : string_(FrameAllocator<base::char16>(arena)) {
+  string_.reserve(128);
+}
+
+FrameStringBuilder::FrameStringBuilder()
+    : FrameStringBuilder(FrameArena::ForCurrentThread()) {
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(
+    const base::char16* text) {
+  string_.append(text);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(base::char16 ch) {
+  string_.push_back(ch);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(double value) {
+  char buffer[32];
+  ::snprintf(buffer, sizeof(buffer), "%g", value);
+  AppendAscii(buffer);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(int value) {
+  AppendSigned(value);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(long value) {
+  AppendSigned(value);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(long long value) {
+  AppendSigned(value);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(unsigned value) {
+  AppendUnsigned(value);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(unsigned long value) {
+  AppendUnsigned(value);
+  return *this;
+}
+
+FrameStringBuilder& FrameStringBuilder::operator<<(
+    unsigned long long value) {
+  AppendUnsigned(value);
+  return *this;
+}
+
+void FrameStringBuilder::AppendAscii(const char* text) {
+  for (auto runner = text; *runner; ++runner)
+    string_.push_back(static_cast<base::char16>(*runner));
+}
+
+void FrameStringBuilder::AppendSigned(long long value) {
+  if (value >= 0) {
+    AppendUnsigned(static_cast<unsigned long long>(value));
+    return;
+  }
+  string_.push_back('-');
+  // Negates in unsigned, since -LLONG_MIN overflows.
+  AppendUnsigned(0ull - static_cast<unsigned long long>(value));
+}
+
+void FrameStringBuilder::AppendUnsigned(unsigned long long value) {
+  char buffer[24];
+  auto runner = buffer + sizeof(buffer);
+  *--runner = 0;
+  do {
+    *--runner = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value);
+  AppendAscii(runner);
+}
+
+}  // namespace common
+
+#endif //!defined(INCLUDE_common_memory_frame_arena_h)
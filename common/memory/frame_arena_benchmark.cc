@@ -0,0 +1,203 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Runs frames of transient objects, HUD text, temporary geometry and
+// sorted keys of draws, on the heap with |std::basic_ostringstream| and
+// |std::vector|, and in |common::FrameArena|, and reports time and heap
+// allocations per frame, and high water marks of the arena.
+//
+// Returns EXIT_FAILURE if text of |common::FrameStringBuilder| differs from
+// the stream, allocations aren't aligned, the arena doesn't consolidate
+// chunks, or steady state frames in the arena allocate from the heap.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. common\memory\frame_arena_benchmark.cc
+//  g++ -std=c++11 -O2 -I. common/memory/frame_arena_benchmark.cc -ldl
+//
+// Usage: frame_arena_benchmark [num_frames]
+
+#define ENABLE_ALLOCATION_HOOKS
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#undef max
+#undef min
+#else
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/debug/allocation_tracker.h"
+#include "common/memory/frame_arena.h"
+
+namespace {
+
+const int kNumDraws = 256;
+const int kNumLines = 8;
+
+struct Point {
+  float x;
+  float y;
+};
+
+// Keeps the compiler from removing work.
+std::atomic<uint64_t> sink;
+
+template<typename Stream>
+void WriteHud(Stream* stream, int frame) {
+  for (auto line = 0; line < kNumLines; ++line) {
+    *stream << L"(Red) Tick=" << frame * 0.25f << L" " <<
+        static_cast<int64_t>(frame) * 1000 + line << L" " <<
+        static_cast<unsigned>(line) << L"\n";
+  }
+}
+
+template<typename PointVector, typename KeyVector>
+void BuildDraws(PointVector* points, KeyVector* keys, int frame) {
+  for (auto index = 0; index < kNumDraws; ++index) {
+    points->push_back(Point{static_cast<float>(index),
+                            static_cast<float>(frame)});
+    // Sort key of layer, material and depth.
+    keys->push_back(static_cast<uint64_t>((index * 7919 + frame) % 1024) <<
+                    32 | static_cast<uint32_t>(index));
+  }
+  std::sort(keys->begin(), keys->end());
+  sink += keys->front() + static_cast<uint64_t>(points->back().x);
+}
+
+void HeapFrame(int frame) {
+  std::basic_ostringstream<base::char16> stream;
+  WriteHud(&stream, frame);
+  sink += stream.str().size();
+  std::vector<Point> points;
+  std::vector<uint64_t> keys;
+  BuildDraws(&points, &keys, frame);
+}
+
+void ArenaFrame(int frame) {
+  auto const arena = common::FrameArena::ForCurrentThread();
+  {
+    common::FrameStringBuilder text;
+    WriteHud(&text, frame);
+    sink += text.size();
+    common::FrameVector<Point> points;
+    common::FrameVector<uint64_t> keys;
+    BuildDraws(&points, &keys, frame);
+  }
+  arena->Reset();
+}
+
+// Checks formatting of numbers against |std::basic_ostringstream|.
+bool VerifyText() {
+  common::FrameArena arena(64);
+  common::FrameStringBuilder builder(&arena);
+  std::basic_ostringstream<base::char16> stream;
+  builder << L"a" << 0 << L" " << -1 << L" " << LLONG_MIN << L" " <<
+      ULLONG_MAX << L" " << 0.1f << L" " << 1234567.0 << L" " << 1e-7 <<
+      L" " << -2.5 << L" " << 42u << L" " << 7l << L" " << 8ul <<
+      static_cast<base::char16>('!');
+  stream << L"a" << 0 << L" " << -1 << L" " << LLONG_MIN << L" " <<
+      ULLONG_MAX << L" " << 0.1f << L" " << 1234567.0 << L" " << 1e-7 <<
+      L" " << -2.5 << L" " << 42u << L" " << 7l << L" " << 8ul <<
+      static_cast<base::char16>('!');
+  auto const expected = stream.str();
+  return builder.size() == expected.size() &&
+         std::equal(expected.begin(), expected.end(), builder.data());
+}
+
+// Checks alignment, growth into chunks, consolidation by |Reset()| and
+// release of the last allocation.
+bool VerifyArena() {
+  common::FrameArena arena(256);
+  auto const byte = arena.Allocate(1, 1);
+  auto const aligned = arena.Allocate(8, 16);
+  if (reinterpret_cast<uintptr_t>(aligned) % 16 ||
+      static_cast<char*>(aligned) <= static_cast<char*>(byte)) {
+    return false;
+  }
+  for (auto count = 0; count < 100; ++count)
+    arena.Allocate(40, 8);
+  if (arena.num_chunks_allocated() < 3 || arena.used() < 4017)
+    return false;
+  auto const used = arena.used();
+  arena.Reset();
+  if (arena.last_high_water() != used || arena.capacity() < used ||
+      arena.used() != 0) {
+    return false;
+  }
+  // The next frame of the same size fits in one chunk.
+  auto const num_chunks = arena.num_chunks_allocated();
+  for (auto count = 0; count < 100; ++count)
+    arena.Allocate(40, 8);
+  auto const last = arena.Allocate(100, 1);
+  arena.Deallocate(last, 100);
+  return arena.num_chunks_allocated() == num_chunks &&
+         arena.Allocate(100, 1) == last;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_frames = argc >= 2 ? atoi(argv[1]) : 100000;
+  std::cout << num_frames << " frames of " << kNumLines << " lines and " <<
+      kNumDraws << " draws" << std::endl;
+  auto failed = false;
+  if (!VerifyText()) {
+    printf("FAILED: text differs from stream\n");
+    failed = true;
+  }
+  if (!VerifyArena()) {
+    printf("FAILED: wrong arena allocations\n");
+    failed = true;
+  }
+
+  // Warms up the arena to its steady state size.
+  ArenaFrame(0);
+  printf("%-20s %10s %10s\n", "frame", "ns", "allocs");
+  uint64_t arena_allocations = 0;
+  for (auto use_arena = 0; use_arena < 2; ++use_arena) {
+    auto const counts_before = base::AllocationTracker::counts();
+    auto const start = base::TimeTicks::Now();
+    for (auto frame = 0; frame < num_frames; ++frame) {
+      if (use_arena)
+        ArenaFrame(frame);
+      else
+        HeapFrame(frame);
+    }
+    auto const frame_ns = (base::TimeTicks::Now() - start)
+        .InMillisecondsF() * 1e6 / num_frames;
+    auto const num_allocations = base::AllocationTracker::counts()
+        .num_allocations - counts_before.num_allocations;
+    printf("%-20s %10.0f %10.1f\n", use_arena ? "frame arena" : "heap",
+           frame_ns, static_cast<double>(num_allocations) / num_frames);
+    if (use_arena)
+      arena_allocations = num_allocations;
+  }
+  auto const arena = common::FrameArena::ForCurrentThread();
+  printf("arena: high water %u bytes last frame, %u bytes peak, capacity %u"
+         " bytes\n", static_cast<unsigned>(arena->last_high_water()),
+         static_cast<unsigned>(arena->peak_high_water()),
+         static_cast<unsigned>(arena->capacity()));
+  if (arena_allocations) {
+    printf("FAILED: steady state frames allocate from heap\n");
+    failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,125 +1,125 @@
-// Copyright (c) 2014 Project Vogue. All rights reserved.
-// Use of this source code is governed by a BSD-style license that can be
-// found in the LICENSE file.
-
-#if !defined(INCLUDE_common_win_scoped_comptr_h)
-#define INCLUDE_common_win_scoped_comptr_h
-
-namespace common {
-
-//////////////////////////////////////////////////////////////////////
-//
-// ComPtr
-//
-template<class T> class ComPtr {
-  private: T* ptr_;
-  public: explicit ComPtr(T* ptr = nullptr) : ptr_(ptr) {
-    if (ptr_)
-      ptr_->AddRef();
-  }
-  public: explicit ComPtr(T& ptr) : ptr_(&ptr) {}
-  public: ComPtr(const ComPtr& other) : ptr_(other.ptr_) {
-    if (ptr_)
-      ptr_->AddRef();
-  }
-  public: ComPtr(ComPtr&& other) : ptr_(other.ptr_) {
-    other.ptr_ = nullptr;
-  }
-  public: ~ComPtr() {
-    reset();
-  }
-  public: operator T*() const { return ptr_; }
-  public: explicit operator bool() const { return ptr_; }
-  public: T* operator->() const { return ptr_; }
-  public: T** operator&() {
-    DCHECK(!ptr_) << "Leak COM interface";
-    return &ptr_;
-  }
-  public: bool operator!() const { return !ptr_; }
-
-  public: bool operator==(const ComPtr& other) const {
-    return ptr_ == other.ptr_;
-  }
-
-  public: bool operator==(T* other) const {
-    return ptr_ == other;
-  }
-
-  public: bool operator!=(const ComPtr& other) const {
-    return ptr_ != other.ptr_;
-  }
-
-  public: bool operator!=(T* other) const {
-    return ptr_ != other;
-  }
-
-  public: ComPtr& operator=(const ComPtr& other) {
-    ptr_ = other.ptr_;
-    if (ptr_)
-      ptr_->AddRef();
-  }
-
-  public: ComPtr& operator=(ComPtr&& other) {
-    ptr_ = other.ptr_;
-    other.ptr_ = nullptr;
-    return *this;
-  }
-
-  public: ComPtr& operator=(T* ptr) = delete;
-
-  public: T* get() const { return ptr_; }
-
-  public: void** location() {
-    DCHECK(!ptr_) << "Leak COM interface";
-    return reinterpret_cast<void**>(&ptr_);
-  }
-
-  public: IUnknown** locationUnknown() {
-    DCHECK(!ptr_) << "Leak COM interface";
-    return reinterpret_cast<IUnknown**>(&ptr_);
-  }
-
-  public: T* release() {
-    DCHECK(ptr_) << "Give ownership for uninitialized object";
-    auto const ret = ptr_;
-    ptr_ = nullptr;
-    return ret;
-  }
-
-  public: void reset(T* ptr) {
-    if (ptr_)
-      ptr_->Release();
-    ptr_ = ptr;
-    if (ptr_)
-      ptr_->AddRef();
-  }
-
-  public: void reset() {
-    if (ptr_)
-      ptr_->Release();
-    ptr_ = nullptr;
-  }
-
-  public: void MustBeNoOtherUse() {
-    auto const ref_count = ptr_->AddRef();
-    ptr_->Release();
-    DCHECK_EQ(ref_count, 2);
-  }
-
-  public: HRESULT QueryFrom(IUnknown* other) {
-    return other->QueryInterface(__uuidof(T), location());
-  }
-};
-
-class ComInitializer {
-  public: ComInitializer() {
-    COM_VERIFY(::CoInitialize(nullptr));
-  }
-  public: ~ComInitializer() {
-    ::CoUninitialize();
-  }
-};
-
-}  // namespace common
-
-#endif //!defined(INCLUDE_common_win_scoped_comptr_h)
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_common_win_scoped_comptr_h)
+#define INCLUDE_common_win_scoped_comptr_h
+
+namespace common {
+
+//////////////////////////////////////////////////////////////////////
+//
+// ComPtr
+//
+template<class T> class ComPtr {
+  private: T* ptr_;
+  public: explicit ComPtr(T* ptr = nullptr) : ptr_(ptr) {
+    if (ptr_)
+      ptr_->AddRef();
+  }
+  public: explicit ComPtr(T& ptr) : ptr_(&ptr) {}
+  public: ComPtr(const ComPtr& other) : ptr_(other.ptr_) {
+    if (ptr_)
+      ptr_->AddRef();
+  }
+  public: ComPtr(ComPtr&& other) : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+  public: ~ComPtr() {
+    reset();
+  }
+  public: operator T*() const { return ptr_; }
+  public: explicit operator bool() const { return ptr_; }
+  public: T* operator->() const { return ptr_; }
+  public: T** operator&() {
+    DCHECK(!ptr_) << "Leak COM interface";
+    return &ptr_;
+  }
+  public: bool operator!() const { return !ptr_; }
+
+  public: bool operator==(const ComPtr& other) const {
+    return ptr_ == other.ptr_;
+  }
+
+  public: bool operator==(T* other) const {
+    return ptr_ == other;
+  }
+
+  public: bool operator!=(const ComPtr& other) const {
+    return ptr_ != other.ptr_;
+  }
+
+  public: bool operator!=(T* other) const {
+    return ptr_ != other;
+  }
+
+  public: ComPtr& operator=(const ComPtr& other) {
+    ptr_ = other.ptr_;
+    if (ptr_)
+      ptr_->AddRef();
+  }
+
+  public: ComPtr& operator=(ComPtr&& other) {
+    ptr_ = other.ptr_;
+    other.ptr_ = nullptr;
+    return *this;
+  }
+
+  public: ComPtr& operator=(T* ptr) = delete;
+
+  public: T* get() const { return ptr_; }
+
+  public: void** location() {
+    DCHECK(!ptr_) << "Leak COM interface";
+    return reinterpret_cast<void**>(&ptr_);
+  }
+
+  public: IUnknown** locationUnknown() {
+    DCHECK(!ptr_) << "Leak COM interface";
+    return reinterpret_cast<IUnknown**>(&ptr_);
+  }
+
+  public: T* release() {
+    DCHECK(ptr_) << "Give ownership for uninitialized object";
+    auto const ret = ptr_;
+    ptr_ = nullptr;
+    return ret;
+  }
+
+  public: void reset(T* ptr) {
+    if (ptr_)
+      ptr_->Release();
+    ptr_ = ptr;
+    if (ptr_)
+      ptr_->AddRef();
+  }
+
+  public: void reset() {
+    if (ptr_)
+      ptr_->Release();
+    ptr_ = nullptr;
+  }
+
+  public: void MustBeNoOtherUse() {
+    auto const ref_count = ptr_->AddRef();
+    ptr_->Release();
+    DCHECK_EQ(ref_count, 2);
+  }
+
+  public: HRESULT QueryFrom(IUnknown* other) {
+    return other->QueryInterface(__uuidof(T), location());
+  }
+};
+
+class ComInitializer {
+  public: ComInitializer() {
+    COM_VERIFY(::CoInitialize(nullptr));
+  }
+  public: ~ComInitializer() {
+    ::CoUninitialize();
+  }
+};
+
+}  // namespace common
+
+#endif //!defined(INCLUDE_common_win_scoped_comptr_h)
@@ -1,1696 +1,2180 @@
-// C4530 L1: C++ exception handler used, but unwind semantics are not enabled.
-// Specify /EHsc
-#pragma warning(disable: 4530)
-
-#define UNICODE
-#define WIN32_LEAN_AND_MEAN
-#define WINVER 0x0700
-#define _WIN32_WINNT 0x0700
-#include <windows.h>
-#undef max
-#undef min
-#include <dcomp.h>
-#include <d3d11.h>
-#include <d2d1.h>
-#include <d2d1helper.h>
-#include <dwmapi.h>
-#include <dwrite.h>
-#include <dxgi1_3.h>
-#include <dxgidebug.h>
-
-#include <algorithm>
-#include <iostream>
-#include <limits>
-#include <list>
-#include <memory>
-#include <string>
-#include <sstream>
-#include <unordered_set>
-
-#include <commctrl.h>
-//#pragma comment(lib, "commctrl.lib")
-
-#pragma comment(lib, "d2d1.lib")
-#pragma comment(lib, "d3d11.lib")
-#pragma comment(lib, "dcomp.lib")
-#pragma comment(lib, "dwmapi.lib")
-#pragma comment(lib, "dwrite.lib")
-#pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "gdi32.lib")
-#pragma comment(lib, "ole32.lib")
-#pragma comment(lib, "user32.lib")
-
-#include "base/basictypes.h"
-#include "base/time/time.h"
-#include "common/memory/singleton.h"
-#include "common/win/scoped_comptr.h"
-#include "gfx/gfx.h"
-
-namespace ui {
-
-class Animatable;
-
-//////////////////////////////////////////////////////////////////////
-//
-// Animation
-//
-class Animation  {
-  public: enum class FillMode {
-    Auto,
-    Backward,
-    Both,
-    Forward,
-    None,
-  };
-
-  public: enum class PlaybackDirection {
-    Alternate,
-    AlternateReverse,
-    Normal,
-    Reverse,
-  };
-
-  public: enum class State {
-    Finish,
-    NotStarted,
-    Running,
-  };
-
-  public: struct Timing {
-    base::TimeDelta delay;
-    PlaybackDirection direction;
-    base::TimeDelta duration;
-    base::TimeDelta end_delay;
-    FillMode fill;
-    double iterations;
-    base::TimeDelta iteration_start;
-
-    Timing();
-    ~Timing() = default;
-  };
-
-  public: class Variable {
-    private: double end_value_;
-    private: double start_value_;
-
-    public: Variable(double start_value, double end_value);
-    public: ~Variable() = default;
-
-    public: double end_value() const { return end_value_; }
-    public: double start_value() const { return start_value_; }
-
-    DISALLOW_COPY_AND_ASSIGN(Variable);
-  };
-
-  private: Animatable* animatable_;
-  private: base::TimeTicks current_time_;
-  private: State state_;
-  private: base::TimeTicks start_time_;
-  private: Timing timing_;
-
-  public: Animation(Animatable* animatable, const Timing& timing);
-  public: ~Animation();
-
-  public: Variable* CreateVariable(double start_value, double end_value);
-  public: double GetDouble(const Variable* variable) const;
-  public: void Play(base::TimeTicks time);
-  public: void Start(base::TimeTicks time);
-  public: void Stop();
-
-  DISALLOW_COPY_AND_ASSIGN(Animation);
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// Animatable
-//
-class Animatable {
-  public: Animatable() = default;
-  public: virtual ~Animatable() = default;
-
-  public: virtual void DidFinishAnimation() = 0;
-  public: virtual void DidFireAnimationTimer() = 0;
-
-  DISALLOW_COPY_AND_ASSIGN(Animatable);
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// Animation
-//
-Animation::Animation(Animatable* animatable, const Timing& timing)
-    : animatable_(animatable), state_(State::NotStarted), timing_(timing) {
-}
-
-Animation::~Animation() {
-}
-
-Animation::Variable* Animation::CreateVariable(double start_value,
-                                               double end_value) {
-  return new Variable(start_value, end_value);
-}
-
-double Animation::GetDouble(const Variable* variable) const {
-  DCHECK_EQ(state_, State::Running);
-  auto const max_time = start_time_ + timing_.delay + timing_.duration;
-  auto const animate_start_time = start_time_ + timing_.delay;
-  auto const animate_time = std::min(current_time_, max_time);
-  auto const duration = timing_.duration - timing_.delay - timing_.end_delay;
-  auto const scale = (animate_time - animate_start_time).InMillisecondsF() /
-      duration.InMillisecondsF();
-  auto const span = variable->end_value() - variable->start_value();
-  return variable->start_value() + span * scale;
-}
-
-void Animation::Play(base::TimeTicks current_time) {
-  if (state_ == State::NotStarted) {
-    Start(current_time);
-    return;
-  }
-  if (state_ != State::Running)
-    return;
-  current_time_ = current_time;
-  if (current_time_ < start_time_ + timing_.delay)
-    return;
-  animatable_->DidFireAnimationTimer();
-  if (current_time < start_time_ + timing_.duration)
-    return;
-  state_ = State::Finish;
-  animatable_->DidFinishAnimation();
-}
-
-void Animation::Start(base::TimeTicks time_ticks) {
-  DCHECK_EQ(state_, State::NotStarted);
-  state_ = State::Running;
-  start_time_ = time_ticks;
-  current_time_ = time_ticks;
-}
-
-void Animation::Stop() {
-  Play(start_time_ + timing_.delay + timing_.duration);
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// Animation::Timing
-//
-Animation::Timing::Timing()
-    : direction(PlaybackDirection::Normal), fill(FillMode::None),
-      iterations(0) {
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// Animation::Variable
-//
-Animation::Variable::Variable(double start_value, double end_value)
-    : end_value_(end_value), start_value_(start_value) {
-}
-
-}  // namespace ui
-
-namespace ui {
-
-class Layer;
-
-//////////////////////////////////////////////////////////////////////
-//
-// ui::Compositor
-//
-class Compositor {
-  private: common::ComPtr<IDCompositionDesktopDevice> composition_device_;
-  private: common::ComPtr<IDCompositionTarget> composition_target_;
-  private: gfx::DxDevice* dx_device_;
-  private: bool need_commit_;
-
-  public: Compositor(gfx::DxDevice* dx_device);
-  public: ~Compositor();
-
-  public: IDCompositionDesktopDevice* device() const {
-    return composition_device_;
-  }
-  public: gfx::DxDevice* dx_device() const { return dx_device_; }
-
-  public: void Commit();
-  public: common::ComPtr<IDCompositionVisual2> CreateVisual();
-  public: void NeedCommit() { need_commit_ = true; }
-  public: void SetTarget(HWND hwnd, Layer* layer);
-
-  DISALLOW_COPY_AND_ASSIGN(Compositor);
-};
-
-Compositor::Compositor(gfx::DxDevice* dx_device)
-    : dx_device_(dx_device), need_commit_(false) {
-  COM_VERIFY(::DCompositionCreateDevice2(
-      dx_device->d2d_device(),
-      IID_PPV_ARGS(&composition_device_)));
-  composition_device_.MustBeNoOtherUse();
-}
-
-Compositor::~Compositor() {
-  composition_target_.MustBeNoOtherUse();
-  composition_target_.reset();
-}
-
-void Compositor::Commit() {
-  if (!need_commit_)
-    return;
-  COM_VERIFY(composition_device_->Commit());
-  need_commit_ = false;
-}
-
-common::ComPtr<IDCompositionVisual2> Compositor::CreateVisual() {
-  common::ComPtr<IDCompositionVisual2> visual;
-  COM_VERIFY(composition_device_->CreateVisual(&visual));
-  return visual;
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// ui::Layer
-//
-class Layer : protected ui::Animatable {
-  private: std::unique_ptr<ui::Animation> animation_;
-  private: gfx::RectF bounds_;
-  private: std::vector<Layer*> child_layers_;
-  private: Compositor* compositor_;
-  private: bool is_active_;
-  private: common::ComPtr<IDCompositionVisual2> visual_;
-
-  public: Layer(Compositor* compositor);
-  public: virtual ~Layer();
-
-  public: Compositor* compositor() const { return compositor_; }
-  public: operator IDCompositionVisual2*() const { return visual_; }
-
-  public: const gfx::RectF& bounds() const { return bounds_; }
-  protected: bool is_active() const { return is_active_; }
-  public: IDCompositionVisual2* visual() const { return visual_; }
-
-  public: void AppendChild(Layer* new_child);
-  public: virtual void DidActive();
-  protected: virtual void DidChangeBounds();
-  public: virtual void DidInactive();
-  public: virtual bool DoAnimate(base::TimeTicks tick_count);
-  public: void SetBounds(const gfx::RectF& new_bounds);
-
-  // ui::Animatable
-  private: virtual void DidFinishAnimation() override;
-  private: virtual void DidFireAnimationTimer() override;
-
-  DISALLOW_COPY_AND_ASSIGN(Layer);
-};
-
-void Compositor::SetTarget(HWND hwnd, Layer* layer) {
-  // Set composition target to this window.
-  COM_VERIFY(composition_device_->CreateTargetForHwnd(
-      hwnd, false, &composition_target_));
-  composition_target_.MustBeNoOtherUse();
-  COM_VERIFY(composition_target_->SetRoot(layer->visual()));
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// Layer
-//
-Layer::Layer(Compositor* compositor)
-    : compositor_(compositor), is_active_(false),
-      visual_(compositor->CreateVisual()) {
-  COM_VERIFY(visual_->SetBitmapInterpolationMode(
-      DCOMPOSITION_BITMAP_INTERPOLATION_MODE_LINEAR));
-  COM_VERIFY(visual_->SetBorderMode(DCOMPOSITION_BORDER_MODE_SOFT));
-
-  common::ComPtr<IDCompositionVisualDebug> debug_visual;
-  COM_VERIFY(debug_visual.QueryFrom(visual_));
-  // TODO(eval1749) It seems heat map is painted with alpha=1.0.
-  //COM_VERIFY(debug_visual->EnableHeatMap(gfx::ColorF(255, 255, 0, 0.1)));
-  //COM_VERIFY(debug_visual->EnableRedrawRegions());
-}
-
-Layer::~Layer() {
-  visual_->SetContent(nullptr);
-  visual_->RemoveAllVisuals();
-}
-
-void Layer::AppendChild(Layer* new_child) {
-  child_layers_.push_back(new_child);
-  COM_VERIFY(visual_->AddVisual(new_child->visual_, true, nullptr));
-}
-
-void Layer::DidActive() {
-  if (is_active_)
-    return;
-  is_active_ = true;
-  for (auto const child : child_layers_) {
-    child->DidActive();
-  }
-}
-
-void Layer::DidChangeBounds() {
-}
-
-void Layer::DidInactive() {
-  if (!is_active_)
-    return;
-  is_active_ = false;
-  for (auto const child : child_layers_) {
-    child->DidInactive();
-  }
-}
-
-bool Layer::DoAnimate(base::TimeTicks tick_count) {
-  auto animated = false;
-  for (auto const child : child_layers_) {
-    animated |= child->DoAnimate(tick_count);
-  }
-  return animated;
-}
-
-void Layer::SetBounds(const gfx::RectF& new_bounds) {
-  auto changed = false;
-  if (bounds_.left() != new_bounds.left()) {
-    COM_VERIFY(visual_->SetOffsetX(new_bounds.left()));
-    bounds_.set_origin(gfx::PointF(new_bounds.left(), bounds_.top()));
-    changed = true;
-  }
-  if (bounds_.top () != new_bounds.top()) {
-    COM_VERIFY(visual_->SetOffsetY(new_bounds.top()));
-    bounds_.set_origin(gfx::PointF(bounds_.left(), new_bounds.top()));
-    changed = true;
-  }
-
-  if (bounds_.size() != new_bounds.size()) {
-    bounds_.set_size(new_bounds.size());
-    changed = true;
-  }
-
-  if (!changed)
-    return;
-
-  DidChangeBounds();
-}
-
-// ui::Animation
-void Layer::DidFinishAnimation() {
-  animation_.reset();
-}
-
-void Layer::DidFireAnimationTimer() {
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// SimpleLayer
-// This class represents a layer with direct composition surface.
-//
-class SimpleLayer : public Layer {
-  public: class ScopedCanvas {
-    private: common::ComPtr<ID2D1DeviceContext> d2d_device_context_;
-    private: SimpleLayer* layer_;
-    private: gfx::RectF bounds_;
-
-    public: ScopedCanvas(SimpleLayer* layer);
-    public: ~ScopedCanvas();
-
-    public: ID2D1DeviceContext* d2d_device_context() const {
-      return d2d_device_context_;
-    }
-    public: const gfx::RectF& bounds() const { return bounds_; }
-  };
-  friend class ScopedCanvas;
-
-  private: common::ComPtr<IDCompositionSurface> surface_;
-
-  public: SimpleLayer(Compositor* compositor);
-  public: virtual ~SimpleLayer();
-
-  private: void AttachSurfaceIfNeeded();
-
-  // ui::Layer
-  protected: virtual void DidChangeBounds() override;
-
-  DISALLOW_COPY_AND_ASSIGN(SimpleLayer);
-};
-
-SimpleLayer::SimpleLayer(Compositor* compositor)
-    : Layer(compositor) {
-}
-
-SimpleLayer::~SimpleLayer() {
-}
-
-void SimpleLayer::AttachSurfaceIfNeeded() {
-  DCHECK(!bounds().empty());
-  if (surface_)
-    return;
-  COM_VERIFY(compositor()->device()->CreateSurface(
-      bounds().width(), bounds().height(),
-      DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ALPHA_MODE_PREMULTIPLIED, &surface_));
-  COM_VERIFY(visual()->SetContent(surface_));
-}
-
-// ui::Layer
-void SimpleLayer::DidChangeBounds() {
-  Layer::DidChangeBounds();
-  surface_.reset();
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// SimpleLayer::ScopedCanvas
-//
-SimpleLayer::ScopedCanvas::ScopedCanvas(SimpleLayer* layer) : layer_(layer) {
- layer_->AttachSurfaceIfNeeded();
-
-  POINT offset;
-  COM_VERIFY(layer_->surface_->BeginDraw(
-      nullptr, IID_PPV_ARGS(&d2d_device_context_), &offset));
-  bounds_ = gfx::RectF(gfx::PointF(static_cast<float>(offset.x),
-                                   static_cast<float>(offset.y)),
-                       layer_->bounds().size());
-}
-
-SimpleLayer::ScopedCanvas::~ScopedCanvas() {
-  // Note: We also need to call DDirectCompositionDevice::Commit() for making
-  // canvas appeared in screen.
-  COM_VERIFY(layer_->surface_->EndDraw());
-}
-
-}  // namespace ui
-
-namespace ui {
-
-//////////////////////////////////////////////////////////////////////
-//
-// Window
-//
-class Window {
-  protected: class Creator {
-    public: Creator(Window* window);
-    public: ~Creator();
-  };
-  friend class Creator;
-
-  private: RECT bounds_;
-  private: HWND hwnd_;
-  private: bool is_active_;
-
-  protected: Window();
-  protected: ~Window();
-
-  public: operator HWND() const { return hwnd_; }
-
-  public: const RECT& bounds() const { return bounds_; }
-  public: bool is_active() const { return is_active_; }
-
-  protected: virtual void DidActive();
-  protected: virtual void DidChangeBounds();
-  protected: virtual void DidCreate();
-  protected: virtual void DidInactive();
-
-  protected: static LPWSTR GetWindowClass();
-  private: static Window* GetWindowFromHwnd(HWND hwnd);
-  protected: virtual LRESULT OnMessage(UINT message, WPARAM wParam,
-                                       LPARAM lParam);
-  protected: virtual void WillDestroy();
-  private: static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message,
-                                              WPARAM wParam, LPARAM lParam);
-
-  DISALLOW_COPY_AND_ASSIGN(Window);
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// Window::Creator
-//
-static Window* global_creating_window;
-
-Window::Creator::Creator(Window* window) {
-  global_creating_window = window;
-}
-
-Window::Creator::~Creator(){
-  global_creating_window = nullptr;
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// Window
-//
-Window::Window() : hwnd_(nullptr), is_active_(false) {
-}
-
-Window::~Window() {
-}
-
-void Window::DidActive() {
-  is_active_ = true;
-}
-
-void Window::DidChangeBounds() {
-}
-
-void Window::DidCreate() {
-}
-
-void Window::DidInactive() {
-  is_active_ = false;
-}
-
-LPWSTR Window::GetWindowClass() {
-  static LPWSTR class_name;
-  if (class_name)
-    return class_name;
-  WNDCLASSEX wcex = { sizeof(WNDCLASSEX) };
-  wcex.style = CS_HREDRAW | CS_VREDRAW;
-  wcex.lpfnWndProc = Window::WindowProc;
-  wcex.cbClsExtra = 0;
-  wcex.cbWndExtra = sizeof(LONG_PTR);
-  wcex.hInstance = HINST_THISCOMPONENT;
-  wcex.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW+1);;
-  wcex.lpszMenuName = nullptr;
-  wcex.hCursor = ::LoadCursor(nullptr, IDC_ARROW);
-  wcex.lpszClassName = L"Window";
-  class_name = MAKEINTATOM(::RegisterClassEx(&wcex));
-  return class_name;
-}
-
-Window* Window::GetWindowFromHwnd(HWND hwnd) {
-  auto const window = reinterpret_cast<Window*>(
-      ::GetWindowLongPtr(hwnd, GWLP_USERDATA));
-  if (window)
-    return window;
-  ::SetWindowLongPtr(hwnd, GWLP_USERDATA,
-                     reinterpret_cast<LONG_PTR>(global_creating_window));
-  global_creating_window->hwnd_ = hwnd;
-  return global_creating_window;
-}
-
-LRESULT Window::OnMessage(UINT message, WPARAM wParam, LPARAM lParam) {
-  switch (message) {
-    case WM_ACTIVATE:
-      is_active_ = wParam != WA_INACTIVE;
-      if (is_active_)
-        DidActive();
-      else
-        DidInactive();
-      return 0;
-    case WM_CREATE:
-      ::GetClientRect(*this, &bounds_);
-      DidCreate();
-      return 1;
-    case WM_DESTROY:
-      WillDestroy();
-      break;
-    case WM_NCDESTROY:
-      ::PostQuitMessage(0);
-      return TRUE;
-    case WM_WINDOWPOSCHANGED: {
-      auto const wp = reinterpret_cast<WINDOWPOS*>(lParam);
-      if (wp->flags & SWP_NOSIZE)
-        return 0;
-      if (!::IsIconic(*this)) {
-        ::GetClientRect(*this, &bounds_);
-        DidChangeBounds();
-      }
-      return 0;
-    }
-  }
-  return ::DefWindowProc(hwnd_, message, wParam, lParam);
-}
-
-LRESULT Window::WindowProc(HWND hwnd, UINT message, WPARAM wParam,
-                          LPARAM lParam) {
-  auto const window = GetWindowFromHwnd(hwnd);
-  return window->OnMessage(message, wParam, lParam);
-}
-
-void Window::WillDestroy() {
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// Schedulable
-//
-class Schedulable {
-  protected: Schedulable() = default;
-  protected: virtual ~Schedulable() = default;
-
-  public: virtual void DoAnimate() = 0;
-
-  DISALLOW_COPY_AND_ASSIGN(Schedulable);
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// Scheduler
-//
-class Scheduler final : public common::Singleton<Scheduler> {
-  public: enum class Method {
-    NoWait, // NoPresentContent=3901 9649 5344, CPU=26%
-    Timer, // NoPresentContent=0 1 0, CPU=12%
-    Waitable, // NoPresentContent=0 8 3, CPU=18%
-  };
-
-  private: std::unordered_set<Schedulable*> animators_;
-
-  public: explicit Scheduler();
-  public: virtual ~Scheduler();
-
-  public: void Add(Schedulable* animator);
-  private: void DidFireTimer();
-  public: void Run(Method method = Method::Waitable);
-
-  private: static void CALLBACK TimerProc(HWND hwnd, UINT message,
-                                          UINT_PTR timer_id, DWORD time);
-  DISALLOW_COPY_AND_ASSIGN(Scheduler);
-};
-
-Scheduler::Scheduler() {
-}
-
-Scheduler::~Scheduler() {
-}
-
-void Scheduler::Add(Schedulable* animator) {
-  animators_.insert(animator);
-}
-
-void Scheduler::DidFireTimer() {
-  for (auto const animator : animators_) {
-    animator->DoAnimate();
-  }
-}
-
-void Scheduler::Run(Method method) {
-  switch (method) {
-    case Method::Timer: {
-      ::SetTimer(nullptr, reinterpret_cast<UINT_PTR>(this), 1,
-                 Scheduler::TimerProc);
-      MSG msg;
-      while (::GetMessage(&msg, nullptr, 0, 0)) {
-        ::TranslateMessage(&msg);
-        ::DispatchMessage(&msg);
-      }
-      return;
-    }
-    case Method::NoWait:
-    case Method::Waitable: {
-      auto const waitable = method == Method::NoWait ? nullptr :
-        ::CreateEvent(nullptr, false, false, nullptr);
-      MSG msg;
-      for (;;) {
-        if (::PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE)) {
-          if (!::GetMessage(&msg, nullptr, 0, 0))
-            break;
-          ::TranslateMessage(&msg);
-          ::DispatchMessage(&msg);
-        } else {
-          if (waitable)
-            ::WaitForSingleObject(waitable, 1);
-          DidFireTimer();
-        }
-      }
-      if (waitable)
-        ::CloseHandle(waitable);
-      return;
-    }
-  }
-  NOTREACHED();
-}
-
-void CALLBACK Scheduler::TimerProc(HWND, UINT, UINT_PTR, DWORD) {
-  Scheduler::instance()->DidFireTimer();
-}
-
-}  // namespace ui
-
-namespace my {
-
-//////////////////////////////////////////////////////////////////////
-//
-// Sampling
-//
-class Sampling {
-  private: float maximum_;
-  private: float minimum_;
-  private: size_t max_samples_;
-  private: std::list<float> samples_;
-
-  public: Sampling(size_t max_samples = 100);
-  public: ~Sampling() = default;
-
-  public: float last() const { return samples_.back(); }
-  public: float maximum() const { return maximum_; }
-  public: float minimum() const { return minimum_; }
-
-  public: void AddSample(base::TimeDelta sample);
-  public: void AddSample(float sample);
-  public: void Paint(ID2D1RenderTarget* canvas, const gfx::Brush& brush,
-                     const gfx::RectF& bounds) const;
-
-  DISALLOW_COPY_AND_ASSIGN(Sampling);
-};
-
-Sampling::Sampling(size_t max_samples) :
-    max_samples_(max_samples), samples_(max_samples) {
-  maximum_ = minimum_ = samples_.front();
-}
-
-void Sampling::AddSample(base::TimeDelta sample) {
-  AddSample(sample.InMillisecondsF());
-}
-
-void Sampling::AddSample(float sample) {
-  auto const discard_sample = samples_.front();
-  samples_.pop_front();
-  samples_.push_back(sample);
-  if (discard_sample != maximum_ && discard_sample != minimum_)
-    return;
-  maximum_ = minimum_ = samples_.front();
-  for (auto const sample : samples_) {
-    maximum_ = std::max(maximum_, sample);
-    minimum_ = std::min(minimum_, sample);
-  }
-}
-
-void Sampling::Paint(ID2D1RenderTarget* canvas, const gfx::Brush& brush,
-                     const gfx::RectF& bounds) const {
-  auto const maximum = maximum_ * 1.1f;
-  auto const minimum = minimum_ * 0.9f;
-  auto const span = maximum == minimum ? 1.0f : maximum - minimum;
-  auto const scale = bounds.height() / span;
-  auto  last_point = gfx::PointF(
-      bounds.left(), bounds.bottom() - (samples_.front() - minimum_) * scale);
-  auto x_step = bounds.width() / samples_.size();
-  auto sum = 0.0f;
-  for (auto const sample : samples_) {
-    sum += sample;
-    auto const curr_point = gfx::PointF(
-        last_point.x() + x_step, bounds.bottom() - (sample - minimum_) * scale);
-    canvas->DrawLine(last_point, curr_point, brush, 1.0f);
-    last_point = curr_point;
-  }
-  auto const avg = sum / samples_.size();
-  auto const avg_y = bounds.bottom()- (avg - minimum_) * scale;
-  canvas->DrawLine(gfx::PointF(bounds.left(), avg_y),
-                   gfx::PointF(bounds.right(), avg_y),
-                   brush, 2.0f);
-  COM_VERIFY(canvas->Flush());
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// BoxShadow
-//
-struct BoxShadow {
-  gfx::SizeF offset;
-  float blur_radius;
-  gfx::ColorF color;
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// Card
-//
-class Card : public ui::Layer {
-  private: enum class State {
-    Active,
-    Inactive,
-    WillBeInactive,
-  };
-
-  private: gfx::RectF content_bounds_;
-  std::vector<BoxShadow> shadows_;
-  private: gfx::SizeF shadow_size_;
-  private: State state_;
-  private: std::unique_ptr<gfx::SwapChain> swap_chain_;
-
-  protected: Card(ui::Compositor* compositor);
-  protected: virtual ~Card() = default;
-
-  public: const gfx::RectF& content_bounds() const { return content_bounds_; }
-  public: ID2D1DeviceContext* d2d_device_context() const {
-    return swap_chain_->d2d_device_context();
-  }
-  public: gfx::SwapChain* swap_chain() const { return swap_chain_.get(); }
-
-  protected: void PaintBackground(ID2D1DeviceContext* canvas) const;
-
-  // ui::Layer
-  protected: virtual void DidChangeBounds() override;
-  protected: virtual void DidInactive() override;
-  protected: virtual bool DoAnimate(base::TimeTicks tick_count) override;
-
-  DISALLOW_COPY_AND_ASSIGN(Card);
-};
-
-Card::Card(ui::Compositor* compositor)
-    : Layer(compositor), state_(State::Inactive) {
-  // Below values are obtained from
-  // http://www.polymer-project.org/tools/designer/
-  shadows_ = {
-    {gfx::SizeF(0.0f, 2.0f), 4.0f, gfx::ColorF(0, 0, 0, 0.098f)},
-    {gfx::SizeF(0.0f, 0.0f), 3.0f, gfx::ColorF(0, 0, 0, 0.098f)}
-  };
-  for (const auto& shadow : shadows_) {
-    shadow_size_.set_width(std::max(shadow_size_.width(),
-        shadow.offset.width() + shadow.blur_radius * 2));
-    shadow_size_.set_height(std::max(shadow_size_.height(),
-        shadow.offset.height() + shadow.blur_radius * 2));
-  }
-}
-
-void Card::PaintBackground(ID2D1DeviceContext* canvas) const {
-  auto const radius = 2.0f;
-  canvas->Clear(gfx::ColorF(gfx::ColorF::White, 0.0f));
-
-  common::ComPtr<ID2D1Image> current_target;
-  canvas->GetTarget(&current_target);
-
-  gfx::Bitmap bitmap(canvas, canvas->GetPixelSize());
-
-  common::ComPtr<ID2D1Effect> blur_effect;
-  COM_VERIFY(canvas->CreateEffect(CLSID_D2D1GaussianBlur, &blur_effect));
-
-  for (const auto& shadow : shadows_) {
-    const auto shadow_size = gfx::SizeF(shadow.blur_radius,
-                                        shadow.blur_radius);
-    const auto shadow_bounds = gfx::RectF(
-       content_bounds().origin() + shadow.offset,
-       content_bounds().size());
-
-    canvas->SetTarget(bitmap);
-    canvas->Clear(gfx::ColorF(0, 0, 0, 0));
-    canvas->FillRoundedRectangle(
-         D2D1::RoundedRect(shadow_bounds, radius, radius),
-         gfx::Brush(canvas, shadow.color));
-
-    blur_effect->SetInput(0, bitmap);
-    COM_VERIFY(blur_effect->SetValue(D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION,
-                                     shadow.blur_radius));
-    canvas->SetTarget(current_target);
-    canvas->DrawImage(blur_effect, gfx::PointF());
-    COM_VERIFY(canvas->Flush());
-  }
-
-  canvas->FillRoundedRectangle(D2D1::RoundedRect(content_bounds(),
-                                                 radius, radius),
-                               gfx::Brush(canvas, gfx::ColorF::White));
-}
-
-// ui::Layer
-void Card::DidChangeBounds() {
-  content_bounds_.set_size(bounds().size() - shadow_size_);
-  D2D1_SIZE_U size = {
-    static_cast<uint32_t>(bounds().width()),
-    static_cast<uint32_t>(bounds().height())
-  };
-
-  if (swap_chain_) {
-    swap_chain_->DidChangeBounds(size);
-    return;
-  }
-
-  // Create swap chain and d2d device context
-  swap_chain_.reset(new gfx::SwapChain(
-      compositor()->dx_device(), size));
-  COM_VERIFY(visual()->SetContent(swap_chain_->swap_chain()));
-}
-
-void Card::DidInactive() {
-  Layer::DidInactive();
-  state_ = State::WillBeInactive;
-}
-
-bool Card::DoAnimate(base::TimeTicks) {
-  if (!swap_chain()->IsReady())
-    return false;
-
-  if (state_ != State::WillBeInactive)
-    return state_ == State::Active;
-
-  state_ = State::Inactive;
-  auto const bounds = content_bounds();
-
-  // Paint "Paused" in center of layer.
-  auto const font_size = 40;
-  common::ComPtr<IDWriteTextFormat> text_format;
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
-    L"Verdana", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
-    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format));
-
-  base::string16 text(L"Paused");
-  common::ComPtr<IDWriteTextLayout> text_layout;
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
-      text.data(), static_cast<UINT>(text.length()), text_format,
-      bounds.width(), bounds.width(),
-      &text_layout));
-
-  DWRITE_TEXT_METRICS text_metrics;
-  COM_VERIFY(text_layout->GetMetrics(&text_metrics));
-
-  auto const text_origin = gfx::PointF(
-    bounds.left() + (bounds.width() - text_metrics.width) / 2,
-    bounds.top() + (bounds.height() - text_metrics.height) / 2);
-
-  auto const canvas = d2d_device_context();
-  canvas->BeginDraw();
-
-  canvas->FillRectangle(bounds,
-    gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Black, 0.4f)));
-
-  gfx::Brush text_brush(canvas, gfx::ColorF(gfx::ColorF::White, 0.9f));
-  canvas->DrawTextLayout(text_origin, text_layout, text_brush);
-
-  COM_VERIFY(canvas->EndDraw());
-  swap_chain()->Present();
-  return true;
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// CartoonCard
-//
-class CartoonCard : public Card {
-  private: class Ball {
-    private: float angle_;
-    private: gfx::PointF center_;
-    private: gfx::SizeF motion_;
-    private: float size_;
-    private: base::TimeTicks tick_count_;
-
-    public: Ball(float angle, float size, const gfx::PointF& center,
-                 const gfx::SizeF& motion,
-                 base::TimeTicks tick_count);
-    public: ~Ball() = default;
-
-    public: const gfx::PointF& center() const { return center_; }
-    public: float size() const { return size_; }
-
-    public: void DidChangeBounds(const gfx::RectF& bounds);
-    public: void DoAnimate(ID2D1RenderTarget* canvas,
-                           const gfx::RectF& bounds,
-                           base::TimeTicks tick_count);
-    public: void DidColision(const Ball& other);
-  };
-
-  private: std::vector<std::unique_ptr<Ball>> balls_;
-  private: base::TimeTicks last_tick_count_;
-  private: DXGI_FRAME_STATISTICS last_stats_;
-  private: int not_present_count_;
-  private: Sampling present_sample_;
-  private: common::ComPtr<IDWriteTextFormat> text_format_;
-  private: Sampling tick_count_sample_;
-
-  public: CartoonCard(ui::Compositor* compositor);
-  public: virtual ~CartoonCard();
-
-  // ui::Layer
-  private: virtual void DidChangeBounds() override;
-  private: virtual bool DoAnimate(base::TimeTicks tick_count) override;
-
-  DISALLOW_COPY_AND_ASSIGN(CartoonCard);
-};
-
-//////////////////////////////////////////////////////////////////////
-//
-// CartoonCard
-//
-CartoonCard::CartoonCard(ui::Compositor* compositor)
-    : Card(compositor), balls_(5),
-      last_tick_count_(base::TimeTicks::Now()), not_present_count_(0) {
-  last_stats_ = {0};
-
-  balls_[0].reset(new Ball(0.0f, 10.0f,
-                           gfx::PointF(10, 10), gfx::SizeF(1.3, 1.2),
-                           last_tick_count_));
-  balls_[1].reset(new Ball(30.0f, 10.0f,
-                           gfx::PointF(90, 10), gfx::SizeF(-2.0, 1.5),
-                           last_tick_count_));
-  balls_[2].reset(new Ball(90.0f, 15.0f,
-                           gfx::PointF(30, 90), gfx::SizeF(1.0, -1.0),
-                           last_tick_count_));
-  balls_[3].reset(new Ball(180.0f, 20.0f,
-                           gfx::PointF(90, 90), gfx::SizeF(-1.0, -1.0),
-                           last_tick_count_));
-  balls_[4].reset(new Ball(180.0f, 13.0f,
-                           gfx::PointF(50, 50), gfx::SizeF(-1.0, -1.0),
-                           last_tick_count_));
-
-  auto const font_size = 13;
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
-    L"Consolas", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
-    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format_));
-}
-
-CartoonCard::~CartoonCard() {
-}
-
-void CartoonCard::DidChangeBounds() {
-  Card::DidChangeBounds();
-  for (const auto& ball : balls_) {
-    ball->DidChangeBounds(content_bounds());
-  }
-}
-
-bool CartoonCard::DoAnimate(base::TimeTicks tick_count) {
-  Card::DoAnimate(tick_count);
-
-  if (!is_active())
-    return false;
-
-  if (!swap_chain()->IsReady()) {
-    ++not_present_count_;
-    return false;
-  }
-
-  // Statistics
-  DXGI_FRAME_STATISTICS stats = {0};
-  // Ignore errors. |GetFrameStatistics()| returns
-  // DXGI_ERROR_FRAME_STATISTICS_DISJOINT.
-  swap_chain()->swap_chain()->GetFrameStatistics(&stats);
-
-  tick_count_sample_.AddSample(tick_count - last_tick_count_);
-  last_tick_count_ = tick_count;
-
-  present_sample_.AddSample(not_present_count_);
-  not_present_count_ = 0;
-
-  auto const canvas = d2d_device_context();
-  canvas->BeginDraw();
-  PaintBackground(canvas);
-
-  for (auto& ball : balls_) {
-    ball->DoAnimate(canvas, content_bounds(), tick_count);
-  }
-  for (auto& ball : balls_) {
-    for (auto& other : balls_) {
-      if (ball == other)
-        continue;
-      auto const distance = ball->center().Distance(other->center());
-      if (distance > ball->size() && distance > other->size())
-        continue;
-      ball->DidColision(*other);
-      break;
-    }
-  }
-
-  // Sample graph
-  tick_count_sample_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Red, 0.5f)),
-      gfx::RectF(gfx::PointF(content_bounds().left(),
-                             content_bounds().bottom() - 20),
-                 content_bounds().bottom_right()));
-  present_sample_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5f)),
-      gfx::RectF(gfx::PointF(content_bounds().left(),
-                             content_bounds().bottom() - 40),
-                 content_bounds().bottom_right() - gfx::SizeF(0, 20)));
-
-  std::basic_ostringstream<base::char16> stream;
-  stream << L"(Red) TickCount=" << tick_count_sample_.minimum() <<
-    L" " << tick_count_sample_.maximum() <<
-    L" " << tick_count_sample_.last() << std::endl;
-  stream << L"(Blue) NotPresentCount=" << present_sample_.minimum() <<
-    L" " << present_sample_.maximum() <<
-    L" " << present_sample_.last() << std::endl;
-  stream << L"PresentCount=" <<
-      stats.PresentCount - last_stats_.PresentCount << std::endl;
-  stream << L"PresentRefreshCount=" <<
-      stats.PresentRefreshCount - last_stats_.PresentRefreshCount << std::endl;
-  stream << L"SyncQPCTime=" <<
-      stats.SyncQPCTime.QuadPart -
-          last_stats_.SyncQPCTime.QuadPart << std::endl;
-  stream << L"SyncGPUTime=" <<
-      stats.SyncGPUTime.QuadPart -
-          last_stats_.SyncGPUTime.QuadPart << std::endl;
-
-  const auto text = stream.str();
-  common::ComPtr<IDWriteTextLayout> text_layout;
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
-      text.data(), static_cast<UINT>(text.length()), text_format_,
-      content_bounds().width(), content_bounds().height(), &text_layout));
-
-  gfx::Brush text_brush(canvas, gfx::ColorF(gfx::ColorF::Black, 0.5f));
-  canvas->DrawTextLayout(gfx::PointF(5.0f, 5.0f), text_layout, text_brush,
-                         D2D1_DRAW_TEXT_OPTIONS_CLIP);
-  COM_VERIFY(canvas->EndDraw());
-  swap_chain()->Present();
-
-  last_stats_ = stats;
-  last_tick_count_ = tick_count;
-  return true;
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// CartoonCard::Ball
-//
-CartoonCard::Ball::Ball(float angle, float size,
-                        const gfx::PointF& center,
-                        const gfx::SizeF& motion, base::TimeTicks tick_count)
-    : angle_(angle), center_(center), motion_(motion), size_(size),
-      tick_count_(tick_count) {
-  motion_ = 1.0f;
-}
-
-void CartoonCard::Ball::DidChangeBounds(const gfx::RectF& bounds) {
-  center_.set_x(std::min(center_.x(), bounds.right() - size_));
-  center_.set_y(std::min(center_.y(), bounds.bottom() - size_));
-}
-
-void CartoonCard::Ball::DoAnimate(ID2D1RenderTarget* canvas,
-                                  const gfx::RectF& content_bounds,
-                                  base::TimeTicks tick_count) {
-  if (tick_count_ == tick_count)
-    return;
-  auto const bounds = content_bounds - size_;
-  auto const tick_delta = std::max(
-      (tick_count - tick_count_).InMilliseconds() / 16,
-      static_cast<int64_t>(1));
-  tick_count_ = tick_count;
-  for (auto count = 0u; count < tick_delta; ++count) {
-    center_ += motion_;
-    if (bounds.Contains(center_))
-      continue;
-    if (center_.x() < bounds.left() || center_.x() >= bounds.right())
-      motion_.set_width(-motion_.width());
-    if (center_.y() < bounds.top() || center_.y() >= bounds.bottom())
-      motion_.set_height(-motion_.height());
-  }
-
-  angle_ = ::fmod(angle_ + tick_delta, 360.0f);
-
-  canvas->SetTransform(D2D1::Matrix3x2F::Rotation(angle_, center_));
-
-  D2D1_ELLIPSE ellipse;
-  ellipse.point = center_;
-  ellipse.radiusX = size_;
-  ellipse.radiusY = size_;
-  canvas->FillEllipse(ellipse,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5)));
-
-  auto const rect_size = size_ * 0.5f;
-  canvas->FillRectangle(
-      gfx::RectF(center_.x() - rect_size, center_.y() - rect_size,
-                 center_.x() + rect_size, center_.y() + rect_size),
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Green, 0.7f)));
-
-  canvas->SetTransform(D2D1::IdentityMatrix());
-  COM_VERIFY(canvas->Flush());
-}
-
-void CartoonCard::Ball::DidColision(const Ball& other) {
-  if (size() > other.size())
-    return;
-  motion_ = gfx::SizeF(-motion_.width(), -motion_.height());
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// RootLayer
-//
-class RootLayer final : public ui::SimpleLayer {
-  public: RootLayer(ui::Compositor* compositor);
-  public: virtual ~RootLayer() = default;
-
-  // ui::Layer
-  private: virtual void DidChangeBounds() override;
-
-  DISALLOW_COPY_AND_ASSIGN(RootLayer);
-};
-
-RootLayer::RootLayer(ui::Compositor* compositor)
-    : ui::SimpleLayer(compositor) {
-}
-
-void RootLayer::DidChangeBounds() {
-  ui::SimpleLayer::DidChangeBounds();
-#if 0
-  ScopedCanvas scoped_canvas(this);
-  auto const bounds = scoped_canvas.bounds() - gfx::SizeF(20, 20);
-  auto const canvas = scoped_canvas.d2d_device_context();
-  canvas->Clear(gfx::ColorF(0, 0, 1, 0.2));
-  gfx::Brush white_brush(canvas,
-                         gfx::ColorF(gfx::ColorF::White, 0.3f));
-  gfx::Brush red_brush(canvas,
-                         gfx::ColorF(gfx::ColorF::White, 0.3f));
-
-  canvas->DrawLine(bounds.origin(), bounds.bottom_right(), white_brush,
-                   5.0f);
-  canvas->DrawLine(gfx::PointF(bounds.right(), bounds.top()),
-                   gfx::PointF(bounds.left(), bounds.bottom()),
-                   white_brush, 5.0f);
-  canvas->FillRectangle(bounds, red_brush);
-#endif
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// StatusLayer
-//
-class StatusLayer : public Card {
-  private: DCOMPOSITION_FRAME_STATISTICS last_stats_;
-  private: base::TimeTicks last_tick_count_;
-  private: Sampling sample_duration_;
-  private: Sampling sample_last_frame_;
-  private: Sampling sample_next_frame_;
-  private: Sampling sample_tick_;
-  private: common::ComPtr<IDWriteTextFormat> text_format_;
-  private: common::ComPtr<IDWriteTextLayout> text_layout_;
-
-  public: StatusLayer(ui::Compositor* compositor);
-  public: virtual ~StatusLayer();
-
-  private: virtual bool DoAnimate(base::TimeTicks tick_count) override;
-
-  DISALLOW_COPY_AND_ASSIGN(StatusLayer);
-};
-
-StatusLayer::StatusLayer(ui::Compositor* compositor)
-    : Card(compositor),
-      last_tick_count_(base::TimeTicks::Now()), sample_duration_(100),
-      sample_last_frame_(100), sample_next_frame_(100), sample_tick_(100) {
-  COM_VERIFY(compositor->device()->GetFrameStatistics(&last_stats_));
-
-  auto const font_size = 13;
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
-    L"Consolas", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
-    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format_));
-}
-
-StatusLayer::~StatusLayer() {
-}
-
-bool StatusLayer::DoAnimate(base::TimeTicks tick_count) {
-  if (!swap_chain()->IsReady())
-    return false;
-
-  DCOMPOSITION_FRAME_STATISTICS stats;
-  COM_VERIFY(compositor()->device()->GetFrameStatistics(&stats));
-
-  // Update samples
-  sample_tick_.AddSample(tick_count - last_tick_count_);
-  last_tick_count_ = tick_count;
-
-  sample_duration_.AddSample(
-    ((stats.currentTime - last_stats_.currentTime) * 1000 /
-     stats.timeFrequency).QuadPart);
-  sample_last_frame_.AddSample(
-    ((stats.lastFrameTime - last_stats_.lastFrameTime) * 1000 /
-     stats.timeFrequency).QuadPart);
-  sample_next_frame_.AddSample(
-    ((stats.nextEstimatedFrameTime - last_stats_.nextEstimatedFrameTime) *
-     1000 / stats.timeFrequency).QuadPart);
-  last_stats_ = stats;
-
-  //ui::SimpleLayer::ScopedCanvas scoped_canvas(this);
-  //auto const canvas = scoped_canvas.d2d_device_context();
-  auto const canvas = d2d_device_context();
-  canvas->BeginDraw();
-  PaintBackground(canvas);
-
-  auto const bounds = content_bounds();
-  //canvas->Clear(gfx::ColorF(0, 0, 0, 0.5));
-  PaintBackground(canvas);
-
-  // Paint graph
-  auto const graph_bounds = gfx::RectF(
-    gfx::PointF(bounds.left() + 4, bounds.bottom() - 84),
-    gfx::PointF(bounds.right() - 4, bounds.bottom() - 4));
-  canvas->FillRectangle(graph_bounds, gfx::Brush(canvas, gfx::ColorF::Black));
-
-  sample_next_frame_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Red, 0.5f)),
-      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 20),
-                 graph_bounds.bottom_right()));
-  sample_duration_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Gold, 0.5f)),
-      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 40),
-                 graph_bounds.bottom_right() - gfx::SizeF(0, 20)));
-  sample_last_frame_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5f)),
-      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 60),
-                 graph_bounds.bottom_right() - gfx::SizeF(0, 40)));
-  sample_tick_.Paint(canvas,
-      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::White, 0.5f)),
-      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 80),
-                 graph_bounds.bottom_right() - gfx::SizeF(0, 60)));
-
-  // Samples values
-  std::basic_ostringstream<base::char16> stream;
-  stream << L"(White) Tick=" << sample_tick_.minimum() << L" " <<
-      sample_tick_.maximum() << L" " << sample_tick_.last() << std::endl;
-  stream << L"(Blue) LastFrameTime=" << sample_last_frame_.minimum() <<
-      L" " << sample_last_frame_.maximum() <<
-      L" " << sample_last_frame_.last() << std::endl;
-  stream << L"(Yellow) CurrentTime=" << sample_duration_.minimum() <<
-      L" " << sample_duration_.maximum() <<
-      L" " << sample_duration_.last() << std::endl;
-  stream << L"(Red) NextFrame=" << sample_next_frame_.minimum() <<
-      L" " << sample_next_frame_.maximum() <<
-      L" " << sample_next_frame_.last() << std::endl;
-  stream << L"rate=" << stats.currentCompositionRate.Numerator <<
-      L"/" << stats.currentCompositionRate.Denominator << std::endl;
-  stream << L"hz=" << stats.timeFrequency.QuadPart << std::endl;
-
-  const auto text = stream.str();
-
-  text_layout_.reset();
-  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
-      text.data(), static_cast<UINT>(text.length()), text_format_,
-      bounds.width(), bounds.height(), &text_layout_));
-
-  gfx::Brush text_brush(canvas, gfx::ColorF::Black, 0.7);
-  canvas->DrawTextLayout(gfx::PointF(5.0f, 5.0f), text_layout_, text_brush,
-                         D2D1_DRAW_TEXT_OPTIONS_CLIP);
-
-  COM_VERIFY(canvas->EndDraw());
-  swap_chain()->Present();
-  return true;
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// DemoApp
-//
-class DemoApp final : public ui::Window, private ui::Schedulable,
-                      private ui::Animatable {
-  private: class Animation {
-    public: enum class Type {
-      Scroll,
-      Zoom,
-    };
-
-    private: std::unique_ptr<ui::Animation> animation_;
-    private: Type type_;
-    private: std::unique_ptr<ui::Animation::Variable> variable1_;
-
-    public: Animation(Type type, ui::Animatable* animatable,
-                      const ui::Animation::Timing& timing);
-    public: ~Animation();
-
-    public: Type type() const { return type_; }
-    public: double value1() const;
-
-    public: void Play(base::TimeTicks current_time);
-    public: void SetValues1(double start, double end);
-    public: void Start();
-  };
-
-  private: std::unique_ptr<Animation> animation_;
-  private: std::unique_ptr<ui::Compositor> compositor_;
-  private: base::TimeTicks last_animate_tick_;
-  private: std::unique_ptr<CartoonCard> cartoon_layer_;
-  private: std::unique_ptr<RootLayer> root_layer_;
-  private: std::unique_ptr<StatusLayer> status_layer_;
-  private: HWND status_hwnd_;
-
-  public: DemoApp();
-  public: virtual ~DemoApp();
-
-  // ui::Animatable
-  private: virtual void DidFinishAnimation() override;
-  private: virtual void DidFireAnimationTimer() override;
-
-  // ui::Schedulable
-  private: virtual void DoAnimate() override;
-
-  // ui::Window
-  private: virtual void DidActive() override;
-  private: virtual void DidChangeBounds() override;
-  private: virtual void DidCreate() override;
-  private: virtual void DidInactive() override;
-  private: virtual LRESULT OnMessage(UINT message, WPARAM wParam,
-                                     LPARAM lParam) override;
-  private: virtual void WillDestroy() override;
-
-  DISALLOW_COPY_AND_ASSIGN(DemoApp);
-};
-
-DemoApp::DemoApp() : status_hwnd_(nullptr) {
-  float dpi_x, dpi_y;
-  gfx::Factory::instance()->d2d_factory()->GetDesktopDpi(&dpi_x, &dpi_y);
-
-  Window::Creator creator(this);
-  auto const hwnd = ::CreateWindow(
-    GetWindowClass(),
-    L"Window Title",
-    WS_OVERLAPPEDWINDOW | WS_VISIBLE,
-    CW_USEDEFAULT,
-    CW_USEDEFAULT,
-    static_cast<UINT>(ceil(640.f * dpi_x / 96.f)),
-    static_cast<UINT>(ceil(800.f * dpi_y / 96.f)),
-    nullptr,
-    nullptr,
-    HINST_THISCOMPONENT,
-    nullptr);
-  if (!hwnd)
-    return;
-  //::ShowWindow(hwnd, SW_SHOWNORMAL);
-  ui::Scheduler::instance()->Add(this);
-}
-
-DemoApp::~DemoApp() {
-}
-
-// ui::Animation
-void DemoApp::DidFinishAnimation() {
-  animation_.reset();
-}
-
-void DemoApp::DidFireAnimationTimer() {
-  switch (animation_->type()) {
-    case Animation::Type::Scroll: {
-      auto const origin_top = animation_->value1();
-      root_layer_->SetBounds(gfx::RectF(
-        gfx::PointF(root_layer_->bounds().left(), origin_top),
-        root_layer_->bounds().size()));
-      compositor_->NeedCommit();
-      break;
-    }
-  }
-}
-
-// ui::Schedulable
-void DemoApp::DoAnimate() {
-  if (!root_layer_)
-    return;
-  auto const current_tick = base::TimeTicks::Now();
-  auto const delta = current_tick - last_animate_tick_;
-  auto const kBackgroundAnimate = 100;
-  if (!is_active() &&
-      delta < base::TimeDelta::FromMilliseconds(kBackgroundAnimate))
-    return;
-  if (animation_)
-    animation_->Play(current_tick);
-  last_animate_tick_ = current_tick;
-  root_layer_->DoAnimate(current_tick);
-  compositor_->Commit();
-}
-
-// ui::Window
-void DemoApp::DidActive() {
-  ui::Window::DidActive();
-  if (root_layer_)
-    root_layer_->DidActive();
-}
-
-void DemoApp::DidChangeBounds() {
-  compositor_->NeedCommit();
-
-  auto const width = bounds().right - bounds().left;
-  auto const height = bounds().bottom - bounds().top;
-
-  auto const tab_height = 32.0f;
-  auto const splitter_height = 5.0f;
-  auto const pane_height = (height - splitter_height - tab_height) / 2;
-
-  root_layer_->SetBounds(gfx::RectF(gfx::PointF(), gfx::SizeF(width, height)));
-
-  // Resize status visual
-  if (status_layer_) {
-    const gfx::SizeF status_size(320.0f, 200.0f);
-    status_layer_->SetBounds(gfx::RectF(gfx::PointF(20, height / 2),
-                                        status_size));
-
-    // Setup transform for status visual
-    common::ComPtr<IDCompositionRotateTransform> rotate_transform;
-    COM_VERIFY(compositor_->device()->CreateRotateTransform(&rotate_transform));
-    COM_VERIFY(rotate_transform->SetCenterX(status_size.width() / 2));
-    COM_VERIFY(rotate_transform->SetCenterY(status_size.height() / 2));
-    COM_VERIFY(rotate_transform->SetAngle(-5));
-    COM_VERIFY(status_layer_->visual()->SetTransform(rotate_transform));
-  }
-
-    gfx::RectF pane_bounds[2] {
-        gfx::RectF(gfx::PointF(0, tab_height), gfx::PointF(width, pane_height)),
-        gfx::RectF(gfx::PointF(0, pane_height + splitter_height),
-                   gfx::PointF(width, height))
-    };
-  // Resize cartoon visual
-  if (cartoon_layer_)
-    cartoon_layer_->SetBounds(pane_bounds[0]);
-
-  // Update composition
-  compositor_->Commit();
-}
-
-// Build visual tree and set composition target to this window.
-void DemoApp::DidCreate() {
-  ui::Window::DidCreate();
-
-  status_hwnd_ = ::CreateWindowEx(
-      0,
-      STATUSCLASSNAMEW,
-      nullptr,
-      WS_CHILD | WS_VISIBLE,
-      0, 0, 0, 0,
-      *this,
-      reinterpret_cast<HMENU>(this),
-      HINST_THISCOMPONENT,
-      nullptr);
-
-  // Create Direct Composition device.
-  compositor_.reset(new ui::Compositor(new gfx::DxDevice()));
-  root_layer_.reset(new RootLayer(compositor_.get()));
-  compositor_->SetTarget(*this, root_layer_.get());
-
-  // Build visual tree
-  cartoon_layer_.reset(new CartoonCard(compositor_.get()));
-  root_layer_->AppendChild(cartoon_layer_.get());
-
-  status_layer_.reset(new StatusLayer(compositor_.get()));
-  root_layer_->AppendChild(status_layer_.get());
-
-  // Setup visual tree bounds
-  DidChangeBounds();
-}
-
-void DemoApp::DidInactive() {
-  if (root_layer_)
-    root_layer_->DidInactive();
-}
-
-LRESULT DemoApp::OnMessage(UINT message, WPARAM wParam, LPARAM lParam) {
-  switch (message) {
-    case WM_ACTIVATE: {
-        MARGINS margins;
-        margins.cxLeftWidth = 0;
-        margins.cxRightWidth = 0;
-        margins.cyBottomHeight = 0;
-        margins.cyTopHeight = -1;
-        COM_VERIFY(::DwmExtendFrameIntoClientArea(*this, &margins));
-        break;
-    }
-    case WM_PAINT: {
-      // Fill window client area with alpha=0.
-      PAINTSTRUCT ps;
-      auto const hdc = ::BeginPaint(*this, &ps);
-      ::FillRect(hdc, &ps.rcPaint,
-                 static_cast<HBRUSH>(::GetStockObject(BLACK_BRUSH)));
-      ::EndPaint(*this, &ps);
-      return 1;
-    }
-    case WM_MOUSEWHEEL: {
-      auto const delta = GET_WHEEL_DELTA_WPARAM(wParam);
-      auto const origin = root_layer_->bounds().origin();
-      ui::Animation::Timing timing;
-      auto const num_frames = 10;
-      auto const speed = 10;
-      auto const sign = delta > 0 ? 1 : -1;
-      timing.duration = base::TimeDelta::FromMilliseconds(16 * num_frames);
-      animation_.reset(new Animation(Animation::Type::Scroll, this, timing));
-      animation_->SetValues1(origin.y(),
-                             origin.y() + sign * speed * num_frames);
-      return 1;
-    }
-    case WM_WINDOWPOSCHANGED:
-      ::SendMessage(status_hwnd_, message, wParam, lParam);
-      break;
-  }
-  return ui::Window::OnMessage(message, wParam, lParam);
-}
-
-void DemoApp::WillDestroy() {
-#if 0
-  composition_target_->SetRoot(nullptr);
-  root_layer_.reset();
-  status_layer_.reset();
-  compositor_.reset();
-#endif
-  ui::Window::WillDestroy();
-}
-
-//////////////////////////////////////////////////////////////////////
-//
-// DemoApp::Animation
-//
-DemoApp::Animation::Animation(Type type,
-                              ui::Animatable* animatable,
-                              const ui::Animation::Timing& timing)
-    : animation_(new ui::Animation(animatable, timing)), type_(type) {
-}
-
-DemoApp::Animation::~Animation() {
-}
-
-void DemoApp::Animation::Play(base::TimeTicks current_time) {
-  animation_->Play(current_time);
-}
-
-double DemoApp::Animation::value1() const {
-  return animation_->GetDouble(variable1_.get());
-}
-
-void DemoApp::Animation::SetValues1(double start, double end) {
-  DCHECK(!variable1_);
-  variable1_.reset(animation_->CreateVariable(start, end));
-}
-
-}  // namespace my
-
-namespace {
-const GUID DXGI_DEBUG_ALL = {
-  0xe48ae283, 0xda80, 0x490b, 0x87, 0xe6, 0x43, 0xe9, 0xa9, 0xcf, 0xda, 0x8
-};
-
-const GUID DXGI_DEBUG_DXGI = {
-  0x25cddaa4, 0xb1c6, 0x47e1, 0xac, 0x3e, 0x98, 0x87, 0x5b, 0x5a, 0x2e, 0x2a
-};
-
-void ReportLiveObjects() {
-  auto const dll = ::GetModuleHandleW(L"dxgidebug.dll");
-  if (!dll)
-    return;
-  typedef HRESULT (WINAPI  *DXGIGetDebugInterface)(REFIID riid, void **ppDebug);
-  DXGIGetDebugInterface func = reinterpret_cast<DXGIGetDebugInterface>(
-      ::GetProcAddress(dll, "DXGIGetDebugInterface"));
-  if (!func)
-    return;
-  common::ComPtr<IDXGIDebug> repoter;
-  COM_VERIFY(func(__uuidof(IDXGIDebug), repoter.location()));
-  repoter->ReportLiveObjects(DXGI_DEBUG_DXGI, DXGI_DEBUG_RLO_ALL);
-}
-}  // namespace
-
-//////////////////////////////////////////////////////////////////////
-//
-// WinMain
-//
-int WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
-  std::vector<common::SingletonBase*> singletons;
-  common::all_singletons = &singletons;
-  //::AllocConsole();
-  common::ComInitializer com_initializer;
-  my::DemoApp application;
-  //ui::Scheduler::instance()->Run(ui::Scheduler::Method::NoWait);
-  ui::Scheduler::instance()->Run(ui::Scheduler::Method::Timer);
-  //ui::Scheduler::instance()->Run(ui::Scheduler::Method::Waitable);
-  for (auto const singleton : singletons) {
-    delete singleton;
-  }
-  ReportLiveObjects();
-  return 0;
-}
+// C4530 L1: C++ exception handler used, but unwind semantics are not enabled.
+// Specify /EHsc
+#pragma warning(disable: 4530)
+
+#define UNICODE
+#define WIN32_LEAN_AND_MEAN
+// Note: ID2D1SpriteBatch requires Windows 10.
+#define WINVER 0x0A00
+#define _WIN32_WINNT 0x0A00
+// Builds with /DDTEST_ZERO_ALLOC count allocations of frame phases, see
+// base/debug/allocation_tracker.h and ui/frame_timing_recorder.h, for
+// "dtest --zero-alloc". Other builds keep the default operator new.
+#if defined(DTEST_ZERO_ALLOC)
+#define ENABLE_ALLOCATION_HOOKS
+#define ENABLE_FRAME_PHASE_COUNTERS
+#endif
+#include <windows.h>
+#undef max
+#undef min
+#include <dcomp.h>
+#include <d3d11.h>
+#include <d2d1.h>
+#include <d2d1_3.h>
+#include <d2d1helper.h>
+#include <dwmapi.h>
+#include <dwrite.h>
+#include <dxgi1_3.h>
+#include <dxgidebug.h>
+#include <emmintrin.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <commctrl.h>
+//#pragma comment(lib, "commctrl.lib")
+
+#pragma comment(lib, "d2d1.lib")
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "dcomp.lib")
+#pragma comment(lib, "dwmapi.lib")
+#pragma comment(lib, "dwrite.lib")
+#pragma comment(lib, "dxguid.lib")
+#pragma comment(lib, "gdi32.lib")
+#pragma comment(lib, "ole32.lib")
+#pragma comment(lib, "user32.lib")
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/debug/allocation_tracker.h"
+#include "base/debug/perf_counters.h"
+#include "base/debug/trace_event.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/sampling.h"
+#include "base/threading/task_scheduler.h"
+#include "base/threading/thread_pool.h"
+#include "base/timer/timing_wheel.h"
+#include "common/memory/frame_arena.h"
+#include "common/memory/singleton.h"
+#include "common/win/scoped_comptr.h"
+#include "gfx/geometry.h"
+#include "gfx/gfx.h"
+#include "gfx/present_params.h"
+#include "gfx/sprite.h"
+#include "physics/fixed_timestep.h"
+#include "physics/particle_store.h"
+#include "physics/uniform_grid.h"
+#include "physics/world.h"
+#include "ui/animation.h"
+#include "ui/frame_scheduler.h"
+#include "ui/frame_throttler.h"
+#include "ui/frame_timing_recorder.h"
+#include "ui/idle_task_queue.h"
+
+namespace ui {
+
+class Layer;
+
+//////////////////////////////////////////////////////////////////////
+//
+// ui::Compositor
+//
+class Compositor {
+  private: common::ComPtr<IDCompositionDesktopDevice> composition_device_;
+  private: common::ComPtr<IDCompositionTarget> composition_target_;
+  private: gfx::DxDevice* dx_device_;
+  private: bool need_commit_;
+
+  public: Compositor(gfx::DxDevice* dx_device);
+  public: ~Compositor();
+
+  public: IDCompositionDesktopDevice* device() const {
+    return composition_device_;
+  }
+  public: gfx::DxDevice* dx_device() const { return dx_device_; }
+
+  public: void Commit();
+  public: common::ComPtr<IDCompositionVisual2> CreateVisual();
+  public: void NeedCommit() { need_commit_ = true; }
+  public: void SetTarget(HWND hwnd, Layer* layer);
+
+  DISALLOW_COPY_AND_ASSIGN(Compositor);
+};
+
+Compositor::Compositor(gfx::DxDevice* dx_device)
+    : dx_device_(dx_device), need_commit_(false) {
+  COM_VERIFY(::DCompositionCreateDevice2(
+      dx_device->d2d_device(),
+      IID_PPV_ARGS(&composition_device_)));
+  composition_device_.MustBeNoOtherUse();
+}
+
+Compositor::~Compositor() {
+  composition_target_.MustBeNoOtherUse();
+  composition_target_.reset();
+}
+
+void Compositor::Commit() {
+  if (!need_commit_)
+    return;
+  TRACE_EVENT0("ui", "Compositor::Commit");
+  COM_VERIFY(composition_device_->Commit());
+  need_commit_ = false;
+}
+
+common::ComPtr<IDCompositionVisual2> Compositor::CreateVisual() {
+  common::ComPtr<IDCompositionVisual2> visual;
+  COM_VERIFY(composition_device_->CreateVisual(&visual));
+  return visual;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ui::Layer
+//
+class Layer : protected ui::Animatable {
+  private: std::unique_ptr<ui::Animation> animation_;
+  private: gfx::RectF bounds_;
+  private: std::vector<Layer*> child_layers_;
+  private: Compositor* compositor_;
+  private: bool is_active_;
+  private: common::ComPtr<IDCompositionVisual2> visual_;
+
+  public: Layer(Compositor* compositor);
+  public: virtual ~Layer();
+
+  public: Compositor* compositor() const { return compositor_; }
+  public: operator IDCompositionVisual2*() const { return visual_; }
+
+  public: const gfx::RectF& bounds() const { return bounds_; }
+  protected: bool is_active() const { return is_active_; }
+  public: IDCompositionVisual2* visual() const { return visual_; }
+
+  public: void AppendChild(Layer* new_child);
+  public: virtual void DidActive();
+  protected: virtual void DidChangeBounds();
+  public: virtual void DidInactive();
+  // Returns true if this layer or its children need another frame.
+  public: virtual bool DoAnimate(base::TimeTicks tick_count);
+  public: void SetBounds(const gfx::RectF& new_bounds);
+
+  // ui::Animatable
+  private: virtual void DidFinishAnimation() override;
+  private: virtual void DidFireAnimationTimer() override;
+
+  DISALLOW_COPY_AND_ASSIGN(Layer);
+};
+
+void Compositor::SetTarget(HWND hwnd, Layer* layer) {
+  // Set composition target to this window.
+  COM_VERIFY(composition_device_->CreateTargetForHwnd(
+      hwnd, false, &composition_target_));
+  composition_target_.MustBeNoOtherUse();
+  COM_VERIFY(composition_target_->SetRoot(layer->visual()));
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Layer
+//
+Layer::Layer(Compositor* compositor)
+    : compositor_(compositor), is_active_(false),
+      visual_(compositor->CreateVisual()) {
+  COM_VERIFY(visual_->SetBitmapInterpolationMode(
+      DCOMPOSITION_BITMAP_INTERPOLATION_MODE_LINEAR));
+  COM_VERIFY(visual_->SetBorderMode(DCOMPOSITION_BORDER_MODE_SOFT));
+
+  common::ComPtr<IDCompositionVisualDebug> debug_visual;
+  COM_VERIFY(debug_visual.QueryFrom(visual_));
+  // TODO(eval1749) It seems heat map is painted with alpha=1.0.
+  //COM_VERIFY(debug_visual->EnableHeatMap(gfx::ColorF(255, 255, 0, 0.1)));
+  //COM_VERIFY(debug_visual->EnableRedrawRegions());
+}
+
+Layer::~Layer() {
+  visual_->SetContent(nullptr);
+  visual_->RemoveAllVisuals();
+}
+
+void Layer::AppendChild(Layer* new_child) {
+  child_layers_.push_back(new_child);
+  COM_VERIFY(visual_->AddVisual(new_child->visual_, true, nullptr));
+}
+
+void Layer::DidActive() {
+  if (is_active_)
+    return;
+  is_active_ = true;
+  for (auto const child : child_layers_) {
+    child->DidActive();
+  }
+}
+
+void Layer::DidChangeBounds() {
+}
+
+void Layer::DidInactive() {
+  if (!is_active_)
+    return;
+  is_active_ = false;
+  for (auto const child : child_layers_) {
+    child->DidInactive();
+  }
+}
+
+bool Layer::DoAnimate(base::TimeTicks tick_count) {
+  TRACE_EVENT0("ui", "Layer::DoAnimate");
+  auto needs_frame = false;
+  for (auto const child : child_layers_) {
+    needs_frame |= child->DoAnimate(tick_count);
+  }
+  return needs_frame;
+}
+
+void Layer::SetBounds(const gfx::RectF& new_bounds) {
+  auto changed = false;
+  if (bounds_.left() != new_bounds.left()) {
+    COM_VERIFY(visual_->SetOffsetX(new_bounds.left()));
+    bounds_.set_origin(gfx::PointF(new_bounds.left(), bounds_.top()));
+    changed = true;
+  }
+  if (bounds_.top () != new_bounds.top()) {
+    COM_VERIFY(visual_->SetOffsetY(new_bounds.top()));
+    bounds_.set_origin(gfx::PointF(bounds_.left(), new_bounds.top()));
+    changed = true;
+  }
+
+  if (bounds_.size() != new_bounds.size()) {
+    bounds_.set_size(new_bounds.size());
+    changed = true;
+  }
+
+  if (!changed)
+    return;
+
+  DidChangeBounds();
+}
+
+// ui::Animation
+void Layer::DidFinishAnimation() {
+  animation_.reset();
+}
+
+void Layer::DidFireAnimationTimer() {
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SimpleLayer
+// This class represents a layer with direct composition surface.
+//
+class SimpleLayer : public Layer {
+  public: class ScopedCanvas {
+    private: common::ComPtr<ID2D1DeviceContext> d2d_device_context_;
+    private: SimpleLayer* layer_;
+    private: gfx::RectF bounds_;
+
+    public: ScopedCanvas(SimpleLayer* layer);
+    public: ~ScopedCanvas();
+
+    public: ID2D1DeviceContext* d2d_device_context() const {
+      return d2d_device_context_;
+    }
+    public: const gfx::RectF& bounds() const { return bounds_; }
+  };
+  friend class ScopedCanvas;
+
+  private: common::ComPtr<IDCompositionSurface> surface_;
+
+  public: SimpleLayer(Compositor* compositor);
+  public: virtual ~SimpleLayer();
+
+  private: void AttachSurfaceIfNeeded();
+
+  // ui::Layer
+  protected: virtual void DidChangeBounds() override;
+
+  DISALLOW_COPY_AND_ASSIGN(SimpleLayer);
+};
+
+SimpleLayer::SimpleLayer(Compositor* compositor)
+    : Layer(compositor) {
+}
+
+SimpleLayer::~SimpleLayer() {
+}
+
+void SimpleLayer::AttachSurfaceIfNeeded() {
+  DCHECK(!bounds().empty());
+  if (surface_)
+    return;
+  COM_VERIFY(compositor()->device()->CreateSurface(
+      bounds().width(), bounds().height(),
+      DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ALPHA_MODE_PREMULTIPLIED, &surface_));
+  COM_VERIFY(visual()->SetContent(surface_));
+}
+
+// ui::Layer
+void SimpleLayer::DidChangeBounds() {
+  Layer::DidChangeBounds();
+  surface_.reset();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SimpleLayer::ScopedCanvas
+//
+SimpleLayer::ScopedCanvas::ScopedCanvas(SimpleLayer* layer) : layer_(layer) {
+ layer_->AttachSurfaceIfNeeded();
+
+  POINT offset;
+  COM_VERIFY(layer_->surface_->BeginDraw(
+      nullptr, IID_PPV_ARGS(&d2d_device_context_), &offset));
+  bounds_ = gfx::RectF(gfx::PointF(static_cast<float>(offset.x),
+                                   static_cast<float>(offset.y)),
+                       layer_->bounds().size());
+}
+
+SimpleLayer::ScopedCanvas::~ScopedCanvas() {
+  // Note: We also need to call DDirectCompositionDevice::Commit() for making
+  // canvas appeared in screen.
+  COM_VERIFY(layer_->surface_->EndDraw());
+}
+
+}  // namespace ui
+
+namespace ui {
+
+//////////////////////////////////////////////////////////////////////
+//
+// Window
+//
+class Window {
+  protected: class Creator {
+    public: Creator(Window* window);
+    public: ~Creator();
+  };
+  friend class Creator;
+
+  private: RECT bounds_;
+  private: HWND hwnd_;
+  private: bool is_active_;
+
+  protected: Window();
+  protected: ~Window();
+
+  public: operator HWND() const { return hwnd_; }
+
+  public: const RECT& bounds() const { return bounds_; }
+  public: bool is_active() const { return is_active_; }
+
+  protected: virtual void DidActive();
+  protected: virtual void DidChangeBounds();
+  protected: virtual void DidCreate();
+  protected: virtual void DidInactive();
+
+  protected: static LPWSTR GetWindowClass();
+  private: static Window* GetWindowFromHwnd(HWND hwnd);
+  protected: virtual LRESULT OnMessage(UINT message, WPARAM wParam,
+                                       LPARAM lParam);
+  protected: virtual void WillDestroy();
+  private: static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message,
+                                              WPARAM wParam, LPARAM lParam);
+
+  DISALLOW_COPY_AND_ASSIGN(Window);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Window::Creator
+//
+static Window* global_creating_window;
+
+Window::Creator::Creator(Window* window) {
+  global_creating_window = window;
+}
+
+Window::Creator::~Creator(){
+  global_creating_window = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Window
+//
+Window::Window() : hwnd_(nullptr), is_active_(false) {
+}
+
+Window::~Window() {
+}
+
+void Window::DidActive() {
+  is_active_ = true;
+}
+
+void Window::DidChangeBounds() {
+}
+
+void Window::DidCreate() {
+}
+
+void Window::DidInactive() {
+  is_active_ = false;
+}
+
+LPWSTR Window::GetWindowClass() {
+  static LPWSTR class_name;
+  if (class_name)
+    return class_name;
+  WNDCLASSEX wcex = { sizeof(WNDCLASSEX) };
+  wcex.style = CS_HREDRAW | CS_VREDRAW;
+  wcex.lpfnWndProc = Window::WindowProc;
+  wcex.cbClsExtra = 0;
+  wcex.cbWndExtra = sizeof(LONG_PTR);
+  wcex.hInstance = HINST_THISCOMPONENT;
+  wcex.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW+1);;
+  wcex.lpszMenuName = nullptr;
+  wcex.hCursor = ::LoadCursor(nullptr, IDC_ARROW);
+  wcex.lpszClassName = L"Window";
+  class_name = MAKEINTATOM(::RegisterClassEx(&wcex));
+  return class_name;
+}
+
+Window* Window::GetWindowFromHwnd(HWND hwnd) {
+  auto const window = reinterpret_cast<Window*>(
+      ::GetWindowLongPtr(hwnd, GWLP_USERDATA));
+  if (window)
+    return window;
+  ::SetWindowLongPtr(hwnd, GWLP_USERDATA,
+                     reinterpret_cast<LONG_PTR>(global_creating_window));
+  global_creating_window->hwnd_ = hwnd;
+  return global_creating_window;
+}
+
+LRESULT Window::OnMessage(UINT message, WPARAM wParam, LPARAM lParam) {
+  switch (message) {
+    case WM_ACTIVATE:
+      is_active_ = wParam != WA_INACTIVE;
+      if (is_active_)
+        DidActive();
+      else
+        DidInactive();
+      return 0;
+    case WM_CREATE:
+      ::GetClientRect(*this, &bounds_);
+      DidCreate();
+      return 1;
+    case WM_DESTROY:
+      WillDestroy();
+      break;
+    case WM_NCDESTROY:
+      ::PostQuitMessage(0);
+      return TRUE;
+    case WM_WINDOWPOSCHANGED: {
+      auto const wp = reinterpret_cast<WINDOWPOS*>(lParam);
+      if (wp->flags & SWP_NOSIZE)
+        return 0;
+      if (!::IsIconic(*this)) {
+        ::GetClientRect(*this, &bounds_);
+        DidChangeBounds();
+      }
+      return 0;
+    }
+  }
+  return ::DefWindowProc(hwnd_, message, wParam, lParam);
+}
+
+LRESULT Window::WindowProc(HWND hwnd, UINT message, WPARAM wParam,
+                          LPARAM lParam) {
+  auto const window = GetWindowFromHwnd(hwnd);
+  return window->OnMessage(message, wParam, lParam);
+}
+
+void Window::WillDestroy() {
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Schedulable
+//
+class Schedulable {
+  protected: Schedulable() = default;
+  protected: virtual ~Schedulable() = default;
+
+  // Called at start of a frame by |Scheduler::Method::Vsync|. Returns true
+  // to request the next frame. Default implementation calls |DoAnimate()|
+  // and requests frames forever.
+  public: virtual bool BeginFrame(const BeginFrameArgs& args);
+  public: virtual void DoAnimate() = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Schedulable);
+};
+
+bool Schedulable::BeginFrame(const BeginFrameArgs&) {
+  DoAnimate();
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Scheduler
+//
+class Scheduler final : public common::Singleton<Scheduler> {
+  public: enum class Method {
+    NoWait, // NoPresentContent=3901 9649 5344, CPU=26%
+    Timer, // NoPresentContent=0 1 0, CPU=12%
+    Waitable, // NoPresentContent=0 8 3, CPU=18%
+    // Sleeps on high resolution waitable timer until predicted vsync, and
+    // only waits for messages when no frame is requested.
+    Vsync,
+  };
+
+  // Frames after this many frames are steady state.
+  private: static const uint64_t kNumWarmUpFrames = 120;
+
+  // Animators are called in order of |Add()|, indexed by client id of
+  // |throttler_|. Removed animators are null.
+  private: std::vector<Schedulable*> animators_;
+  private: bool disallow_frame_allocation_;
+  private: FrameScheduler frame_scheduler_;
+  private: FrameTimingRecorder frame_timing_;
+  private: IdleTaskQueue idle_tasks_;
+  // Start of the last frame of |Method::Timer| and |Method::Waitable|.
+  private: base::TimeTicks last_timer_frame_time_;
+  private: uint64_t num_wakeups_;
+  private: base::TaskScheduler task_scheduler_;
+  private: FrameThrottler throttler_;
+  private: base::TimingWheel timers_;
+
+  public: explicit Scheduler();
+  public: virtual ~Scheduler();
+
+  // Allocations in steady state frames are counted as disallowed, with
+  // their stacks, by |base::AllocationTracker|.
+  public: void set_disallow_frame_allocation(bool value) {
+    disallow_frame_allocation_ = value;
+  }
+  public: const FrameScheduler& frame_scheduler() const {
+    return frame_scheduler_;
+  }
+  public: const FrameTimingRecorder& frame_timing() const {
+    return frame_timing_;
+  }
+  public: const IdleTaskQueue& idle_tasks() const { return idle_tasks_; }
+  public: FrameTimingRecorder* mutable_frame_timing() {
+    return &frame_timing_;
+  }
+  public: uint64_t num_wakeups() const { return num_wakeups_; }
+  public: const FrameThrottler& throttler() const { return throttler_; }
+
+  // |rate| is the maximum rate of |animator|, see |FrameThrottler|.
+  public: void Add(Schedulable* animator, FrameRate rate = FrameRate::Hz60);
+  private: FrameThrottler::ClientId ClientIdOf(Schedulable* animator) const;
+  // Tasks posted to the returned runner run in order on a worker thread.
+  public: std::shared_ptr<base::SequencedTaskRunner>
+      CreateSequencedTaskRunner(base::TaskPriority priority);
+  public: bool IsTimerPending(base::TimingWheel::TimerId timer_id) const {
+    return timers_.IsPending(timer_id);
+  }
+  private: void DidBeginFrame();
+  private: void DidFireTimer();
+  private: static bool DispatchMessages();
+  private: static base::TimeTicks FromQpc(uint64_t qpc);
+  // Runs |task| on a worker thread, |task| must not touch windows, layers
+  // nor Direct2D resources, which belong to UI thread.
+  public: void PostTask(base::TaskPriority priority, const base::Task& task);
+  // Runs |task| on UI thread in time left before the next frame or timer.
+  public: void PostIdleTask(const IdleTaskQueue::IdleTask& task);
+  public: void Remove(Schedulable* animator);
+  // Called on invalidation, input or animation start, to wake up
+  // |Method::Vsync| scheduler for |animator|.
+  public: void RequestFrame(Schedulable* animator);
+  public: void Run(Method method = Method::Waitable);
+  private: void RunVsync();
+  // Activation and visibility of windows of |animator|, for throttling.
+  public: void SetActive(Schedulable* animator, bool active);
+  public: void SetVisible(Schedulable* animator, bool visible);
+  // Calls |callback| at |deadline| or later. |Method::Vsync| scheduler
+  // wakes up only for the earliest timer or frame.
+  public: base::TimingWheel::TimerId StartTimer(
+      base::TimeTicks deadline, const base::TimingWheel::Callback& callback);
+  public: void StopTimer(base::TimingWheel::TimerId timer_id);
+  // Starts a frame of |throttler_|, and calls |BeginFrame()| of animators
+  // it lets tick.
+  private: void TickAnimators(const BeginFrameArgs& args);
+
+  private: static void CALLBACK TimerProc(HWND hwnd, UINT message,
+                                          UINT_PTR timer_id, DWORD time);
+  DISALLOW_COPY_AND_ASSIGN(Scheduler);
+};
+
+Scheduler::Scheduler()
+    : disallow_frame_allocation_(false),
+      frame_scheduler_(base::TimeDelta::FromMicroseconds(16667)),
+      frame_timing_(4096), num_wakeups_(0),
+      task_scheduler_(std::max(
+          static_cast<int>(std::thread::hardware_concurrency()) - 1, 1)),
+      timers_(base::TimeTicks::Now(), base::TimeDelta::FromMilliseconds(1)) {
+}
+
+Scheduler::~Scheduler() {
+}
+
+void Scheduler::Add(Schedulable* animator, FrameRate rate) {
+  if (std::find(animators_.begin(), animators_.end(), animator) !=
+      animators_.end()) {
+    return;
+  }
+  animators_.push_back(animator);
+  auto const client_id = throttler_.AddClient(rate);
+  DCHECK_EQ(client_id + 1, animators_.size());
+  throttler_.RequestFrame(client_id);
+}
+
+FrameThrottler::ClientId Scheduler::ClientIdOf(Schedulable* animator) const {
+  auto const it = std::find(animators_.begin(), animators_.end(), animator);
+  DCHECK(it != animators_.end());
+  return static_cast<FrameThrottler::ClientId>(it - animators_.begin());
+}
+
+std::shared_ptr<base::SequencedTaskRunner>
+Scheduler::CreateSequencedTaskRunner(base::TaskPriority priority) {
+  return task_scheduler_.CreateSequencedTaskRunner(priority);
+}
+
+void Scheduler::DidBeginFrame() {
+  TRACE_EVENT0("ui", "Scheduler::DidBeginFrame");
+  auto const args = frame_scheduler_.BeginFrame(base::TimeTicks::Now());
+  frame_timing_.BeginFrame(args.frame_time);
+  auto const disallow_allocation = disallow_frame_allocation_ &&
+      frame_timing_.frame_number() > kNumWarmUpFrames;
+  if (disallow_allocation)
+    base::AllocationTracker::DisallowAllocation();
+  TickAnimators(args);
+  if (disallow_allocation)
+    base::AllocationTracker::AllowAllocation();
+  common::FrameArena::ForCurrentThread()->Reset();
+  // Requests the next frame before finishing this frame, so a late frame
+  // of continuous animation is counted as skipped vsyncs.
+  auto const now = base::TimeTicks::Now();
+  base::TimeTicks tick_time;
+  if (throttler_.NextTickTime(now, &tick_time) && tick_time <= now)
+    frame_scheduler_.RequestFrame(now);
+  frame_scheduler_.DidFinishFrame(args, base::TimeTicks::Now());
+  idle_tasks_.DidFinishFrame(args, base::TimeTicks::Now());
+
+  // Note: On Windows 8.1 and later, |hwnd| should be null.
+  DWM_TIMING_INFO timing_info = {0};
+  timing_info.cbSize = sizeof(timing_info);
+  if (FAILED(::DwmGetCompositionTimingInfo(nullptr, &timing_info)))
+    return;
+  frame_scheduler_.DidPresent(FromQpc(timing_info.qpcVBlank),
+                              FromQpc(timing_info.qpcRefreshPeriod) -
+                                  base::TimeTicks());
+}
+
+// Timers fire every millisecond, but animators tick at most once a vsync
+// interval, throttled as |Method::Vsync| does.
+void Scheduler::DidFireTimer() {
+  TRACE_EVENT0("ui", "Scheduler::DidFireTimer");
+  auto const now = base::TimeTicks::Now();
+  timers_.Advance(now);
+  auto const interval = frame_scheduler_.interval();
+  if (now - last_timer_frame_time_ < interval)
+    return;
+  last_timer_frame_time_ = now;
+  BeginFrameArgs args = {now + interval, now, interval,
+                         frame_timing_.frame_number() + 1};
+  frame_timing_.BeginFrame(now);
+  TickAnimators(args);
+  common::FrameArena::ForCurrentThread()->Reset();
+}
+
+// Returns false on WM_QUIT.
+bool Scheduler::DispatchMessages() {
+  MSG msg;
+  while (::PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+    if (msg.message == WM_QUIT)
+      return false;
+    ::TranslateMessage(&msg);
+    ::DispatchMessage(&msg);
+  }
+  return true;
+}
+
+// Converts QueryPerformanceCounter() value to |base::TimeTicks|, in
+// two parts to avoid overflow.
+base::TimeTicks Scheduler::FromQpc(uint64_t qpc) {
+  static LARGE_INTEGER ticks_per_sec;
+  if (!ticks_per_sec.QuadPart)
+    ::QueryPerformanceFrequency(&ticks_per_sec);
+  auto const frequency = static_cast<uint64_t>(ticks_per_sec.QuadPart);
+  auto const microseconds =
+      qpc / frequency * base::Time::kMicrosecondsPerSecond +
+      qpc % frequency * base::Time::kMicrosecondsPerSecond / frequency;
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(microseconds));
+}
+
+void Scheduler::PostTask(base::TaskPriority priority,
+                         const base::Task& task) {
+  task_scheduler_.PostTask(priority, task);
+}
+
+void Scheduler::PostIdleTask(const IdleTaskQueue::IdleTask& task) {
+  idle_tasks_.PostIdleTask(task);
+}
+
+void Scheduler::Remove(Schedulable* animator) {
+  auto const client_id = ClientIdOf(animator);
+  throttler_.RemoveClient(client_id);
+  animators_[client_id] = nullptr;
+}
+
+void Scheduler::RequestFrame(Schedulable* animator) {
+  throttler_.RequestFrame(ClientIdOf(animator));
+}
+
+void Scheduler::Run(Method method) {
+  switch (method) {
+    case Method::Timer: {
+      ::SetTimer(nullptr, reinterpret_cast<UINT_PTR>(this), 1,
+                 Scheduler::TimerProc);
+      MSG msg;
+      while (::GetMessage(&msg, nullptr, 0, 0)) {
+        ::TranslateMessage(&msg);
+        ::DispatchMessage(&msg);
+      }
+      return;
+    }
+    case Method::NoWait:
+    case Method::Waitable: {
+      auto const waitable = method == Method::NoWait ? nullptr :
+        ::CreateEvent(nullptr, false, false, nullptr);
+      MSG msg;
+      for (;;) {
+        if (::PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE)) {
+          if (!::GetMessage(&msg, nullptr, 0, 0))
+            break;
+          ::TranslateMessage(&msg);
+          ::DispatchMessage(&msg);
+        } else {
+          if (waitable)
+            ::WaitForSingleObject(waitable, 1);
+          DidFireTimer();
+        }
+      }
+      if (waitable)
+        ::CloseHandle(waitable);
+      return;
+    }
+    case Method::Vsync:
+      RunVsync();
+      return;
+  }
+  NOTREACHED();
+}
+
+// Sleeps until the next frame time, the next throttled tick or the next
+// timer on waitable timer, or until a message arrives, instead of polling.
+// Idle tasks run before sleeping. When no frame is requested and no timer
+// is pending, we wait only for messages, so idle application doesn't wake
+// up. High resolution timer requires Windows 10 version 1803, we use
+// normal waitable timer on older Windows.
+void Scheduler::RunVsync() {
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+  auto timer = ::CreateWaitableTimerExW(
+      nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+      TIMER_ALL_ACCESS);
+  if (!timer)
+    timer = ::CreateWaitableTimer(nullptr, false, nullptr);
+  for (;;) {
+    auto const now = base::TimeTicks::Now();
+    timers_.Advance(now);
+    base::TimeTicks tick_time;
+    auto const has_tick = throttler_.NextTickTime(now, &tick_time);
+    if (has_tick && tick_time <= now)
+      frame_scheduler_.RequestFrame(now);
+    auto const needs_frame = frame_scheduler_.needs_frame();
+    auto const frame_time = needs_frame ? frame_scheduler_.NextFrameTime() :
+                                          now;
+    if (needs_frame && frame_time <= now) {
+      DidBeginFrame();
+      if (!DispatchMessages())
+        break;
+      continue;
+    }
+
+    auto has_wake_time = needs_frame;
+    auto wake_time = frame_time;
+    if (has_tick && (!has_wake_time || tick_time < wake_time)) {
+      has_wake_time = true;
+      wake_time = tick_time;
+    }
+    base::TimeTicks timer_time;
+    if (timers_.NextDeadline(&timer_time) &&
+        (!has_wake_time || timer_time < wake_time)) {
+      has_wake_time = true;
+      wake_time = timer_time;
+    }
+
+    if (!idle_tasks_.empty()) {
+      auto const deadline = has_wake_time ? wake_time :
+          now + base::TimeDelta::FromMilliseconds(
+              IdleTaskQueue::kMaxIdlePeriod);
+      if (idle_tasks_.RunIdleTasks(deadline)) {
+        if (!DispatchMessages())
+          break;
+        continue;
+      }
+    }
+
+    auto num_handles = 0u;
+    if (has_wake_time) {
+      // Due time is relative in 100 nanoseconds, when it is negative.
+      LARGE_INTEGER due_time;
+      due_time.QuadPart = -std::max((wake_time - now).InMicroseconds(),
+                                    static_cast<int64_t>(0)) * 10;
+      ::SetWaitableTimer(timer, &due_time, 0, nullptr, nullptr, false);
+      num_handles = 1;
+    }
+    auto const result = ::MsgWaitForMultipleObjectsEx(
+        num_handles, &timer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    ++num_wakeups_;
+    if (result == WAIT_OBJECT_0 + num_handles && !DispatchMessages())
+      break;
+  }
+  ::CloseHandle(timer);
+}
+
+void Scheduler::SetActive(Schedulable* animator, bool active) {
+  throttler_.SetActive(ClientIdOf(animator), active);
+}
+
+void Scheduler::SetVisible(Schedulable* animator, bool visible) {
+  throttler_.SetVisible(ClientIdOf(animator), visible);
+}
+
+base::TimingWheel::TimerId Scheduler::StartTimer(
+    base::TimeTicks deadline, const base::TimingWheel::Callback& callback) {
+  return timers_.Add(deadline, callback);
+}
+
+void Scheduler::StopTimer(base::TimingWheel::TimerId timer_id) {
+  timers_.Cancel(timer_id);
+}
+
+void Scheduler::TickAnimators(const BeginFrameArgs& args) {
+  throttler_.BeginFrame(args);
+  for (auto client_id = 0u; client_id < animators_.size(); ++client_id) {
+    if (!throttler_.ShouldTick(client_id))
+      continue;
+    if (animators_[client_id]->BeginFrame(args))
+      throttler_.RequestFrame(client_id);
+  }
+}
+
+void CALLBACK Scheduler::TimerProc(HWND, UINT, UINT_PTR, DWORD) {
+  Scheduler::instance()->DidFireTimer();
+}
+
+}  // namespace ui
+
+namespace my {
+
+//////////////////////////////////////////////////////////////////////
+//
+// Sampling
+//
+class Sampling {
+  private: base::Sampling samples_;
+
+  public: Sampling(size_t max_samples = 100);
+  public: ~Sampling() = default;
+
+  public: float last() const { return samples_.last(); }
+  public: float maximum() const { return samples_.maximum(); }
+  public: float minimum() const { return samples_.minimum(); }
+
+  public: void AddSample(base::TimeDelta sample);
+  public: void AddSample(float sample);
+  public: void Paint(ID2D1RenderTarget* canvas, const gfx::Brush& brush,
+                     const gfx::RectF& bounds) const;
+
+  DISALLOW_COPY_AND_ASSIGN(Sampling);
+};
+
+// The graph starts with zero samples, so its scale doesn't jump while
+// filling up.
+Sampling::Sampling(size_t max_samples) : samples_(max_samples) {
+  for (auto count = 0u; count < max_samples; ++count)
+    samples_.AddSample(0.0f);
+}
+
+void Sampling::AddSample(base::TimeDelta sample) {
+  AddSample(sample.InMillisecondsF());
+}
+
+void Sampling::AddSample(float sample) {
+  samples_.AddSample(sample);
+}
+
+void Sampling::Paint(ID2D1RenderTarget* canvas, const gfx::Brush& brush,
+                     const gfx::RectF& bounds) const {
+  auto const maximum = samples_.maximum() * 1.1f;
+  auto const minimum = samples_.minimum() * 0.9f;
+  auto const span = maximum == minimum ? 1.0f : maximum - minimum;
+  auto const scale = bounds.height() / span;
+  auto  last_point = gfx::PointF(
+      bounds.left(),
+      bounds.bottom() - (samples_[0] - samples_.minimum()) * scale);
+  auto x_step = bounds.width() / samples_.size();
+  for (auto index = 0u; index < samples_.size(); ++index) {
+    auto const curr_point = gfx::PointF(
+        last_point.x() + x_step,
+        bounds.bottom() - (samples_[index] - samples_.minimum()) * scale);
+    canvas->DrawLine(last_point, curr_point, brush, 1.0f);
+    last_point = curr_point;
+  }
+  auto const avg = static_cast<float>(samples_.average());
+  auto const avg_y = bounds.bottom()- (avg - samples_.minimum()) * scale;
+  canvas->DrawLine(gfx::PointF(bounds.left(), avg_y),
+                   gfx::PointF(bounds.right(), avg_y),
+                   brush, 2.0f);
+  COM_VERIFY(canvas->Flush());
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Telemetry
+// Quantiles of frame times over a whole run, where |Sampling| only shows
+// the last samples. Histograms are merged into |kFileName| at exit, so it
+// has quantiles over all runs.
+//
+class Telemetry final : public common::Singleton<Telemetry> {
+  DECLARE_SINGLETON_CLASS(Telemetry);
+
+  public: enum class Metric {
+    // Microseconds between frames of |CartoonCard|.
+    CartoonTick,
+    // Number of ticks |CartoonCard| waited for its swap chain.
+    CartoonNotPresent,
+    // Microseconds between updates of |StatusLayer|.
+    StatusTick,
+    // Microseconds between DirectComposition frame statistics.
+    CompositionTime,
+    LastFrameTime,
+    NextFrameTime,
+    Count,
+  };
+
+  private: static const char* const kFileName;
+
+  private: base::Histogram histograms_[static_cast<int>(Metric::Count)];
+
+  private: Telemetry() = default;
+  private: ~Telemetry();
+
+  // Lock-free, can be called from any thread.
+  public: void Record(Metric metric, int64_t value);
+  public: void Record(Metric metric, base::TimeDelta value);
+
+  private: static const char* NameOf(Metric metric);
+
+  DISALLOW_COPY_AND_ASSIGN(Telemetry);
+};
+
+const char* const Telemetry::kFileName = "dtest_telemetry.txt";
+
+Telemetry::~Telemetry() {
+  std::vector<base::HistogramSnapshot> snapshots(
+      static_cast<size_t>(Metric::Count));
+  {
+    std::ifstream stream(kFileName);
+    for (auto& snapshot : snapshots) {
+      if (!stream || !snapshot.Deserialize(&stream)) {
+        snapshots.assign(snapshots.size(), base::HistogramSnapshot());
+        break;
+      }
+    }
+  }
+  for (auto index = 0; index < static_cast<int>(Metric::Count); ++index) {
+    auto const run = histograms_[index].Snapshot();
+    snapshots[index].Merge(run);
+    DVLOG(INFO) << NameOf(static_cast<Metric>(index)) << " count=" <<
+        run.count() << " p50=" << run.ValueAtQuantile(0.5) << " p90=" <<
+        run.ValueAtQuantile(0.9) << " p99=" << run.ValueAtQuantile(0.99) <<
+        " p99.9=" << run.ValueAtQuantile(0.999) << " all runs p99=" <<
+        snapshots[index].ValueAtQuantile(0.99) << std::endl;
+  }
+  std::ofstream stream(kFileName);
+  for (auto const& snapshot : snapshots)
+    snapshot.Serialize(&stream);
+}
+
+const char* Telemetry::NameOf(Metric metric) {
+  static const char* const kNames[] = {
+    "CartoonTick", "CartoonNotPresent", "StatusTick", "CompositionTime",
+    "LastFrameTime", "NextFrameTime",
+  };
+  return kNames[static_cast<int>(metric)];
+}
+
+void Telemetry::Record(Metric metric, int64_t value) {
+  histograms_[static_cast<int>(metric)].Record(value);
+}
+
+void Telemetry::Record(Metric metric, base::TimeDelta value) {
+  histograms_[static_cast<int>(metric)].Record(value);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// BoxShadow
+//
+struct BoxShadow {
+  gfx::SizeF offset;
+  float blur_radius;
+  gfx::ColorF color;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Card
+//
+class Card : public ui::Layer {
+  private: enum class State {
+    Active,
+    Inactive,
+    WillBeInactive,
+  };
+
+  private: gfx::RectF content_bounds_;
+  std::vector<BoxShadow> shadows_;
+  private: gfx::SizeF shadow_size_;
+  private: State state_;
+  private: std::unique_ptr<gfx::SwapChain> swap_chain_;
+  private: ui::FrameTimingRecorder::LayerId timing_id_;
+
+  // |name| identifies this card in frame timing.
+  protected: Card(ui::Compositor* compositor, const char* name);
+  protected: virtual ~Card() = default;
+
+  public: const gfx::RectF& content_bounds() const { return content_bounds_; }
+  public: ID2D1DeviceContext* d2d_device_context() const {
+    return swap_chain_->d2d_device_context();
+  }
+  protected: ui::FrameTimingRecorder* frame_timing() const {
+    return ui::Scheduler::instance()->mutable_frame_timing();
+  }
+  public: gfx::SwapChain* swap_chain() const { return swap_chain_.get(); }
+  protected: ui::FrameTimingRecorder::LayerId timing_id() const {
+    return timing_id_;
+  }
+
+  protected: void PaintBackground(ID2D1DeviceContext* canvas) const;
+  protected: gfx::IntRect ToPixelRect(const gfx::RectF& rect) const;
+
+  // ui::Layer
+  protected: virtual void DidActive() override;
+  protected: virtual void DidChangeBounds() override;
+  protected: virtual void DidInactive() override;
+  protected: virtual bool DoAnimate(base::TimeTicks tick_count) override;
+
+  DISALLOW_COPY_AND_ASSIGN(Card);
+};
+
+Card::Card(ui::Compositor* compositor, const char* name)
+    : Layer(compositor), state_(State::Inactive),
+      timing_id_(frame_timing()->AddLayer(name)) {
+  // Below values are obtained from
+  // http://www.polymer-project.org/tools/designer/
+  shadows_ = {
+    {gfx::SizeF(0.0f, 2.0f), 4.0f, gfx::ColorF(0, 0, 0, 0.098f)},
+    {gfx::SizeF(0.0f, 0.0f), 3.0f, gfx::ColorF(0, 0, 0, 0.098f)}
+  };
+  for (const auto& shadow : shadows_) {
+    shadow_size_.set_width(std::max(shadow_size_.width(),
+        shadow.offset.width() + shadow.blur_radius * 2));
+    shadow_size_.set_height(std::max(shadow_size_.height(),
+        shadow.offset.height() + shadow.blur_radius * 2));
+  }
+}
+
+void Card::PaintBackground(ID2D1DeviceContext* canvas) const {
+  TRACE_EVENT0("my", "Card::PaintBackground");
+  auto const radius = 2.0f;
+  canvas->Clear(gfx::ColorF(gfx::ColorF::White, 0.0f));
+
+  common::ComPtr<ID2D1Image> current_target;
+  canvas->GetTarget(&current_target);
+
+  gfx::Bitmap bitmap(canvas, canvas->GetPixelSize());
+
+  ui::ScopedFramePhase blur_phase(frame_timing(), timing_id_,
+                                  ui::FramePhase::Blur);
+  common::ComPtr<ID2D1Effect> blur_effect;
+  COM_VERIFY(canvas->CreateEffect(CLSID_D2D1GaussianBlur, &blur_effect));
+
+  for (const auto& shadow : shadows_) {
+    const auto shadow_size = gfx::SizeF(shadow.blur_radius,
+                                        shadow.blur_radius);
+    const auto shadow_bounds = gfx::RectF(
+       content_bounds().origin() + shadow.offset,
+       content_bounds().size());
+
+    canvas->SetTarget(bitmap);
+    canvas->Clear(gfx::ColorF(0, 0, 0, 0));
+    canvas->FillRoundedRectangle(
+         D2D1::RoundedRect(shadow_bounds, radius, radius),
+         gfx::Brush(canvas, shadow.color));
+
+    blur_effect->SetInput(0, bitmap);
+    COM_VERIFY(blur_effect->SetValue(D2D1_GAUSSIANBLUR_PROP_STANDARD_DEVIATION,
+                                     shadow.blur_radius));
+    canvas->SetTarget(current_target);
+    canvas->DrawImage(blur_effect, gfx::PointF());
+    COM_VERIFY(canvas->Flush());
+  }
+
+  canvas->FillRoundedRectangle(D2D1::RoundedRect(content_bounds(),
+                                                 radius, radius),
+                               gfx::Brush(canvas, gfx::ColorF::White));
+}
+
+// Returns the smallest rectangle in back buffer pixels which contains |rect|
+// in DIPs.
+gfx::IntRect Card::ToPixelRect(const gfx::RectF& rect) const {
+  float dpi_x, dpi_y;
+  d2d_device_context()->GetDpi(&dpi_x, &dpi_y);
+  auto const scale_x = dpi_x / 96.0f;
+  auto const scale_y = dpi_y / 96.0f;
+  gfx::IntRect pixel_rect = {
+    static_cast<int>(::floor(rect.left() * scale_x)),
+    static_cast<int>(::floor(rect.top() * scale_y)),
+    static_cast<int>(::ceil(rect.right() * scale_x)),
+    static_cast<int>(::ceil(rect.bottom() * scale_y))
+  };
+  return pixel_rect;
+}
+
+// ui::Layer
+void Card::DidActive() {
+  Layer::DidActive();
+  state_ = State::Active;
+}
+
+void Card::DidChangeBounds() {
+  content_bounds_.set_size(bounds().size() - shadow_size_);
+  D2D1_SIZE_U size = {
+    static_cast<uint32_t>(bounds().width()),
+    static_cast<uint32_t>(bounds().height())
+  };
+
+  if (swap_chain_) {
+    swap_chain_->DidChangeBounds(size);
+    return;
+  }
+
+  // Create swap chain and d2d device context
+  swap_chain_.reset(new gfx::SwapChain(
+      compositor()->dx_device(), size));
+  COM_VERIFY(visual()->SetContent(swap_chain_->swap_chain()));
+}
+
+void Card::DidInactive() {
+  Layer::DidInactive();
+  state_ = State::WillBeInactive;
+}
+
+bool Card::DoAnimate(base::TimeTicks) {
+  // Try again in the next frame.
+  if (!swap_chain()->IsReady())
+    return true;
+
+  if (state_ != State::WillBeInactive)
+    return state_ == State::Active;
+
+  state_ = State::Inactive;
+  auto const bounds = content_bounds();
+
+  // Paint "Paused" in center of layer.
+  auto const font_size = 40;
+  common::ComPtr<IDWriteTextFormat> text_format;
+  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
+    L"Verdana", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
+    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format));
+
+  base::string16 text(L"Paused");
+  common::ComPtr<IDWriteTextLayout> text_layout;
+  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
+      text.data(), static_cast<UINT>(text.length()), text_format,
+      bounds.width(), bounds.width(),
+      &text_layout));
+
+  DWRITE_TEXT_METRICS text_metrics;
+  COM_VERIFY(text_layout->GetMetrics(&text_metrics));
+
+  auto const text_origin = gfx::PointF(
+    bounds.left() + (bounds.width() - text_metrics.width) / 2,
+    bounds.top() + (bounds.height() - text_metrics.height) / 2);
+
+  auto const canvas = d2d_device_context();
+  canvas->BeginDraw();
+
+  canvas->FillRectangle(bounds,
+    gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Black, 0.4f)));
+
+  gfx::Brush text_brush(canvas, gfx::ColorF(gfx::ColorF::White, 0.9f));
+  canvas->DrawTextLayout(text_origin, text_layout, text_brush);
+
+  COM_VERIFY(canvas->EndDraw());
+  swap_chain()->Present();
+  return false;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// CartoonCard
+//
+class CartoonCard : public Card {
+  // We simulate 128ms at most in a frame.
+  private: static const int kMaxStepsPerFrame = 8;
+
+  // Interpolated angles and positions of balls for painting.
+  private: std::vector<float> ball_angles_;
+  private: std::unique_ptr<gfx::SpriteBatch> ball_batch_;
+  private: std::vector<gfx::SpriteInstance> ball_instances_;
+  private: std::unique_ptr<gfx::Bitmap> ball_sprite_;
+  private: std::vector<float> ball_xs_;
+  private: std::vector<float> ball_ys_;
+  // We don't use thread pool for a few balls.
+  private: physics::World balls_;
+  private: physics::FixedTimestep timestep_;
+  private: base::TimeTicks last_tick_count_;
+  private: DXGI_FRAME_STATISTICS last_stats_;
+  private: int not_present_count_;
+  private: Sampling present_sample_;
+  private: common::ComPtr<IDWriteTextFormat> text_format_;
+  private: Sampling tick_count_sample_;
+
+  public: CartoonCard(ui::Compositor* compositor);
+  public: virtual ~CartoonCard();
+
+  private: physics::Bounds ball_bounds() const;
+
+  private: void CreateBallSprite();
+  private: void PaintBalls(ID2D1DeviceContext* canvas);
+
+  // ui::Layer
+  private: virtual void DidChangeBounds() override;
+  private: virtual bool DoAnimate(base::TimeTicks tick_count) override;
+
+  DISALLOW_COPY_AND_ASSIGN(CartoonCard);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// CartoonCard
+//
+CartoonCard::CartoonCard(ui::Compositor* compositor)
+    : Card(compositor, "CartoonCard"),
+      timestep_(base::TimeDelta::FromMilliseconds(16), kMaxStepsPerFrame),
+      last_tick_count_(base::TimeTicks::Now()), not_present_count_(0) {
+  last_stats_ = {0};
+  timestep_.Reset(last_tick_count_);
+
+  // x, y, motion x, motion y, size, angle
+  auto const balls = balls_.mutable_particles();
+  balls->Add(10.0f, 10.0f, 1.3f, 1.2f, 10.0f, 0.0f);
+  balls->Add(90.0f, 10.0f, -2.0f, 1.5f, 10.0f, 30.0f);
+  balls->Add(30.0f, 90.0f, 1.0f, -1.0f, 15.0f, 90.0f);
+  balls->Add(90.0f, 90.0f, -1.0f, -1.0f, 20.0f, 180.0f);
+  balls->Add(50.0f, 50.0f, -1.0f, -1.0f, 13.0f, 180.0f);
+
+  auto const font_size = 13;
+  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
+    L"Consolas", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
+    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format_));
+}
+
+CartoonCard::~CartoonCard() {
+}
+
+physics::Bounds CartoonCard::ball_bounds() const {
+  auto const& bounds = content_bounds();
+  physics::Bounds ball_bounds = {
+    bounds.left(), bounds.top(), bounds.right(), bounds.bottom()
+  };
+  return ball_bounds;
+}
+
+// Paints a ball into sprite bitmap once. Balls are drawn from this sprite
+// with rotation by |gfx::SpriteBatch|.
+void CartoonCard::CreateBallSprite() {
+  auto const kSpriteSize = 64u;
+  auto const canvas = d2d_device_context();
+  ball_sprite_.reset(new gfx::Bitmap(canvas,
+                                     D2D1::SizeU(kSpriteSize, kSpriteSize)));
+
+  common::ComPtr<ID2D1Image> current_target;
+  canvas->GetTarget(&current_target);
+  canvas->SetTarget(*ball_sprite_);
+  canvas->BeginDraw();
+  canvas->Clear(gfx::ColorF(0, 0, 0, 0));
+  auto const size = canvas->GetSize();
+  auto const radius = size.width / 2;
+  auto const center = gfx::PointF(radius, radius);
+  D2D1_ELLIPSE ellipse;
+  ellipse.point = center;
+  ellipse.radiusX = radius;
+  ellipse.radiusY = radius;
+  canvas->FillEllipse(ellipse,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5)));
+
+  auto const rect_size = radius * 0.5f;
+  canvas->FillRectangle(
+      gfx::RectF(center.x() - rect_size, center.y() - rect_size,
+                 center.x() + rect_size, center.y() + rect_size),
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Green, 0.7f)));
+  COM_VERIFY(canvas->EndDraw());
+  canvas->SetTarget(current_target);
+
+  ball_batch_.reset(new gfx::SpriteBatch(canvas, *ball_sprite_));
+}
+
+void CartoonCard::DidChangeBounds() {
+  Card::DidChangeBounds();
+  if (!ball_batch_)
+    CreateBallSprite();
+  balls_.mutable_particles()->ClampInto(ball_bounds());
+}
+
+bool CartoonCard::DoAnimate(base::TimeTicks tick_count) {
+  auto needs_frame = false;
+  {
+    ui::ScopedFramePhase phase(frame_timing(), timing_id(),
+                               ui::FramePhase::Animate);
+    needs_frame = Card::DoAnimate(tick_count);
+  }
+
+  if (!is_active())
+    return needs_frame;
+
+  if (!swap_chain()->IsReady()) {
+    ++not_present_count_;
+    return true;
+  }
+
+  // Statistics
+  DXGI_FRAME_STATISTICS stats = {0};
+  // Ignore errors. |GetFrameStatistics()| returns
+  // DXGI_ERROR_FRAME_STATISTICS_DISJOINT.
+  swap_chain()->swap_chain()->GetFrameStatistics(&stats);
+
+  tick_count_sample_.AddSample(tick_count - last_tick_count_);
+  Telemetry::instance()->Record(Telemetry::Metric::CartoonTick,
+                                tick_count - last_tick_count_);
+  last_tick_count_ = tick_count;
+
+  present_sample_.AddSample(not_present_count_);
+  Telemetry::instance()->Record(Telemetry::Metric::CartoonNotPresent,
+                                not_present_count_);
+  not_present_count_ = 0;
+
+  {
+    ui::ScopedFramePhase phase(frame_timing(), timing_id(),
+                               ui::FramePhase::Physics);
+    balls_.Step(ball_bounds(), timestep_.Advance(tick_count));
+  }
+
+  // Present is nested in paint, and is subtracted from it.
+  ui::ScopedFramePhase paint_phase(frame_timing(), timing_id(),
+                                   ui::FramePhase::Paint);
+  auto const canvas = d2d_device_context();
+  canvas->BeginDraw();
+  PaintBackground(canvas);
+  PaintBalls(canvas);
+
+  // Sample graph
+  tick_count_sample_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Red, 0.5f)),
+      gfx::RectF(gfx::PointF(content_bounds().left(),
+                             content_bounds().bottom() - 20),
+                 content_bounds().bottom_right()));
+  present_sample_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5f)),
+      gfx::RectF(gfx::PointF(content_bounds().left(),
+                             content_bounds().bottom() - 40),
+                 content_bounds().bottom_right() - gfx::SizeF(0, 20)));
+
+  {
+    ui::ScopedFramePhase text_phase(frame_timing(), timing_id(),
+                                    ui::FramePhase::TextLayout);
+    common::FrameStringBuilder text;
+    text << L"(Red) TickCount=" << tick_count_sample_.minimum() <<
+      L" " << tick_count_sample_.maximum() <<
+      L" " << tick_count_sample_.last() << L"\n";
+    text << L"(Blue) NotPresentCount=" << present_sample_.minimum() <<
+      L" " << present_sample_.maximum() <<
+      L" " << present_sample_.last() << L"\n";
+    text << L"PresentCount=" <<
+        stats.PresentCount - last_stats_.PresentCount << L"\n";
+    text << L"PresentRefreshCount=" <<
+        stats.PresentRefreshCount - last_stats_.PresentRefreshCount <<
+        L"\n";
+    text << L"SyncQPCTime=" <<
+        stats.SyncQPCTime.QuadPart -
+            last_stats_.SyncQPCTime.QuadPart << L"\n";
+    text << L"SyncGPUTime=" <<
+        stats.SyncGPUTime.QuadPart -
+            last_stats_.SyncGPUTime.QuadPart << L"\n";
+
+    common::ComPtr<IDWriteTextLayout> text_layout;
+    COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
+        text.data(), static_cast<UINT>(text.size()), text_format_,
+        content_bounds().width(), content_bounds().height(), &text_layout));
+
+    gfx::Brush text_brush(canvas, gfx::ColorF(gfx::ColorF::Black, 0.5f));
+    canvas->DrawTextLayout(gfx::PointF(5.0f, 5.0f), text_layout, text_brush,
+                           D2D1_DRAW_TEXT_OPTIONS_CLIP);
+  }
+  COM_VERIFY(canvas->EndDraw());
+  {
+    ui::ScopedFramePhase present_phase(frame_timing(), timing_id(),
+                                       ui::FramePhase::Present);
+    swap_chain()->Present();
+  }
+
+  last_stats_ = stats;
+  last_tick_count_ = tick_count;
+  return true;
+}
+
+// Draws all balls in one sprite batch, instead of a transform, two brushes,
+// two fills and a flush for each ball. Balls are painted between the last
+// two steps by time left in |timestep_|.
+void CartoonCard::PaintBalls(ID2D1DeviceContext* canvas) {
+  auto const& balls = balls_.particles();
+  auto const num_balls = balls.size();
+  ball_angles_.resize(num_balls);
+  ball_instances_.resize(num_balls);
+  ball_xs_.resize(num_balls);
+  ball_ys_.resize(num_balls);
+  balls.Interpolate(std::min(timestep_.alpha(), 1.0f), ball_xs_.data(),
+                    ball_ys_.data(), ball_angles_.data());
+  auto const radii = balls.radii();
+  for (auto index = 0u; index < num_balls; ++index) {
+    auto& instance = ball_instances_[index];
+    instance.center_x = ball_xs_[index];
+    instance.center_y = ball_ys_[index];
+    instance.size = radii[index];
+    instance.angle = ball_angles_[index];
+    instance.color = 0xFFFFFFFF;
+  }
+  ball_batch_->Draw(canvas, ball_instances_.data(), ball_instances_.size());
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// RootLayer
+//
+class RootLayer final : public ui::SimpleLayer {
+  public: RootLayer(ui::Compositor* compositor);
+  public: virtual ~RootLayer() = default;
+
+  // ui::Layer
+  private: virtual void DidChangeBounds() override;
+
+  DISALLOW_COPY_AND_ASSIGN(RootLayer);
+};
+
+RootLayer::RootLayer(ui::Compositor* compositor)
+    : ui::SimpleLayer(compositor) {
+}
+
+void RootLayer::DidChangeBounds() {
+  ui::SimpleLayer::DidChangeBounds();
+#if 0
+  ScopedCanvas scoped_canvas(this);
+  auto const bounds = scoped_canvas.bounds() - gfx::SizeF(20, 20);
+  auto const canvas = scoped_canvas.d2d_device_context();
+  canvas->Clear(gfx::ColorF(0, 0, 1, 0.2));
+  gfx::Brush white_brush(canvas,
+                         gfx::ColorF(gfx::ColorF::White, 0.3f));
+  gfx::Brush red_brush(canvas,
+                         gfx::ColorF(gfx::ColorF::White, 0.3f));
+
+  canvas->DrawLine(bounds.origin(), bounds.bottom_right(), white_brush,
+                   5.0f);
+  canvas->DrawLine(gfx::PointF(bounds.right(), bounds.top()),
+                   gfx::PointF(bounds.left(), bounds.bottom()),
+                   white_brush, 5.0f);
+  canvas->FillRectangle(bounds, red_brush);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// StatusLayer
+//
+class StatusLayer : public Card, public ui::Schedulable {
+  private: DCOMPOSITION_FRAME_STATISTICS last_stats_;
+  private: base::TimeTicks last_tick_count_;
+  private: Sampling sample_duration_;
+  private: Sampling sample_last_frame_;
+  private: Sampling sample_next_frame_;
+  private: Sampling sample_tick_;
+  private: common::ComPtr<IDWriteTextFormat> text_format_;
+  private: common::ComPtr<IDWriteTextLayout> text_layout_;
+
+  public: StatusLayer(ui::Compositor* compositor);
+  public: virtual ~StatusLayer();
+
+  private: virtual bool DoAnimate(base::TimeTicks tick_count) override;
+  private: void Update(base::TimeTicks tick_count);
+
+  // ui::Schedulable
+  private: virtual bool BeginFrame(const ui::BeginFrameArgs& args) override;
+  private: virtual void DoAnimate() override;
+
+  DISALLOW_COPY_AND_ASSIGN(StatusLayer);
+};
+
+StatusLayer::StatusLayer(ui::Compositor* compositor)
+    : Card(compositor, "StatusLayer"),
+      last_tick_count_(base::TimeTicks::Now()), sample_duration_(100),
+      sample_last_frame_(100), sample_next_frame_(100), sample_tick_(100) {
+  COM_VERIFY(compositor->device()->GetFrameStatistics(&last_stats_));
+
+  auto const font_size = 13;
+  COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextFormat(
+    L"Consolas", nullptr, DWRITE_FONT_WEIGHT_REGULAR, DWRITE_FONT_STYLE_NORMAL,
+    DWRITE_FONT_STRETCH_NORMAL, font_size, L"en-us", &text_format_));
+  ui::Scheduler::instance()->Add(this, ui::FrameRate::Hz10);
+}
+
+StatusLayer::~StatusLayer() {
+  ui::Scheduler::instance()->Remove(this);
+}
+
+// Status is ticked by |ui::Scheduler| at 10 Hz rather than by the layer
+// tree.
+bool StatusLayer::DoAnimate(base::TimeTicks) {
+  return false;
+}
+
+// ui::Schedulable
+// Status shows statistics of frames requested by other clients, so it never
+// requests a frame by itself.
+bool StatusLayer::BeginFrame(const ui::BeginFrameArgs& args) {
+  Update(args.frame_time);
+  return false;
+}
+
+void StatusLayer::DoAnimate() {
+  Update(base::TimeTicks::Now());
+}
+
+void StatusLayer::Update(base::TimeTicks tick_count) {
+  if (!swap_chain()->IsReady())
+    return;
+
+  DCOMPOSITION_FRAME_STATISTICS stats;
+  COM_VERIFY(compositor()->device()->GetFrameStatistics(&stats));
+
+  // Update samples
+  sample_tick_.AddSample(tick_count - last_tick_count_);
+  auto const telemetry = Telemetry::instance();
+  telemetry->Record(Telemetry::Metric::StatusTick,
+                    tick_count - last_tick_count_);
+  last_tick_count_ = tick_count;
+
+  sample_duration_.AddSample(
+    ((stats.currentTime - last_stats_.currentTime) * 1000 /
+     stats.timeFrequency).QuadPart);
+  sample_last_frame_.AddSample(
+    ((stats.lastFrameTime - last_stats_.lastFrameTime) * 1000 /
+     stats.timeFrequency).QuadPart);
+  sample_next_frame_.AddSample(
+    ((stats.nextEstimatedFrameTime - last_stats_.nextEstimatedFrameTime) *
+     1000 / stats.timeFrequency).QuadPart);
+  auto const frequency = stats.timeFrequency.QuadPart;
+  telemetry->Record(Telemetry::Metric::CompositionTime,
+      (stats.currentTime.QuadPart - last_stats_.currentTime.QuadPart) *
+      1000000 / frequency);
+  telemetry->Record(Telemetry::Metric::LastFrameTime,
+      (stats.lastFrameTime.QuadPart - last_stats_.lastFrameTime.QuadPart) *
+      1000000 / frequency);
+  telemetry->Record(Telemetry::Metric::NextFrameTime,
+      (stats.nextEstimatedFrameTime.QuadPart -
+       last_stats_.nextEstimatedFrameTime.QuadPart) * 1000000 / frequency);
+  last_stats_ = stats;
+
+  // Present is nested in paint, and is subtracted from it.
+  ui::ScopedFramePhase paint_phase(frame_timing(), timing_id(),
+                                   ui::FramePhase::Paint);
+  //ui::SimpleLayer::ScopedCanvas scoped_canvas(this);
+  //auto const canvas = scoped_canvas.d2d_device_context();
+  auto const canvas = d2d_device_context();
+  canvas->BeginDraw();
+
+  auto const bounds = content_bounds();
+  auto const graph_bounds = gfx::RectF(
+    gfx::PointF(bounds.left() + 4, bounds.bottom() - 84),
+    gfx::PointF(bounds.right() - 4, bounds.bottom() - 4));
+  auto const text_bounds = gfx::RectF(
+    gfx::PointF(bounds.left() + 5, bounds.top() + 5),
+    gfx::PointF(bounds.right() - 5, graph_bounds.top() - 4));
+
+  // Only numbers and graph are changed in every frame, so we repaint
+  // background and present whole back buffer only after resizing.
+  gfx::PresentParams present_params;
+  if (swap_chain()->needs_full_present()) {
+    //canvas->Clear(gfx::ColorF(0, 0, 0, 0.5));
+    PaintBackground(canvas);
+  } else {
+    canvas->FillRectangle(text_bounds,
+                          gfx::Brush(canvas, gfx::ColorF::White));
+    present_params.AddDirtyRect(ToPixelRect(text_bounds));
+    present_params.AddDirtyRect(ToPixelRect(graph_bounds));
+  }
+
+  // Paint graph
+  canvas->FillRectangle(graph_bounds, gfx::Brush(canvas, gfx::ColorF::Black));
+
+  sample_next_frame_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Red, 0.5f)),
+      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 20),
+                 graph_bounds.bottom_right()));
+  sample_duration_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Gold, 0.5f)),
+      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 40),
+                 graph_bounds.bottom_right() - gfx::SizeF(0, 20)));
+  sample_last_frame_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::Blue, 0.5f)),
+      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 60),
+                 graph_bounds.bottom_right() - gfx::SizeF(0, 40)));
+  sample_tick_.Paint(canvas,
+      gfx::Brush(canvas, gfx::ColorF(gfx::ColorF::White, 0.5f)),
+      gfx::RectF(gfx::PointF(graph_bounds.left(), graph_bounds.bottom() - 80),
+                 graph_bounds.bottom_right() - gfx::SizeF(0, 60)));
+
+  {
+    ui::ScopedFramePhase text_phase(frame_timing(), timing_id(),
+                                    ui::FramePhase::TextLayout);
+    // Samples values
+    common::FrameStringBuilder text;
+    text << L"(White) Tick=" << sample_tick_.minimum() << L" " <<
+        sample_tick_.maximum() << L" " << sample_tick_.last() << L"\n";
+    text << L"(Blue) LastFrameTime=" << sample_last_frame_.minimum() <<
+        L" " << sample_last_frame_.maximum() <<
+        L" " << sample_last_frame_.last() << L"\n";
+    text << L"(Yellow) CurrentTime=" << sample_duration_.minimum() <<
+        L" " << sample_duration_.maximum() <<
+        L" " << sample_duration_.last() << L"\n";
+    text << L"(Red) NextFrame=" << sample_next_frame_.minimum() <<
+        L" " << sample_next_frame_.maximum() <<
+        L" " << sample_next_frame_.last() << L"\n";
+    text << L"rate=" << stats.currentCompositionRate.Numerator <<
+        L"/" << stats.currentCompositionRate.Denominator << L"\n";
+    text << L"hz=" << stats.timeFrequency.QuadPart << L"\n";
+    text << L"wakeups=" << ui::Scheduler::instance()->num_wakeups() <<
+        L" frames=" <<
+        ui::Scheduler::instance()->frame_scheduler().num_frames() << L"\n";
+    auto const& idle_tasks = ui::Scheduler::instance()->idle_tasks();
+    text << L"idle=" << idle_tasks.idle_time_used().InMilliseconds() <<
+        L"/" << idle_tasks.idle_time().InMilliseconds() << L"ms missed=" <<
+        idle_tasks.num_missed_deadlines() << L"\n";
+    auto const arena = common::FrameArena::ForCurrentThread();
+    text << L"arena=" << arena->last_high_water() << L"/" <<
+        arena->peak_high_water() << L" bytes\n";
+
+    text_layout_.reset();
+    COM_VERIFY(gfx::Factory::instance()->dwrite()->CreateTextLayout(
+        text.data(), static_cast<UINT>(text.size()), text_format_,
+        text_bounds.width(), text_bounds.height(), &text_layout_));
+
+    gfx::Brush text_brush(canvas, gfx::ColorF::Black, 0.7);
+    canvas->DrawTextLayout(text_bounds.origin(), text_layout_, text_brush,
+                           D2D1_DRAW_TEXT_OPTIONS_CLIP);
+  }
+
+  COM_VERIFY(canvas->EndDraw());
+  ui::ScopedFramePhase present_phase(frame_timing(), timing_id(),
+                                     ui::FramePhase::Present);
+  swap_chain()->Present(present_params);
+}
+
+// Writes phase times of recent frames to dtest_frame_timing.csv and
+// dtest_frame_timing.json. DemoApp does this on F12 and at exit.
+void WriteFrameTiming() {
+  auto const& frame_timing = ui::Scheduler::instance()->frame_timing();
+  {
+    std::ofstream stream("dtest_frame_timing.csv");
+    frame_timing.WriteCsv(&stream);
+  }
+  std::ofstream stream("dtest_frame_timing.json");
+  frame_timing.WriteJson(&stream);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// DemoApp
+//
+class DemoApp final : public ui::Window, private ui::Schedulable,
+                      private ui::Animatable {
+  private: class Animation {
+    public: enum class Type {
+      Scroll,
+      Zoom,
+    };
+
+    private: std::unique_ptr<ui::Animation> animation_;
+    private: Type type_;
+    private: std::unique_ptr<ui::Animation::Variable> variable1_;
+
+    public: Animation(Type type, ui::Animatable* animatable,
+                      const ui::Animation::Timing& timing);
+    public: ~Animation();
+
+    public: Type type() const { return type_; }
+    public: double value1() const;
+
+    public: base::TimeTicks NextFrameTime(base::TimeTicks current_time) const {
+      return animation_->NextFrameTime(current_time);
+    }
+    public: void Play(base::TimeTicks current_time);
+    public: void SetValues1(double start, double end);
+    public: void Start();
+  };
+
+  private: std::unique_ptr<Animation> animation_;
+  private: std::unique_ptr<ui::Compositor> compositor_;
+  private: std::unique_ptr<CartoonCard> cartoon_layer_;
+  private: base::TimingWheel::TimerId frame_timer_;
+  private: base::TimeTicks frame_timer_time_;
+  private: std::unique_ptr<RootLayer> root_layer_;
+  private: std::unique_ptr<StatusLayer> status_layer_;
+  private: HWND status_hwnd_;
+  private: ui::FrameTimingRecorder::LayerId timing_id_;
+
+  public: DemoApp();
+  public: virtual ~DemoApp();
+
+  // Returns true if layers or animation need another frame.
+  private: bool Animate(base::TimeTicks current_tick);
+  // Tells activation and visibility of this window to the scheduler for
+  // throttling.
+  private: void DidChangeActivation(bool active);
+  private: void DidChangeVisibility(bool visible);
+  // Requests a frame at |time| by timer. We keep the earlier one if a timer
+  // is pending.
+  private: void RequestFrameAt(base::TimeTicks time);
+
+  // ui::Animatable
+  private: virtual void DidFinishAnimation() override;
+  private: virtual void DidFireAnimationTimer() override;
+
+  // ui::Schedulable
+  private: virtual bool BeginFrame(const ui::BeginFrameArgs& args) override;
+  private: virtual void DoAnimate() override;
+
+  // ui::Window
+  private: virtual void DidActive() override;
+  private: virtual void DidChangeBounds() override;
+  private: virtual void DidCreate() override;
+  private: virtual void DidInactive() override;
+  private: virtual LRESULT OnMessage(UINT message, WPARAM wParam,
+                                     LPARAM lParam) override;
+  private: virtual void WillDestroy() override;
+
+  DISALLOW_COPY_AND_ASSIGN(DemoApp);
+};
+
+DemoApp::DemoApp()
+    : frame_timer_(0), status_hwnd_(nullptr),
+      timing_id_(ui::Scheduler::instance()->mutable_frame_timing()->AddLayer(
+          "DemoApp")) {
+  // Window messages during creating window request frames.
+  ui::Scheduler::instance()->Add(this, ui::FrameRate::OnDemand);
+
+  float dpi_x, dpi_y;
+  gfx::Factory::instance()->d2d_factory()->GetDesktopDpi(&dpi_x, &dpi_y);
+
+  Window::Creator creator(this);
+  auto const hwnd = ::CreateWindow(
+    GetWindowClass(),
+    L"Window Title",
+    WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+    CW_USEDEFAULT,
+    CW_USEDEFAULT,
+    static_cast<UINT>(ceil(640.f * dpi_x / 96.f)),
+    static_cast<UINT>(ceil(800.f * dpi_y / 96.f)),
+    nullptr,
+    nullptr,
+    HINST_THISCOMPONENT,
+    nullptr);
+  if (!hwnd)
+    return;
+  //::ShowWindow(hwnd, SW_SHOWNORMAL);
+}
+
+DemoApp::~DemoApp() {
+}
+
+// ui::Animation
+void DemoApp::DidFinishAnimation() {
+  animation_.reset();
+}
+
+void DemoApp::DidFireAnimationTimer() {
+  switch (animation_->type()) {
+    case Animation::Type::Scroll: {
+      auto const origin_top = animation_->value1();
+      root_layer_->SetBounds(gfx::RectF(
+        gfx::PointF(root_layer_->bounds().left(), origin_top),
+        root_layer_->bounds().size()));
+      compositor_->NeedCommit();
+      break;
+    }
+  }
+}
+
+bool DemoApp::Animate(base::TimeTicks current_tick) {
+  if (!root_layer_)
+    return false;
+  auto const frame_timing =
+      ui::Scheduler::instance()->mutable_frame_timing();
+  auto needs_frame = false;
+  {
+    // Cards record their own phases, which are subtracted from this one.
+    ui::ScopedFramePhase phase(frame_timing, timing_id_,
+                               ui::FramePhase::Animate);
+    if (animation_)
+      animation_->Play(current_tick);
+    needs_frame = root_layer_->DoAnimate(current_tick);
+  }
+  {
+    ui::ScopedFramePhase phase(frame_timing, timing_id_,
+                               ui::FramePhase::Commit);
+    compositor_->Commit();
+  }
+  if (animation_) {
+    auto const next_frame_time = animation_->NextFrameTime(current_tick);
+    if (next_frame_time > current_tick)
+      RequestFrameAt(next_frame_time);
+    else
+      needs_frame = true;
+  }
+  return needs_frame;
+}
+
+void DemoApp::DidChangeActivation(bool active) {
+  auto const scheduler = ui::Scheduler::instance();
+  scheduler->SetActive(this, active);
+  if (status_layer_)
+    scheduler->SetActive(status_layer_.get(), active);
+  scheduler->RequestFrame(this);
+}
+
+void DemoApp::DidChangeVisibility(bool visible) {
+  auto const scheduler = ui::Scheduler::instance();
+  scheduler->SetVisible(this, visible);
+  if (status_layer_)
+    scheduler->SetVisible(status_layer_.get(), visible);
+  if (visible)
+    scheduler->RequestFrame(this);
+}
+
+void DemoApp::RequestFrameAt(base::TimeTicks time) {
+  auto const scheduler = ui::Scheduler::instance();
+  if (scheduler->IsTimerPending(frame_timer_)) {
+    if (frame_timer_time_ <= time)
+      return;
+    scheduler->StopTimer(frame_timer_);
+  }
+  frame_timer_time_ = time;
+  frame_timer_ = scheduler->StartTimer(time, [this, scheduler]() {
+    scheduler->RequestFrame(this);
+  });
+}
+
+// ui::Schedulable
+// Animations use vsync time rather than current time, so motion doesn't
+// jitter with wakeup latency.
+bool DemoApp::BeginFrame(const ui::BeginFrameArgs& args) {
+  return Animate(args.frame_time);
+}
+
+void DemoApp::DoAnimate() {
+  Animate(base::TimeTicks::Now());
+}
+
+// ui::Window
+void DemoApp::DidActive() {
+  ui::Window::DidActive();
+  if (root_layer_)
+    root_layer_->DidActive();
+  DidChangeActivation(true);
+}
+
+void DemoApp::DidChangeBounds() {
+  compositor_->NeedCommit();
+
+  auto const width = bounds().right - bounds().left;
+  auto const height = bounds().bottom - bounds().top;
+
+  auto const tab_height = 32.0f;
+  auto const splitter_height = 5.0f;
+  auto const pane_height = (height - splitter_height - tab_height) / 2;
+
+  root_layer_->SetBounds(gfx::RectF(gfx::PointF(), gfx::SizeF(width, height)));
+
+  // Resize status visual
+  if (status_layer_) {
+    const gfx::SizeF status_size(320.0f, 200.0f);
+    status_layer_->SetBounds(gfx::RectF(gfx::PointF(20, height / 2),
+                                        status_size));
+
+    // Setup transform for status visual
+    common::ComPtr<IDCompositionRotateTransform> rotate_transform;
+    COM_VERIFY(compositor_->device()->CreateRotateTransform(&rotate_transform));
+    COM_VERIFY(rotate_transform->SetCenterX(status_size.width() / 2));
+    COM_VERIFY(rotate_transform->SetCenterY(status_size.height() / 2));
+    COM_VERIFY(rotate_transform->SetAngle(-5));
+    COM_VERIFY(status_layer_->visual()->SetTransform(rotate_transform));
+  }
+
+    gfx::RectF pane_bounds[2] {
+        gfx::RectF(gfx::PointF(0, tab_height), gfx::PointF(width, pane_height)),
+        gfx::RectF(gfx::PointF(0, pane_height + splitter_height),
+                   gfx::PointF(width, height))
+    };
+  // Resize cartoon visual
+  if (cartoon_layer_)
+    cartoon_layer_->SetBounds(pane_bounds[0]);
+
+  // Update composition
+  compositor_->Commit();
+  ui::Scheduler::instance()->RequestFrame(this);
+}
+
+// Build visual tree and set composition target to this window.
+void DemoApp::DidCreate() {
+  ui::Window::DidCreate();
+
+  status_hwnd_ = ::CreateWindowEx(
+      0,
+      STATUSCLASSNAMEW,
+      nullptr,
+      WS_CHILD | WS_VISIBLE,
+      0, 0, 0, 0,
+      *this,
+      reinterpret_cast<HMENU>(this),
+      HINST_THISCOMPONENT,
+      nullptr);
+
+  // Create Direct Composition device.
+  compositor_.reset(new ui::Compositor(new gfx::DxDevice()));
+  root_layer_.reset(new RootLayer(compositor_.get()));
+  compositor_->SetTarget(*this, root_layer_.get());
+
+  // Build visual tree
+  cartoon_layer_.reset(new CartoonCard(compositor_.get()));
+  root_layer_->AppendChild(cartoon_layer_.get());
+
+  status_layer_.reset(new StatusLayer(compositor_.get()));
+  root_layer_->AppendChild(status_layer_.get());
+
+  // Setup visual tree bounds
+  DidChangeBounds();
+}
+
+void DemoApp::DidInactive() {
+  if (root_layer_)
+    root_layer_->DidInactive();
+  DidChangeActivation(false);
+}
+
+LRESULT DemoApp::OnMessage(UINT message, WPARAM wParam, LPARAM lParam) {
+  switch (message) {
+    case WM_ACTIVATE: {
+        MARGINS margins;
+        margins.cxLeftWidth = 0;
+        margins.cxRightWidth = 0;
+        margins.cyBottomHeight = 0;
+        margins.cyTopHeight = -1;
+        COM_VERIFY(::DwmExtendFrameIntoClientArea(*this, &margins));
+        break;
+    }
+    case WM_PAINT: {
+      // Fill window client area with alpha=0.
+      PAINTSTRUCT ps;
+      auto const hdc = ::BeginPaint(*this, &ps);
+      ::FillRect(hdc, &ps.rcPaint,
+                 static_cast<HBRUSH>(::GetStockObject(BLACK_BRUSH)));
+      ::EndPaint(*this, &ps);
+      return 1;
+    }
+    case WM_MOUSEWHEEL: {
+      auto const delta = GET_WHEEL_DELTA_WPARAM(wParam);
+      auto const origin = root_layer_->bounds().origin();
+      ui::Animation::Timing timing;
+      auto const num_frames = 10;
+      auto const speed = 10;
+      auto const sign = delta > 0 ? 1 : -1;
+      timing.duration = base::TimeDelta::FromMilliseconds(16 * num_frames);
+      animation_.reset(new Animation(Animation::Type::Scroll, this, timing));
+      animation_->SetValues1(origin.y(),
+                             origin.y() + sign * speed * num_frames);
+      ui::Scheduler::instance()->RequestFrame(this);
+      return 1;
+    }
+    case WM_KEYDOWN:
+      if (wParam == VK_F12) {
+        WriteFrameTiming();
+        return 0;
+      }
+      break;
+    case WM_SIZE:
+      DidChangeVisibility(wParam != SIZE_MINIMIZED);
+      break;
+    case WM_WINDOWPOSCHANGED:
+      ::SendMessage(status_hwnd_, message, wParam, lParam);
+      break;
+  }
+  return ui::Window::OnMessage(message, wParam, lParam);
+}
+
+void DemoApp::WillDestroy() {
+#if 0
+  composition_target_->SetRoot(nullptr);
+  root_layer_.reset();
+  status_layer_.reset();
+  compositor_.reset();
+#endif
+  ui::Window::WillDestroy();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// DemoApp::Animation
+//
+DemoApp::Animation::Animation(Type type,
+                              ui::Animatable* animatable,
+                              const ui::Animation::Timing& timing)
+    : animation_(new ui::Animation(animatable, timing)), type_(type) {
+}
+
+DemoApp::Animation::~Animation() {
+}
+
+void DemoApp::Animation::Play(base::TimeTicks current_time) {
+  animation_->Play(current_time);
+}
+
+double DemoApp::Animation::value1() const {
+  return animation_->GetDouble(variable1_.get());
+}
+
+void DemoApp::Animation::SetValues1(double start, double end) {
+  DCHECK(!variable1_);
+  variable1_.reset(animation_->CreateVariable(start, end));
+}
+
+}  // namespace my
+
+namespace {
+const GUID DXGI_DEBUG_ALL = {
+  0xe48ae283, 0xda80, 0x490b, 0x87, 0xe6, 0x43, 0xe9, 0xa9, 0xcf, 0xda, 0x8
+};
+
+const GUID DXGI_DEBUG_DXGI = {
+  0x25cddaa4, 0xb1c6, 0x47e1, 0xac, 0x3e, 0x98, 0x87, 0x5b, 0x5a, 0x2e, 0x2a
+};
+
+void ReportLiveObjects() {
+  auto const dll = ::GetModuleHandleW(L"dxgidebug.dll");
+  if (!dll)
+    return;
+  typedef HRESULT (WINAPI  *DXGIGetDebugInterface)(REFIID riid, void **ppDebug);
+  DXGIGetDebugInterface func = reinterpret_cast<DXGIGetDebugInterface>(
+      ::GetProcAddress(dll, "DXGIGetDebugInterface"));
+  if (!func)
+    return;
+  common::ComPtr<IDXGIDebug> repoter;
+  COM_VERIFY(func(__uuidof(IDXGIDebug), repoter.location()));
+  repoter->ReportLiveObjects(DXGI_DEBUG_DXGI, DXGI_DEBUG_RLO_ALL);
+}
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////
+//
+// WinMain
+//
+int WinMain(HINSTANCE, HINSTANCE, LPSTR command_line, int) {
+  std::vector<common::SingletonBase*> singletons;
+  common::all_singletons = &singletons;
+  // "dtest --trace" writes trace events to dtest_trace.json at exit, for
+  // chrome://tracing or Perfetto.
+  auto const tracing = ::strstr(command_line, "--trace") != nullptr;
+  base::TraceLog::instance()->SetEnabled(tracing);
+  // "dtest --zero-alloc" fails if steady state frames allocate, and writes
+  // stacks of allocations to dtest_allocations.txt. Without hooks, nothing
+  // is counted, so it fails at once.
+  auto const zero_allocation = ::strstr(command_line, "--zero-alloc") !=
+                               nullptr;
+  if (zero_allocation && !base::AllocationTracker::enabled()) {
+    std::ofstream stream("dtest_allocations.txt");
+    stream << "--zero-alloc needs a build with /DDTEST_ZERO_ALLOC" <<
+        std::endl;
+    return 1;
+  }
+  ui::Scheduler::instance()->set_disallow_frame_allocation(zero_allocation);
+  //::AllocConsole();
+  common::ComInitializer com_initializer;
+  {
+    // Layers of |application| remove themselves from |ui::Scheduler| on
+    // destruction, so |application| must be destroyed before singletons.
+    my::DemoApp application;
+    //ui::Scheduler::instance()->Run(ui::Scheduler::Method::NoWait);
+    //ui::Scheduler::instance()->Run(ui::Scheduler::Method::Timer);
+    //ui::Scheduler::instance()->Run(ui::Scheduler::Method::Waitable);
+    ui::Scheduler::instance()->Run(ui::Scheduler::Method::Vsync);
+  }
+  if (tracing) {
+    base::TraceLog::instance()->SetEnabled(false);
+    std::ofstream stream("dtest_trace.json");
+    base::TraceLog::instance()->WriteJson(&stream);
+  }
+  my::WriteFrameTiming();
+  auto const num_disallowed =
+      base::AllocationTracker::instance()->num_disallowed_allocations();
+  if (zero_allocation) {
+    std::ofstream stream("dtest_allocations.txt");
+    base::AllocationTracker::instance()->WriteSites(&stream, 20);
+  }
+  for (auto const singleton : singletons) {
+    delete singleton;
+  }
+  ReportLiveObjects();
+  return num_disallowed ? 1 : 0;
+}
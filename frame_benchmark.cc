@@ -0,0 +1,586 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Runs frames of scenes like DemoApp without window, with any number of
+// CartoonCards, balls per card and StatusLayers, and reports how many
+// frames per second the machine sustains, 50th and 99th percentile of frame
+// time and peak RSS.
+//
+// A card steps its balls on |physics::World|, draws them with
+// |gfx::SoftwareCanvas| and presents its whole swap chain. A status layer
+// updates its samples at 10 Hz and presents changed regions. Both build
+// their HUD text in |common::FrameArena|, but don't lay it out. Frames run
+// back to back on a virtual clock advancing 1/60 second a frame, so every
+// run simulates the same steps, and fps is frames over time taken by them.
+//
+// --sweep=cards or --sweep=balls finds the largest scene whose 99th
+// percentile of frame time is in --budget_ms, by doubling the number of
+// cards or balls per card until a scene misses the budget, then bisecting.
+//
+// Results are also written by --benchmark_out in the JSON format of
+// |base::BenchmarkRunner|, with percentiles and RSS as counters.
+//
+// Returns EXIT_FAILURE if two runs of a scene paint different pixels, or
+// a card paints no ball.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. frame_benchmark.cc psapi.lib
+//  g++ -std=c++11 -O2 -pthread -I. frame_benchmark.cc -o frame_benchmark
+//
+// Usage: frame_benchmark [--cards=1] [--balls=5] [--status=1] [--frames=600]
+//                        [--budget_ms=16.67] [--sweep=cards|balls]
+//                        [--benchmark_out=file] [--benchmark_repetitions=n]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#undef max
+#undef min
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/metrics/sampling.h"
+#include "base/strings/csv.h"
+#include "base/test/benchmark.h"
+#include "base/test/random.h"
+#include "base/threading/thread_pool.h"
+#include "common/memory/frame_arena.h"
+#include "gfx/blend.h"
+#include "gfx/present_params.h"
+#include "gfx/sprite.h"
+#include "gfx/software_canvas.h"
+#include "gfx/software_swap_chain.h"
+#include "physics/fixed_timestep.h"
+#include "physics/particle_store.h"
+#include "physics/uniform_grid.h"
+#include "physics/world.h"
+
+namespace {
+
+// Size of CartoonCard content and StatusLayer in DemoApp.
+const int kCardHeight = 380;
+const int kCardWidth = 640;
+const int kStatusHeight = 200;
+const int kStatusWidth = 320;
+
+const int kFrameIntervalUs = 16667;
+const int kMaxSweepValue = 1 << 20;
+const int kNumSamples = 100;
+// Frames before measuring, for caches of sprite images and the arena.
+const int kNumWarmUpFrames = 30;
+const int kSpriteSize = 64;
+// StatusLayer is ticked at 10 Hz.
+const int kStatusInterval = 6;
+
+const uint32_t kBlue = gfx::PremultipliedColor(0, 0, 1, 0.5f);
+const uint32_t kGreen = gfx::PremultipliedColor(0, 0.5f, 0, 0.7f);
+const uint32_t kRed = gfx::PremultipliedColor(1, 0, 0, 0.5f);
+const uint32_t kWhite = gfx::PremultipliedColor(1, 1, 1, 1);
+
+// Keeps the compiler from removing work.
+std::atomic<uint64_t> sink;
+
+// Draws samples as bars, instead of lines |my::Sampling::Paint()| draws,
+// since |gfx::SoftwareCanvas| has no lines.
+void PaintGraph(gfx::SoftwareCanvas* canvas, const base::Sampling& samples,
+                const gfx::IntRect& rect, uint32_t color) {
+  auto const minimum = samples.minimum();
+  auto const span = samples.maximum() == minimum ? 1.0f :
+      samples.maximum() - minimum;
+  auto const scale = (rect.bottom - rect.top) / span;
+  auto const step = static_cast<float>(rect.right - rect.left) /
+                    samples.capacity();
+  for (auto index = 0u; index < samples.size(); ++index) {
+    auto const left = rect.left + step * index;
+    canvas->FillRectangle(left, rect.bottom - (samples[index] - minimum) *
+                          scale, left + step, static_cast<float>(rect.bottom),
+                          color);
+  }
+}
+
+// Peak resident set size of this process in bytes, since |ResetPeakRss()|
+// where the system can reset it.
+uint64_t PeakRss() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters = {0};
+  counters.cb = sizeof(counters);
+  ::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize;
+#else
+  unsigned long long peak_kb = 0;
+  if (auto const file = ::fopen("/proc/self/status", "r")) {
+    char line[256];
+    while (::fgets(line, sizeof(line), file)) {
+      if (::sscanf(line, "VmHWM: %llu kB", &peak_kb) == 1)
+        break;
+    }
+    ::fclose(file);
+  }
+  return static_cast<uint64_t>(peak_kb) * 1024;
+#endif
+}
+
+void ResetPeakRss() {
+#if defined(__linux__)
+  // Since Linux 4.0, writing 5 resets peak RSS to current RSS.
+  if (auto const file = ::fopen("/proc/self/clear_refs", "w")) {
+    ::fputs("5", file);
+    ::fclose(file);
+  }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// CartoonCard
+// Balls of CartoonCard on a card of the same size, with a graph of ticks.
+//
+class CartoonCard final {
+  // We simulate 128ms at most in a frame, as CartoonCard does.
+  private: static const int kMaxStepsPerFrame = 8;
+
+  private: std::vector<float> ball_angles_;
+  private: std::vector<gfx::SpriteInstance> ball_instances_;
+  private: gfx::SoftwareSprite* ball_sprite_;
+  private: std::vector<float> ball_xs_;
+  private: std::vector<float> ball_ys_;
+  private: physics::World balls_;
+  private: base::TimeTicks last_frame_time_;
+  private: gfx::SoftwareSwapChain swap_chain_;
+  // |canvas_| draws into back buffer of |swap_chain_|, so it follows.
+  private: gfx::SoftwareCanvas canvas_;
+  private: base::Sampling tick_sample_;
+  private: physics::FixedTimestep timestep_;
+
+  public: CartoonCard(int num_balls, gfx::SoftwareSprite* ball_sprite,
+                      base::TimeTicks start_time);
+  public: ~CartoonCard() = default;
+
+  public: const gfx::SoftwareBitmap& front_buffer() const {
+    return swap_chain_.front_buffer();
+  }
+
+  public: void DoFrame(base::TimeTicks frame_time);
+
+  DISALLOW_COPY_AND_ASSIGN(CartoonCard);
+};
+
+CartoonCard::CartoonCard(int num_balls, gfx::SoftwareSprite* ball_sprite,
+                         base::TimeTicks start_time)
+    : ball_angles_(num_balls), ball_instances_(num_balls),
+      ball_sprite_(ball_sprite), ball_xs_(num_balls), ball_ys_(num_balls),
+      last_frame_time_(start_time), swap_chain_(kCardWidth, kCardHeight),
+      canvas_(swap_chain_.back_buffer()), tick_sample_(kNumSamples),
+      timestep_(base::TimeDelta::FromMilliseconds(16), kMaxStepsPerFrame) {
+  timestep_.Reset(start_time);
+  uint32_t seed = 1;
+  for (auto index = 0; index < num_balls; ++index) {
+    auto const radius = base::RandomFloat(&seed, 10, 20);
+    auto const x = base::RandomFloat(&seed, radius, kCardWidth - radius);
+    auto const y = base::RandomFloat(&seed, radius, kCardHeight - radius);
+    auto const vx = base::RandomFloat(&seed, -2, 2);
+    auto const vy = base::RandomFloat(&seed, -2, 2);
+    balls_.mutable_particles()->Add(x, y, vx, vy, radius,
+                                    base::RandomFloat(&seed, 0, 360));
+  }
+}
+
+void CartoonCard::DoFrame(base::TimeTicks frame_time) {
+  tick_sample_.AddSample(static_cast<float>(
+      (frame_time - last_frame_time_).InMillisecondsF()));
+  last_frame_time_ = frame_time;
+  physics::Bounds bounds = {0.0f, 0.0f, kCardWidth, kCardHeight};
+  balls_.Step(bounds, timestep_.Advance(frame_time));
+
+  auto const& balls = balls_.particles();
+  balls.Interpolate(std::min(timestep_.alpha(), 1.0f), ball_xs_.data(),
+                    ball_ys_.data(), ball_angles_.data());
+  for (auto index = 0u; index < balls.size(); ++index) {
+    auto& instance = ball_instances_[index];
+    instance.center_x = ball_xs_[index];
+    instance.center_y = ball_ys_[index];
+    instance.size = balls.radii()[index];
+    instance.angle = ball_angles_[index];
+    instance.color = 0xFFFFFFFF;
+  }
+  canvas_.Clear(kWhite);
+  canvas_.DrawSprites(ball_sprite_, ball_instances_.data(),
+                      ball_instances_.size());
+  gfx::IntRect graph_rect = {0, kCardHeight - 20, kCardWidth, kCardHeight};
+  PaintGraph(&canvas_, tick_sample_, graph_rect, kRed);
+
+  common::FrameStringBuilder text;
+  text << L"(Red) TickCount=" << tick_sample_.minimum() << L" " <<
+      tick_sample_.maximum() << L" " << tick_sample_.last() << L"\n";
+  text << L"Balls=" << balls.size() << L"\n";
+  sink += text.size();
+
+  swap_chain_.Present();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// StatusLayer
+// Graphs and numbers of ticks and frame times, as StatusLayer shows.
+//
+class StatusLayer final {
+  private: base::TimeTicks last_frame_time_;
+  private: base::Sampling sample_frame_;
+  private: base::Sampling sample_tick_;
+  private: gfx::SoftwareSwapChain swap_chain_;
+  // |canvas_| draws into back buffer of |swap_chain_|, so it follows.
+  private: gfx::SoftwareCanvas canvas_;
+
+  public: explicit StatusLayer(base::TimeTicks start_time);
+  public: ~StatusLayer() = default;
+
+  // |frame_ms| is time taken by the last frame.
+  public: void Update(base::TimeTicks frame_time, double frame_ms);
+
+  DISALLOW_COPY_AND_ASSIGN(StatusLayer);
+};
+
+StatusLayer::StatusLayer(base::TimeTicks start_time)
+    : last_frame_time_(start_time), sample_frame_(kNumSamples),
+      sample_tick_(kNumSamples), swap_chain_(kStatusWidth, kStatusHeight),
+      canvas_(swap_chain_.back_buffer()) {
+}
+
+void StatusLayer::Update(base::TimeTicks frame_time, double frame_ms) {
+  sample_tick_.AddSample(static_cast<float>(
+      (frame_time - last_frame_time_).InMillisecondsF()));
+  last_frame_time_ = frame_time;
+  sample_frame_.AddSample(static_cast<float>(frame_ms));
+
+  gfx::IntRect graph_rect = {4, kStatusHeight - 84, kStatusWidth - 4,
+                             kStatusHeight - 4};
+  gfx::IntRect text_rect = {5, 5, kStatusWidth - 5, graph_rect.top - 4};
+  // Only numbers and graph are changed in every frame, so we repaint
+  // background and present whole back buffer only after resizing.
+  gfx::PresentParams present_params;
+  if (swap_chain_.needs_full_present()) {
+    canvas_.Clear(kWhite);
+  } else {
+    canvas_.FillRectangle(text_rect.left, text_rect.top, text_rect.right,
+                          text_rect.bottom, kWhite);
+    present_params.AddDirtyRect(text_rect);
+    present_params.AddDirtyRect(graph_rect);
+  }
+  canvas_.FillRectangle(graph_rect.left, graph_rect.top, graph_rect.right,
+                        graph_rect.bottom, kWhite);
+  PaintGraph(&canvas_, sample_tick_, graph_rect, kGreen);
+  PaintGraph(&canvas_, sample_frame_, graph_rect, kBlue);
+
+  common::FrameStringBuilder text;
+  text << L"(Green) Tick=" << sample_tick_.minimum() << L" " <<
+      sample_tick_.maximum() << L" " << sample_tick_.last() << L"\n";
+  text << L"(Blue) FrameTime=" << sample_frame_.minimum() << L" " <<
+      sample_frame_.maximum() << L" " << sample_frame_.last() << L"\n";
+  auto const arena = common::FrameArena::ForCurrentThread();
+  text << L"arena=" << arena->last_high_water() << L"/" <<
+      arena->peak_high_water() << L" bytes\n";
+  sink += text.size();
+
+  swap_chain_.Present(present_params);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SceneSize
+//
+struct SceneSize {
+  int num_balls;
+  int num_cards;
+  int num_status_layers;
+};
+
+std::string NameOf(const SceneSize& size) {
+  std::ostringstream name;
+  name << "cards:" << size.num_cards << "/balls:" << size.num_balls <<
+      "/status:" << size.num_status_layers;
+  return name.str();
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Scene
+//
+class Scene final {
+  private: gfx::SoftwareSprite ball_sprite_;
+  private: std::vector<std::unique_ptr<CartoonCard>> cards_;
+  // Origin of virtual clock.
+  private: base::TimeTicks start_time_;
+  private: std::vector<std::unique_ptr<StatusLayer>> status_layers_;
+
+  public: explicit Scene(const SceneSize& size);
+  public: ~Scene() = default;
+
+  public: const CartoonCard& card(size_t index) const {
+    return *cards_[index];
+  }
+
+  // |last_frame_ms| is time taken by the previous frame.
+  public: void DoFrame(int frame_number, double last_frame_ms);
+
+  DISALLOW_COPY_AND_ASSIGN(Scene);
+};
+
+Scene::Scene(const SceneSize& size)
+    : ball_sprite_(kSpriteSize, kSpriteSize),
+      start_time_(base::TimeTicks::Now()) {
+  {
+    gfx::SoftwareCanvas canvas(ball_sprite_.bitmap());
+    auto const radius = kSpriteSize / 2.0f;
+    canvas.Clear(0);
+    canvas.FillEllipse(radius, radius, radius, kBlue);
+    auto const rect_size = radius * 0.5f;
+    canvas.FillRectangle(radius - rect_size, radius - rect_size,
+                         radius + rect_size, radius + rect_size, kGreen);
+    ball_sprite_.DidChangeBitmap();
+  }
+  for (auto count = 0; count < size.num_cards; ++count) {
+    cards_.push_back(std::unique_ptr<CartoonCard>(
+        new CartoonCard(size.num_balls, &ball_sprite_, start_time_)));
+  }
+  for (auto count = 0; count < size.num_status_layers; ++count) {
+    status_layers_.push_back(std::unique_ptr<StatusLayer>(
+        new StatusLayer(start_time_)));
+  }
+}
+
+void Scene::DoFrame(int frame_number, double last_frame_ms) {
+  auto const frame_time = start_time_ + base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(frame_number + 1) * kFrameIntervalUs);
+  for (auto const& card : cards_)
+    card->DoFrame(frame_time);
+  if (frame_number % kStatusInterval == 0) {
+    for (auto const& status_layer : status_layers_)
+      status_layer->Update(frame_time, last_frame_ms);
+  }
+  common::FrameArena::ForCurrentThread()->Reset();
+}
+
+// Returns time per frame, frames per second, percentiles of frame time and
+// peak RSS of |size| in |result|.
+void RunScene(const SceneSize& size, int num_frames,
+              base::BenchmarkResult* result) {
+  ResetPeakRss();
+  Scene scene(size);
+  auto last_frame_ms = 0.0;
+  for (auto frame = 0; frame < kNumWarmUpFrames; ++frame)
+    scene.DoFrame(frame, last_frame_ms);
+
+  std::vector<double> frame_times(num_frames);
+  base::BenchmarkState state(0, num_frames);
+  auto frame = 0;
+  while (state.KeepRunning()) {
+    auto const start = base::TimeTicks::Now();
+    scene.DoFrame(kNumWarmUpFrames + frame, last_frame_ms);
+    last_frame_ms = (base::TimeTicks::Now() - start).InMillisecondsF();
+    frame_times[frame] = last_frame_ms;
+    ++frame;
+  }
+  std::sort(frame_times.begin(), frame_times.end());
+  // Nearest rank
+  auto const percentile = [&](int percent) {
+    auto const rank = (frame_times.size() * percent + 99) / 100;
+    return frame_times[std::max(rank, static_cast<size_t>(1)) - 1];
+  };
+  result->aggregate.clear();
+  result->counters.clear();
+  result->counters.push_back(std::make_pair("p50_frame_ms", percentile(50)));
+  result->counters.push_back(std::make_pair("p99_frame_ms", percentile(99)));
+  result->counters.push_back(std::make_pair(
+      "peak_rss_bytes", static_cast<double>(PeakRss())));
+  result->cpu_time = state.cpu_time() * 1e9 / num_frames;
+  result->items_per_second = num_frames / state.real_time();
+  result->iterations = num_frames;
+  result->name = "BM_Frame/" + NameOf(size);
+  result->real_time = state.real_time() * 1e9 / num_frames;
+}
+
+// Runs |size| for each repetition, and returns true if median of 99th
+// percentiles of frame time is in |budget_ms|.
+bool MeasureScene(base::BenchmarkRunner* runner, const SceneSize& size,
+                  int num_frames, double budget_ms) {
+  std::vector<base::BenchmarkResult> repetitions(runner->repetitions());
+  std::vector<double> p99s;
+  for (auto repetition = 0; repetition < runner->repetitions();
+       ++repetition) {
+    auto& result = repetitions[repetition];
+    RunScene(size, num_frames, &result);
+    result.repetition = repetition;
+    p99s.push_back(result.counters[1].second);
+  }
+  runner->AddResults(repetitions);
+  std::sort(p99s.begin(), p99s.end());
+  auto const meets_budget = p99s[p99s.size() / 2] <= budget_ms;
+  if (runner->format() != "console")
+    return meets_budget;
+  for (auto const& result : repetitions) {
+    printf("%-32s %8lld %10.1f %9.3f %9.3f %12.0f %7s\n",
+           NameOf(size).c_str(), static_cast<long long>(result.iterations),
+           result.items_per_second, result.counters[0].second,
+           result.counters[1].second, result.counters[2].second / 1024,
+           result.counters[1].second <= budget_ms ? "yes" : "no");
+  }
+  return meets_budget;
+}
+
+// Returns the largest value of |dimension| of |size| which meets
+// |budget_ms|, or zero if no value does. The last value is within 5% of the
+// first missing value.
+int Sweep(base::BenchmarkRunner* runner, SceneSize size,
+          int SceneSize::*dimension, int num_frames, double budget_ms) {
+  auto passed = 0;
+  auto missed = 0;
+  auto value = std::max(size.*dimension, 1);
+  for (;;) {
+    size.*dimension = value;
+    if (MeasureScene(runner, size, num_frames, budget_ms))
+      passed = value;
+    else
+      missed = value;
+    if (!missed) {
+      if (value >= kMaxSweepValue)
+        return passed;
+      value *= 2;
+      continue;
+    }
+    if (missed - passed <= std::max(1, missed / 20))
+      return passed;
+    value = (passed + missed) / 2;
+  }
+}
+
+// Checks that two runs of a scene paint same pixels on the virtual clock,
+// and balls are painted.
+bool VerifyScene() {
+  SceneSize size = {20, 1, 1};
+  Scene scene1(size);
+  Scene scene2(size);
+  for (auto frame = 0; frame < 60; ++frame) {
+    scene1.DoFrame(frame, 1.0);
+    scene2.DoFrame(frame, 1.0);
+  }
+  auto const& bitmap1 = scene1.card(0).front_buffer();
+  auto const& bitmap2 = scene2.card(0).front_buffer();
+  auto const num_pixels = bitmap1.width() * bitmap1.height();
+  auto const num_ball_pixels = std::count_if(
+      bitmap1.pixels(), bitmap1.pixels() + num_pixels,
+      [](uint32_t pixel) { return pixel != kWhite; });
+  return std::equal(bitmap1.pixels(), bitmap1.pixels() + num_pixels,
+                    bitmap2.pixels()) &&
+         num_ball_pixels > 0;
+}
+
+bool ParseInt(const std::string& value, int* result) {
+  char* end;
+  auto const number = ::strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end || number < 0 || number > kMaxSweepValue)
+    return false;
+  *result = static_cast<int>(number);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  SceneSize size = {5, 1, 1};
+  auto budget_ms = 1000.0 / 60;
+  auto num_frames = 600;
+  std::string sweep;
+  // Flags of |base::BenchmarkRunner|.
+  std::vector<char*> runner_argv(1, argv[0]);
+  for (auto index = 1; index < argc; ++index) {
+    std::string arg(argv[index]);
+    auto const equal = arg.find('=');
+    auto const name = arg.substr(0, equal);
+    auto const value = equal == std::string::npos ? std::string() :
+        arg.substr(equal + 1);
+    auto valid = true;
+    if (name.find("--benchmark_") == 0) {
+      runner_argv.push_back(argv[index]);
+    } else if (name == "--balls") {
+      valid = ParseInt(value, &size.num_balls);
+    } else if (name == "--budget_ms") {
+      budget_ms = ::atof(value.c_str());
+      valid = budget_ms > 0;
+    } else if (name == "--cards") {
+      valid = ParseInt(value, &size.num_cards);
+    } else if (name == "--frames") {
+      valid = ParseInt(value, &num_frames) && num_frames > 0;
+    } else if (name == "--status") {
+      valid = ParseInt(value, &size.num_status_layers);
+    } else if (name == "--sweep") {
+      sweep = value;
+      valid = sweep == "balls" || sweep == "cards";
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      std::cerr << "Unknown or invalid flag: " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  base::BenchmarkRunner runner;
+  if (!runner.Init(static_cast<int>(runner_argv.size()), runner_argv.data()))
+    return EXIT_FAILURE;
+
+  auto failed = false;
+  if (!VerifyScene()) {
+    printf("FAILED: scenes paint different pixels\n");
+    failed = true;
+  }
+  if (runner.format() == "console") {
+    std::cout << num_frames << " frames, budget " << budget_ms << " ms" <<
+        std::endl;
+    printf("%-32s %8s %10s %9s %9s %12s %7s\n", "scene", "frames", "fps",
+           "p50 ms", "p99 ms", "peak RSS KB", "budget");
+  }
+  if (sweep.empty()) {
+    MeasureScene(&runner, size, num_frames, budget_ms);
+  } else {
+    auto const dimension = sweep == "cards" ? &SceneSize::num_cards :
+        &SceneSize::num_balls;
+    auto const largest = Sweep(&runner, size, dimension, num_frames,
+                               budget_ms);
+    size.*dimension = largest;
+    if (runner.format() == "console") {
+      std::cout << "Largest scene in budget: " <<
+          (largest ? NameOf(size) : "none") << std::endl;
+    }
+  }
+  if (runner.Report() != EXIT_SUCCESS)
+    failed = true;
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,519 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_blend_h)
+#define INCLUDE_gfx_blend_h
+
+// Functions compiled for an instruction set which isn't enabled for whole
+// translation unit. MSVC allows intrinsics without target option.
+#if defined(_MSC_VER)
+#define GFX_TARGET(isa)
+#else
+#define GFX_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace gfx {
+namespace blend {
+
+// Pixels are DXGI_FORMAT_B8G8R8A8_UNORM with DXGI_ALPHA_MODE_PREMULTIPLIED,
+// which is |uint32_t| 0xAARRGGBB on little endian. All kernels compute
+// channel * alpha / 255 with rounding, then results of SIMD kernels are
+// identical to scalar kernels.
+
+//////////////////////////////////////////////////////////////////////
+//
+// Isa
+//
+enum class Isa {
+  Scalar,
+  SSE2,
+  AVX2,
+  AVX512,
+};
+
+const char* IsaName(Isa isa);
+bool IsIsaSupported(Isa isa);
+Isa SupportedIsa();
+
+//////////////////////////////////////////////////////////////////////
+//
+// Kernels
+//
+struct Kernels {
+  Isa isa;
+  // dst = src
+  void (*src_copy)(uint32_t* dst, const uint32_t* src, size_t count);
+  // dst = src + dst * (1 - src.alpha)
+  void (*src_over)(uint32_t* dst, const uint32_t* src, size_t count);
+  // dst = src * opacity + dst * (1 - src.alpha * opacity), opacity in 0..255
+  void (*src_over_opacity)(uint32_t* dst, const uint32_t* src, size_t count,
+                           uint32_t opacity);
+};
+
+// Returns kernels for |isa|. |isa| must be supported by CPU.
+const Kernels& KernelsFor(Isa isa);
+
+// Returns kernels for the best instruction set supported by CPU.
+const Kernels& kernels();
+
+void SrcCopy(uint32_t* dst, const uint32_t* src, size_t count);
+void SrcOver(uint32_t* dst, const uint32_t* src, size_t count);
+void SrcOver(uint32_t* dst, const uint32_t* src, size_t count, float opacity);
+
+// Composes |width| x |height| pixels of |src| into |dst|. Strides are in
+// bytes.
+void CompositeRect(uint8_t* dst, size_t dst_stride,
+                   const uint8_t* src, size_t src_stride,
+                   size_t width, size_t height, float opacity);
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+//
+// Scalar kernels
+//
+// Returns |pixel| * |scale| / 255 for each channel, where x / 255 is
+// computed by (x + 128 + ((x + 128) >> 8)) >> 8.
+inline uint32_t ScalePixel(uint32_t pixel, uint32_t scale) {
+  auto rb = (pixel & 0x00FF00FF) * scale + 0x00800080;
+  rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+  auto ag = ((pixel >> 8) & 0x00FF00FF) * scale + 0x00800080;
+  ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+  return rb | ag;
+}
+
+// Returns per channel saturated sum as |_mm_adds_epu8()|.
+inline uint32_t AddPixel(uint32_t pixel1, uint32_t pixel2) {
+  auto result = 0u;
+  for (auto shift = 0; shift < 32; shift += 8) {
+    auto const sum = ((pixel1 >> shift) & 0xFF) + ((pixel2 >> shift) & 0xFF);
+    result |= std::min(sum, 255u) << shift;
+  }
+  return result;
+}
+
+inline uint32_t SrcOverPixel(uint32_t dst, uint32_t src) {
+  auto const alpha = src >> 24;
+  if (alpha == 255)
+    return src;
+  if (!src)
+    return dst;
+  return AddPixel(src, ScalePixel(dst, 255 - alpha));
+}
+
+void SrcCopyScalar(uint32_t* dst, const uint32_t* src, size_t count) {
+  for (auto const end = dst + count; dst < end; ++dst) {
+    *dst = *src;
+    ++src;
+  }
+}
+
+void SrcOverScalar(uint32_t* dst, const uint32_t* src, size_t count) {
+  for (auto const end = dst + count; dst < end; ++dst) {
+    *dst = SrcOverPixel(*dst, *src);
+    ++src;
+  }
+}
+
+void SrcOverOpacityScalar(uint32_t* dst, const uint32_t* src, size_t count,
+                          uint32_t opacity) {
+  for (auto const end = dst + count; dst < end; ++dst) {
+    if (*src)
+      *dst = SrcOverPixel(*dst, ScalePixel(*src, opacity));
+    ++src;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SSE2 kernels
+//
+// Returns |dst| * (255 - |alpha|) / 255 for 8 16-bit channels.
+GFX_TARGET("sse2")
+inline __m128i ScaleByInverseAlpha128(__m128i dst, __m128i src) {
+  auto const alpha = _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  auto const scale = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+  auto const product = _mm_add_epi16(_mm_mullo_epi16(dst, scale),
+                                     _mm_set1_epi16(128));
+  return _mm_mulhi_epu16(product, _mm_set1_epi16(257));
+}
+
+GFX_TARGET("sse2")
+inline __m128i ScaleByOpacity128(__m128i src, __m128i opacity) {
+  auto const product = _mm_add_epi16(_mm_mullo_epi16(src, opacity),
+                                     _mm_set1_epi16(128));
+  return _mm_mulhi_epu16(product, _mm_set1_epi16(257));
+}
+
+GFX_TARGET("sse2")
+inline __m128i SrcOver128(__m128i dst, __m128i src) {
+  auto const zero = _mm_setzero_si128();
+  auto const lo = ScaleByInverseAlpha128(_mm_unpacklo_epi8(dst, zero),
+                                         _mm_unpacklo_epi8(src, zero));
+  auto const hi = ScaleByInverseAlpha128(_mm_unpackhi_epi8(dst, zero),
+                                         _mm_unpackhi_epi8(src, zero));
+  return _mm_adds_epu8(src, _mm_packus_epi16(lo, hi));
+}
+
+GFX_TARGET("sse2")
+void SrcCopySSE2(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const end = dst + (count & ~static_cast<size_t>(3));
+  for (; dst < end; dst += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    src += 4;
+  }
+  SrcCopyScalar(dst, src, count & 3);
+}
+
+GFX_TARGET("sse2")
+void SrcOverSSE2(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const alpha_mask = _mm_set1_epi32(0xFF000000);
+  auto const zero = _mm_setzero_si128();
+  auto const end = dst + (count & ~static_cast<size_t>(3));
+  for (; dst < end; dst += 4) {
+    auto const source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    src += 4;
+    auto const alpha = _mm_and_si128(source, alpha_mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xFFFF) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), source);
+      continue;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(source, zero)) == 0xFFFF)
+      continue;
+    auto const dest = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), SrcOver128(dest, source));
+  }
+  SrcOverScalar(dst, src, count & 3);
+}
+
+GFX_TARGET("sse2")
+void SrcOverOpacitySSE2(uint32_t* dst, const uint32_t* src, size_t count,
+                        uint32_t opacity) {
+  auto const scale = _mm_set1_epi16(static_cast<int16_t>(opacity));
+  auto const zero = _mm_setzero_si128();
+  auto const end = dst + (count & ~static_cast<size_t>(3));
+  for (; dst < end; dst += 4) {
+    auto const source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    src += 4;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(source, zero)) == 0xFFFF)
+      continue;
+    auto const scaled = _mm_packus_epi16(
+        ScaleByOpacity128(_mm_unpacklo_epi8(source, zero), scale),
+        ScaleByOpacity128(_mm_unpackhi_epi8(source, zero), scale));
+    auto const dest = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), SrcOver128(dest, scaled));
+  }
+  SrcOverOpacityScalar(dst, src, count & 3, opacity);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// AVX2 kernels
+//
+GFX_TARGET("avx2")
+inline __m256i ScaleByInverseAlpha256(__m256i dst, __m256i src) {
+  auto const alpha = _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  auto const scale = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+  auto const product = _mm256_add_epi16(_mm256_mullo_epi16(dst, scale),
+                                        _mm256_set1_epi16(128));
+  return _mm256_mulhi_epu16(product, _mm256_set1_epi16(257));
+}
+
+GFX_TARGET("avx2")
+inline __m256i ScaleByOpacity256(__m256i src, __m256i opacity) {
+  auto const product = _mm256_add_epi16(_mm256_mullo_epi16(src, opacity),
+                                        _mm256_set1_epi16(128));
+  return _mm256_mulhi_epu16(product, _mm256_set1_epi16(257));
+}
+
+// Note: unpack and pack operate in each 128-bit lane, so pixel order is
+// preserved.
+GFX_TARGET("avx2")
+inline __m256i SrcOver256(__m256i dst, __m256i src) {
+  auto const zero = _mm256_setzero_si256();
+  auto const lo = ScaleByInverseAlpha256(_mm256_unpacklo_epi8(dst, zero),
+                                         _mm256_unpacklo_epi8(src, zero));
+  auto const hi = ScaleByInverseAlpha256(_mm256_unpackhi_epi8(dst, zero),
+                                         _mm256_unpackhi_epi8(src, zero));
+  return _mm256_adds_epu8(src, _mm256_packus_epi16(lo, hi));
+}
+
+GFX_TARGET("avx2")
+void SrcCopyAVX2(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const end = dst + (count & ~static_cast<size_t>(7));
+  for (; dst < end; dst += 8) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+    src += 8;
+  }
+  SrcCopySSE2(dst, src, count & 7);
+}
+
+GFX_TARGET("avx2")
+void SrcOverAVX2(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const alpha_mask = _mm256_set1_epi32(0xFF000000);
+  auto const end = dst + (count & ~static_cast<size_t>(7));
+  for (; dst < end; dst += 8) {
+    auto const source =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    src += 8;
+    auto const alpha = _mm256_and_si256(source, alpha_mask);
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alpha_mask)) == -1) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), source);
+      continue;
+    }
+    if (_mm256_testz_si256(source, source))
+      continue;
+    auto const dest = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                        SrcOver256(dest, source));
+  }
+  SrcOverSSE2(dst, src, count & 7);
+}
+
+GFX_TARGET("avx2")
+void SrcOverOpacityAVX2(uint32_t* dst, const uint32_t* src, size_t count,
+                        uint32_t opacity) {
+  auto const scale = _mm256_set1_epi16(static_cast<int16_t>(opacity));
+  auto const zero = _mm256_setzero_si256();
+  auto const end = dst + (count & ~static_cast<size_t>(7));
+  for (; dst < end; dst += 8) {
+    auto const source =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    src += 8;
+    if (_mm256_testz_si256(source, source))
+      continue;
+    auto const scaled = _mm256_packus_epi16(
+        ScaleByOpacity256(_mm256_unpacklo_epi8(source, zero), scale),
+        ScaleByOpacity256(_mm256_unpackhi_epi8(source, zero), scale));
+    auto const dest = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dst));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                        SrcOver256(dest, scaled));
+  }
+  SrcOverOpacitySSE2(dst, src, count & 7, opacity);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// AVX-512 kernels
+// These kernels require AVX512BW for 8-bit and 16-bit operations. Tail
+// pixels are processed with masked load and store.
+//
+GFX_TARGET("avx512f,avx512bw")
+inline __m512i ScaleByInverseAlpha512(__m512i dst, __m512i src) {
+  auto const alpha = _mm512_shufflehi_epi16(
+      _mm512_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  auto const scale = _mm512_sub_epi16(_mm512_set1_epi16(255), alpha);
+  auto const product = _mm512_add_epi16(_mm512_mullo_epi16(dst, scale),
+                                        _mm512_set1_epi16(128));
+  return _mm512_mulhi_epu16(product, _mm512_set1_epi16(257));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+inline __m512i ScaleByOpacity512(__m512i src, __m512i opacity) {
+  auto const product = _mm512_add_epi16(_mm512_mullo_epi16(src, opacity),
+                                        _mm512_set1_epi16(128));
+  return _mm512_mulhi_epu16(product, _mm512_set1_epi16(257));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+inline __m512i SrcOver512(__m512i dst, __m512i src) {
+  auto const zero = _mm512_setzero_si512();
+  auto const lo = ScaleByInverseAlpha512(_mm512_unpacklo_epi8(dst, zero),
+                                         _mm512_unpacklo_epi8(src, zero));
+  auto const hi = ScaleByInverseAlpha512(_mm512_unpackhi_epi8(dst, zero),
+                                         _mm512_unpackhi_epi8(src, zero));
+  return _mm512_adds_epu8(src, _mm512_packus_epi16(lo, hi));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+inline __mmask16 TailMask512(size_t count) {
+  return static_cast<__mmask16>((1u << count) - 1);
+}
+
+GFX_TARGET("avx512f,avx512bw")
+void SrcCopyAVX512(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const end = dst + (count & ~static_cast<size_t>(15));
+  for (; dst < end; dst += 16) {
+    _mm512_storeu_si512(dst, _mm512_loadu_si512(src));
+    src += 16;
+  }
+  if (auto const rest = count & 15) {
+    auto const mask = TailMask512(rest);
+    _mm512_mask_storeu_epi32(dst, mask, _mm512_maskz_loadu_epi32(mask, src));
+  }
+}
+
+GFX_TARGET("avx512f,avx512bw")
+inline void SrcOverBlock512(uint32_t* dst, const uint32_t* src,
+                            __mmask16 mask) {
+  auto const alpha_mask = _mm512_set1_epi32(0xFF000000);
+  auto const source = _mm512_maskz_loadu_epi32(mask, src);
+  auto const opaque = _mm512_cmpeq_epi32_mask(
+      _mm512_and_si512(source, alpha_mask), alpha_mask);
+  if (opaque == mask) {
+    _mm512_mask_storeu_epi32(dst, mask, source);
+    return;
+  }
+  auto const visible = _mm512_test_epi32_mask(source, source);
+  if (!visible)
+    return;
+  auto const dest = _mm512_maskz_loadu_epi32(mask, dst);
+  _mm512_mask_storeu_epi32(dst, mask, SrcOver512(dest, source));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+void SrcOverAVX512(uint32_t* dst, const uint32_t* src, size_t count) {
+  auto const end = dst + (count & ~static_cast<size_t>(15));
+  for (; dst < end; dst += 16) {
+    SrcOverBlock512(dst, src, static_cast<__mmask16>(0xFFFF));
+    src += 16;
+  }
+  if (auto const rest = count & 15)
+    SrcOverBlock512(dst, src, TailMask512(rest));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+inline void SrcOverOpacityBlock512(uint32_t* dst, const uint32_t* src,
+                                   __m512i scale, __mmask16 mask) {
+  auto const source = _mm512_maskz_loadu_epi32(mask, src);
+  if (!_mm512_test_epi32_mask(source, source))
+    return;
+  auto const zero = _mm512_setzero_si512();
+  auto const scaled = _mm512_packus_epi16(
+      ScaleByOpacity512(_mm512_unpacklo_epi8(source, zero), scale),
+      ScaleByOpacity512(_mm512_unpackhi_epi8(source, zero), scale));
+  auto const dest = _mm512_maskz_loadu_epi32(mask, dst);
+  _mm512_mask_storeu_epi32(dst, mask, SrcOver512(dest, scaled));
+}
+
+GFX_TARGET("avx512f,avx512bw")
+void SrcOverOpacityAVX512(uint32_t* dst, const uint32_t* src, size_t count,
+                          uint32_t opacity) {
+  auto const scale = _mm512_set1_epi16(static_cast<int16_t>(opacity));
+  auto const end = dst + (count & ~static_cast<size_t>(15));
+  for (; dst < end; dst += 16) {
+    SrcOverOpacityBlock512(dst, src, scale, static_cast<__mmask16>(0xFFFF));
+    src += 16;
+  }
+  if (auto const rest = count & 15)
+    SrcOverOpacityBlock512(dst, src, scale, TailMask512(rest));
+}
+
+Isa DetectIsa() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  auto const max_id = info[0];
+  __cpuid(info, 1);
+  auto const has_osxsave = (info[2] & (1 << 27)) != 0;
+  auto const has_avx = (info[2] & (1 << 28)) != 0;
+  if (!has_osxsave || !has_avx || max_id < 7)
+    return Isa::SSE2;
+  // The OS must save YMM registers, and ZMM registers for AVX-512.
+  auto const xcr0 = _xgetbv(0);
+  if ((xcr0 & 0x06) != 0x06)
+    return Isa::SSE2;
+  __cpuidex(info, 7, 0);
+  auto const has_avx2 = (info[1] & (1 << 5)) != 0;
+  auto const has_avx512f = (info[1] & (1 << 16)) != 0;
+  auto const has_avx512bw = (info[1] & (1 << 30)) != 0;
+  if (has_avx512f && has_avx512bw && (xcr0 & 0xE6) == 0xE6)
+    return Isa::AVX512;
+  return has_avx2 ? Isa::AVX2 : Isa::SSE2;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return Isa::AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return Isa::AVX2;
+  return Isa::SSE2;
+#endif
+}
+
+}  // namespace
+
+const char* IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::Scalar:
+      return "scalar";
+    case Isa::SSE2:
+      return "sse2";
+    case Isa::AVX2:
+      return "avx2";
+    case Isa::AVX512:
+      return "avx512";
+  }
+  NOTREACHED();
+  return "unknown";
+}
+
+bool IsIsaSupported(Isa isa) {
+  return static_cast<int>(isa) <= static_cast<int>(SupportedIsa());
+}
+
+Isa SupportedIsa() {
+  static auto const isa = DetectIsa();
+  return isa;
+}
+
+const Kernels& KernelsFor(Isa isa) {
+  static const Kernels all_kernels[] = {
+    {Isa::Scalar, SrcCopyScalar, SrcOverScalar, SrcOverOpacityScalar},
+    {Isa::SSE2, SrcCopySSE2, SrcOverSSE2, SrcOverOpacitySSE2},
+    {Isa::AVX2, SrcCopyAVX2, SrcOverAVX2, SrcOverOpacityAVX2},
+    {Isa::AVX512, SrcCopyAVX512, SrcOverAVX512, SrcOverOpacityAVX512},
+  };
+  DCHECK(IsIsaSupported(isa));
+  return all_kernels[static_cast<int>(isa)];
+}
+
+const Kernels& kernels() {
+  static const Kernels& best_kernels = KernelsFor(SupportedIsa());
+  return best_kernels;
+}
+
+void SrcCopy(uint32_t* dst, const uint32_t* src, size_t count) {
+  kernels().src_copy(dst, src, count);
+}
+
+void SrcOver(uint32_t* dst, const uint32_t* src, size_t count) {
+  kernels().src_over(dst, src, count);
+}
+
+void SrcOver(uint32_t* dst, const uint32_t* src, size_t count,
+             float opacity) {
+  auto const scale = static_cast<uint32_t>(
+      std::max(0.0f, std::min(opacity, 1.0f)) * 255.0f + 0.5f);
+  if (!scale)
+    return;
+  if (scale == 255) {
+    kernels().src_over(dst, src, count);
+    return;
+  }
+  kernels().src_over_opacity(dst, src, count, scale);
+}
+
+void CompositeRect(uint8_t* dst, size_t dst_stride,
+                   const uint8_t* src, size_t src_stride,
+                   size_t width, size_t height, float opacity) {
+  for (auto y = 0u; y < height; ++y) {
+    SrcOver(reinterpret_cast<uint32_t*>(dst),
+            reinterpret_cast<const uint32_t*>(src), width, opacity);
+    dst += dst_stride;
+    src += src_stride;
+  }
+}
+
+}  // namespace blend
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_blend_h)
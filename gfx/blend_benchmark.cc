@@ -0,0 +1,250 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures throughput of premultiplied BGRA compositing kernels in
+// gfx/blend.h for each instruction set against scalar reference.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. gfx\blend_benchmark.cc
+//  g++ -std=c++11 -O2 -I. gfx/blend_benchmark.cc -o blend_benchmark
+//
+// Usage: blend_benchmark [megabytes_per_run]
+//
+// Throughput is destination bytes per second, e.g. 4 * pixels / seconds.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "gfx/blend.h"
+
+namespace {
+
+using gfx::blend::Isa;
+using gfx::blend::Kernels;
+
+// A frame of 512x512 pixels, 1MB, fits in L2 cache on most processors.
+const size_t kWidth = 512;
+const size_t kHeight = 512;
+const size_t kNumPixels = kWidth * kHeight;
+const uint32_t kOpacity = 179;
+
+enum class Pattern {
+  Opaque,
+  Transparent,
+  Mixed,
+  // Sprites on transparent background, e.g. balls on a card.
+  Runs,
+};
+
+const char* PatternName(Pattern pattern) {
+  switch (pattern) {
+    case Pattern::Opaque:
+      return "opaque";
+    case Pattern::Transparent:
+      return "transparent";
+    case Pattern::Mixed:
+      return "mixed";
+    case Pattern::Runs:
+      return "runs";
+  }
+  return "unknown";
+}
+
+uint32_t MakePremultiplied(uint32_t color, uint32_t alpha) {
+  auto pixel = alpha << 24;
+  for (auto shift = 0; shift < 24; shift += 8) {
+    auto const channel = (color >> shift) & 0xFF;
+    pixel |= ((channel * alpha + 127) / 255) << shift;
+  }
+  return pixel;
+}
+
+std::vector<uint32_t> MakePixels(Pattern pattern, uint32_t seed) {
+  std::vector<uint32_t> pixels(kNumPixels);
+  for (auto index = 0u; index < pixels.size(); ++index) {
+    auto const color = base::NextRandom(&seed);
+    auto alpha = 0u;
+    switch (pattern) {
+      case Pattern::Opaque:
+        alpha = 255;
+        break;
+      case Pattern::Transparent:
+        alpha = 0;
+        break;
+      case Pattern::Mixed:
+        alpha = base::NextRandom(&seed) & 0xFF;
+        break;
+      case Pattern::Runs: {
+        auto const x = index % kWidth;
+        auto const y = index / kWidth;
+        auto const in_sprite = (x / 32 + y / 32) % 3 == 0;
+        auto const edge = x % 32 == 0 || x % 32 == 31;
+        alpha = !in_sprite ? 0 : edge ? 128 : 255;
+        break;
+      }
+    }
+    pixels[index] = MakePremultiplied(color, alpha);
+  }
+  return pixels;
+}
+
+enum class Operation {
+  SrcCopy,
+  SrcOver,
+  SrcOverOpacity,
+};
+
+const char* OperationName(Operation operation) {
+  switch (operation) {
+    case Operation::SrcCopy:
+      return "src-copy";
+    case Operation::SrcOver:
+      return "src-over";
+    case Operation::SrcOverOpacity:
+      return "src-over-opacity";
+  }
+  return "unknown";
+}
+
+void RunKernel(const Kernels& kernels, Operation operation, uint32_t* dst,
+               const uint32_t* src) {
+  for (auto y = 0u; y < kHeight; ++y) {
+    switch (operation) {
+      case Operation::SrcCopy:
+        kernels.src_copy(dst, src, kWidth);
+        break;
+      case Operation::SrcOver:
+        kernels.src_over(dst, src, kWidth);
+        break;
+      case Operation::SrcOverOpacity:
+        kernels.src_over_opacity(dst, src, kWidth, kOpacity);
+        break;
+    }
+    dst += kWidth;
+    src += kWidth;
+  }
+}
+
+// Returns true if |kernels| produces the same pixels as scalar kernels. We
+// use odd width to exercise tail handling.
+bool Verify(const Kernels& kernels, Operation operation,
+            const std::vector<uint32_t>& src,
+            const std::vector<uint32_t>& dst) {
+  auto const& reference = gfx::blend::KernelsFor(Isa::Scalar);
+  auto expected = dst;
+  auto actual = dst;
+  for (auto width = 1u; width <= 67; width += 3) {
+    std::copy(dst.begin(), dst.end(), expected.begin());
+    std::copy(dst.begin(), dst.end(), actual.begin());
+    switch (operation) {
+      case Operation::SrcCopy:
+        reference.src_copy(expected.data(), src.data(), width);
+        kernels.src_copy(actual.data(), src.data(), width);
+        break;
+      case Operation::SrcOver:
+        reference.src_over(expected.data(), src.data(), width);
+        kernels.src_over(actual.data(), src.data(), width);
+        break;
+      case Operation::SrcOverOpacity:
+        reference.src_over_opacity(expected.data(), src.data(), width,
+                                   kOpacity);
+        kernels.src_over_opacity(actual.data(), src.data(), width, kOpacity);
+        break;
+    }
+    if (!std::equal(expected.begin(), expected.begin() + width + 1,
+                    actual.begin())) {
+      return false;
+    }
+  }
+  std::copy(dst.begin(), dst.end(), expected.begin());
+  std::copy(dst.begin(), dst.end(), actual.begin());
+  RunKernel(reference, operation, expected.data(), src.data());
+  RunKernel(kernels, operation, actual.data(), src.data());
+  return expected == actual;
+}
+
+double Measure(const Kernels& kernels, Operation operation,
+               const std::vector<uint32_t>& src,
+               const std::vector<uint32_t>& dst, size_t megabytes) {
+  auto frame = dst;
+  auto const frame_bytes = kNumPixels * sizeof(uint32_t);
+  auto const num_runs = std::max(megabytes * 1024 * 1024 / frame_bytes,
+                                 static_cast<size_t>(1));
+  // Warm up cache.
+  RunKernel(kernels, operation, frame.data(), src.data());
+  auto const start = base::TimeTicks::Now();
+  for (auto run = 0u; run < num_runs; ++run) {
+    // Restore destination every 16 runs to keep alpha distribution.
+    if (run % 16 == 15)
+      std::copy(dst.begin(), dst.end(), frame.begin());
+    RunKernel(kernels, operation, frame.data(), src.data());
+  }
+  auto const elapsed = (base::TimeTicks::Now() - start).InMillisecondsF();
+  return frame_bytes * num_runs / (elapsed / 1000) / 1e9;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const megabytes = argc >= 2 ? static_cast<size_t>(atoi(argv[1])) : 2048;
+  const Isa isas[] = {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512};
+  const Operation operations[] = {
+    Operation::SrcCopy, Operation::SrcOver, Operation::SrcOverOpacity,
+  };
+  const Pattern patterns[] = {
+    Pattern::Opaque, Pattern::Transparent, Pattern::Mixed, Pattern::Runs,
+  };
+
+  std::cout << "Best ISA: " << gfx::blend::IsaName(gfx::blend::SupportedIsa())
+            << ", " << kWidth << "x" << kHeight << " pixels, "
+            << megabytes << "MB per run" << std::endl;
+  printf("%-18s %-12s %-8s %10s %8s\n", "operation", "source", "isa", "GB/s",
+         "speedup");
+  auto const dst = MakePixels(Pattern::Mixed, 1);
+  auto failed = false;
+  for (auto const operation : operations) {
+    for (auto const pattern : patterns) {
+      if (operation == Operation::SrcCopy && pattern != Pattern::Mixed)
+        continue;
+      auto const src = MakePixels(pattern, 2);
+      auto scalar_throughput = 0.0;
+      for (auto const isa : isas) {
+        if (!gfx::blend::IsIsaSupported(isa))
+          continue;
+        auto const& kernels = gfx::blend::KernelsFor(isa);
+        if (!Verify(kernels, operation, src, dst)) {
+          printf("%-18s %-12s %-8s MISMATCH\n", OperationName(operation),
+                 PatternName(pattern), gfx::blend::IsaName(isa));
+          failed = true;
+          continue;
+        }
+        auto const throughput = Measure(kernels, operation, src, dst,
+                                        megabytes);
+        if (isa == Isa::Scalar)
+          scalar_throughput = throughput;
+        printf("%-18s %-12s %-8s %10.2f %7.2fx\n", OperationName(operation),
+               PatternName(pattern), gfx::blend::IsaName(isa), throughput,
+               throughput / scalar_throughput);
+      }
+    }
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,380 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_geometry_h)
+#define INCLUDE_gfx_geometry_h
+
+// Sizes, points and rectangles in Direct2D structures. They don't need
+// Direct2D, so benchmarks use them without Windows.
+
+#if !defined(_WIN32)
+// Same layout as structures in d2d1.h.
+struct D2D1_POINT_2F {
+  float x;
+  float y;
+};
+
+struct D2D1_RECT_F {
+  float left;
+  float top;
+  float right;
+  float bottom;
+};
+
+struct D2D1_SIZE_F {
+  float width;
+  float height;
+};
+#endif
+
+namespace gfx {
+
+//////////////////////////////////////////////////////////////////////
+//
+// SizeF
+//
+class SizeF final {
+  private: D2D1_SIZE_F size_;
+
+  public: SizeF(const SizeF& other);
+  public: SizeF(const D2D1_SIZE_F& size);
+  public: SizeF(float x, float y);
+  public: SizeF();
+
+  public: operator const D2D1_SIZE_F&() const { return size_; }
+  public: operator D2D1_SIZE_F() { return size_; }
+
+  public: SizeF operator+(const SizeF& other) const;
+  public: SizeF operator+(float value) const;
+  public: SizeF operator-(const SizeF& other) const;
+  public: SizeF operator-(float value) const;
+
+  public: SizeF& operator=(float new_value);
+  public: SizeF& operator+=(const SizeF& other);
+  public: SizeF& operator+=(float new_value);
+  public: SizeF& operator-=(const SizeF& other);
+  public: SizeF& operator-=(float new_value);
+
+  public: bool operator==(const SizeF& other) const;
+  public: bool operator!=(const SizeF& other) const;
+
+  public: float height() const { return size_.height; }
+  public: void set_height(float new_height) { size_.height = new_height; }
+  public: float width() const { return size_.width; }
+  public: void set_width(float new_width) { size_.width = new_width; }
+};
+
+SizeF::SizeF(const SizeF& other) : size_(other.size_) {
+}
+
+SizeF::SizeF(const D2D1_SIZE_F& size) : size_(size) {
+}
+
+SizeF::SizeF(float width, float height) {
+  size_.width = width;
+  size_.height = height;
+}
+
+SizeF::SizeF() : SizeF(0.0f, 0.0f) {
+}
+
+SizeF SizeF::operator+(const SizeF& other) const {
+  return SizeF(width() + other.width(), height() + other.height());
+}
+
+SizeF SizeF::operator+(float value) const {
+  return SizeF(width() + value, height() + value);
+}
+
+SizeF SizeF::operator-(const SizeF& other) const {
+  return SizeF(width() - other.width(), height() - other.height());
+}
+
+SizeF SizeF::operator-(float value) const {
+  return SizeF(width() - value, height() - value);
+}
+
+SizeF& SizeF::operator=(float new_value) {
+  size_.width = size_.height = new_value;
+  return *this;
+}
+
+SizeF& SizeF::operator+=(const SizeF& other) {
+  size_.width += other.size_.width;
+  size_.height += other.size_.height;
+  return *this;
+}
+
+SizeF& SizeF::operator+=(float new_value) {
+  size_.width += new_value;
+  size_.height += new_value;
+  return *this;
+}
+
+SizeF& SizeF::operator-=(const SizeF& other) {
+  size_.width += other.size_.width;
+  size_.height += other.size_.height;
+  return *this;
+}
+
+SizeF& SizeF::operator-=(float new_value) {
+  size_.width -= new_value;
+  size_.height -= new_value;
+  return *this;
+}
+
+bool SizeF::operator==(const SizeF& other) const {
+  return size_.width == other.size_.width && size_.height == other.size_.height;
+}
+
+bool SizeF::operator!=(const SizeF& other) const {
+  return !operator==(other);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// PointF
+//
+class PointF final {
+  private: D2D1_POINT_2F point_;
+
+  public: PointF(const PointF& other);
+  public: PointF(const D2D1_POINT_2F& point);
+  public: PointF(float x, float y);
+  public: PointF();
+
+  public: operator const D2D1_POINT_2F&() const { return point_; }
+  public: operator D2D1_POINT_2F&() { return point_; }
+
+  public: PointF operator+(const SizeF& size) const;
+  public: PointF operator-(const SizeF& size) const;
+
+  public: PointF& operator=(float new_value);
+  public: PointF& operator+=(const SizeF& other);
+  public: PointF& operator+=(float new_value);
+  public: PointF& operator-=(const SizeF& other);
+  public: PointF& operator-=(float new_value);
+
+  public: bool operator==(const PointF& other) const;
+  public: bool operator!=(const PointF& other) const;
+
+  public: float x() const { return point_.x; }
+  public: void set_x(float new_x) { point_.x = new_x; }
+  public: float y() const { return point_.y; }
+  public: void set_y(float new_y) { point_.y = new_y; }
+
+  public: float Distance(const PointF& other) const;
+};
+
+PointF::PointF(const PointF& other) : point_(other.point_) {
+}
+
+PointF::PointF(const D2D1_POINT_2F& point) : point_(point) {
+}
+
+PointF::PointF(float x, float y) {
+  point_.x = x;
+  point_.y = y;
+}
+
+PointF::PointF() : PointF(0.0f, 0.0f) {
+}
+
+PointF PointF::operator+(const SizeF& size) const {
+  return PointF(x() + size.width(), y() + size.height());
+}
+
+PointF PointF::operator-(const SizeF& size) const {
+  return PointF(x() - size.width(), y() - size.height());
+}
+
+PointF& PointF::operator=(float new_value) {
+  point_.x = point_.y = new_value;
+  return *this;
+}
+
+PointF& PointF::operator+=(const SizeF& size) {
+  point_.x += size.width();
+  point_.y += size.height();
+  return *this;
+}
+
+PointF& PointF::operator+=(float new_value) {
+  point_.x += new_value;
+  point_.y += new_value;
+  return *this;
+}
+
+PointF& PointF::operator-=(const SizeF& size) {
+  point_.x -= size.width();
+  point_.y -= size.height();
+  return *this;
+}
+
+PointF& PointF::operator-=(float new_value) {
+  point_.x -= new_value;
+  point_.y -= new_value;
+  return *this;
+}
+
+bool PointF::operator==(const PointF& other) const {
+  return point_.x == other.point_.x && point_.y == other.point_.y;
+}
+
+bool PointF::operator!=(const PointF& other) const {
+  return !operator==(other);
+}
+
+float PointF::Distance(const PointF& other) const {
+  auto const dx = point_.x - other.point_.x;
+  auto const dy = point_.y - other.point_.y;
+  return ::sqrt(dx * dx + dy * dy);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// RectF
+//
+class RectF final {
+  private: D2D1_RECT_F rect_;
+
+  public: RectF(const RectF& other);
+  public: RectF(const D2D1_RECT_F& rect);
+  public: RectF(float left, float top, float right, float bottom);
+  public: RectF(const PointF& origin, const PointF& bottom_right);
+  public: RectF(const PointF& origin, const SizeF& size);
+  public: RectF();
+
+  public: operator const D2D1_RECT_F&() const { return rect_; }
+  public: operator D2D1_RECT_F&() { return rect_; }
+
+  public: RectF operator+(const SizeF& size) const;
+  public: RectF operator+(float value) const {
+    return operator+(SizeF(value, value));
+  }
+  public: RectF operator-(const SizeF& size) const;
+  public: RectF operator-(float value) const {
+    return operator-(SizeF(value, value));
+  }
+
+  public: RectF& operator+=(const SizeF& size);
+  public: RectF& operator+=(float new_value);
+  public: RectF& operator-=(const SizeF& size);
+  public: RectF& operator-=(float new_value);
+
+  public: bool operator==(const RectF& other) const;
+  public: bool operator!=(const RectF& other) const;
+
+  public: float bottom() const { return rect_.bottom; }
+  public: PointF bottom_right() const { return PointF(right(), bottom()); }
+  public: bool empty() const { return width() <= 0 || height() <= 0; }
+  public: float left() const { return rect_.left; }
+  public: float height() const { return rect_.bottom - rect_.top; }
+  public: PointF origin() const { return PointF(left(), top()); }
+  public: void set_origin(const gfx::PointF& origin);
+  public: float right() const { return rect_.right; }
+  public: SizeF size() const { return SizeF(width(), height()); }
+  public: void set_size(const gfx::SizeF& size);
+  public: float top() const { return rect_.top; }
+  public: float width() const { return rect_.right - rect_.left; }
+
+  public: bool Contains(const PointF& point)const;
+
+  // Move the rectangle by horizontal and vertical distance.
+  public: RectF Offset(const SizeF& size) const;
+};
+
+RectF::RectF(const RectF& other) : rect_(other.rect_) {
+}
+
+RectF::RectF(const D2D1_RECT_F& rect) : rect_(rect) {
+}
+
+RectF::RectF(float left, float top, float right, float bottom) {
+  rect_.left = left;
+  rect_.top = top;
+  rect_.right = right;
+  rect_.bottom = bottom;
+}
+
+RectF::RectF(const PointF& origin, const PointF& bottom_right)
+    : RectF(origin.x(), origin.y(), bottom_right.x(), bottom_right.y()) {
+}
+
+RectF::RectF(const PointF& origin, const SizeF& size)
+    : RectF(origin, origin + size) {
+}
+
+RectF::RectF() : RectF(0.0f, 0.0f, 0.0f, 0.0f) {
+}
+
+RectF RectF::operator+(const SizeF& size) const {
+  return gfx::RectF(left() - size.width(), top() - size.height(),
+                    right() + size.width(), bottom() - size.height());
+}
+
+RectF RectF::operator-(const SizeF& size) const {
+  return gfx::RectF(left() + size.width(), top() + size.height(),
+                    right() - size.width(), bottom() - size.height());
+}
+
+RectF& RectF::operator+=(const SizeF& size) {
+  rect_.left -= size.width();
+  rect_.top -= size.height();
+  rect_.right += size.width();
+  rect_.bottom += size.height();
+  return *this;
+}
+
+RectF& RectF::operator+=(float new_value) {
+  return *this += SizeF(new_value, new_value);
+}
+
+RectF& RectF::operator-=(const SizeF& size) {
+  rect_.left += size.width();
+  rect_.top += size.height();
+  rect_.right -= size.width();
+  rect_.bottom -= size.height();
+  return *this;
+}
+
+RectF& RectF::operator-=(float new_value) {
+  return *this -= SizeF(new_value, new_value);
+}
+
+bool RectF::operator==(const RectF& other) const {
+  return rect_.left == other.rect_.left && rect_.top == other.rect_.top &&
+         rect_.right == other.rect_.right &&
+         rect_.bottom == other.rect_.bottom;
+}
+
+bool RectF::operator!=(const RectF& other) const {
+  return !operator==(other);
+}
+
+void RectF::set_origin(const PointF& new_origin){
+  auto const size = this->size();
+  rect_.left = new_origin.x();
+  rect_.top = new_origin.y();
+  rect_.right = rect_.left + size.width();
+  rect_.bottom = rect_.top + size.height();
+}
+
+void RectF::set_size(const SizeF& new_size) {
+  rect_.right = rect_.left + new_size.width();
+  rect_.bottom = rect_.top + new_size.height();
+}
+
+bool RectF::Contains(const PointF& point) const {
+  return point.x() >= rect_.left && point.x() < rect_.right &&
+         point.y() >= rect_.top && point.y() < rect_.bottom;
+}
+
+RectF RectF::Offset(const SizeF& size) const {
+  return gfx::RectF(origin() + size, this->size());
+}
+
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_geometry_h)
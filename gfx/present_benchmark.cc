@@ -0,0 +1,187 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures frame time and bytes copied by |gfx::SoftwareSwapChain| with
+// full present, dirty rects and scroll rect for a HUD like StatusLayer, e.g.
+// numbers and a graph scrolling left change in every frame. Frame time
+// includes painting changed regions. Presented frames are checked against
+// frames painted as whole.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. gfx\present_benchmark.cc
+//  g++ -std=c++11 -O2 -I. gfx/present_benchmark.cc -o present_benchmark
+//
+// Usage: present_benchmark [num_frames]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "gfx/blend.h"
+#include "gfx/present_params.h"
+#include "gfx/sprite.h"
+#include "gfx/software_canvas.h"
+#include "gfx/software_swap_chain.h"
+
+namespace {
+
+const int kWidth = 1280;
+const int kHeight = 720;
+const int kScrollStep = 2;
+const gfx::IntRect kTextRect = {5, 5, 405, 95};
+const gfx::IntRect kGraphRect = {4, kHeight - 84, kWidth - 4, kHeight - 4};
+
+enum class Mode {
+  Full,
+  Dirty,
+  Scroll,
+};
+
+const char* ModeName(Mode mode) {
+  switch (mode) {
+    case Mode::Full:
+      return "full";
+    case Mode::Dirty:
+      return "dirty";
+    case Mode::Scroll:
+      return "scroll";
+  }
+  return "unknown";
+}
+
+// Graph contents scroll left |kScrollStep| pixels in each frame.
+uint32_t GraphPixel(int frame, int x, int y) {
+  auto const column = static_cast<uint32_t>(x + frame * kScrollStep);
+  return 0xFF000000 | ((column * 2654435761u) >> 8 & 0xFFFF00) |
+         static_cast<uint32_t>(y & 0xFF);
+}
+
+uint32_t TextPixel(int frame, int x, int y) {
+  return 0xFF000000 | (static_cast<uint32_t>((x ^ y) + frame * 7) & 0xFFFFFF);
+}
+
+void PaintRect(gfx::SoftwareBitmap* bitmap, const gfx::IntRect& rect,
+               int frame, uint32_t (*painter)(int, int, int)) {
+  for (auto y = rect.top; y < rect.bottom; ++y) {
+    auto const pixels = bitmap->row(y);
+    for (auto x = rect.left; x < rect.right; ++x)
+      pixels[x] = painter(frame, x, y);
+  }
+}
+
+void PaintBackground(gfx::SoftwareBitmap* bitmap) {
+  std::fill(bitmap->pixels(),
+            bitmap->pixels() + bitmap->width() * bitmap->height(),
+            0xFFFFFFFF);
+}
+
+void PaintFrame(gfx::SoftwareBitmap* bitmap, int frame) {
+  PaintBackground(bitmap);
+  PaintRect(bitmap, kTextRect, frame, TextPixel);
+  PaintRect(bitmap, kGraphRect, frame, GraphPixel);
+}
+
+// Paints |frame| into |swap_chain| and presents it.
+void DoFrame(gfx::SoftwareSwapChain* swap_chain, Mode mode, int frame) {
+  auto const back_buffer = swap_chain->back_buffer();
+  gfx::PresentParams params;
+  if (mode == Mode::Full || swap_chain->needs_full_present()) {
+    PaintFrame(back_buffer, frame);
+    swap_chain->Present(params);
+    return;
+  }
+  PaintRect(back_buffer, kTextRect, frame, TextPixel);
+  params.AddDirtyRect(kTextRect);
+  if (mode == Mode::Dirty) {
+    PaintRect(back_buffer, kGraphRect, frame, GraphPixel);
+    params.AddDirtyRect(kGraphRect);
+    swap_chain->Present(params);
+    return;
+  }
+  auto exposed = kGraphRect;
+  exposed.left = kGraphRect.right - kScrollStep;
+  PaintRect(back_buffer, exposed, frame, GraphPixel);
+  params.AddDirtyRect(exposed);
+  auto scrolled = kGraphRect;
+  scrolled.right = exposed.left;
+  params.SetScroll(scrolled, -kScrollStep, 0);
+  swap_chain->Present(params);
+}
+
+bool Verify(Mode mode) {
+  gfx::SoftwareSwapChain swap_chain(kWidth, kHeight);
+  gfx::SoftwareBitmap expected(kWidth, kHeight);
+  for (auto frame = 0; frame < 10; ++frame) {
+    DoFrame(&swap_chain, mode, frame);
+    PaintFrame(&expected, frame);
+    auto const size = kWidth * kHeight;
+    if (!std::equal(expected.pixels(), expected.pixels() + size,
+                    swap_chain.front_buffer().pixels()) ||
+        !std::equal(expected.pixels(), expected.pixels() + size,
+                    swap_chain.back_buffer()->pixels())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Measure(Mode mode, int num_frames, double* milliseconds,
+             double* copied_bytes) {
+  gfx::SoftwareSwapChain swap_chain(kWidth, kHeight);
+  DoFrame(&swap_chain, mode, 0);
+  auto const start_bytes = swap_chain.copied_bytes();
+  auto const start = base::TimeTicks::Now();
+  for (auto frame = 1; frame <= num_frames; ++frame)
+    DoFrame(&swap_chain, mode, frame);
+  *milliseconds = (base::TimeTicks::Now() - start).InMillisecondsF() /
+                  num_frames;
+  *copied_bytes = static_cast<double>(swap_chain.copied_bytes() -
+                                      start_bytes) / num_frames;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_frames = argc >= 2 ? atoi(argv[1]) : 1000;
+  const Mode modes[] = {Mode::Full, Mode::Dirty, Mode::Scroll};
+  std::cout << "Back buffer " << kWidth << "x" << kHeight << ", "
+            << num_frames << " frames" << std::endl;
+  printf("%-8s %12s %16s %8s\n", "mode", "ms/frame", "copied bytes",
+         "ratio");
+  auto full_bytes = 0.0;
+  auto failed = false;
+  for (auto const mode : modes) {
+    if (!Verify(mode)) {
+      printf("%-8s MISMATCH\n", ModeName(mode));
+      failed = true;
+      continue;
+    }
+    auto milliseconds = 0.0;
+    auto copied_bytes = 0.0;
+    Measure(mode, num_frames, &milliseconds, &copied_bytes);
+    if (mode == Mode::Full)
+      full_bytes = copied_bytes;
+    printf("%-8s %12.4f %16.0f %7.3f\n", ModeName(mode), milliseconds,
+           copied_bytes, copied_bytes / full_bytes);
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
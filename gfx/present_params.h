@@ -0,0 +1,108 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_present_params_h)
+#define INCLUDE_gfx_present_params_h
+
+namespace gfx {
+
+//////////////////////////////////////////////////////////////////////
+//
+// IntRect
+// A rectangle in pixels, |right| and |bottom| are exclusive.
+//
+struct IntRect {
+  int left;
+  int top;
+  int right;
+  int bottom;
+
+  int height() const { return bottom - top; }
+  bool IsEmpty() const { return left >= right || top >= bottom; }
+  int width() const { return right - left; }
+
+  IntRect Intersect(const IntRect& other) const;
+  IntRect Offset(int delta_x, int delta_y) const;
+};
+
+IntRect IntRect::Intersect(const IntRect& other) const {
+  IntRect result = {
+    std::max(left, other.left), std::max(top, other.top),
+    std::min(right, other.right), std::min(bottom, other.bottom)
+  };
+  return result;
+}
+
+IntRect IntRect::Offset(int delta_x, int delta_y) const {
+  IntRect result = {
+    left + delta_x, top + delta_y, right + delta_x, bottom + delta_y
+  };
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// PresentParams
+// Describes which part of back buffer is changed since the last present,
+// same as |DXGI_PRESENT_PARAMETERS|. Pixels in scroll rect come from
+// the previous frame at scroll rect moved by minus scroll offset, and pixels
+// in dirty rects come from back buffer. Other pixels are kept as the
+// previous frame. Empty params means whole back buffer is changed.
+//
+class PresentParams final {
+  private: std::vector<IntRect> dirty_rects_;
+  private: int scroll_offset_x_;
+  private: int scroll_offset_y_;
+  private: IntRect scroll_rect_;
+
+  public: PresentParams();
+  public: ~PresentParams() = default;
+
+  public: const std::vector<IntRect>& dirty_rects() const {
+    return dirty_rects_;
+  }
+  public: bool has_scroll() const { return !scroll_rect_.IsEmpty(); }
+  public: bool is_full() const {
+    return dirty_rects_.empty() && !has_scroll();
+  }
+  public: int scroll_offset_x() const { return scroll_offset_x_; }
+  public: int scroll_offset_y() const { return scroll_offset_y_; }
+  public: const IntRect& scroll_rect() const { return scroll_rect_; }
+
+  public: void AddDirtyRect(const IntRect& rect);
+  public: void Clear();
+  // Content of |rect| moved by (-|offset_x|, -|offset_y|) in the previous
+  // frame is moved into |rect|. Callers should add exposed area as dirty
+  // rect.
+  public: void SetScroll(const IntRect& rect, int offset_x, int offset_y);
+};
+
+PresentParams::PresentParams()
+    : scroll_offset_x_(0), scroll_offset_y_(0) {
+  scroll_rect_ = IntRect();
+}
+
+void PresentParams::AddDirtyRect(const IntRect& rect) {
+  if (rect.IsEmpty())
+    return;
+  dirty_rects_.push_back(rect);
+}
+
+void PresentParams::Clear() {
+  dirty_rects_.clear();
+  scroll_offset_x_ = 0;
+  scroll_offset_y_ = 0;
+  scroll_rect_ = IntRect();
+}
+
+void PresentParams::SetScroll(const IntRect& rect, int offset_x,
+                              int offset_y) {
+  scroll_offset_x_ = offset_x;
+  scroll_offset_y_ = offset_y;
+  scroll_rect_ = rect;
+}
+
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_present_params_h)
@@ -0,0 +1,433 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_software_canvas_h)
+#define INCLUDE_gfx_software_canvas_h
+
+#include "gfx/blend.h"
+#include "gfx/sprite.h"
+
+namespace gfx {
+
+//////////////////////////////////////////////////////////////////////
+//
+// SoftwareBitmap
+// Premultiplied BGRA pixels in system memory, see gfx/blend.h.
+//
+class SoftwareBitmap final {
+  private: size_t height_;
+  private: std::vector<uint32_t> pixels_;
+  private: size_t width_;
+
+  public: SoftwareBitmap(size_t width, size_t height);
+  public: ~SoftwareBitmap() = default;
+
+  public: size_t height() const { return height_; }
+  public: uint32_t* pixels() { return pixels_.data(); }
+  public: const uint32_t* pixels() const { return pixels_.data(); }
+  // Number of bytes between rows.
+  public: size_t stride() const { return width_ * sizeof(uint32_t); }
+  public: size_t width() const { return width_; }
+
+  public: uint32_t* row(size_t y) { return pixels_.data() + y * width_; }
+  public: const uint32_t* row(size_t y) const {
+    return pixels_.data() + y * width_;
+  }
+
+  public: void Resize(size_t width, size_t height);
+
+  DISALLOW_COPY_AND_ASSIGN(SoftwareBitmap);
+};
+
+SoftwareBitmap::SoftwareBitmap(size_t width, size_t height)
+    : height_(height), pixels_(width * height), width_(width) {
+}
+
+void SoftwareBitmap::Resize(size_t width, size_t height) {
+  height_ = height;
+  width_ = width;
+  pixels_.resize(width * height);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SoftwareSprite
+// A sprite bitmap with cache of scaled, rotated and tinted images of it.
+// Sizes are quantized into whole pixels and angles into |kNumAngles| steps,
+// so drawing an instance is source-over of cached image rows.
+//
+class SoftwareSprite final {
+  public: static const int kNumAngles = 128;
+
+  // A cached image and spans of its rows without transparent pixels at
+  // both ends, so drawing skips corners of rotated images.
+  public: struct Image {
+    SoftwareBitmap bitmap;
+    uint64_t key;
+    // [first, second) of each row, empty for a transparent row.
+    std::vector<std::pair<int, int>> spans;
+
+    explicit Image(size_t size) : bitmap(size, size), key(0) {}
+  };
+
+  private: SoftwareBitmap bitmap_;
+  // Cached images, most recently used first.
+  private: std::list<Image> images_;
+  private: std::unordered_map<uint64_t, std::list<Image>::iterator>
+      image_map_;
+  private: size_t images_size_;
+  private: size_t max_images_size_;
+
+  // |max_images_size| is number of bytes of cached images.
+  // |TrimImages()| discards least recently used images over it.
+  public: SoftwareSprite(size_t width, size_t height,
+                         size_t max_images_size = 32 * 1024 * 1024);
+  public: ~SoftwareSprite() = default;
+
+  // Paint sprite into |bitmap()| then call |DidChangeBitmap()|.
+  public: SoftwareBitmap* bitmap() { return &bitmap_; }
+  public: size_t images_size() const { return images_size_; }
+  public: size_t num_images() const { return images_.size(); }
+
+  public: void DidChangeBitmap();
+  // Returned image is valid until |TrimImages()| or |DidChangeBitmap()|.
+  public: const Image& ImageFor(const SpriteInstance& instance);
+  public: void TrimImages();
+
+  private: void RenderImage(int diameter, int angle_step, uint32_t color,
+                            SoftwareBitmap* image) const;
+
+  DISALLOW_COPY_AND_ASSIGN(SoftwareSprite);
+};
+
+namespace {
+const float kRadiansPerDegree = 3.14159265358979f / 180.0f;
+
+// Narrows [|*start|, |*end|) to t where 0 <= |origin| + |delta| * t < |limit|.
+void ClipSpan(float origin, float delta, float limit, float* start,
+              float* end) {
+  if (delta == 0) {
+    if (origin < 0 || origin >= limit)
+      *end = *start;
+    return;
+  }
+  auto const t0 = (0 - origin) / delta;
+  auto const t1 = (limit - origin) / delta;
+  *start = std::max(*start, std::min(t0, t1));
+  *end = std::min(*end, std::max(t0, t1));
+}
+
+// Returns |pixel| multiplied by |color| for each channel.
+uint32_t ModulatePixel(uint32_t pixel, uint32_t color) {
+  auto result = 0u;
+  for (auto shift = 0; shift < 32; shift += 8) {
+    auto const product = ((pixel >> shift) & 0xFF) *
+                         ((color >> shift) & 0xFF) + 128;
+    result |= ((product + (product >> 8)) >> 8) << shift;
+  }
+  return result;
+}
+}  // namespace
+
+SoftwareSprite::SoftwareSprite(size_t width, size_t height,
+                               size_t max_images_size)
+    : bitmap_(width, height), images_size_(0),
+      max_images_size_(max_images_size) {
+}
+
+void SoftwareSprite::DidChangeBitmap() {
+  image_map_.clear();
+  images_.clear();
+  images_size_ = 0;
+}
+
+const SoftwareSprite::Image& SoftwareSprite::ImageFor(
+    const SpriteInstance& instance) {
+  auto const diameter = std::max(
+      static_cast<int>(instance.size * 2 + 0.5f), 1);
+  auto const turns = instance.angle / 360.0f;
+  auto const angle_step = static_cast<int>(
+      (turns - ::floor(turns)) * kNumAngles + 0.5f) % kNumAngles;
+  auto const key = (static_cast<uint64_t>(diameter) << 40) |
+                   (static_cast<uint64_t>(angle_step) << 32) |
+                   instance.color;
+  auto const it = image_map_.find(key);
+  if (it != image_map_.end()) {
+    images_.splice(images_.begin(), images_, it->second);
+    return *it->second;
+  }
+
+  auto const angle = angle_step * 360.0f / kNumAngles * kRadiansPerDegree;
+  auto const extent = diameter * (::fabs(::cos(angle)) + ::fabs(::sin(angle)));
+  images_.emplace_front(static_cast<size_t>(::ceil(extent)));
+  auto& image = images_.front();
+  image.key = key;
+  RenderImage(diameter, angle_step, instance.color, &image.bitmap);
+  auto const width = static_cast<int>(image.bitmap.width());
+  image.spans.resize(image.bitmap.height());
+  for (auto y = 0u; y < image.spans.size(); ++y) {
+    auto const pixels = image.bitmap.row(y);
+    auto first = 0;
+    while (first < width && !pixels[first])
+      ++first;
+    auto last = width;
+    while (last > first && !pixels[last - 1])
+      --last;
+    image.spans[y] = std::make_pair(first, last);
+  }
+  images_size_ += image.bitmap.stride() * image.bitmap.height();
+  image_map_[key] = images_.begin();
+  return image;
+}
+
+void SoftwareSprite::TrimImages() {
+  while (images_size_ > max_images_size_ && !images_.empty()) {
+    auto const& image = images_.back();
+    images_size_ -= image.bitmap.stride() * image.bitmap.height();
+    image_map_.erase(image.key);
+    images_.pop_back();
+  }
+}
+
+// Samples |bitmap_| with nearest neighbor by mapping each pixel center of
+// |image| into |bitmap_| with inverse rotation.
+void SoftwareSprite::RenderImage(int diameter, int angle_step,
+                                 uint32_t color, SoftwareBitmap* image) const {
+  auto const angle = angle_step * 360.0f / kNumAngles * kRadiansPerDegree;
+  auto const cosine = ::cos(angle);
+  auto const sine = ::sin(angle);
+  auto const sprite_width = static_cast<float>(bitmap_.width());
+  auto const sprite_height = static_cast<float>(bitmap_.height());
+  auto const scale_x = sprite_width / diameter;
+  auto const scale_y = sprite_height / diameter;
+  auto const du = cosine * scale_x;
+  auto const dv = -sine * scale_y;
+  auto const last_u = static_cast<int>(bitmap_.width()) - 1;
+  auto const last_v = static_cast<int>(bitmap_.height()) - 1;
+  auto const center = image->width() / 2.0f;
+  auto const radius = diameter / 2.0f;
+  std::fill(image->pixels(),
+            image->pixels() + image->width() * image->height(), 0);
+  for (auto y = 0u; y < image->height(); ++y) {
+    auto const dx = 0.5f - center;
+    auto const dy = y + 0.5f - center;
+    auto const u0 = (dx * cosine + dy * sine + radius) * scale_x;
+    auto const v0 = (dy * cosine - dx * sine + radius) * scale_y;
+    auto start = 0.0f;
+    auto end = static_cast<float>(image->width());
+    ClipSpan(u0, du, sprite_width, &start, &end);
+    ClipSpan(v0, dv, sprite_height, &start, &end);
+    auto const first = static_cast<int>(::ceil(start));
+    auto const last = std::min(static_cast<int>(::ceil(end)),
+                               static_cast<int>(image->width()));
+    auto u = u0 + du * first;
+    auto v = v0 + dv * first;
+    auto pixels = image->row(y);
+    for (auto x = first; x < last; ++x) {
+      auto const iu = std::min(std::max(static_cast<int>(u), 0), last_u);
+      auto const iv = std::min(std::max(static_cast<int>(v), 0), last_v);
+      auto const pixel = bitmap_.row(iv)[iu];
+      pixels[x] = color == 0xFFFFFFFF ? pixel : ModulatePixel(pixel, color);
+      u += du;
+      v += dv;
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// SoftwareCanvas
+// Draws into |SoftwareBitmap| with source-over compositing. Shapes are
+// aliased, e.g. a pixel is painted if its center is inside of shape.
+//
+class SoftwareCanvas final {
+  // |DrawSprites()| composites sprites band by band of this many rows, so
+  // a band stays in cache while all sprites overlapping it are drawn.
+  private: static const int kBandHeight = 64;
+
+  private: struct SpriteDraw {
+    const SoftwareSprite::Image* image;
+    int left;
+    int top;
+  };
+
+  // Indexes of |sprite_draws_| overlapping each band, in order of bands.
+  private: std::vector<size_t> band_draws_;
+  // Start of each band in |band_draws_|, and end of the last band.
+  private: std::vector<size_t> band_starts_;
+  private: SoftwareBitmap* bitmap_;
+  // Scratch buffer for a row of source pixels.
+  private: std::vector<uint32_t> span_;
+  private: std::vector<SpriteDraw> sprite_draws_;
+
+  public: explicit SoftwareCanvas(SoftwareBitmap* bitmap);
+  public: ~SoftwareCanvas() = default;
+
+  public: SoftwareBitmap* bitmap() const { return bitmap_; }
+
+  public: void Clear(uint32_t color);
+  public: void DrawBitmap(const SoftwareBitmap& bitmap, int left, int top,
+                          float opacity = 1.0f);
+  // Draws all |instances| of |sprite| in one call. Images of instances
+  // are looked up first, then composited band by band in order of
+  // instances, only spans of non-transparent pixels.
+  public: void DrawSprites(SoftwareSprite* sprite,
+                           const SpriteInstance* instances, size_t count);
+  public: void FillEllipse(float center_x, float center_y, float radius,
+                           uint32_t color);
+  public: void FillRectangle(float left, float top, float right,
+                             float bottom, uint32_t color);
+
+  private: void FillSpan(int left, int right, int y, uint32_t color);
+
+  DISALLOW_COPY_AND_ASSIGN(SoftwareCanvas);
+};
+
+SoftwareCanvas::SoftwareCanvas(SoftwareBitmap* bitmap)
+    : bitmap_(bitmap), span_(bitmap->width()) {
+}
+
+void SoftwareCanvas::Clear(uint32_t color) {
+  std::fill(bitmap_->pixels(),
+            bitmap_->pixels() + bitmap_->width() * bitmap_->height(), color);
+}
+
+void SoftwareCanvas::DrawBitmap(const SoftwareBitmap& bitmap, int left,
+                                int top, float opacity) {
+  auto const src_left = std::max(-left, 0);
+  auto const src_top = std::max(-top, 0);
+  auto const dst_left = std::max(left, 0);
+  auto const dst_top = std::max(top, 0);
+  auto const width = std::min(static_cast<int>(bitmap.width()) - src_left,
+      static_cast<int>(bitmap_->width()) - dst_left);
+  auto const height = std::min(static_cast<int>(bitmap.height()) - src_top,
+      static_cast<int>(bitmap_->height()) - dst_top);
+  if (width <= 0 || height <= 0)
+    return;
+  blend::CompositeRect(
+      reinterpret_cast<uint8_t*>(bitmap_->row(dst_top) + dst_left),
+      bitmap_->stride(),
+      reinterpret_cast<const uint8_t*>(bitmap.row(src_top) + src_left),
+      bitmap.stride(), width, height, opacity);
+}
+
+void SoftwareCanvas::DrawSprites(SoftwareSprite* sprite,
+                                 const SpriteInstance* instances,
+                                 size_t count) {
+  auto const width = static_cast<int>(bitmap_->width());
+  auto const height = static_cast<int>(bitmap_->height());
+  auto const num_bands = (height + kBandHeight - 1) / kBandHeight;
+  auto const first_band = [](const SpriteDraw& draw) {
+    return std::max(draw.top, 0) / kBandHeight;
+  };
+  auto const last_band = [height](const SpriteDraw& draw) {
+    return (std::min(draw.top + static_cast<int>(draw.image->bitmap.height()),
+                     height) - 1) / kBandHeight;
+  };
+
+  // Count sprites overlapping each band.
+  sprite_draws_.clear();
+  band_starts_.assign(num_bands + 1, 0);
+  for (auto const end = instances + count; instances < end; ++instances) {
+    if (instances->size <= 0)
+      continue;
+    auto const& image = sprite->ImageFor(*instances);
+    auto const size = static_cast<int>(image.bitmap.width());
+    auto const half = size / 2.0f;
+    SpriteDraw draw = {
+      &image, static_cast<int>(::floor(instances->center_x - half)),
+      static_cast<int>(::floor(instances->center_y - half))
+    };
+    if (draw.left >= width || draw.left + size <= 0 || draw.top >= height ||
+        draw.top + size <= 0) {
+      continue;
+    }
+    sprite_draws_.push_back(draw);
+    for (auto band = first_band(draw); band <= last_band(draw); ++band)
+      ++band_starts_[band];
+  }
+  if (sprite_draws_.empty()) {
+    sprite->TrimImages();
+    return;
+  }
+
+  // Group sprites by band keeping their order. Ends of bands are filled
+  // backward into starts.
+  for (auto band = 1; band <= num_bands; ++band)
+    band_starts_[band] += band_starts_[band - 1];
+  band_draws_.resize(band_starts_[num_bands]);
+  for (auto index = sprite_draws_.size(); index-- > 0;) {
+    auto const& draw = sprite_draws_[index];
+    for (auto band = first_band(draw); band <= last_band(draw); ++band)
+      band_draws_[--band_starts_[band]] = index;
+  }
+
+  auto const src_over = blend::kernels().src_over;
+  for (auto band = 0; band < num_bands; ++band) {
+    auto const band_top = band * kBandHeight;
+    auto const band_bottom = std::min(band_top + kBandHeight, height);
+    for (auto position = band_starts_[band];
+         position < band_starts_[band + 1]; ++position) {
+      auto const& draw = sprite_draws_[band_draws_[position]];
+      auto const& image = *draw.image;
+      auto const bottom = std::min(
+          draw.top + static_cast<int>(image.bitmap.height()), band_bottom);
+      for (auto y = std::max(draw.top, band_top); y < bottom; ++y) {
+        auto const& span = image.spans[y - draw.top];
+        auto const left = std::max(draw.left + span.first, 0);
+        auto const right = std::min(draw.left + span.second, width);
+        if (left >= right)
+          continue;
+        src_over(bitmap_->row(y) + left,
+                 image.bitmap.row(y - draw.top) + (left - draw.left),
+                 right - left);
+      }
+    }
+  }
+  sprite->TrimImages();
+}
+
+void SoftwareCanvas::FillEllipse(float center_x, float center_y,
+                                 float radius, uint32_t color) {
+  auto const top = std::max(static_cast<int>(::ceil(center_y - radius - 0.5f)),
+                            0);
+  auto const bottom = std::min(
+      static_cast<int>(::floor(center_y + radius - 0.5f)),
+      static_cast<int>(bitmap_->height()) - 1);
+  for (auto y = top; y <= bottom; ++y) {
+    auto const dy = y + 0.5f - center_y;
+    auto const square = radius * radius - dy * dy;
+    if (square < 0)
+      continue;
+    auto const half_width = ::sqrt(square);
+    FillSpan(static_cast<int>(::ceil(center_x - half_width - 0.5f)),
+             static_cast<int>(::floor(center_x + half_width - 0.5f)) + 1,
+             y, color);
+  }
+}
+
+void SoftwareCanvas::FillRectangle(float left, float top, float right,
+                                   float bottom, uint32_t color) {
+  auto const first_y = std::max(static_cast<int>(::ceil(top - 0.5f)), 0);
+  auto const last_y = std::min(static_cast<int>(::ceil(bottom - 0.5f)),
+                               static_cast<int>(bitmap_->height()));
+  auto const first_x = static_cast<int>(::ceil(left - 0.5f));
+  auto const last_x = static_cast<int>(::ceil(right - 0.5f));
+  for (auto y = first_y; y < last_y; ++y)
+    FillSpan(first_x, last_x, y, color);
+}
+
+void SoftwareCanvas::FillSpan(int left, int right, int y, uint32_t color) {
+  left = std::max(left, 0);
+  right = std::min(right, static_cast<int>(bitmap_->width()));
+  if (left >= right)
+    return;
+  span_.resize(bitmap_->width());
+  std::fill(span_.begin(), span_.begin() + (right - left), color);
+  blend::SrcOver(bitmap_->row(y) + left, span_.data(), right - left);
+}
+
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_software_canvas_h)
@@ -0,0 +1,122 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_software_swap_chain_h)
+#define INCLUDE_gfx_software_swap_chain_h
+
+namespace gfx {
+
+//////////////////////////////////////////////////////////////////////
+//
+// SoftwareSwapChain
+// Software backend of |SwapChain|. Callers paint into |back_buffer()| and
+// |Present()| copies changed regions into |front_buffer()|. Back buffer
+// keeps contents of the last presented frame, so callers need to paint only
+// dirty rects.
+//
+class SoftwareSwapChain final {
+  private: SoftwareBitmap back_buffer_;
+  private: uint64_t copied_bytes_;
+  private: SoftwareBitmap front_buffer_;
+  private: bool needs_full_present_;
+
+  public: SoftwareSwapChain(size_t width, size_t height);
+  public: ~SoftwareSwapChain() = default;
+
+  public: SoftwareBitmap* back_buffer() { return &back_buffer_; }
+  // Total number of bytes copied by |Present()|.
+  public: uint64_t copied_bytes() const { return copied_bytes_; }
+  public: const SoftwareBitmap& front_buffer() const { return front_buffer_; }
+  public: bool needs_full_present() const { return needs_full_present_; }
+
+  public: void DidChangeBounds(size_t width, size_t height);
+  public: void Present();
+  // Presents whole back buffer if |params| is empty or this is the first
+  // present after resizing.
+  public: void Present(const PresentParams& params);
+
+  private: IntRect bounds() const;
+  private: void CopyRect(const SoftwareBitmap& source, const IntRect& rect,
+                         SoftwareBitmap* destination);
+  private: void Scroll(const PresentParams& params);
+
+  DISALLOW_COPY_AND_ASSIGN(SoftwareSwapChain);
+};
+
+SoftwareSwapChain::SoftwareSwapChain(size_t width, size_t height)
+    : back_buffer_(width, height), copied_bytes_(0),
+      front_buffer_(width, height), needs_full_present_(true) {
+}
+
+IntRect SoftwareSwapChain::bounds() const {
+  IntRect bounds = {
+    0, 0, static_cast<int>(back_buffer_.width()),
+    static_cast<int>(back_buffer_.height())
+  };
+  return bounds;
+}
+
+void SoftwareSwapChain::CopyRect(const SoftwareBitmap& source,
+                                 const IntRect& rect,
+                                 SoftwareBitmap* destination) {
+  auto const clipped = rect.Intersect(bounds());
+  if (clipped.IsEmpty())
+    return;
+  auto const row_bytes = clipped.width() * sizeof(uint32_t);
+  for (auto y = clipped.top; y < clipped.bottom; ++y) {
+    ::memcpy(destination->row(y) + clipped.left, source.row(y) + clipped.left,
+             row_bytes);
+  }
+  copied_bytes_ += row_bytes * clipped.height();
+}
+
+void SoftwareSwapChain::DidChangeBounds(size_t width, size_t height) {
+  back_buffer_.Resize(width, height);
+  front_buffer_.Resize(width, height);
+  needs_full_present_ = true;
+}
+
+void SoftwareSwapChain::Present() {
+  Present(PresentParams());
+}
+
+void SoftwareSwapChain::Present(const PresentParams& params) {
+  if (needs_full_present_ || params.is_full()) {
+    needs_full_present_ = false;
+    CopyRect(back_buffer_, bounds(), &front_buffer_);
+    return;
+  }
+  if (params.has_scroll())
+    Scroll(params);
+  for (auto const& rect : params.dirty_rects())
+    CopyRect(back_buffer_, rect, &front_buffer_);
+  // Back buffer doesn't have scrolled contents yet.
+  if (params.has_scroll())
+    CopyRect(front_buffer_, params.scroll_rect(), &back_buffer_);
+}
+
+// Moves contents of front buffer inside scroll rect. Rows are copied in
+// order not to overwrite source rows.
+void SoftwareSwapChain::Scroll(const PresentParams& params) {
+  auto const offset_x = params.scroll_offset_x();
+  auto const offset_y = params.scroll_offset_y();
+  auto const rect = params.scroll_rect().Intersect(bounds()).Intersect(
+      bounds().Offset(offset_x, offset_y));
+  if (rect.IsEmpty())
+    return;
+  auto const row_bytes = rect.width() * sizeof(uint32_t);
+  auto const first = offset_y > 0 ? rect.bottom - 1 : rect.top;
+  auto const step = offset_y > 0 ? -1 : 1;
+  for (auto count = 0; count < rect.height(); ++count) {
+    auto const y = first + step * count;
+    ::memmove(front_buffer_.row(y) + rect.left,
+              front_buffer_.row(y - offset_y) + rect.left - offset_x,
+              row_bytes);
+  }
+  copied_bytes_ += row_bytes * rect.height();
+}
+
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_software_swap_chain_h)
@@ -0,0 +1,43 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_gfx_sprite_h)
+#define INCLUDE_gfx_sprite_h
+
+namespace gfx {
+
+//////////////////////////////////////////////////////////////////////
+//
+// SpriteInstance
+// An instance of sprite for batched drawing. A sprite is drawn into square
+// of |size| * 2 centered at (|center_x|, |center_y|) and rotated |angle|
+// degrees clockwise around its center.
+//
+struct SpriteInstance {
+  float center_x;
+  float center_y;
+  float size;
+  float angle;
+  // Premultiplied BGRA tint color, 0xFFFFFFFF draws sprite as is.
+  uint32_t color;
+};
+
+// Returns premultiplied BGRA pixel value from straight color.
+uint32_t PremultipliedColor(float red, float green, float blue, float alpha);
+
+uint32_t PremultipliedColor(float red, float green, float blue, float alpha) {
+  auto const clamp = [](float value) {
+    return std::max(0.0f, std::min(value, 1.0f));
+  };
+  auto const scale = clamp(alpha) * 255.0f;
+  auto const channel = [=](float value) {
+    return static_cast<uint32_t>(clamp(value) * scale + 0.5f);
+  };
+  return (static_cast<uint32_t>(scale + 0.5f) << 24) |
+         (channel(red) << 16) | (channel(green) << 8) | channel(blue);
+}
+
+}  // namespace gfx
+
+#endif //!defined(INCLUDE_gfx_sprite_h)
@@ -0,0 +1,222 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures frame time of drawing CartoonCard balls with software canvas,
+// from 5 balls up to 100k balls. "per-ball" draws an ellipse and a rectangle
+// for each ball as CartoonCard::Ball::DoAnimate did, "batched" draws all
+// balls from one sprite with gfx::SoftwareCanvas::DrawSprites(). Images
+// of the sprite are cached before measuring.
+//
+// Returns EXIT_FAILURE if batched drawing differs from drawing cached
+// images one by one, or the sprite keeps more images than its limit.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. gfx\sprite_benchmark.cc
+//  g++ -std=c++11 -O2 -I. gfx/sprite_benchmark.cc -o sprite_benchmark
+//
+// Usage: sprite_benchmark [num_frames]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "gfx/blend.h"
+#include "gfx/sprite.h"
+#include "gfx/software_canvas.h"
+
+namespace {
+
+// Size of CartoonCard content in DemoApp.
+const size_t kCanvasWidth = 640;
+const size_t kCanvasHeight = 380;
+const size_t kSpriteSize = 64;
+
+std::vector<gfx::SpriteInstance> MakeBalls(size_t count) {
+  std::vector<gfx::SpriteInstance> balls(count);
+  uint32_t seed = 1;
+  for (auto& ball : balls) {
+    ball.size = base::RandomFloat(&seed, 10, 20);
+    ball.center_x = base::RandomFloat(&seed, ball.size,
+                                      kCanvasWidth - ball.size);
+    ball.center_y = base::RandomFloat(&seed, ball.size,
+                                      kCanvasHeight - ball.size);
+    ball.angle = base::RandomFloat(&seed, 0, 360);
+    ball.color = 0xFFFFFFFF;
+  }
+  return balls;
+}
+
+void MoveBalls(std::vector<gfx::SpriteInstance>* balls) {
+  for (auto& ball : *balls) {
+    ball.angle = ::fmod(ball.angle + 1, 360.0f);
+    ball.center_x = ::fmod(ball.center_x + 1, kCanvasWidth - 0.0f);
+  }
+}
+
+const uint32_t kBlue = gfx::PremultipliedColor(0, 0, 1, 0.5f);
+const uint32_t kGreen = gfx::PremultipliedColor(0, 0.5f, 0, 0.7f);
+const uint32_t kWhite = gfx::PremultipliedColor(1, 1, 1, 1);
+
+void PaintBall(gfx::SoftwareCanvas* canvas, float center_x, float center_y,
+               float size) {
+  canvas->FillEllipse(center_x, center_y, size, kBlue);
+  auto const rect_size = size * 0.5f;
+  canvas->FillRectangle(center_x - rect_size, center_y - rect_size,
+                        center_x + rect_size, center_y + rect_size, kGreen);
+}
+
+void PaintBallSprite(gfx::SoftwareSprite* sprite) {
+  gfx::SoftwareCanvas sprite_canvas(sprite->bitmap());
+  sprite_canvas.Clear(0);
+  PaintBall(&sprite_canvas, kSpriteSize / 2.0f, kSpriteSize / 2.0f,
+            kSpriteSize / 2.0f);
+  sprite->DidChangeBitmap();
+}
+
+// Caches images of all angles of sizes of |balls|.
+void WarmUp(gfx::SoftwareSprite* sprite, gfx::SoftwareCanvas* canvas,
+            const std::vector<gfx::SpriteInstance>& balls) {
+  std::vector<gfx::SpriteInstance> instances;
+  std::vector<bool> seen(kSpriteSize * 2);
+  for (auto const& ball : balls) {
+    auto const diameter = static_cast<size_t>(ball.size * 2 + 0.5f);
+    if (diameter >= seen.size() || seen[diameter])
+      continue;
+    seen[diameter] = true;
+    for (auto step = 0; step < gfx::SoftwareSprite::kNumAngles; ++step) {
+      auto instance = ball;
+      instance.angle = step * 360.0f / gfx::SoftwareSprite::kNumAngles;
+      instances.push_back(instance);
+    }
+  }
+  canvas->DrawSprites(sprite, instances.data(), instances.size());
+}
+
+double MeasurePerBall(size_t num_balls, size_t num_frames) {
+  gfx::SoftwareBitmap bitmap(kCanvasWidth, kCanvasHeight);
+  gfx::SoftwareCanvas canvas(&bitmap);
+  auto balls = MakeBalls(num_balls);
+  canvas.Clear(kWhite);
+  auto const start = base::TimeTicks::Now();
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    canvas.Clear(kWhite);
+    for (auto const& ball : balls)
+      PaintBall(&canvas, ball.center_x, ball.center_y, ball.size);
+    MoveBalls(&balls);
+  }
+  return (base::TimeTicks::Now() - start).InMillisecondsF() / num_frames;
+}
+
+double MeasureBatched(size_t num_balls, size_t num_frames) {
+  gfx::SoftwareSprite sprite(kSpriteSize, kSpriteSize);
+  PaintBallSprite(&sprite);
+  gfx::SoftwareBitmap bitmap(kCanvasWidth, kCanvasHeight);
+  gfx::SoftwareCanvas canvas(&bitmap);
+  auto balls = MakeBalls(num_balls);
+  WarmUp(&sprite, &canvas, balls);
+  auto const start = base::TimeTicks::Now();
+  for (auto frame = 0u; frame < num_frames; ++frame) {
+    canvas.Clear(kWhite);
+    canvas.DrawSprites(&sprite, balls.data(), balls.size());
+    MoveBalls(&balls);
+  }
+  return (base::TimeTicks::Now() - start).InMillisecondsF() / num_frames;
+}
+
+// Batched drawing composites the same pixels as drawing cached images in
+// order of instances, including instances outside of canvas.
+bool VerifyBatched() {
+  gfx::SoftwareSprite sprite(kSpriteSize, kSpriteSize);
+  PaintBallSprite(&sprite);
+  auto balls = MakeBalls(2000);
+  for (auto index = 0u; index < balls.size(); index += 10)
+    balls[index].center_x -= 30;
+  gfx::SoftwareBitmap batched(kCanvasWidth, kCanvasHeight);
+  gfx::SoftwareCanvas batched_canvas(&batched);
+  batched_canvas.Clear(kWhite);
+  batched_canvas.DrawSprites(&sprite, balls.data(), balls.size());
+  gfx::SoftwareBitmap expected(kCanvasWidth, kCanvasHeight);
+  gfx::SoftwareCanvas expected_canvas(&expected);
+  expected_canvas.Clear(kWhite);
+  for (auto const& ball : balls) {
+    auto const& image = sprite.ImageFor(ball).bitmap;
+    auto const half = image.width() / 2.0f;
+    expected_canvas.DrawBitmap(
+        image, static_cast<int>(::floor(ball.center_x - half)),
+        static_cast<int>(::floor(ball.center_y - half)));
+  }
+  return std::equal(batched.pixels(),
+                    batched.pixels() + kCanvasWidth * kCanvasHeight,
+                    expected.pixels());
+}
+
+// A sprite keeps recently used images within its limit.
+bool VerifyCacheLimit() {
+  auto const max_images_size = static_cast<size_t>(256 * 1024);
+  gfx::SoftwareSprite sprite(kSpriteSize, kSpriteSize, max_images_size);
+  PaintBallSprite(&sprite);
+  gfx::SoftwareBitmap bitmap(kCanvasWidth, kCanvasHeight);
+  gfx::SoftwareCanvas canvas(&bitmap);
+  auto balls = MakeBalls(100);
+  for (auto frame = 0; frame < 200; ++frame) {
+    MoveBalls(&balls);
+    canvas.DrawSprites(&sprite, balls.data(), balls.size());
+    if (sprite.images_size() > max_images_size)
+      return false;
+  }
+  // The last ball was drawn last, so its image is kept.
+  auto const num_images = sprite.num_images();
+  sprite.ImageFor(balls.back());
+  return num_images && sprite.num_images() == num_images;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const max_frames = argc >= 2 ? static_cast<size_t>(atoi(argv[1])) : 200;
+  std::cout << "ISA: " << gfx::blend::IsaName(gfx::blend::SupportedIsa())
+            << ", canvas " << kCanvasWidth << "x" << kCanvasHeight
+            << std::endl;
+  printf("%8s %14s %14s %8s\n", "balls", "per-ball ms", "batched ms",
+         "speedup");
+  const size_t ball_counts[] = {5, 50, 500, 5000, 20000, 50000, 100000};
+  for (auto const num_balls : ball_counts) {
+    // Keep total work roughly constant.
+    auto const num_frames = std::max(max_frames * 50 / (num_balls + 45),
+                                     static_cast<size_t>(3));
+    auto const per_ball = MeasurePerBall(num_balls, num_frames);
+    auto const batched = MeasureBatched(num_balls, num_frames);
+    printf("%8zu %14.3f %14.3f %7.2fx\n", num_balls, per_ball, batched,
+           per_ball / batched);
+  }
+
+  auto failed = false;
+  if (!VerifyBatched()) {
+    printf("FAILED: batched drawing differs from drawing one by one\n");
+    failed = true;
+  }
+  if (!VerifyCacheLimit()) {
+    printf("FAILED: sprite keeps images over its limit\n");
+    failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
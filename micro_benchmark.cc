@@ -0,0 +1,333 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Micro benchmarks of primitives used in every frame: geometry of gfx,
+// |base::TimeTicks::Now()|, |base::Sampling::AddSample()|,
+// |ui::Animation::GetDouble()|, integration and collision of CartoonCard
+// balls, and printCombination() of string_combination.cpp. Items per second
+// count points, samples, balls or printed lines.
+//
+// Results are printed as a table, or as CSV or JSON of Google benchmark by
+// --benchmark_format, and written to a file by --benchmark_out, for
+// tracking over time. See |base::BenchmarkRunner| for flags.
+//
+// Returns EXIT_FAILURE if a primitive returns a wrong result.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. micro_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. micro_benchmark.cc -o micro_benchmark
+//
+// Usage: micro_benchmark [--benchmark_format=json] [--benchmark_out=file]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(_WIN32)
+#include <windows.h>
+#include <d2d1.h>
+#undef max
+#undef min
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/metrics/sampling.h"
+#include "base/strings/csv.h"
+#include "base/test/benchmark.h"
+#include "base/test/random.h"
+#include "base/threading/thread_pool.h"
+#include "gfx/geometry.h"
+#include "physics/particle_store.h"
+#include "physics/uniform_grid.h"
+#include "physics/world.h"
+#include "ui/animation.h"
+
+#define STRING_COMBINATION_NO_MAIN
+#include "string_combination.cpp"
+
+namespace {
+
+const int kNumPoints = 1024;
+// Size of a card in DemoApp.
+const float kCardHeight = 480.0f;
+const float kCardWidth = 640.0f;
+
+std::vector<gfx::PointF> MakePoints() {
+  std::vector<gfx::PointF> points;
+  uint32_t seed = 1;
+  for (auto index = 0; index < kNumPoints; ++index) {
+    points.push_back(gfx::PointF(base::RandomFloat(&seed, 0, kCardWidth),
+                                 base::RandomFloat(&seed, 0, kCardHeight)));
+  }
+  return points;
+}
+
+physics::Bounds MakeBalls(int64_t count, physics::ParticleStore* balls) {
+  uint32_t seed = 1;
+  for (auto index = 0; index < count; ++index) {
+    auto const radius = base::RandomFloat(&seed, 10, 20);
+    auto const x = base::RandomFloat(&seed, radius, kCardWidth - radius);
+    auto const y = base::RandomFloat(&seed, radius, kCardHeight - radius);
+    auto const vx = base::RandomFloat(&seed, -2, 2);
+    auto const vy = base::RandomFloat(&seed, -2, 2);
+    balls->Add(x, y, vx, vy, radius, 0.0f);
+  }
+  physics::Bounds bounds = {0.0f, 0.0f, kCardWidth, kCardHeight};
+  return bounds;
+}
+
+bool AreBallsInBounds(const physics::ParticleStore& balls,
+                      const physics::Bounds& bounds) {
+  for (auto index = 0u; index < balls.size(); ++index) {
+    if (balls.xs()[index] < bounds.left ||
+        balls.xs()[index] > bounds.right ||
+        balls.ys()[index] < bounds.top ||
+        balls.ys()[index] > bounds.bottom) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Collisions are found after the last move, which doesn't move balls, so
+// balls hit at the last step overlap.
+bool AreFirstHitsOverlapped(const physics::World& world) {
+  auto const& balls = world.particles();
+  for (auto index = 0u; index < balls.size(); ++index) {
+    auto const other = world.first_hits()[index];
+    if (other < 0)
+      continue;
+    auto const dx = balls.xs()[index] - balls.xs()[other];
+    auto const dy = balls.ys()[index] - balls.ys()[other];
+    auto const distance = balls.radii()[index] + balls.radii()[other];
+    if (dx * dx + dy * dy > distance * distance)
+      return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// NullAnimatable
+//
+class NullAnimatable final : public ui::Animatable {
+  public: NullAnimatable() = default;
+  public: virtual ~NullAnimatable() = default;
+
+  // ui::Animatable
+  private: virtual void DidFinishAnimation() override {}
+  private: virtual void DidFireAnimationTimer() override {}
+
+  DISALLOW_COPY_AND_ASSIGN(NullAnimatable);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// gfx
+//
+void BM_PointFDistance(base::BenchmarkState* state) {
+  if (gfx::PointF(1, 2).Distance(gfx::PointF(4, 6)) != 5.0f)
+    state->SkipWithError("wrong distance");
+  auto const points = MakePoints();
+  while (state->KeepRunning()) {
+    auto sum = 0.0f;
+    for (auto index = 1; index < kNumPoints; ++index)
+      sum += points[index].Distance(points[index - 1]);
+    base::DoNotOptimize(sum);
+  }
+  state->SetItemsProcessed(state->iterations() * (kNumPoints - 1));
+}
+BENCHMARK(BM_PointFDistance);
+
+// Bounds of a ball moved and deflated, as painting a card does.
+void BM_RectFArithmetic(base::BenchmarkState* state) {
+  auto const check = gfx::RectF(gfx::PointF(1, 2), gfx::SizeF(10, 20))
+      .Offset(gfx::SizeF(3, 4)) - 1.0f;
+  if (check != gfx::RectF(5, 7, 13, 25))
+    state->SkipWithError("wrong rectangle");
+  auto const points = MakePoints();
+  while (state->KeepRunning()) {
+    auto sum = 0.0f;
+    for (auto const& point : points) {
+      auto const rect = gfx::RectF(point - gfx::SizeF(10, 10),
+                                   gfx::SizeF(20, 20))
+          .Offset(gfx::SizeF(1.5f, -1.5f)) - 2.0f;
+      sum += rect.left() + rect.width();
+    }
+    base::DoNotOptimize(sum);
+  }
+  state->SetItemsProcessed(state->iterations() * kNumPoints);
+}
+BENCHMARK(BM_RectFArithmetic);
+
+void BM_RectFContains(base::BenchmarkState* state) {
+  auto const bounds = gfx::RectF(100, 100, kCardWidth - 100,
+                                 kCardHeight - 100);
+  auto const points = MakePoints();
+  auto expected = 0;
+  for (auto const& point : points) {
+    if (point.x() >= 100 && point.x() < kCardWidth - 100 &&
+        point.y() >= 100 && point.y() < kCardHeight - 100) {
+      ++expected;
+    }
+  }
+  while (state->KeepRunning()) {
+    auto count = 0;
+    for (auto const& point : points)
+      count += bounds.Contains(point);
+    if (count != expected)
+      state->SkipWithError("wrong containment");
+    base::DoNotOptimize(count);
+  }
+  state->SetItemsProcessed(state->iterations() * kNumPoints);
+}
+BENCHMARK(BM_RectFContains);
+
+//////////////////////////////////////////////////////////////////////
+//
+// base
+//
+void BM_TimeTicksNow(base::BenchmarkState* state) {
+  auto last = base::TimeTicks::Now();
+  while (state->KeepRunning()) {
+    auto const now = base::TimeTicks::Now();
+    if (now < last)
+      state->SkipWithError("time goes backward");
+    last = now;
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+BENCHMARK(BM_TimeTicksNow);
+
+// Argument is capacity of the window.
+void BM_SamplingAddSample(base::BenchmarkState* state) {
+  base::Sampling check(3);
+  for (auto const sample : {5.0f, 1.0f, 4.0f, 2.0f})
+    check.AddSample(sample);
+  if (check.minimum() != 1.0f || check.maximum() != 4.0f)
+    state->SkipWithError("wrong minimum or maximum");
+  std::vector<float> samples;
+  uint32_t seed = 1;
+  for (auto index = 0; index < kNumPoints; ++index)
+    samples.push_back(base::RandomFloat(&seed, 10, 20));
+  base::Sampling sampling(static_cast<size_t>(state->arg()));
+  while (state->KeepRunning()) {
+    for (auto const sample : samples)
+      sampling.AddSample(sample);
+  }
+  base::DoNotOptimize(sampling.maximum());
+  state->SetItemsProcessed(state->iterations() * kNumPoints);
+}
+BENCHMARK(BM_SamplingAddSample)->Arg(100)->Arg(4096);
+
+//////////////////////////////////////////////////////////////////////
+//
+// ui
+//
+void BM_AnimationGetDouble(base::BenchmarkState* state) {
+  NullAnimatable animatable;
+  ui::Animation::Timing timing;
+  timing.duration = base::TimeDelta::FromMilliseconds(1000);
+  ui::Animation animation(&animatable, timing);
+  std::unique_ptr<ui::Animation::Variable> variable(
+      animation.CreateVariable(10.0, 20.0));
+  auto const start = base::TimeTicks::Now();
+  animation.Start(start);
+  animation.Play(start + base::TimeDelta::FromMilliseconds(500));
+  if (animation.GetDouble(variable.get()) != 15.0)
+    state->SkipWithError("wrong value at half of duration");
+  // Keeps the compiler from computing the value out of the loop.
+  base::DoNotOptimize(&animation);
+  while (state->KeepRunning())
+    base::DoNotOptimize(animation.GetDouble(variable.get()));
+  state->SetItemsProcessed(state->iterations());
+}
+BENCHMARK(BM_AnimationGetDouble);
+
+//////////////////////////////////////////////////////////////////////
+//
+// physics
+// Argument is number of balls in a card.
+//
+void BM_BallIntegration(base::BenchmarkState* state) {
+  physics::ParticleStore balls;
+  auto const bounds = MakeBalls(state->arg(), &balls);
+  while (state->KeepRunning())
+    balls.Step(bounds, 1);
+  if (!AreBallsInBounds(balls, bounds))
+    state->SkipWithError("ball out of bounds");
+  state->SetItemsProcessed(state->iterations() * state->arg());
+}
+BENCHMARK(BM_BallIntegration)->Arg(5)->Arg(100)->Arg(1000);
+
+void BM_BallCollision(base::BenchmarkState* state) {
+  physics::World world;
+  auto const bounds = MakeBalls(state->arg(), world.mutable_particles());
+  while (state->KeepRunning())
+    world.Step(bounds, 1);
+  if (!AreFirstHitsOverlapped(world))
+    state->SkipWithError("hit without overlap");
+  state->SetItemsProcessed(state->iterations() * state->arg());
+}
+BENCHMARK(BM_BallCollision)->Arg(5)->Arg(100)->Arg(1000);
+
+//////////////////////////////////////////////////////////////////////
+//
+// string_combination
+// Argument is length of string. Output goes to the null device.
+//
+void BM_PrintCombination(base::BenchmarkState* state) {
+  std::string text;
+  for (auto index = 0; index < state->arg(); ++index)
+    text.push_back(static_cast<char>('a' + index));
+  auto const num_lines = (static_cast<int64_t>(1) << state->arg()) - 1;
+  if (auto const check = ::tmpfile()) {
+    printCombination(text.c_str(), check);
+    ::rewind(check);
+    auto count = static_cast<int64_t>(0);
+    for (auto ch = ::fgetc(check); ch != EOF; ch = ::fgetc(check))
+      count += ch == '\n';
+    ::fclose(check);
+    if (count != num_lines)
+      state->SkipWithError("wrong number of combinations");
+  }
+#if defined(_WIN32)
+  auto const null_file = ::fopen("NUL", "w");
+#else
+  auto const null_file = ::fopen("/dev/null", "w");
+#endif
+  while (state->KeepRunning())
+    printCombination(text.c_str(), null_file);
+  ::fclose(null_file);
+  state->SetItemsProcessed(state->iterations() * num_lines);
+}
+BENCHMARK(BM_PrintCombination)->Arg(4)->Arg(8)->Arg(12);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::BenchmarkRunner runner;
+  if (!runner.Init(argc, argv))
+    return EXIT_FAILURE;
+  return runner.Run();
+}
@@ -0,0 +1,199 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures collision detection of CartoonCard balls per step with
+// |physics::UniformGrid| and with testing all pairs, from 100 balls up to
+// 1M balls. Balls keep the same density, e.g. world grows with number of
+// balls. Grid results are checked against all pairs up to 10k balls, and
+// for balls on a line.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. physics\collision_benchmark.cc
+//  g++ -std=c++11 -O2 -I. physics/collision_benchmark.cc -o collision_benchmark
+//
+// Usage: collision_benchmark [num_steps]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "physics/uniform_grid.h"
+
+namespace {
+
+// World area per ball in square pixels. A ball covers about 700 square
+// pixels.
+const float kAreaPerBall = 4000.0f;
+const size_t kMaxAllPairs = 10000;
+const double kFrameMilliseconds = 1000.0 / 60;
+
+struct Balls {
+  std::vector<float> xs;
+  std::vector<float> ys;
+  std::vector<float> motion_xs;
+  std::vector<float> motion_ys;
+  std::vector<float> radii;
+  float size;
+};
+
+Balls MakeBalls(size_t count) {
+  Balls balls;
+  balls.size = ::sqrt(kAreaPerBall * count);
+  uint32_t seed = 1;
+  for (auto index = 0u; index < count; ++index) {
+    auto const radius = base::RandomFloat(&seed, 10, 20);
+    balls.radii.push_back(radius);
+    balls.xs.push_back(base::RandomFloat(&seed, radius, balls.size - radius));
+    balls.ys.push_back(base::RandomFloat(&seed, radius, balls.size - radius));
+    balls.motion_xs.push_back(base::RandomFloat(&seed, -2, 2));
+    balls.motion_ys.push_back(base::RandomFloat(&seed, -2, 2));
+  }
+  return balls;
+}
+
+void MoveBalls(Balls* balls) {
+  for (auto index = 0u; index < balls->xs.size(); ++index) {
+    balls->xs[index] += balls->motion_xs[index];
+    balls->ys[index] += balls->motion_ys[index];
+    if (balls->xs[index] < 0 || balls->xs[index] >= balls->size)
+      balls->motion_xs[index] = -balls->motion_xs[index];
+    if (balls->ys[index] < 0 || balls->ys[index] >= balls->size)
+      balls->motion_ys[index] = -balls->motion_ys[index];
+  }
+}
+
+// Reference of |UniformGrid::FindFirstHits()| as CartoonCard::DoAnimate
+// did, but with squared distance.
+void FindFirstHitsAllPairs(const Balls& balls, int* first_hits) {
+  auto const count = balls.xs.size();
+  for (auto index = 0u; index < count; ++index) {
+    first_hits[index] = -1;
+    for (auto other = 0u; other < count; ++other) {
+      if (other == index)
+        continue;
+      auto const dx = balls.xs[other] - balls.xs[index];
+      auto const dy = balls.ys[other] - balls.ys[index];
+      auto const limit = std::max(balls.radii[index], balls.radii[other]);
+      if (dx * dx + dy * dy > limit * limit)
+        continue;
+      first_hits[index] = static_cast<int>(other);
+      break;
+    }
+  }
+}
+
+void FindFirstHitsGrid(physics::UniformGrid* grid, const Balls& balls,
+                       int* first_hits) {
+  grid->Build(balls.xs.data(), balls.ys.data(), balls.radii.data(),
+              balls.xs.size());
+  grid->FindFirstHits(first_hits);
+}
+
+bool Verify(size_t num_balls) {
+  auto balls = MakeBalls(num_balls);
+  physics::UniformGrid grid;
+  std::vector<int> expected(num_balls);
+  std::vector<int> actual(num_balls);
+  for (auto step = 0; step < 10; ++step) {
+    FindFirstHitsAllPairs(balls, expected.data());
+    FindFirstHitsGrid(&grid, balls, actual.data());
+    if (expected != actual)
+      return false;
+    MoveBalls(&balls);
+  }
+  return true;
+}
+
+// Checks balls on a horizontal line far apart, whose bounding box has no
+// area, against all pairs, and that the grid doesn't have a column for
+// each radius of the line.
+bool VerifyCollinear() {
+  const size_t kNumBalls = 1000;
+  Balls balls;
+  balls.size = 0;
+  for (auto index = 0u; index < kNumBalls; ++index) {
+    // Balls are in pairs, which collide.
+    balls.radii.push_back(10);
+    balls.xs.push_back((index / 2) * 1e6f + (index % 2) * 5);
+    balls.ys.push_back(100);
+  }
+  physics::UniformGrid grid;
+  std::vector<int> expected(kNumBalls);
+  std::vector<int> actual(kNumBalls);
+  FindFirstHitsAllPairs(balls, expected.data());
+  FindFirstHitsGrid(&grid, balls, actual.data());
+  return expected == actual && grid.num_cells() <= kNumBalls * 4 + 17;
+}
+
+// Returns milliseconds per step. |num_hits| gets number of colliding balls
+// in the last step.
+template<typename Function>
+double Measure(size_t num_balls, size_t num_steps, const Function& function,
+               size_t* num_hits) {
+  auto balls = MakeBalls(num_balls);
+  std::vector<int> first_hits(num_balls);
+  auto elapsed = 0.0;
+  for (auto step = 0u; step < num_steps; ++step) {
+    auto const start = base::TimeTicks::Now();
+    function(balls, first_hits.data());
+    elapsed += (base::TimeTicks::Now() - start).InMillisecondsF();
+    MoveBalls(&balls);
+  }
+  *num_hits = static_cast<size_t>(std::count_if(
+      first_hits.begin(), first_hits.end(),
+      [](int hit) { return hit >= 0; }));
+  return elapsed / num_steps;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const max_steps = argc >= 2 ? static_cast<size_t>(atoi(argv[1])) : 100;
+  printf("%8s %8s %12s %12s %10s %8s\n", "balls", "hits", "grid ms",
+         "all-pairs ms", "speedup", "60Hz");
+  const size_t ball_counts[] = {100, 1000, 10000, 100000, 1000000};
+  physics::UniformGrid grid;
+  auto failed = false;
+  if (!VerifyCollinear()) {
+    printf("FAILED: wrong hits or too many cells of balls on a line\n");
+    failed = true;
+  }
+  for (auto const num_balls : ball_counts) {
+    if (num_balls <= kMaxAllPairs && !Verify(num_balls)) {
+      printf("%8zu MISMATCH\n", num_balls);
+      failed = true;
+      continue;
+    }
+    // Keep total work roughly constant.
+    auto const num_steps = std::max(max_steps * 10000 / num_balls,
+                                    static_cast<size_t>(3));
+    size_t num_hits = 0;
+    auto const grid_ms = Measure(num_balls, num_steps,
+        [&](const Balls& balls, int* first_hits) {
+          FindFirstHitsGrid(&grid, balls, first_hits);
+        }, &num_hits);
+    printf("%8zu %8zu %12.3f", num_balls, num_hits, grid_ms);
+    if (num_balls <= kMaxAllPairs) {
+      auto const all_pairs_ms = Measure(num_balls,
+          std::max(num_steps / 100, static_cast<size_t>(1)),
+          FindFirstHitsAllPairs, &num_hits);
+      printf(" %12.3f %9.1fx", all_pairs_ms, all_pairs_ms / grid_ms);
+    } else {
+      printf(" %12s %10s", "-", "-");
+    }
+    printf(" %8s\n", grid_ms <= kFrameMilliseconds ? "yes" : "no");
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
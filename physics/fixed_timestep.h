@@ -0,0 +1,64 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_physics_fixed_timestep_h)
+#define INCLUDE_physics_fixed_timestep_h
+
+namespace physics {
+
+//////////////////////////////////////////////////////////////////////
+//
+// FixedTimestep
+// Accumulates frame time and returns number of fixed steps to simulate.
+// Time left in accumulator is used for interpolating between the previous
+// step and the last step, e.g. |alpha()|.
+//
+// We drop time more than |max_steps| steps, e.g. after the window is
+// restored, to simulate a late frame in bounded time.
+//
+class FixedTimestep final {
+  private: int64_t accumulated_;
+  private: base::TimeTicks last_time_;
+  private: int max_steps_;
+  private: int64_t step_;
+
+  public: FixedTimestep(base::TimeDelta step, int max_steps);
+  public: ~FixedTimestep() = default;
+
+  public: float alpha() const;
+
+  // Returns number of steps to advance simulation to |now|.
+  public: int Advance(base::TimeTicks now);
+  public: void Reset(base::TimeTicks now);
+
+  DISALLOW_COPY_AND_ASSIGN(FixedTimestep);
+};
+
+FixedTimestep::FixedTimestep(base::TimeDelta step, int max_steps)
+    : accumulated_(0), max_steps_(max_steps),
+      step_(std::max(step.InMicroseconds(), static_cast<int64_t>(1))) {
+}
+
+float FixedTimestep::alpha() const {
+  return static_cast<float>(accumulated_) / step_;
+}
+
+int FixedTimestep::Advance(base::TimeTicks now) {
+  accumulated_ += std::max((now - last_time_).InMicroseconds(),
+                           static_cast<int64_t>(0));
+  last_time_ = now;
+  auto const num_steps = accumulated_ / step_;
+  accumulated_ -= num_steps * step_;
+  return static_cast<int>(std::min(num_steps,
+                                   static_cast<int64_t>(max_steps_)));
+}
+
+void FixedTimestep::Reset(base::TimeTicks now) {
+  accumulated_ = 0;
+  last_time_ = now;
+}
+
+}  // namespace physics
+
+#endif //!defined(INCLUDE_physics_fixed_timestep_h)
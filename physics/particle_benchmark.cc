@@ -0,0 +1,153 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures frame time of moving balls with |physics::ParticleStore| against
+// heap allocated balls moved by scalar loop, as CartoonCard::Ball did, for
+// frames of one step and late frames of many steps. Positions are checked
+// against the scalar loop.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. physics\particle_benchmark.cc
+//  g++ -std=c++11 -O2 -I. physics/particle_benchmark.cc -o particle_benchmark
+//
+// Usage: particle_benchmark [num_frames]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "physics/particle_store.h"
+
+namespace {
+
+const physics::Bounds kBounds = {0.0f, 0.0f, 1280.0f, 720.0f};
+
+// A ball as CartoonCard::Ball, allocated separately.
+class Ball final {
+  public: float angle_;
+  public: float radius_;
+  public: float vx_;
+  public: float vy_;
+  public: float x_;
+  public: float y_;
+
+  public: Ball(float x, float y, float vx, float vy, float radius,
+               float angle)
+      : angle_(angle), radius_(radius), vx_(vx), vy_(vy), x_(x), y_(y) {
+  }
+
+  public: void DoAnimate(const physics::Bounds& bounds, int num_steps) {
+    auto const min_x = bounds.left + radius_;
+    auto const max_x = bounds.right - radius_;
+    auto const min_y = bounds.top + radius_;
+    auto const max_y = bounds.bottom - radius_;
+    for (auto step = 0; step < num_steps; ++step) {
+      x_ += vx_;
+      y_ += vy_;
+      if (x_ < min_x || x_ >= max_x)
+        vx_ = -vx_;
+      if (y_ < min_y || y_ >= max_y)
+        vy_ = -vy_;
+    }
+    angle_ = ::fmod(angle_ + num_steps, 360.0f);
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(Ball);
+};
+
+void MakeBalls(size_t count, std::vector<std::unique_ptr<Ball>>* balls,
+               physics::ParticleStore* store) {
+  uint32_t seed = 1;
+  for (auto index = 0u; index < count; ++index) {
+    auto const radius = base::RandomFloat(&seed, 10, 20);
+    auto const x = base::RandomFloat(&seed, radius, kBounds.right - radius);
+    auto const y = base::RandomFloat(&seed, radius, kBounds.bottom - radius);
+    auto const vx = base::RandomFloat(&seed, -2, 2);
+    auto const vy = base::RandomFloat(&seed, -2, 2);
+    auto const angle = static_cast<float>(base::NextRandom(&seed) % 360);
+    balls->push_back(std::unique_ptr<Ball>(
+        new Ball(x, y, vx, vy, radius, angle)));
+    store->Add(x, y, vx, vy, radius, angle);
+  }
+}
+
+bool Verify(size_t num_balls) {
+  std::vector<std::unique_ptr<Ball>> balls;
+  physics::ParticleStore store;
+  MakeBalls(num_balls, &balls, &store);
+  for (auto frame = 0; frame < 100; ++frame) {
+    auto const num_steps = frame % 7 + 1;
+    for (auto& ball : balls)
+      ball->DoAnimate(kBounds, num_steps);
+    store.Step(kBounds, num_steps);
+  }
+  for (auto index = 0u; index < num_balls; ++index) {
+    auto const& ball = *balls[index];
+    if (ball.x_ != store.xs()[index] || ball.y_ != store.ys()[index] ||
+        ball.vx_ != store.vxs()[index] || ball.vy_ != store.vys()[index] ||
+        ball.angle_ != store.angles()[index]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns milliseconds per frame.
+template<typename Function>
+double Measure(size_t num_frames, const Function& function) {
+  auto const start = base::TimeTicks::Now();
+  for (auto frame = 0u; frame < num_frames; ++frame)
+    function();
+  return (base::TimeTicks::Now() - start).InMillisecondsF() / num_frames;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const max_frames = argc >= 2 ? static_cast<size_t>(atoi(argv[1])) : 100;
+  printf("%8s %6s %12s %12s %10s %8s\n", "balls", "steps", "scalar ms",
+         "SoA ms", "ns/step", "speedup");
+  const size_t ball_counts[] = {1000, 10000, 100000, 1000000};
+  const int step_counts[] = {1, 4, 8};
+  auto failed = false;
+  for (auto const num_balls : ball_counts) {
+    if (!Verify(std::min(num_balls, static_cast<size_t>(10003)))) {
+      printf("%8zu MISMATCH\n", num_balls);
+      failed = true;
+      continue;
+    }
+    std::vector<std::unique_ptr<Ball>> balls;
+    physics::ParticleStore store;
+    MakeBalls(num_balls, &balls, &store);
+    // Keep total work roughly constant.
+    auto const num_frames = std::max(max_frames * 100000 / num_balls,
+                                     static_cast<size_t>(3));
+    for (auto const num_steps : step_counts) {
+      auto const scalar_ms = Measure(num_frames, [&]() {
+        for (auto& ball : balls)
+          ball->DoAnimate(kBounds, num_steps);
+      });
+      auto const store_ms = Measure(num_frames, [&]() {
+        store.Step(kBounds, num_steps);
+      });
+      printf("%8zu %6d %12.3f %12.3f %10.3f %7.2fx\n", num_balls, num_steps,
+             scalar_ms, store_ms,
+             store_ms * 1e6 / (num_balls * num_steps), scalar_ms / store_ms);
+    }
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_physics_particle_store_h)
+#define INCLUDE_physics_particle_store_h
+
+namespace physics {
+
+//////////////////////////////////////////////////////////////////////
+//
+// Bounds
+//
+struct Bounds {
+  float left;
+  float top;
+  float right;
+  float bottom;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// ParticleStore
+// Circles moving in bounds, stored as structure of arrays. |Step()|
+// advances all particles with SSE2, four particles at once, and keeps
+// positions before the last step for render interpolation.
+//
+// A particle reverses its motion along an axis when its center goes out of
+// |Bounds| deflated by its radius, as CartoonCard::Ball did.
+//
+class ParticleStore final {
+  private: std::vector<float> angles_;
+  private: std::vector<float> previous_angles_;
+  private: std::vector<float> previous_xs_;
+  private: std::vector<float> previous_ys_;
+  private: std::vector<float> radii_;
+  // Degrees per step.
+  private: std::vector<float> spins_;
+  private: std::vector<float> vxs_;
+  private: std::vector<float> vys_;
+  private: std::vector<float> xs_;
+  private: std::vector<float> ys_;
+
+  public: ParticleStore() = default;
+  public: ~ParticleStore() = default;
+
+  public: const float* angles() const { return angles_.data(); }
+  public: const float* radii() const { return radii_.data(); }
+  public: size_t size() const { return xs_.size(); }
+  public: const float* vxs() const { return vxs_.data(); }
+  public: const float* vys() const { return vys_.data(); }
+  public: const float* xs() const { return xs_.data(); }
+  public: const float* ys() const { return ys_.data(); }
+
+  public: size_t Add(float x, float y, float vx, float vy, float radius,
+                     float angle, float spin = 1.0f);
+  // Moves particles into |bounds| if they are out of right or bottom, e.g.
+  // after resizing.
+  public: void ClampInto(const Bounds& bounds);
+  public: void Clear();
+  // Stores positions and angles between the previous step and the last
+  // step, |alpha| is zero for the previous step and one for the last step.
+  public: void Interpolate(float alpha, float* xs, float* ys,
+                           float* angles) const;
+  public: void ReverseMotion(size_t index);
+  // Advances |num_steps| steps in one pass, particles are kept in
+  // registers during steps.
+  public: void Step(const Bounds& bounds, int num_steps);
+  // Same as |Step()| for particles in [|start|, |end|). Particles are
+  // independent, so callers can step ranges on different threads.
+  public: void StepRange(const Bounds& bounds, int num_steps, size_t start,
+                         size_t end);
+
+  private: void StepScalar(const Bounds& bounds, int num_steps, size_t start,
+                           size_t end);
+
+  DISALLOW_COPY_AND_ASSIGN(ParticleStore);
+};
+
+size_t ParticleStore::Add(float x, float y, float vx, float vy, float radius,
+                          float angle, float spin) {
+  angles_.push_back(angle);
+  previous_angles_.push_back(angle);
+  previous_xs_.push_back(x);
+  previous_ys_.push_back(y);
+  radii_.push_back(radius);
+  spins_.push_back(spin);
+  vxs_.push_back(vx);
+  vys_.push_back(vy);
+  xs_.push_back(x);
+  ys_.push_back(y);
+  return xs_.size() - 1;
+}
+
+void ParticleStore::ClampInto(const Bounds& bounds) {
+  for (auto index = 0u; index < size(); ++index) {
+    xs_[index] = std::min(xs_[index], bounds.right - radii_[index]);
+    ys_[index] = std::min(ys_[index], bounds.bottom - radii_[index]);
+    previous_xs_[index] = xs_[index];
+    previous_ys_[index] = ys_[index];
+  }
+}
+
+void ParticleStore::Clear() {
+  angles_.clear();
+  previous_angles_.clear();
+  previous_xs_.clear();
+  previous_ys_.clear();
+  radii_.clear();
+  spins_.clear();
+  vxs_.clear();
+  vys_.clear();
+  xs_.clear();
+  ys_.clear();
+}
+
+void ParticleStore::Interpolate(float alpha, float* xs, float* ys,
+                                float* angles) const {
+  for (auto index = 0u; index < size(); ++index) {
+    xs[index] = previous_xs_[index] +
+                (xs_[index] - previous_xs_[index]) * alpha;
+    ys[index] = previous_ys_[index] +
+                (ys_[index] - previous_ys_[index]) * alpha;
+    // Angle wraps around at 360 degrees.
+    auto delta = angles_[index] - previous_angles_[index];
+    if (delta < -180.0f)
+      delta += 360.0f;
+    angles[index] = previous_angles_[index] + delta * alpha;
+  }
+}
+
+void ParticleStore::ReverseMotion(size_t index) {
+  vxs_[index] = -vxs_[index];
+  vys_[index] = -vys_[index];
+}
+
+void ParticleStore::Step(const Bounds& bounds, int num_steps) {
+  StepRange(bounds, num_steps, 0, size());
+}
+
+void ParticleStore::StepRange(const Bounds& bounds, int num_steps,
+                              size_t start, size_t end) {
+  if (num_steps <= 0)
+    return;
+  auto const vector_end = start + ((end - start) & ~static_cast<size_t>(3));
+  auto const left = _mm_set1_ps(bounds.left);
+  auto const top = _mm_set1_ps(bounds.top);
+  auto const right = _mm_set1_ps(bounds.right);
+  auto const bottom = _mm_set1_ps(bounds.bottom);
+  auto const sign = _mm_set1_ps(-0.0f);
+  auto const full_turn = _mm_set1_ps(360.0f);
+  for (auto index = start; index < vector_end; index += 4) {
+    auto const radius = _mm_loadu_ps(&radii_[index]);
+    auto const min_x = _mm_add_ps(left, radius);
+    auto const max_x = _mm_sub_ps(right, radius);
+    auto const min_y = _mm_add_ps(top, radius);
+    auto const max_y = _mm_sub_ps(bottom, radius);
+    auto const spin = _mm_loadu_ps(&spins_[index]);
+    auto x = _mm_loadu_ps(&xs_[index]);
+    auto y = _mm_loadu_ps(&ys_[index]);
+    auto vx = _mm_loadu_ps(&vxs_[index]);
+    auto vy = _mm_loadu_ps(&vys_[index]);
+    auto angle = _mm_loadu_ps(&angles_[index]);
+    auto previous_x = x;
+    auto previous_y = y;
+    auto previous_angle = angle;
+    for (auto step = 0; step < num_steps; ++step) {
+      previous_x = x;
+      previous_y = y;
+      previous_angle = angle;
+      x = _mm_add_ps(x, vx);
+      y = _mm_add_ps(y, vy);
+      auto const out_x = _mm_or_ps(_mm_cmplt_ps(x, min_x),
+                                   _mm_cmpge_ps(x, max_x));
+      auto const out_y = _mm_or_ps(_mm_cmplt_ps(y, min_y),
+                                   _mm_cmpge_ps(y, max_y));
+      vx = _mm_xor_ps(vx, _mm_and_ps(out_x, sign));
+      vy = _mm_xor_ps(vy, _mm_and_ps(out_y, sign));
+      angle = _mm_add_ps(angle, spin);
+      angle = _mm_sub_ps(angle, _mm_and_ps(_mm_cmpge_ps(angle, full_turn),
+                                           full_turn));
+    }
+    _mm_storeu_ps(&previous_xs_[index], previous_x);
+    _mm_storeu_ps(&previous_ys_[index], previous_y);
+    _mm_storeu_ps(&previous_angles_[index], previous_angle);
+    _mm_storeu_ps(&xs_[index], x);
+    _mm_storeu_ps(&ys_[index], y);
+    _mm_storeu_ps(&vxs_[index], vx);
+    _mm_storeu_ps(&vys_[index], vy);
+    _mm_storeu_ps(&angles_[index], angle);
+  }
+  StepScalar(bounds, num_steps, vector_end, end);
+}
+
+// Same as |StepRange()| without SIMD, e.g. for tail of range.
+void ParticleStore::StepScalar(const Bounds& bounds, int num_steps,
+                               size_t start, size_t end) {
+  for (auto index = start; index < end; ++index) {
+    auto const radius = radii_[index];
+    auto const min_x = bounds.left + radius;
+    auto const max_x = bounds.right - radius;
+    auto const min_y = bounds.top + radius;
+    auto const max_y = bounds.bottom - radius;
+    for (auto step = 0; step < num_steps; ++step) {
+      previous_xs_[index] = xs_[index];
+      previous_ys_[index] = ys_[index];
+      previous_angles_[index] = angles_[index];
+      xs_[index] += vxs_[index];
+      ys_[index] += vys_[index];
+      if (xs_[index] < min_x || xs_[index] >= max_x)
+        vxs_[index] = -vxs_[index];
+      if (ys_[index] < min_y || ys_[index] >= max_y)
+        vys_[index] = -vys_[index];
+      angles_[index] += spins_[index];
+      if (angles_[index] >= 360.0f)
+        angles_[index] -= 360.0f;
+    }
+  }
+}
+
+}  // namespace physics
+
+#endif //!defined(INCLUDE_physics_particle_store_h)
@@ -0,0 +1,208 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_physics_uniform_grid_h)
+#define INCLUDE_physics_uniform_grid_h
+
+namespace physics {
+
+//////////////////////////////////////////////////////////////////////
+//
+// UniformGrid
+// Broad-phase collision detection of circles. Two circles collide when
+// distance of their centers is less than or equal to the larger radius.
+// Cell size is the largest radius, so colliding circles are always in the
+// same cell or adjacent cells.
+//
+// |Build()| places circles into cells by counting sort in O(n + cells),
+// we rebuild grid in each step rather than updating cells incrementally.
+//
+class UniformGrid final {
+  // Items sorted by cell, |cell_starts_[cell]| is the first item of |cell|
+  // and |cell_starts_[cell + 1]| is end of items.
+  private: std::vector<uint32_t> cell_items_;
+  private: std::vector<float> cell_radii_;
+  private: float cell_size_;
+  private: std::vector<uint32_t> cell_starts_;
+  private: std::vector<float> cell_xs_;
+  private: std::vector<float> cell_ys_;
+  private: std::vector<uint32_t> item_cells_;
+  private: int num_columns_;
+  private: int num_rows_;
+  private: float origin_x_;
+  private: float origin_y_;
+
+  public: UniformGrid();
+  public: ~UniformGrid() = default;
+
+  public: float cell_size() const { return cell_size_; }
+  public: size_t num_cells() const { return cell_starts_.size() - 1; }
+  public: size_t num_items() const { return cell_items_.size(); }
+  public: int num_rows() const { return num_rows_; }
+
+  public: void Build(const float* xs, const float* ys, const float* radii,
+                     size_t count);
+  // Stores the smallest index of items colliding with each item into
+  // |first_hits|, or -1 if item doesn't collide.
+  public: void FindFirstHits(int* first_hits) const;
+  // Same as |FindFirstHits()| for items in rows [|first_row|, |end_row|) but
+  // only with items in the same rows. Bands of rows don't share items, so
+  // callers can process bands on different threads.
+  public: void FindFirstHitsInBand(int first_row, int end_row,
+                                   int* first_hits) const;
+  // Updates |first_hits| of items in the first and the last rows of band
+  // with items in rows adjacent to band, after |FindFirstHitsInBand()| for
+  // all bands. Result is the same as |FindFirstHits()| in any order of bands.
+  public: void MergeFirstHitsAcrossBand(int first_row, int end_row,
+                                        int* first_hits) const;
+
+  private: int CellOf(float x, float y) const;
+  private: void FindHitsInRow(int row, int neighbor_first_row,
+                              int neighbor_last_row, bool merge,
+                              int* first_hits) const;
+
+  DISALLOW_COPY_AND_ASSIGN(UniformGrid);
+};
+
+UniformGrid::UniformGrid()
+    : cell_size_(1.0f), cell_starts_(1), num_columns_(0), num_rows_(0),
+      origin_x_(0.0f), origin_y_(0.0f) {
+}
+
+void UniformGrid::Build(const float* xs, const float* ys, const float* radii,
+                        size_t count) {
+  cell_items_.resize(count);
+  cell_radii_.resize(count);
+  cell_xs_.resize(count);
+  cell_ys_.resize(count);
+  item_cells_.resize(count);
+  if (!count) {
+    cell_starts_.assign(1, 0);
+    num_columns_ = num_rows_ = 0;
+    return;
+  }
+
+  auto min_x = xs[0];
+  auto max_x = xs[0];
+  auto min_y = ys[0];
+  auto max_y = ys[0];
+  auto max_radius = radii[0];
+  for (auto index = 1u; index < count; ++index) {
+    min_x = std::min(min_x, xs[index]);
+    max_x = std::max(max_x, xs[index]);
+    min_y = std::min(min_y, ys[index]);
+    max_y = std::max(max_y, ys[index]);
+    max_radius = std::max(max_radius, radii[index]);
+  }
+
+  // Make cells larger if circles are sparse to bound number of cells. Each
+  // dimension is bounded too, since area of circles on a line is zero.
+  auto const width = max_x - min_x;
+  auto const height = max_y - min_y;
+  auto const max_cells = static_cast<float>(count * 4 + 16);
+  cell_size_ = std::max(max_radius, 1.0f);
+  if (width * height > cell_size_ * cell_size_ * max_cells)
+    cell_size_ = ::sqrt(width * height / max_cells);
+  cell_size_ = std::max(cell_size_, std::max(width, height) / max_cells);
+  origin_x_ = min_x;
+  origin_y_ = min_y;
+  num_columns_ = static_cast<int>(width / cell_size_) + 1;
+  num_rows_ = static_cast<int>(height / cell_size_) + 1;
+
+  // Counting sort keeps index order in each cell.
+  cell_starts_.assign(num_columns_ * num_rows_ + 1, 0);
+  for (auto index = 0u; index < count; ++index) {
+    auto const cell = CellOf(xs[index], ys[index]);
+    item_cells_[index] = cell;
+    ++cell_starts_[cell + 1];
+  }
+  for (auto cell = 1u; cell < cell_starts_.size(); ++cell)
+    cell_starts_[cell] += cell_starts_[cell - 1];
+  for (auto index = 0u; index < count; ++index) {
+    auto const position = cell_starts_[item_cells_[index]]++;
+    cell_items_[position] = index;
+    cell_radii_[position] = radii[index];
+    cell_xs_[position] = xs[index];
+    cell_ys_[position] = ys[index];
+  }
+  // Now |cell_starts_[cell]| points end of |cell|, shift them back.
+  for (auto cell = cell_starts_.size() - 1; cell > 0; --cell)
+    cell_starts_[cell] = cell_starts_[cell - 1];
+  cell_starts_[0] = 0;
+}
+
+int UniformGrid::CellOf(float x, float y) const {
+  auto const column = std::min(
+      static_cast<int>((x - origin_x_) / cell_size_), num_columns_ - 1);
+  auto const row = std::min(
+      static_cast<int>((y - origin_y_) / cell_size_), num_rows_ - 1);
+  return row * num_columns_ + column;
+}
+
+void UniformGrid::FindFirstHits(int* first_hits) const {
+  FindFirstHitsInBand(0, num_rows_, first_hits);
+}
+
+void UniformGrid::FindFirstHitsInBand(int first_row, int end_row,
+                                      int* first_hits) const {
+  for (auto row = first_row; row < end_row; ++row) {
+    FindHitsInRow(row, std::max(row - 1, first_row),
+                  std::min(row + 1, end_row - 1), false, first_hits);
+  }
+}
+
+// Narrow-phase compares squared distance with squared larger radius. Three
+// adjacent cells in a row are contiguous in |cell_items_|. We skip items
+// whose index isn't smaller than the best hit so far. When |merge| is true,
+// the best hit so far starts from |first_hits|.
+void UniformGrid::FindHitsInRow(int row, int neighbor_first_row,
+                                int neighbor_last_row, bool merge,
+                                int* first_hits) const {
+  auto const kNoHit = std::numeric_limits<uint32_t>::max();
+  for (auto column = 0; column < num_columns_; ++column) {
+    auto const first_column = std::max(column - 1, 0);
+    auto const last_column = std::min(column + 1, num_columns_ - 1);
+    auto const cell = row * num_columns_ + column;
+    for (auto position = cell_starts_[cell];
+         position < cell_starts_[cell + 1]; ++position) {
+      auto const item = cell_items_[position];
+      auto const x = cell_xs_[position];
+      auto const y = cell_ys_[position];
+      auto const radius = cell_radii_[position];
+      auto best = merge && first_hits[item] >= 0 ?
+          static_cast<uint32_t>(first_hits[item]) : kNoHit;
+      for (auto other_row = neighbor_first_row;
+           other_row <= neighbor_last_row; ++other_row) {
+        auto const other_cells = other_row * num_columns_;
+        auto const start = cell_starts_[other_cells + first_column];
+        auto const end = cell_starts_[other_cells + last_column + 1];
+        for (auto other = start; other < end; ++other) {
+          auto const other_item = cell_items_[other];
+          if (other_item >= best || other_item == item)
+            continue;
+          auto const dx = cell_xs_[other] - x;
+          auto const dy = cell_ys_[other] - y;
+          auto const limit = std::max(radius, cell_radii_[other]);
+          if (dx * dx + dy * dy <= limit * limit)
+            best = other_item;
+        }
+      }
+      first_hits[item] = best == kNoHit ? -1 : static_cast<int>(best);
+    }
+  }
+}
+
+void UniformGrid::MergeFirstHitsAcrossBand(int first_row, int end_row,
+                                           int* first_hits) const {
+  if (first_row >= end_row)
+    return;
+  if (first_row > 0)
+    FindHitsInRow(first_row, first_row - 1, first_row - 1, true, first_hits);
+  if (end_row < num_rows_)
+    FindHitsInRow(end_row - 1, end_row, end_row, true, first_hits);
+}
+
+}  // namespace physics
+
+#endif //!defined(INCLUDE_physics_uniform_grid_h)
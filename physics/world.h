@@ -0,0 +1,114 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_physics_world_h)
+#define INCLUDE_physics_world_h
+
+namespace physics {
+
+//////////////////////////////////////////////////////////////////////
+//
+// World
+// Steps particles and resolves collisions, on |base::ThreadPool| if
+// available. A step has five phases separated by barriers:
+//  1. Move particles, chunks of particles in parallel.
+//  2. Build |UniformGrid| on the calling thread.
+//  3. Find collisions inside bands of grid rows, bands in parallel.
+//  4. Merge collisions across bands, bands in parallel.
+//  5. Reverse motion of the smaller particle of colliding particles,
+//     chunks of particles in parallel.
+//
+// Each phase writes only particles or items owned by its chunk or band, and
+// first hit is the smallest index of colliding particles, so results are
+// identical for any number of threads.
+//
+class World final {
+  // Number of particles in a chunk of phase 1 and 5.
+  public: static const size_t kChunkSize = 4096;
+  // Number of bands per thread in phase 3 and 4, for load balancing.
+  public: static const int kBandsPerThread = 4;
+
+  private: std::vector<int> first_hits_;
+  private: UniformGrid grid_;
+  private: ParticleStore particles_;
+  private: base::ThreadPool* thread_pool_;
+
+  // |thread_pool| can be null for stepping on the calling thread.
+  public: explicit World(base::ThreadPool* thread_pool = nullptr);
+  public: ~World() = default;
+
+  public: const int* first_hits() const { return first_hits_.data(); }
+  public: const ParticleStore& particles() const { return particles_; }
+  public: ParticleStore* mutable_particles() { return &particles_; }
+
+  public: void Step(const Bounds& bounds, int num_steps);
+
+  private: void ParallelFor(size_t count, size_t grain,
+                            const base::ThreadPool::Function& function);
+  private: void ResolveCollisions();
+
+  DISALLOW_COPY_AND_ASSIGN(World);
+};
+
+World::World(base::ThreadPool* thread_pool) : thread_pool_(thread_pool) {
+}
+
+void World::ParallelFor(size_t count, size_t grain,
+                        const base::ThreadPool::Function& function) {
+  if (!thread_pool_) {
+    function(0, count);
+    return;
+  }
+  thread_pool_->ParallelFor(count, grain, function);
+}
+
+void World::ResolveCollisions() {
+  auto const num_particles = particles_.size();
+  first_hits_.resize(num_particles);
+  grid_.Build(particles_.xs(), particles_.ys(), particles_.radii(),
+              num_particles);
+
+  auto const num_rows = grid_.num_rows();
+  auto const num_threads = thread_pool_ ? thread_pool_->num_threads() : 1;
+  auto const num_bands = std::max(
+      std::min(num_threads * kBandsPerThread, num_rows), 1);
+  auto const band_start = [=](size_t band) {
+    return static_cast<int>(band * num_rows / num_bands);
+  };
+  ParallelFor(num_bands, 1, [&](size_t begin, size_t end) {
+    for (auto band = begin; band < end; ++band) {
+      grid_.FindFirstHitsInBand(band_start(band), band_start(band + 1),
+                                first_hits_.data());
+    }
+  });
+  ParallelFor(num_bands, 1, [&](size_t begin, size_t end) {
+    for (auto band = begin; band < end; ++band) {
+      grid_.MergeFirstHitsAcrossBand(band_start(band), band_start(band + 1),
+                                     first_hits_.data());
+    }
+  });
+
+  // A particle reverses only its own motion, so this is also parallel.
+  auto const radii = particles_.radii();
+  ParallelFor(num_particles, kChunkSize, [&](size_t begin, size_t end) {
+    for (auto index = begin; index < end; ++index) {
+      auto const other = first_hits_[index];
+      if (other >= 0 && radii[index] <= radii[other])
+        particles_.ReverseMotion(index);
+    }
+  });
+}
+
+void World::Step(const Bounds& bounds, int num_steps) {
+  if (num_steps <= 0)
+    return;
+  ParallelFor(particles_.size(), kChunkSize, [&](size_t begin, size_t end) {
+    particles_.StepRange(bounds, num_steps, begin, end);
+  });
+  ResolveCollisions();
+}
+
+}  // namespace physics
+
+#endif //!defined(INCLUDE_physics_world_h)
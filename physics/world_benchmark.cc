@@ -0,0 +1,123 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Measures steps per second of |physics::World| with 1 to 32 threads, and
+// checks positions and motions after steps are bit-identical to stepping on
+// the calling thread for every number of threads.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. physics\world_benchmark.cc
+//  g++ -std=c++11 -O2 -pthread -I. physics/world_benchmark.cc
+//
+// Usage: world_benchmark [num_particles] [num_steps]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "base/basictypes.h"
+#include "base/threading/thread_pool.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "physics/particle_store.h"
+#include "physics/uniform_grid.h"
+#include "physics/world.h"
+
+namespace {
+
+// World area per particle in square pixels, same as collision_benchmark.
+const float kAreaPerParticle = 4000.0f;
+
+physics::Bounds MakeParticles(size_t count, physics::ParticleStore* store) {
+  auto const size = ::sqrt(kAreaPerParticle * count);
+  uint32_t seed = 1;
+  for (auto index = 0u; index < count; ++index) {
+    auto const radius = base::RandomFloat(&seed, 10, 20);
+    auto const x = base::RandomFloat(&seed, radius, size - radius);
+    auto const y = base::RandomFloat(&seed, radius, size - radius);
+    auto const vx = base::RandomFloat(&seed, -2, 2);
+    auto const vy = base::RandomFloat(&seed, -2, 2);
+    store->Add(x, y, vx, vy, radius, 0.0f);
+  }
+  physics::Bounds bounds = {0.0f, 0.0f, size, size};
+  return bounds;
+}
+
+bool SameFloats(const float* expected, const float* actual, size_t count) {
+  return !::memcmp(expected, actual, count * sizeof(float));
+}
+
+bool SameParticles(const physics::ParticleStore& expected,
+                   const physics::ParticleStore& actual) {
+  auto const count = expected.size();
+  return count == actual.size() &&
+         SameFloats(expected.xs(), actual.xs(), count) &&
+         SameFloats(expected.ys(), actual.ys(), count) &&
+         SameFloats(expected.vxs(), actual.vxs(), count) &&
+         SameFloats(expected.vys(), actual.vys(), count) &&
+         SameFloats(expected.angles(), actual.angles(), count);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_particles = argc >= 2 ?
+      static_cast<size_t>(atoi(argv[1])) : 200000;
+  auto const num_steps = argc >= 3 ? atoi(argv[2]) : 20;
+  std::cout << num_particles << " particles, " << num_steps << " steps, "
+            << std::thread::hardware_concurrency() << " hardware threads"
+            << std::endl;
+
+  // Reference on the calling thread.
+  physics::World reference;
+  auto const bounds = MakeParticles(num_particles,
+                                    reference.mutable_particles());
+  for (auto step = 0; step < num_steps; ++step)
+    reference.Step(bounds, 1);
+
+  printf("%8s %12s %10s %10s %10s\n", "threads", "steps/s", "speedup",
+         "steals", "identical");
+  const int thread_counts[] = {1, 2, 4, 8, 16, 32};
+  auto single_thread_rate = 0.0;
+  auto failed = false;
+  for (auto const num_threads : thread_counts) {
+    base::ThreadPool thread_pool(num_threads);
+    physics::World world(&thread_pool);
+    MakeParticles(num_particles, world.mutable_particles());
+    auto const start = base::TimeTicks::Now();
+    for (auto step = 0; step < num_steps; ++step)
+      world.Step(bounds, 1);
+    auto const seconds = (base::TimeTicks::Now() - start).InMillisecondsF() /
+                         1000;
+    auto const rate = num_steps / seconds;
+    if (num_threads == 1)
+      single_thread_rate = rate;
+    auto const identical = SameParticles(reference.particles(),
+                                         world.particles());
+    failed |= !identical;
+    printf("%8d %12.2f %9.2fx %10llu %10s\n", num_threads, rate,
+           rate / single_thread_rate,
+           static_cast<unsigned long long>(thread_pool.num_steals()),
+           identical ? "yes" : "NO");
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Merges call tree CSVs of the Visual Studio profiler or
+// |base::SamplingProfiler|, and writes the merged tree, folded stacks for
+// flamegraph.pl, or a diff of two profiles by functions. Inputs are read
+// through memory mapping row by row, and the merged tree has at most
+// --max-nodes nodes, so a multi-gigabyte capture doesn't need memory of
+// its size. Names and modules are filtered by the rules of calltree2dot.py.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. profiling\calltree.cc
+//  g++ -std=c++11 -O2 -I. profiling/calltree.cc -o calltree
+//
+// Usage:
+//  calltree merge [options] input.csv... > merged.csv
+//  calltree folded [options] input.csv... > stacks.folded
+//  calltree diff [options] before.csv after.csv > diff.csv
+// Options:
+//  --max-nodes=N     Nodes of a merged tree, 4000000 by default.
+//  --modules=a,b     Modules of interest, instead of Blink modules.
+//  --no-filter       Keep ignored functions and calls in a module.
+//  --top=N           Functions in a diff, 100 by default.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/strings/csv.h"
+#include "profiling/calltree.h"
+
+namespace {
+
+bool StartsWith(const std::string& text, const char* prefix) {
+  return !text.compare(0, ::strlen(prefix), prefix);
+}
+
+std::vector<std::string> Split(const std::string& text) {
+  std::vector<std::string> parts;
+  std::istringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, ','))
+    parts.push_back(part);
+  return parts;
+}
+
+int Usage() {
+  std::cerr << "Usage: calltree merge|folded|diff [--max-nodes=N]" <<
+      " [--modules=a,b] [--no-filter] [--top=N] input.csv..." << std::endl;
+  return EXIT_FAILURE;
+}
+
+bool AddFile(profiling::CallTreeMerger* merger,
+             const std::string& file_name) {
+  if (merger->AddFile(file_name))
+    return true;
+  std::cerr << "Can't read call tree CSV " << file_name << std::endl;
+  return false;
+}
+
+void Report(const profiling::CallTreeMerger& merger) {
+  std::cerr << merger.num_rows() << " rows, " << merger.num_samples() <<
+      " samples, " << merger.num_nodes() << " nodes, " <<
+      merger.num_filtered_rows() << " filtered, " <<
+      merger.num_truncated_rows() << " truncated, " <<
+      merger.num_malformed_rows() << " malformed" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2)
+    return Usage();
+  std::string const command = argv[1];
+  profiling::CallTreeFilter filter;
+  size_t max_nodes = 4000000;
+  size_t max_rows = 100;
+  std::vector<std::string> inputs;
+  for (auto index = 2; index < argc; ++index) {
+    std::string const arg = argv[index];
+    if (StartsWith(arg, "--max-nodes="))
+      max_nodes = static_cast<size_t>(atoll(arg.c_str() + 12));
+    else if (StartsWith(arg, "--modules="))
+      filter.SetModules(Split(arg.substr(10)));
+    else if (arg == "--no-filter")
+      filter.set_enabled(false);
+    else if (StartsWith(arg, "--top="))
+      max_rows = static_cast<size_t>(atoll(arg.c_str() + 6));
+    else if (StartsWith(arg, "--"))
+      return Usage();
+    else
+      inputs.push_back(arg);
+  }
+  if (inputs.empty())
+    return Usage();
+
+  if (command == "diff") {
+    if (inputs.size() != 2)
+      return Usage();
+    profiling::CallTreeMerger before(filter, max_nodes);
+    profiling::CallTreeMerger after(filter, max_nodes);
+    if (!AddFile(&before, inputs[0]) || !AddFile(&after, inputs[1]))
+      return EXIT_FAILURE;
+    Report(before);
+    Report(after);
+    profiling::WriteDiff(before, after, max_rows, &std::cout);
+    return EXIT_SUCCESS;
+  }
+
+  if (command != "merge" && command != "folded")
+    return Usage();
+  profiling::CallTreeMerger merger(filter, max_nodes);
+  for (auto const& input : inputs) {
+    if (!AddFile(&merger, input))
+      return EXIT_FAILURE;
+  }
+  Report(merger);
+  if (command == "merge")
+    merger.WriteCsv(&std::cout);
+  else
+    merger.WriteFolded(&std::cout);
+  return EXIT_SUCCESS;
+}
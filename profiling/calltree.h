@@ -0,0 +1,723 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_profiling_calltree_h)
+#define INCLUDE_profiling_calltree_h
+
+namespace profiling {
+
+//////////////////////////////////////////////////////////////////////
+//
+// MappedFile
+// Read only view of a whole file. Pages are read on demand and can be
+// dropped by the system, so a multi-gigabyte capture doesn't take memory
+// of the process.
+//
+class MappedFile final {
+  private: const char* data_;
+#if defined(_WIN32)
+  private: HANDLE file_;
+  private: HANDLE mapping_;
+#endif
+  private: size_t size_;
+
+  public: MappedFile();
+  public: ~MappedFile();
+
+  public: const char* data() const { return data_; }
+  public: size_t size() const { return size_; }
+
+  public: bool Open(const std::string& file_name);
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+#if defined(_WIN32)
+MappedFile::MappedFile()
+    : data_(nullptr), file_(INVALID_HANDLE_VALUE), mapping_(nullptr),
+      size_(0) {
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    ::UnmapViewOfFile(data_);
+  if (mapping_)
+    ::CloseHandle(mapping_);
+  if (file_ != INVALID_HANDLE_VALUE)
+    ::CloseHandle(file_);
+}
+
+bool MappedFile::Open(const std::string& file_name) {
+  DCHECK(!data_);
+  file_ = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr);
+  if (file_ == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file_, &size))
+    return false;
+  size_ = static_cast<size_t>(size.QuadPart);
+  // A mapping of an empty file fails.
+  if (!size_)
+    return true;
+  mapping_ = ::CreateFileMapping(file_, nullptr, PAGE_READONLY, 0, 0,
+                                 nullptr);
+  if (!mapping_)
+    return false;
+  data_ = static_cast<const char*>(::MapViewOfFile(mapping_, FILE_MAP_READ,
+                                                   0, 0, 0));
+  return data_ != nullptr;
+}
+#else
+MappedFile::MappedFile() : data_(nullptr), size_(0) {
+}
+
+MappedFile::~MappedFile() {
+  if (data_)
+    ::munmap(const_cast<char*>(data_), size_);
+}
+
+bool MappedFile::Open(const std::string& file_name) {
+  DCHECK(!data_);
+  auto const fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat stat_buffer;
+  if (::fstat(fd, &stat_buffer)) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(stat_buffer.st_size);
+  auto const mapped = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE,
+                                     fd, 0) :
+                              nullptr;
+  ::close(fd);
+  if (mapped == MAP_FAILED)
+    return false;
+  if (mapped)
+    ::madvise(mapped, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(mapped);
+  return true;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////
+//
+// CallTreeRow
+// A row of call tree CSV exported by the Visual Studio profiler or written
+// by |base::CallTree|.
+//
+struct CallTreeRow {
+  uint64_t exclusive;
+  uint64_t inclusive;
+  int level;
+  std::string module;
+  std::string name;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// CallTreeReader
+// Reads rows of call tree CSV one by one. Columns are found by names in
+// the header, as csv.DictReader does, and percentages are ignored. Fields
+// are reused between rows, so reading doesn't allocate after the first
+// rows.
+//
+class CallTreeReader final {
+  private: const char* end_;
+  private: int exclusive_column_;
+  private: std::vector<std::string> fields_;
+  private: int inclusive_column_;
+  private: int level_column_;
+  private: int module_column_;
+  private: int name_column_;
+  private: uint64_t num_malformed_rows_;
+  private: int num_columns_;
+  private: int num_header_columns_;
+  private: const char* position_;
+
+  public: CallTreeReader(const char* data, size_t size);
+  public: ~CallTreeReader() = default;
+
+  // Rows without enough fields or with a level which isn't a number.
+  public: uint64_t num_malformed_rows() const { return num_malformed_rows_; }
+
+  // Returns false at the end.
+  public: bool Next(CallTreeRow* row);
+  // Samples may be written as "1,234".
+  private: static uint64_t ParseNumber(const std::string& field);
+  private: bool ReadLine();
+  // Reads the header. Returns false if a column is missing.
+  public: bool Start();
+
+  DISALLOW_COPY_AND_ASSIGN(CallTreeReader);
+};
+
+CallTreeReader::CallTreeReader(const char* data, size_t size)
+    : end_(data + size), exclusive_column_(-1), inclusive_column_(-1),
+      level_column_(-1), module_column_(-1), name_column_(-1),
+      num_malformed_rows_(0), num_columns_(0), num_header_columns_(0),
+      position_(data) {
+  // UTF-8 byte order mark
+  if (size >= 3 && !::memcmp(data, "\xEF\xBB\xBF", 3))
+    position_ += 3;
+}
+
+bool CallTreeReader::Next(CallTreeRow* row) {
+  while (ReadLine()) {
+    if (num_columns_ < num_header_columns_) {
+      ++num_malformed_rows_;
+      continue;
+    }
+    auto const& level = fields_[level_column_];
+    if (level.empty() ||
+        level.find_first_not_of("0123456789") != std::string::npos) {
+      ++num_malformed_rows_;
+      continue;
+    }
+    row->level = atoi(level.c_str());
+    row->name.assign(fields_[name_column_]);
+    row->module.assign(fields_[module_column_]);
+    row->inclusive = ParseNumber(fields_[inclusive_column_]);
+    row->exclusive = ParseNumber(fields_[exclusive_column_]);
+    return true;
+  }
+  return false;
+}
+
+uint64_t CallTreeReader::ParseNumber(const std::string& field) {
+  uint64_t number = 0;
+  for (auto const ch : field) {
+    if (ch >= '0' && ch <= '9')
+      number = number * 10 + static_cast<uint64_t>(ch - '0');
+    else if (ch != ',' && ch != ' ')
+      break;
+  }
+  return number;
+}
+
+// Splits a line into |fields_|, and sets |num_columns_|. A quoted field
+// may have commas and doubled quotes, but not line breaks.
+bool CallTreeReader::ReadLine() {
+  while (position_ < end_ && (*position_ == '\n' || *position_ == '\r'))
+    ++position_;
+  if (position_ >= end_)
+    return false;
+  num_columns_ = 0;
+  for (;;) {
+    if (fields_.size() <= static_cast<size_t>(num_columns_))
+      fields_.push_back(std::string());
+    auto& field = fields_[num_columns_++];
+    field.clear();
+    if (position_ < end_ && *position_ == '"') {
+      ++position_;
+      while (position_ < end_) {
+        auto const quote = static_cast<const char*>(
+            ::memchr(position_, '"', static_cast<size_t>(end_ - position_)));
+        auto const field_end = quote ? quote : end_;
+        field.append(position_, field_end);
+        position_ = quote ? quote + 1 : end_;
+        if (position_ >= end_ || *position_ != '"')
+          break;
+        field.push_back('"');
+        ++position_;
+      }
+    }
+    auto const start = std::min(position_, end_);
+    auto runner = start;
+    while (runner < end_ && *runner != ',' && *runner != '\n' &&
+           *runner != '\r') {
+      ++runner;
+    }
+    field.append(start, runner);
+    position_ = runner;
+    if (position_ >= end_ || *position_ != ',')
+      break;
+    ++position_;
+  }
+  if (position_ < end_)
+    ++position_;
+  return true;
+}
+
+bool CallTreeReader::Start() {
+  if (!ReadLine())
+    return false;
+  num_header_columns_ = num_columns_;
+  for (auto index = 0; index < num_columns_; ++index) {
+    auto const& name = fields_[index];
+    if (name == "Level")
+      level_column_ = index;
+    else if (name == "Function Name")
+      name_column_ = index;
+    else if (name == "Inclusive Samples")
+      inclusive_column_ = index;
+    else if (name == "Exclusive Samples")
+      exclusive_column_ = index;
+    else if (name == "Module Name")
+      module_column_ = index;
+  }
+  return exclusive_column_ >= 0 && inclusive_column_ >= 0 &&
+         level_column_ >= 0 && module_column_ >= 0 && name_column_ >= 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// CallTreeFilter
+// Rules of profiling/calltree2dot.py. Names are decoded before merging,
+// and an ignored function, or a call in the same module which isn't of
+// interest, is merged into its caller. Unlike calltree2dot.py, long names
+// aren't shortened, since they are keys.
+//
+class CallTreeFilter final {
+  private: bool enabled_;
+  private: std::unordered_set<std::string> ignores_;
+  private: std::unordered_set<std::string> modules_;
+
+  public: CallTreeFilter();
+  public: ~CallTreeFilter() = default;
+
+  public: bool enabled() const { return enabled_; }
+  public: void set_enabled(bool enabled) { enabled_ = enabled; }
+
+  public: void DecodeName(std::string* name) const;
+  public: bool IsInterestedModule(const std::string& module) const;
+  public: void SetModules(const std::vector<std::string>& modules);
+  // |name| is a name before decoding and |decoded_name| is after.
+  public: bool ShouldIgnore(const std::string& name,
+                            const std::string& decoded_name) const;
+
+  DISALLOW_COPY_AND_ASSIGN(CallTreeFilter);
+};
+
+CallTreeFilter::CallTreeFilter()
+    : enabled_(true),
+      ignores_({
+        "_RTC_CheckEsp",
+        "Node::getFlag",
+        "Node::hasRareData",
+        "Node::treeScope",
+        "TreeScope::document",
+        "WTF::RefPtr<Node>::RefPtr<Node>",
+      }),
+      modules_({"blink_platform.dll", "webcore_shared.dll"}) {
+}
+
+void CallTreeFilter::DecodeName(std::string* name) const {
+  static const char* const kReplacements[][2] = {
+    {" >", ">"},
+    {"blink::", ""},
+    {"EditingAlgorithm<NodeTraversal>", "EditingStrategy"},
+    {"EditingAlgorithm<ComposedTreeTraversal>",
+     "EditingInComposedTreeStrategy"},
+    {"Algorithm<EditingStrategy>", ""},
+    {"Algorithm<EditingInComposedTreeStrategy>", "InComposedTree"},
+    {"Template<EditingStrategy>", ""},
+    {"Template<EditingInComposedTreeStrategy>", "InComposedTree"},
+  };
+  for (auto const& replacement : kReplacements) {
+    auto const from = replacement[0];
+    auto const from_size = ::strlen(from);
+    auto const to_size = ::strlen(replacement[1]);
+    for (auto position = name->find(from); position != std::string::npos;
+         position = name->find(from, position + to_size)) {
+      name->replace(position, from_size, replacement[1]);
+    }
+  }
+}
+
+bool CallTreeFilter::IsInterestedModule(const std::string& module) const {
+  return modules_.count(module) != 0;
+}
+
+void CallTreeFilter::SetModules(const std::vector<std::string>& modules) {
+  modules_.clear();
+  modules_.insert(modules.begin(), modules.end());
+}
+
+bool CallTreeFilter::ShouldIgnore(const std::string& name,
+                                  const std::string& decoded_name) const {
+  static const char* const kPrefixes[] = {
+    "DataRef<", "WTF::PassRefPtr<", "WTF::RawPtr<", "WTF::RefPtr<",
+  };
+  if (name.find('~') != std::string::npos)
+    return true;
+  for (auto const prefix : kPrefixes) {
+    if (!name.compare(0, ::strlen(prefix), prefix))
+      return true;
+  }
+  return ignores_.count(decoded_name) != 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// FunctionSamples
+// Samples of a function in all calls. Inclusive samples of a recursive
+// call are counted once.
+//
+struct FunctionSamples {
+  uint64_t exclusive;
+  uint64_t inclusive;
+  std::string module;
+  std::string name;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// CallTreeMerger
+// Merges rows of call tree CSVs, of the same or different runs, into one
+// tree by paths of function names. Level 0 rows, e.g. programs, are
+// children of a root.
+//
+// Memory is bounded by |max_nodes|. A row which needs a node after that,
+// and rows under it, are merged into the nearest caller which has a node,
+// so samples still add up. Level 0 rows always have nodes.
+//
+class CallTreeMerger final {
+  private: struct Function {
+    std::string module;
+    std::string name;
+  };
+
+  // Children of a node are linked by |next_sibling|.
+  private: struct Node {
+    uint64_t exclusive;
+    uint64_t inclusive;
+    int first_child;
+    int function_id;
+    int next_sibling;
+  };
+
+  private: static const int kRoot = 0;
+
+  // Node by parent and function id.
+  private: std::unordered_map<uint64_t, int> children_;
+  private: const CallTreeFilter& filter_;
+  // Function id by module and name.
+  private: std::unordered_map<std::string, int> function_ids_;
+  private: std::vector<Function> functions_;
+  private: std::string key_;
+  private: size_t max_nodes_;
+  private: std::vector<Node> nodes_;
+  private: uint64_t num_filtered_rows_;
+  private: uint64_t num_malformed_rows_;
+  private: uint64_t num_rows_;
+  private: uint64_t num_truncated_rows_;
+  // Node of each level of the last row.
+  private: std::vector<int> path_;
+  private: std::string raw_name_;
+
+  public: CallTreeMerger(const CallTreeFilter& filter, size_t max_nodes);
+  public: ~CallTreeMerger() = default;
+
+  public: size_t num_nodes() const { return nodes_.size(); }
+  public: uint64_t num_filtered_rows() const { return num_filtered_rows_; }
+  public: uint64_t num_malformed_rows() const { return num_malformed_rows_; }
+  public: uint64_t num_rows() const { return num_rows_; }
+  public: uint64_t num_samples() const { return nodes_[kRoot].inclusive; }
+  public: uint64_t num_truncated_rows() const { return num_truncated_rows_; }
+
+  // Returns false if |data| isn't call tree CSV.
+  public: bool AddCsv(const char* data, size_t size);
+  public: bool AddFile(const std::string& file_name);
+  // Rows of a CSV should be added from the first one.
+  public: void AddRow(CallTreeRow* row);
+  private: int FindFunction(const std::string& name,
+                            const std::string& module, bool can_add);
+  private: std::vector<int> SortedChildren(int node_index) const;
+  public: std::vector<FunctionSamples> SumByFunction() const;
+  private: void SumNode(int node_index, std::vector<int>* active_counts,
+                       std::vector<FunctionSamples>* samples) const;
+  // Writes merged tree in the same CSV.
+  public: void WriteCsv(std::ostream* stream) const;
+  // Writes "caller;callee count" lines of exclusive samples, for
+  // flamegraph.pl.
+  public: void WriteFolded(std::ostream* stream) const;
+  private: void WriteFoldedNode(std::ostream* stream, int node_index,
+                                std::string* path) const;
+  private: void WriteNode(std::ostream* stream, int node_index,
+                          int level) const;
+
+  DISALLOW_COPY_AND_ASSIGN(CallTreeMerger);
+};
+
+CallTreeMerger::CallTreeMerger(const CallTreeFilter& filter,
+                               size_t max_nodes)
+    : filter_(filter), max_nodes_(std::max(max_nodes,
+                                           static_cast<size_t>(1))),
+      num_filtered_rows_(0), num_malformed_rows_(0), num_rows_(0),
+      num_truncated_rows_(0) {
+  functions_.push_back(Function{"", "root"});
+  nodes_.push_back(Node{0, 0, -1, 0, -1});
+}
+
+bool CallTreeMerger::AddCsv(const char* data, size_t size) {
+  CallTreeReader reader(data, size);
+  if (!reader.Start())
+    return false;
+  path_.clear();
+  CallTreeRow row;
+  while (reader.Next(&row))
+    AddRow(&row);
+  num_malformed_rows_ += reader.num_malformed_rows();
+  return true;
+}
+
+bool CallTreeMerger::AddFile(const std::string& file_name) {
+  MappedFile file;
+  return file.Open(file_name) && AddCsv(file.data(), file.size());
+}
+
+void CallTreeMerger::AddRow(CallTreeRow* row) {
+  ++num_rows_;
+  if (row->level > static_cast<int>(path_.size())) {
+    ++num_malformed_rows_;
+    return;
+  }
+  path_.resize(static_cast<size_t>(row->level));
+  auto const parent = path_.empty() ? kRoot : path_.back();
+  if (!row->level)
+    nodes_[kRoot].inclusive += row->inclusive;
+  raw_name_.assign(row->name);
+  filter_.DecodeName(&row->name);
+  if (filter_.enabled() && parent != kRoot &&
+      (filter_.ShouldIgnore(raw_name_, row->name) ||
+       (!filter_.IsInterestedModule(row->module) &&
+        functions_[nodes_[parent].function_id].module == row->module))) {
+    ++num_filtered_rows_;
+    nodes_[parent].exclusive += row->exclusive;
+    path_.push_back(parent);
+    return;
+  }
+  auto const can_add = nodes_.size() < max_nodes_ || parent == kRoot;
+  auto const function_id = FindFunction(row->name, row->module, can_add);
+  auto node_index = -1;
+  if (function_id >= 0) {
+    auto const key = static_cast<uint64_t>(parent) << 32 |
+                     static_cast<uint32_t>(function_id);
+    auto const it = children_.find(key);
+    if (it != children_.end()) {
+      node_index = it->second;
+    } else if (can_add) {
+      node_index = static_cast<int>(nodes_.size());
+      nodes_.push_back(Node{0, 0, -1, function_id,
+                            nodes_[parent].first_child});
+      nodes_[parent].first_child = node_index;
+      children_[key] = node_index;
+    }
+  }
+  if (node_index < 0) {
+    ++num_truncated_rows_;
+    nodes_[parent].exclusive += row->exclusive;
+    path_.push_back(parent);
+    return;
+  }
+  nodes_[node_index].exclusive += row->exclusive;
+  nodes_[node_index].inclusive += row->inclusive;
+  path_.push_back(node_index);
+}
+
+// Returns -1 if the function isn't known and |can_add| is false.
+int CallTreeMerger::FindFunction(const std::string& name,
+                                 const std::string& module, bool can_add) {
+  key_.assign(module);
+  key_.push_back('\0');
+  key_.append(name);
+  auto const it = function_ids_.find(key_);
+  if (it != function_ids_.end())
+    return it->second;
+  if (!can_add)
+    return -1;
+  auto const function_id = static_cast<int>(functions_.size());
+  functions_.push_back(Function{module, name});
+  function_ids_[key_] = function_id;
+  return function_id;
+}
+
+// Returns children of |node_index| in order of inclusive samples, and of
+// names for the same samples.
+std::vector<int> CallTreeMerger::SortedChildren(int node_index) const {
+  std::vector<int> children;
+  for (auto child = nodes_[node_index].first_child; child >= 0;
+       child = nodes_[child].next_sibling) {
+    children.push_back(child);
+  }
+  std::sort(children.begin(), children.end(), [this](int a, int b) {
+    if (nodes_[a].inclusive != nodes_[b].inclusive)
+      return nodes_[a].inclusive > nodes_[b].inclusive;
+    return functions_[nodes_[a].function_id].name <
+           functions_[nodes_[b].function_id].name;
+  });
+  return children;
+}
+
+std::vector<FunctionSamples> CallTreeMerger::SumByFunction() const {
+  std::vector<FunctionSamples> samples(functions_.size());
+  for (auto index = 0u; index < functions_.size(); ++index) {
+    samples[index].exclusive = 0;
+    samples[index].inclusive = 0;
+    samples[index].module = functions_[index].module;
+    samples[index].name = functions_[index].name;
+  }
+  std::vector<int> active_counts(functions_.size());
+  for (auto child = nodes_[kRoot].first_child; child >= 0;
+       child = nodes_[child].next_sibling) {
+    SumNode(child, &active_counts, &samples);
+  }
+  samples.erase(samples.begin());
+  return samples;
+}
+
+void CallTreeMerger::SumNode(int node_index, std::vector<int>* active_counts,
+                             std::vector<FunctionSamples>* samples) const {
+  auto const& node = nodes_[node_index];
+  auto& function_samples = (*samples)[node.function_id];
+  auto& active_count = (*active_counts)[node.function_id];
+  if (!active_count)
+    function_samples.inclusive += node.inclusive;
+  function_samples.exclusive += node.exclusive;
+  ++active_count;
+  for (auto child = node.first_child; child >= 0;
+       child = nodes_[child].next_sibling) {
+    SumNode(child, active_counts, samples);
+  }
+  --active_count;
+}
+
+void CallTreeMerger::WriteCsv(std::ostream* stream) const {
+  *stream << "Level,Function Name,Inclusive Samples,Exclusive Samples," <<
+      "Inclusive Samples %,Exclusive Samples %,Module Name" << std::endl;
+  auto const flags = stream->flags();
+  auto const precision = stream->precision();
+  stream->setf(std::ios::fixed, std::ios::floatfield);
+  stream->precision(2);
+  for (auto const child : SortedChildren(kRoot))
+    WriteNode(stream, child, 0);
+  stream->flags(flags);
+  stream->precision(precision);
+}
+
+void CallTreeMerger::WriteFolded(std::ostream* stream) const {
+  std::string path;
+  for (auto const child : SortedChildren(kRoot))
+    WriteFoldedNode(stream, child, &path);
+}
+
+void CallTreeMerger::WriteFoldedNode(std::ostream* stream, int node_index,
+                                     std::string* path) const {
+  auto const& node = nodes_[node_index];
+  auto const size = path->size();
+  if (size)
+    path->push_back(';');
+  // ";" separates frames.
+  for (auto const ch : functions_[node.function_id].name)
+    path->push_back(ch == ';' ? ':' : ch);
+  if (node.exclusive)
+    *stream << *path << " " << node.exclusive << "\n";
+  for (auto const child : SortedChildren(node_index))
+    WriteFoldedNode(stream, child, path);
+  path->resize(size);
+}
+
+void CallTreeMerger::WriteNode(std::ostream* stream, int node_index,
+                               int level) const {
+  auto const& node = nodes_[node_index];
+  auto const& function = functions_[node.function_id];
+  auto const total = static_cast<double>(std::max(num_samples(),
+                                                  static_cast<uint64_t>(1)));
+  *stream << level << ",";
+  base::WriteCsvField(stream, function.name);
+  *stream << "," << node.inclusive << "," << node.exclusive << "," <<
+      node.inclusive * 100 / total << "," << node.exclusive * 100 / total <<
+      ",";
+  base::WriteCsvField(stream, function.module);
+  *stream << "\n";
+  for (auto const child : SortedChildren(node_index))
+    WriteNode(stream, child, level + 1);
+}
+
+// Writes functions of |before| and |after| in order of change of share of
+// inclusive samples, as CSV. Shares are in percent of all samples of each
+// profile, since profiles may have different number of samples.
+void WriteDiff(const CallTreeMerger& before, const CallTreeMerger& after,
+               size_t max_rows, std::ostream* stream) {
+  struct Change {
+    const FunctionSamples* before;
+    const FunctionSamples* after;
+    double exclusive;
+    double inclusive;
+  };
+  auto const before_samples = before.SumByFunction();
+  auto const after_samples = after.SumByFunction();
+  std::unordered_map<std::string, Change> changes;
+  for (auto const& samples : before_samples) {
+    auto& change = changes[samples.module + '\0' + samples.name];
+    change.before = &samples;
+  }
+  for (auto const& samples : after_samples) {
+    auto const key = samples.module + '\0' + samples.name;
+    auto const it = changes.find(key);
+    if (it == changes.end())
+      changes[key] = Change{nullptr, &samples, 0, 0};
+    else
+      it->second.after = &samples;
+  }
+  auto const before_total = static_cast<double>(
+      std::max(before.num_samples(), static_cast<uint64_t>(1)));
+  auto const after_total = static_cast<double>(
+      std::max(after.num_samples(), static_cast<uint64_t>(1)));
+  std::vector<Change> sorted;
+  for (auto& pair : changes) {
+    auto& change = pair.second;
+    auto const before_exclusive = change.before ? change.before->exclusive : 0;
+    auto const before_inclusive = change.before ? change.before->inclusive : 0;
+    auto const after_exclusive = change.after ? change.after->exclusive : 0;
+    auto const after_inclusive = change.after ? change.after->inclusive : 0;
+    change.exclusive = after_exclusive * 100 / after_total -
+                       before_exclusive * 100 / before_total;
+    change.inclusive = after_inclusive * 100 / after_total -
+                       before_inclusive * 100 / before_total;
+    sorted.push_back(change);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Change& a, const Change& b) {
+              if (::fabs(a.inclusive) != ::fabs(b.inclusive))
+                return ::fabs(a.inclusive) > ::fabs(b.inclusive);
+              if (::fabs(a.exclusive) != ::fabs(b.exclusive))
+                return ::fabs(a.exclusive) > ::fabs(b.exclusive);
+              auto const& a_samples = a.before ? *a.before : *a.after;
+              auto const& b_samples = b.before ? *b.before : *b.after;
+              return a_samples.name < b_samples.name;
+            });
+  if (sorted.size() > max_rows)
+    sorted.resize(max_rows);
+
+  *stream << "Function Name,Module Name,Inclusive Samples Before," <<
+      "Inclusive Samples After,Inclusive % Delta,Exclusive Samples Before," <<
+      "Exclusive Samples After,Exclusive % Delta" << std::endl;
+  auto const flags = stream->flags();
+  auto const precision = stream->precision();
+  stream->setf(std::ios::fixed, std::ios::floatfield);
+  stream->precision(2);
+  for (auto const& change : sorted) {
+    auto const& samples = change.before ? *change.before : *change.after;
+    base::WriteCsvField(stream, samples.name);
+    *stream << ",";
+    base::WriteCsvField(stream, samples.module);
+    *stream << "," <<
+        (change.before ? change.before->inclusive : 0) << "," <<
+        (change.after ? change.after->inclusive : 0) << "," <<
+        change.inclusive << "," <<
+        (change.before ? change.before->exclusive : 0) << "," <<
+        (change.after ? change.after->exclusive : 0) << "," <<
+        change.exclusive << "\n";
+  }
+  stream->flags(flags);
+  stream->precision(precision);
+}
+
+}  // namespace profiling
+
+#endif //!defined(INCLUDE_profiling_calltree_h)
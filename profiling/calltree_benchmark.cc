@@ -0,0 +1,316 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Writes a call tree CSV of random stacks, and merges it with
+// |profiling::CallTreeMerger| from a mapped file, and by reading lines
+// into a map by paths of names, as calltree2dot.py keeps entries in
+// dicts. Reports throughput and memory of both, and of a merger bounded to
+// a thousand nodes.
+//
+// Returns EXIT_FAILURE if merged CSV, folded stacks or a diff of known
+// profiles are wrong, or samples of the bounded tree don't add up.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. profiling\calltree_benchmark.cc
+//  g++ -std=c++11 -O2 -I. profiling/calltree_benchmark.cc
+//
+// Usage: calltree_benchmark [num_rows] [csv_file]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/strings/csv.h"
+#include "base/test/random.h"
+#include "profiling/calltree.h"
+
+namespace {
+
+const int kNumFunctions = 2000;
+const int kMaxLevel = 40;
+
+// Writes |num_rows| rows of a random call tree, of which each row has
+// samples of its callees, as the Visual Studio profiler exports.
+void WriteRandomCsv(size_t num_rows, std::ostream* stream) {
+  struct Row {
+    int level;
+    int function;
+    uint64_t exclusive;
+    uint64_t inclusive;
+  };
+  uint32_t seed = 1;
+  std::vector<Row> rows(num_rows);
+  auto level = 0;
+  for (auto& row : rows) {
+    row.level = level;
+    row.function = static_cast<int>(base::NextRandom(&seed) % kNumFunctions);
+    row.exclusive = base::NextRandom(&seed) % 3 ? 0 :
+                    1 + base::NextRandom(&seed) % 50;
+    row.inclusive = row.exclusive;
+    auto const choice = base::NextRandom(&seed) % 8;
+    if (choice < 5 && level < kMaxLevel)
+      ++level;
+    else if (choice < 7 && level > 1)
+      level -= 1 + static_cast<int>(base::NextRandom(&seed) % (level - 1));
+  }
+  // Callers include samples of callees.
+  std::vector<Row*> path;
+  for (auto& row : rows) {
+    path.resize(static_cast<size_t>(row.level));
+    for (auto const caller : path)
+      caller->inclusive += row.exclusive;
+    path.push_back(&row);
+  }
+  *stream << "Level,Function Name,Inclusive Samples,Exclusive Samples," <<
+      "Inclusive Samples %,Exclusive Samples %,Module Name\n";
+  for (auto const& row : rows) {
+    *stream << row.level << ",\"ns::Class<int, char>::Function" <<
+        row.function << "(int)\"," << row.inclusive << "," <<
+        row.exclusive << ",0.00,0.00,module" << row.function % 4 <<
+        ".dll\n";
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MapMerger
+// Reads lines and keeps samples by path of names, as calltree2dot.py
+// keeps entries.
+//
+class MapMerger final {
+  private: std::map<std::string, std::pair<uint64_t, uint64_t>> samples_;
+
+  public: MapMerger() = default;
+  public: ~MapMerger() = default;
+
+  public: size_t memory_size() const;
+  public: size_t size() const { return samples_.size(); }
+
+  public: void AddFile(const std::string& file_name);
+
+  DISALLOW_COPY_AND_ASSIGN(MapMerger);
+};
+
+size_t MapMerger::memory_size() const {
+  size_t size = 0;
+  for (auto const& pair : samples_)
+    size += pair.first.capacity() + sizeof(pair) + 32;
+  return size;
+}
+
+void MapMerger::AddFile(const std::string& file_name) {
+  std::ifstream stream(file_name);
+  std::string line;
+  std::getline(stream, line);
+  std::vector<std::string> path;
+  while (std::getline(stream, line)) {
+    std::vector<std::string> fields;
+    std::string field;
+    auto quoted = false;
+    for (auto const ch : line) {
+      if (ch == '"') {
+        quoted = !quoted;
+      } else if (ch == ',' && !quoted) {
+        fields.push_back(field);
+        field.clear();
+      } else {
+        field.push_back(ch);
+      }
+    }
+    fields.push_back(field);
+    auto const level = static_cast<size_t>(atoi(fields[0].c_str()));
+    path.resize(level);
+    path.push_back(fields[1]);
+    std::string key;
+    for (auto const& name : path)
+      key += name + ";";
+    auto& samples = samples_[key];
+    samples.first += static_cast<uint64_t>(atoll(fields[2].c_str()));
+    samples.second += static_cast<uint64_t>(atoll(fields[3].c_str()));
+  }
+}
+
+// Returns sum of exclusive samples in merged CSV.
+uint64_t SumExclusive(const std::string& csv) {
+  std::istringstream stream(csv);
+  std::string line;
+  std::getline(stream, line);
+  uint64_t sum = 0;
+  while (std::getline(stream, line)) {
+    // Exclusive samples follow inclusive samples after the quoted name.
+    auto const name_end = line.find("\",");
+    auto const comma = line.find(',', name_end + 2);
+    sum += static_cast<uint64_t>(atoll(line.c_str() + comma + 1));
+  }
+  return sum;
+}
+
+// Merges a CSV of the Visual Studio profiler, with a byte order mark, CRLF
+// and numbers with thousands separators, and a CSV of |base::CallTree|.
+bool VerifyMerge() {
+  static const char kStudioCsv[] =
+      "\xEF\xBB\xBF"
+      "Level,Function Name,Inclusive Samples,Exclusive Samples,"
+      "Inclusive Samples %,Exclusive Samples %,Module Name\r\n"
+      "0,\"dtest.exe\",\"1,200\",0,100.00 %,0.00 %,\"dtest.exe\"\r\n"
+      "1,\"blink::Node::~Node\",\"1,200\",200,100.00 %,16.67 %,"
+      "\"blink_platform.dll\"\r\n"
+      "2,\"Paint\",\"1,000\",100,83.33 %,8.33 %,\"blink_platform.dll\"\r\n"
+      "3,\"memcpy\",900,600,75.00 %,50.00 %,\"ntdll.dll\"\r\n"
+      "4,\"RtlCopy\",300,300,25.00 %,25.00 %,\"ntdll.dll\"\r\n";
+  static const char kProfilerCsv[] =
+      "Level,Function Name,Inclusive Samples,Exclusive Samples,"
+      "Inclusive Samples %,Exclusive Samples %,Module Name\n"
+      "0,\"dtest.exe\",100,0,100.00,0.00,\"dtest.exe\"\n"
+      "1,\"Node::~Node\",100,0,100.00,0.00,\"blink_platform.dll\"\n"
+      "2,\"Paint\",100,50,100.00,50.00,\"blink_platform.dll\"\n"
+      "3,\"std::map<int, \"\"a\"\">::find\",50,50,50.00,50.00,"
+      "\"libc.so\"\n";
+  profiling::CallTreeFilter filter;
+  profiling::CallTreeMerger merger(filter, 100);
+  if (!merger.AddCsv(kStudioCsv, sizeof(kStudioCsv) - 1) ||
+      !merger.AddCsv(kProfilerCsv, sizeof(kProfilerCsv) - 1)) {
+    return false;
+  }
+  // "~Node" is ignored, and "RtlCopy" is merged into "memcpy" in the same
+  // module.
+  std::ostringstream csv;
+  merger.WriteCsv(&csv);
+  if (csv.str() !=
+      "Level,Function Name,Inclusive Samples,Exclusive Samples,"
+      "Inclusive Samples %,Exclusive Samples %,Module Name\n"
+      "0,\"dtest.exe\",1300,200,100.00,15.38,\"dtest.exe\"\n"
+      "1,\"Paint\",1100,150,84.62,11.54,\"blink_platform.dll\"\n"
+      "2,\"memcpy\",900,900,69.23,69.23,\"ntdll.dll\"\n"
+      "2,\"std::map<int, \"\"a\"\">::find\",50,50,3.85,3.85,\"libc.so\"\n" ||
+      merger.num_filtered_rows() != 3) {
+    printf("%s", csv.str().c_str());
+    return false;
+  }
+  std::ostringstream folded;
+  merger.WriteFolded(&folded);
+  if (folded.str() !=
+      "dtest.exe 200\n"
+      "dtest.exe;Paint 150\n"
+      "dtest.exe;Paint;memcpy 900\n"
+      "dtest.exe;Paint;std::map<int, \"a\">::find 50\n") {
+    printf("%s", folded.str().c_str());
+    return false;
+  }
+
+  // Share of "Paint" is down from 1000/1200 to 100/100.
+  profiling::CallTreeMerger before(filter, 100);
+  profiling::CallTreeMerger after(filter, 100);
+  before.AddCsv(kStudioCsv, sizeof(kStudioCsv) - 1);
+  after.AddCsv(kProfilerCsv, sizeof(kProfilerCsv) - 1);
+  std::ostringstream diff;
+  profiling::WriteDiff(before, after, 3, &diff);
+  if (diff.str() !=
+      "Function Name,Module Name,Inclusive Samples Before,"
+      "Inclusive Samples After,Inclusive % Delta,Exclusive Samples Before,"
+      "Exclusive Samples After,Exclusive % Delta\n"
+      "\"memcpy\",\"ntdll.dll\",900,0,-75.00,900,0,-75.00\n"
+      "\"std::map<int, \"\"a\"\">::find\",\"libc.so\",0,50,50.00,0,50,"
+      "50.00\n"
+      "\"Paint\",\"blink_platform.dll\",1000,100,16.67,100,50,41.67\n") {
+    printf("%s", diff.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_rows = argc >= 2 ?
+      static_cast<size_t>(atoll(argv[1])) : 2000000;
+  std::string const file_name = argc >= 3 ? argv[2] :
+                                            "calltree_benchmark.csv";
+  {
+    std::ofstream stream(file_name);
+    WriteRandomCsv(num_rows, &stream);
+  }
+  profiling::MappedFile file;
+  if (!file.Open(file_name)) {
+    printf("FAILED: can't open %s\n", file_name.c_str());
+    return EXIT_FAILURE;
+  }
+  auto const megabytes = file.size() / 1e6;
+  std::cout << num_rows << " rows, " << megabytes << " MB" << std::endl;
+
+  auto failed = false;
+  profiling::CallTreeFilter filter;
+  filter.set_enabled(false);
+  printf("%-20s %10s %10s %10s\n", "merger", "MB/s", "nodes", "MB");
+  profiling::CallTreeMerger merger(filter, 4000000);
+  auto start = base::TimeTicks::Now();
+  merger.AddCsv(file.data(), file.size());
+  auto const merger_seconds =
+      (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  // A node, its entry in the map of children and its function.
+  printf("%-20s %10.1f %10u %10.1f\n", "mapped", megabytes / merger_seconds,
+         static_cast<unsigned>(merger.num_nodes()),
+         merger.num_nodes() * 96 / 1e6);
+
+  profiling::CallTreeMerger bounded(filter, 1000);
+  start = base::TimeTicks::Now();
+  bounded.AddCsv(file.data(), file.size());
+  auto const bounded_seconds =
+      (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  printf("%-20s %10.1f %10u %10.1f\n", "mapped, 1000 nodes",
+         megabytes / bounded_seconds,
+         static_cast<unsigned>(bounded.num_nodes()),
+         bounded.num_nodes() * 96 / 1e6);
+
+  MapMerger map_merger;
+  start = base::TimeTicks::Now();
+  map_merger.AddFile(file_name);
+  auto const map_seconds =
+      (base::TimeTicks::Now() - start).InMillisecondsF() / 1000;
+  printf("%-20s %10.1f %10u %10.1f\n", "getline and map",
+         megabytes / map_seconds, static_cast<unsigned>(map_merger.size()),
+         map_merger.memory_size() / 1e6);
+
+  // Both mergers have a node per path, and samples of all rows add up.
+  std::ostringstream csv;
+  merger.WriteCsv(&csv);
+  std::ostringstream bounded_csv;
+  bounded.WriteCsv(&bounded_csv);
+  if (merger.num_nodes() - 1 != map_merger.size() ||
+      merger.num_rows() != num_rows || merger.num_truncated_rows() ||
+      bounded.num_nodes() != 1000 || !bounded.num_truncated_rows() ||
+      bounded.num_samples() != merger.num_samples() ||
+      SumExclusive(csv.str()) != merger.num_samples() ||
+      SumExclusive(bounded_csv.str()) != merger.num_samples()) {
+    printf("FAILED: samples of merged tree don't add up\n");
+    failed = true;
+  }
+  if (!VerifyMerge()) {
+    printf("FAILED: wrong merge, folded stacks or diff\n");
+    failed = true;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
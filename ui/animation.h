@@ -0,0 +1,188 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_animation_h)
+#define INCLUDE_ui_animation_h
+
+namespace ui {
+
+class Animatable;
+
+//////////////////////////////////////////////////////////////////////
+//
+// Animation
+//
+class Animation  {
+  public: enum class FillMode {
+    Auto,
+    Backward,
+    Both,
+    Forward,
+    None,
+  };
+
+  public: enum class PlaybackDirection {
+    Alternate,
+    AlternateReverse,
+    Normal,
+    Reverse,
+  };
+
+  public: enum class State {
+    Finish,
+    NotStarted,
+    Running,
+  };
+
+  public: struct Timing {
+    base::TimeDelta delay;
+    PlaybackDirection direction;
+    base::TimeDelta duration;
+    base::TimeDelta end_delay;
+    FillMode fill;
+    double iterations;
+    base::TimeDelta iteration_start;
+
+    Timing();
+    ~Timing() = default;
+  };
+
+  public: class Variable {
+    private: double end_value_;
+    private: double start_value_;
+
+    public: Variable(double start_value, double end_value);
+    public: ~Variable() = default;
+
+    public: double end_value() const { return end_value_; }
+    public: double start_value() const { return start_value_; }
+
+    DISALLOW_COPY_AND_ASSIGN(Variable);
+  };
+
+  private: Animatable* animatable_;
+  private: base::TimeTicks current_time_;
+  private: State state_;
+  private: base::TimeTicks start_time_;
+  private: Timing timing_;
+
+  public: Animation(Animatable* animatable, const Timing& timing);
+  public: ~Animation();
+
+  public: Variable* CreateVariable(double start_value, double end_value);
+  public: double GetDouble(const Variable* variable) const;
+  // Returns time when this animation changes at or after |current_time|,
+  // e.g. end of start delay, for requesting a frame by timer instead of
+  // every frame.
+  public: base::TimeTicks NextFrameTime(base::TimeTicks current_time) const;
+  public: void Play(base::TimeTicks time);
+  public: void Start(base::TimeTicks time);
+  public: void Stop();
+
+  DISALLOW_COPY_AND_ASSIGN(Animation);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Animatable
+//
+class Animatable {
+  public: Animatable() = default;
+  public: virtual ~Animatable() = default;
+
+  public: virtual void DidFinishAnimation() = 0;
+  public: virtual void DidFireAnimationTimer() = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Animatable);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Animation
+//
+Animation::Animation(Animatable* animatable, const Timing& timing)
+    : animatable_(animatable), state_(State::NotStarted), timing_(timing) {
+}
+
+Animation::~Animation() {
+}
+
+Animation::Variable* Animation::CreateVariable(double start_value,
+                                               double end_value) {
+  return new Variable(start_value, end_value);
+}
+
+double Animation::GetDouble(const Variable* variable) const {
+  DCHECK_EQ(state_, State::Running);
+  auto const max_time = start_time_ + timing_.delay + timing_.duration;
+  auto const animate_start_time = start_time_ + timing_.delay;
+  auto const animate_time = std::min(current_time_, max_time);
+  auto const duration = timing_.duration - timing_.delay - timing_.end_delay;
+  auto const scale = (animate_time - animate_start_time).InMillisecondsF() /
+      duration.InMillisecondsF();
+  auto const span = variable->end_value() - variable->start_value();
+  return variable->start_value() + span * scale;
+}
+
+base::TimeTicks Animation::NextFrameTime(
+    base::TimeTicks current_time) const {
+  if (state_ != State::Running)
+    return current_time;
+  auto const active_start_time = start_time_ + timing_.delay;
+  if (current_time < active_start_time)
+    return active_start_time;
+  auto const finish_time = start_time_ + timing_.duration;
+  if (current_time >= finish_time - timing_.end_delay)
+    return std::max(finish_time, current_time);
+  return current_time;
+}
+
+void Animation::Play(base::TimeTicks current_time) {
+  if (state_ == State::NotStarted) {
+    Start(current_time);
+    return;
+  }
+  if (state_ != State::Running)
+    return;
+  current_time_ = current_time;
+  if (current_time_ < start_time_ + timing_.delay)
+    return;
+  animatable_->DidFireAnimationTimer();
+  if (current_time < start_time_ + timing_.duration)
+    return;
+  state_ = State::Finish;
+  animatable_->DidFinishAnimation();
+}
+
+void Animation::Start(base::TimeTicks time_ticks) {
+  DCHECK_EQ(state_, State::NotStarted);
+  state_ = State::Running;
+  start_time_ = time_ticks;
+  current_time_ = time_ticks;
+}
+
+void Animation::Stop() {
+  Play(start_time_ + timing_.delay + timing_.duration);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Animation::Timing
+//
+Animation::Timing::Timing()
+    : direction(PlaybackDirection::Normal), fill(FillMode::None),
+      iterations(0) {
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Animation::Variable
+//
+Animation::Variable::Variable(double start_value, double end_value)
+    : end_value_(end_value), start_value_(start_value) {
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_animation_h)
@@ -0,0 +1,420 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Feeds pointer moves at 1000 Hz, wheel events at 500 Hz and a click every
+// 100 ms from an input thread, with four swap chains signaled ready by a
+// presenter thread 3 ms after each present. Compares |ui::EventLoop| with
+// a loop polling every millisecond, as |ui::Scheduler::Run(Method::Timer)|
+// does, which dispatches every input event and checks every swap chain
+// with zero timeout. Reports wakeups, dispatched events, latency from
+// input to dispatch and from input to the frame which handles it.
+//
+// Pointer moves and wheel events wait for the frame in |ui::EventLoop|, so
+// their dispatch is later than polling, but input to frame should be the
+// same.
+//
+// Returns EXIT_FAILURE if wheel deltas or clicks are lost, clicks are out
+// of order, or |ui::EventLoop| holds input longer than a frame interval or
+// shows it in a later frame than polling.
+//
+// Compile by using:
+//  g++ -std=c++11 -O2 -pthread -I. ui/event_loop_linux_benchmark.cc
+//
+// Usage: event_loop_linux_benchmark [milliseconds]
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/timer/timing_wheel.h"
+#include "ui/frame_scheduler.h"
+#include "ui/input_coalescer.h"
+#include "ui/event_loop_linux.h"
+
+namespace {
+
+const int kClickInterval = 100;
+const int kNumSwapChains = 4;
+const int64_t kPresentLatency = 3000;
+const int64_t kInterval = 16667;
+
+int64_t Percentile(std::vector<int64_t> values, int percent) {
+  if (values.empty())
+    return 0;
+  auto const index = (values.size() - 1) * percent / 100;
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// PollingLoop
+// Wakes up every millisecond, dispatches each input event as it comes, and
+// checks swap chains with zero timeout poll(). It has the same interface
+// as |ui::EventLoop| for the benchmark.
+//
+class PollingLoop final {
+  public: typedef std::function<void()> Callback;
+
+  private: ui::EventLoop::FrameCallback frame_callback_;
+  private: ui::FrameScheduler frame_scheduler_;
+  private: ui::InputCoalescer::Dispatcher input_dispatcher_;
+  private: std::mutex mutex_;
+  private: uint64_t num_wakeups_;
+  private: std::vector<ui::InputEvent> posted_events_;
+  private: std::vector<Callback> posted_tasks_;
+  private: bool quit_;
+  private: std::vector<std::pair<int, Callback>> watches_;
+
+  public: PollingLoop(base::TimeDelta interval,
+                      const ui::EventLoop::FrameCallback& frame_callback,
+                      const ui::InputCoalescer::Dispatcher& input_dispatcher);
+  public: ~PollingLoop() = default;
+
+  public: uint64_t num_wakeups() const { return num_wakeups_; }
+
+  public: void AddWatch(int fd, const Callback& callback);
+  public: void PostInputEvent(const ui::InputEvent& event);
+  public: void PostTask(const Callback& task);
+  public: void Quit() { quit_ = true; }
+  public: void RequestFrame();
+  public: void Run();
+
+  DISALLOW_COPY_AND_ASSIGN(PollingLoop);
+};
+
+PollingLoop::PollingLoop(
+    base::TimeDelta interval,
+    const ui::EventLoop::FrameCallback& frame_callback,
+    const ui::InputCoalescer::Dispatcher& input_dispatcher)
+    : frame_callback_(frame_callback), frame_scheduler_(interval),
+      input_dispatcher_(input_dispatcher), num_wakeups_(0), quit_(false) {
+}
+
+void PollingLoop::AddWatch(int fd, const Callback& callback) {
+  watches_.push_back(std::make_pair(fd, callback));
+}
+
+void PollingLoop::PostInputEvent(const ui::InputEvent& event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  posted_events_.push_back(event);
+}
+
+void PollingLoop::PostTask(const Callback& task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  posted_tasks_.push_back(task);
+}
+
+void PollingLoop::RequestFrame() {
+  frame_scheduler_.RequestFrame(base::TimeTicks::Now());
+}
+
+void PollingLoop::Run() {
+  while (!quit_) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ++num_wakeups_;
+    std::vector<ui::InputEvent> events;
+    std::vector<Callback> tasks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      events.swap(posted_events_);
+      tasks.swap(posted_tasks_);
+    }
+    for (auto const& event : events) {
+      input_dispatcher_(event);
+      RequestFrame();
+    }
+    for (auto const& task : tasks)
+      task();
+    for (auto const& watch : watches_) {
+      pollfd poll_fd = {watch.first, POLLIN, 0};
+      if (::poll(&poll_fd, 1, 0) > 0)
+        watch.second();
+    }
+    if (frame_scheduler_.needs_frame() &&
+        frame_scheduler_.NextFrameTime() <= base::TimeTicks::Now()) {
+      auto const args = frame_scheduler_.BeginFrame(base::TimeTicks::Now());
+      if (frame_callback_(args))
+        RequestFrame();
+      frame_scheduler_.DidFinishFrame(args, base::TimeTicks::Now());
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Presenter
+// Signals a swap chain ready |kPresentLatency| after it is presented.
+//
+class Presenter final {
+  private: std::condition_variable condition_;
+  private: std::mutex mutex_;
+  // Pairs of ready time and swap chain.
+  private: std::deque<std::pair<base::TimeTicks, int>> pending_;
+  private: bool shutting_down_;
+  private: std::vector<std::unique_ptr<ui::FrameReadySignal>> signals_;
+  private: std::thread thread_;
+
+  public: Presenter();
+  public: ~Presenter();
+
+  public: ui::FrameReadySignal* signal(int index) {
+    return signals_[index].get();
+  }
+
+  public: void Present(int index);
+
+  private: void ThreadMain();
+
+  DISALLOW_COPY_AND_ASSIGN(Presenter);
+};
+
+Presenter::Presenter() : shutting_down_(false) {
+  for (auto index = 0; index < kNumSwapChains; ++index) {
+    signals_.push_back(std::unique_ptr<ui::FrameReadySignal>(
+        new ui::FrameReadySignal()));
+    signals_.back()->Signal();
+  }
+  thread_ = std::thread(&Presenter::ThreadMain, this);
+}
+
+Presenter::~Presenter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+}
+
+void Presenter::Present(int index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::make_pair(
+        base::TimeTicks::Now() +
+            base::TimeDelta::FromMicroseconds(kPresentLatency),
+        index));
+  }
+  condition_.notify_one();
+}
+
+void Presenter::ThreadMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    condition_.wait(lock, [this]() {
+      return shutting_down_ || !pending_.empty();
+    });
+    if (shutting_down_)
+      return;
+    auto const entry = pending_.front();
+    pending_.pop_front();
+    lock.unlock();
+    auto const delay = entry.first - base::TimeTicks::Now();
+    if (delay > base::TimeDelta()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(
+          delay.InMicroseconds()));
+    }
+    signals_[entry.second]->Signal();
+    lock.lock();
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  int64_t dispatch_p50;
+  int64_t dispatch_p99;
+  int64_t frame_p50;
+  int64_t frame_p99;
+  int num_clicks;
+  uint64_t num_dispatched;
+  uint64_t num_frames;
+  uint64_t num_posted;
+  uint64_t num_wakeups;
+  bool clicks_in_order;
+  float wheel_delta;
+};
+
+// Runs |Loop| with an application painting swap chains on input.
+template<typename Loop>
+Result Run(int milliseconds) {
+  Result result = Result();
+  result.clicks_in_order = true;
+  std::vector<int64_t> dispatch_latencies;
+  std::vector<int64_t> frame_latencies;
+  // Time of the oldest input event not yet handled by a frame.
+  base::TimeTicks oldest_input;
+  auto has_input = false;
+  auto expected_click = ui::InputEvent::Type::PointerDown;
+  bool ready[kNumSwapChains] = {};
+  Presenter presenter;
+  Loop* loop_pointer = nullptr;
+
+  auto const dispatcher = [&](const ui::InputEvent& event) {
+    auto const now = base::TimeTicks::Now();
+    dispatch_latencies.push_back((now - event.time_stamp).InMicroseconds());
+    ++result.num_dispatched;
+    result.wheel_delta += event.wheel_delta_y;
+    if (!ui::InputCoalescer::IsContinuous(event.type)) {
+      result.clicks_in_order &= event.type == expected_click;
+      expected_click = event.type == ui::InputEvent::Type::PointerDown ?
+          ui::InputEvent::Type::PointerUp : ui::InputEvent::Type::PointerDown;
+      ++result.num_clicks;
+      loop_pointer->RequestFrame();
+    }
+    if (!has_input || event.time_stamp < oldest_input)
+      oldest_input = event.time_stamp;
+    has_input = true;
+  };
+  auto const frame_callback = [&](const ui::BeginFrameArgs&) {
+    ++result.num_frames;
+    if (has_input) {
+      frame_latencies.push_back(
+          (base::TimeTicks::Now() - oldest_input).InMicroseconds());
+      has_input = false;
+    }
+    // Swap chains not ready yet are painted in the next frame, which the
+    // next input requests.
+    for (auto index = 0; index < kNumSwapChains; ++index) {
+      if (!ready[index])
+        continue;
+      ready[index] = false;
+      presenter.Present(index);
+    }
+    return false;
+  };
+
+  Loop loop(base::TimeDelta::FromMicroseconds(kInterval), frame_callback,
+            dispatcher);
+  loop_pointer = &loop;
+  for (auto index = 0; index < kNumSwapChains; ++index) {
+    auto const signal = presenter.signal(index);
+    auto const ready_pointer = &ready[index];
+    loop.AddWatch(signal->fd(), [signal, ready_pointer]() {
+      if (signal->Reset())
+        *ready_pointer = true;
+    });
+  }
+
+  std::atomic<uint64_t> num_posted(0);
+  std::thread input_thread([&]() {
+    auto const start = std::chrono::steady_clock::now();
+    for (auto tick = 0; tick < milliseconds; ++tick) {
+      std::this_thread::sleep_until(start + std::chrono::milliseconds(tick));
+      ui::InputEvent event = ui::InputEvent();
+      event.num_coalesced = 1;
+      event.time_stamp = base::TimeTicks::Now();
+      event.type = ui::InputEvent::Type::PointerMove;
+      event.x = static_cast<float>(tick % 640);
+      event.y = static_cast<float>(tick % 480);
+      loop.PostInputEvent(event);
+      ++num_posted;
+      if (tick % 2 == 0) {
+        event.type = ui::InputEvent::Type::Wheel;
+        event.wheel_delta_y = 1;
+        loop.PostInputEvent(event);
+        ++num_posted;
+      }
+      if (tick % kClickInterval == 0 || tick % kClickInterval == 5) {
+        event.type = tick % kClickInterval ? ui::InputEvent::Type::PointerUp :
+                                             ui::InputEvent::Type::PointerDown;
+        event.wheel_delta_y = 0;
+        loop.PostInputEvent(event);
+        ++num_posted;
+      }
+    }
+    // Let the last frame run before quit.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    loop.PostTask([&loop]() { loop.Quit(); });
+  });
+  loop.Run();
+  input_thread.join();
+
+  result.dispatch_p50 = Percentile(dispatch_latencies, 50);
+  result.dispatch_p99 = Percentile(dispatch_latencies, 99);
+  result.frame_p50 = Percentile(frame_latencies, 50);
+  result.frame_p99 = Percentile(frame_latencies, 99);
+  result.num_posted = num_posted;
+  result.num_wakeups = loop.num_wakeups();
+  return result;
+}
+
+void PrintResult(const char* name, const Result& result, int milliseconds) {
+  printf("%-10s %10.1f %10.1f %8.1f %8lld %8lld %8lld %8lld\n", name,
+         result.num_wakeups * 1000.0 / milliseconds,
+         result.num_dispatched * 1000.0 / milliseconds,
+         result.num_frames * 1000.0 / milliseconds,
+         static_cast<long long>(result.dispatch_p50),
+         static_cast<long long>(result.dispatch_p99),
+         static_cast<long long>(result.frame_p50),
+         static_cast<long long>(result.frame_p99));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const milliseconds = argc >= 2 ? atoi(argv[1]) : 3000;
+  std::cout << milliseconds << " ms of input, " << kNumSwapChains <<
+      " swap chains" << std::endl;
+
+  printf("%-10s %10s %10s %8s %8s %8s %8s %8s\n", "loop", "wakeups/s",
+         "events/s", "frames/s", "disp p50", "disp p99", "frame p50",
+         "frame p99");
+  auto const polling = Run<PollingLoop>(milliseconds);
+  PrintResult("polling", polling, milliseconds);
+  auto const epoll = Run<ui::EventLoop>(milliseconds);
+  PrintResult("epoll", epoll, milliseconds);
+
+  auto const expected_wheel = static_cast<float>((milliseconds + 1) / 2);
+  auto const expected_clicks = (milliseconds + kClickInterval - 1) /
+                               kClickInterval +
+                               (milliseconds + kClickInterval - 6) /
+                               kClickInterval;
+  auto failed = false;
+  for (auto const& result : {polling, epoll}) {
+    failed |= result.wheel_delta != expected_wheel ||
+              result.num_clicks != expected_clicks ||
+              !result.clicks_in_order;
+  }
+  if (failed) {
+    printf("FAILED: input events are lost or out of order\n");
+    return EXIT_FAILURE;
+  }
+  printf("epoll against polling: dispatch p50 %+lld us, frame p50 %+lld us\n",
+         static_cast<long long>(epoll.dispatch_p50 - polling.dispatch_p50),
+         static_cast<long long>(epoll.frame_p50 - polling.frame_p50));
+  // A quarter of interval is slack for late wakeups.
+  if (epoll.dispatch_p99 > kInterval * 5 / 4 ||
+      epoll.frame_p50 > polling.frame_p50 + kInterval / 4) {
+    printf("FAILED: input waits longer than a frame\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
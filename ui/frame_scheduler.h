@@ -0,0 +1,279 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_frame_scheduler_h)
+#define INCLUDE_ui_frame_scheduler_h
+
+namespace ui {
+
+//////////////////////////////////////////////////////////////////////
+//
+// BeginFrameArgs
+// |frame_time| is the vsync which starts a frame, animations should use it
+// instead of current time for smooth motion. It is current time when we
+// woke up a bit before the vsync, so animations never sample ahead of now.
+// A frame should be committed before |deadline| to be shown at the next
+// vsync.
+//
+struct BeginFrameArgs {
+  base::TimeTicks deadline;
+  base::TimeTicks frame_time;
+  base::TimeDelta interval;
+  uint64_t sequence_number;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// VsyncPredictor
+// Predicts vsync times from timestamps of presented frames. Each timestamp
+// adjusts the phase by a quarter of its error and the interval by a
+// sixteenth of its error per interval, so jitter of timestamps is smoothed
+// out.
+//
+// A timestamp more than a quarter of interval off the prediction is an
+// outlier and ignored. |kMaxOutliers| outliers in a row mean vsync phase is
+// changed, e.g. the window moved to another display, and we restart
+// prediction from the last timestamp.
+//
+class VsyncPredictor final {
+  public: static const int kMaxOutliers = 4;
+
+  // Microseconds between vsyncs.
+  private: double interval_;
+  private: uint64_t num_outliers_;
+  private: uint64_t num_samples_;
+  private: int num_successive_outliers_;
+  // Microseconds of a vsync.
+  private: double phase_;
+
+  public: explicit VsyncPredictor(base::TimeDelta interval);
+  public: ~VsyncPredictor() = default;
+
+  public: base::TimeDelta interval() const;
+  public: uint64_t num_outliers() const { return num_outliers_; }
+  public: uint64_t num_samples() const { return num_samples_; }
+
+  // |refresh_interval| is the refresh rate reported by the compositor, or
+  // zero if unknown. A timestamp alone can't tell a rate change, e.g. we
+  // see only every other vsync at 144 Hz when frames start every other
+  // vsync.
+  public: void AddTimestamp(base::TimeTicks timestamp,
+                            base::TimeDelta refresh_interval);
+  // Returns the latest vsync at or before |time|.
+  public: base::TimeTicks LastVsyncAt(base::TimeTicks time) const;
+  // Returns the earliest vsync after |time|.
+  public: base::TimeTicks NextVsyncAfter(base::TimeTicks time) const;
+
+  private: static base::TimeTicks FromMicroseconds(double microseconds);
+  private: static double ToMicroseconds(base::TimeTicks time);
+
+  DISALLOW_COPY_AND_ASSIGN(VsyncPredictor);
+};
+
+VsyncPredictor::VsyncPredictor(base::TimeDelta interval)
+    : interval_(static_cast<double>(interval.InMicroseconds())),
+      num_outliers_(0), num_samples_(0), num_successive_outliers_(0),
+      phase_(0) {
+}
+
+base::TimeDelta VsyncPredictor::interval() const {
+  return base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(::floor(interval_ + 0.5)));
+}
+
+void VsyncPredictor::AddTimestamp(base::TimeTicks timestamp,
+                                  base::TimeDelta refresh_interval) {
+  auto const time = ToMicroseconds(timestamp);
+  auto const reported = static_cast<double>(
+      refresh_interval.InMicroseconds());
+  if (reported > 0 && ::fabs(reported - interval_) > interval_ / 8) {
+    // Refresh rate is changed.
+    interval_ = reported;
+    num_successive_outliers_ = 0;
+    num_samples_ = 0;
+  }
+  if (!num_samples_) {
+    phase_ = time;
+    ++num_samples_;
+    return;
+  }
+
+  // Timestamp of a vsync we already know, e.g. no frame is presented since
+  // the last call.
+  if (time <= phase_ + interval_ / 4)
+    return;
+
+  auto const num_intervals = std::max(
+      ::floor((time - phase_) / interval_ + 0.5), 1.0);
+  auto const error = time - phase_ - num_intervals * interval_;
+  if (::fabs(error) > interval_ / 4) {
+    ++num_outliers_;
+    if (++num_successive_outliers_ < kMaxOutliers)
+      return;
+    num_successive_outliers_ = 0;
+    phase_ = time;
+    ++num_samples_;
+    return;
+  }
+
+  num_successive_outliers_ = 0;
+  phase_ += num_intervals * interval_ + error / 4;
+  interval_ += error / num_intervals / 16;
+  ++num_samples_;
+}
+
+base::TimeTicks VsyncPredictor::FromMicroseconds(double microseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(
+      static_cast<int64_t>(::floor(microseconds + 0.5)));
+}
+
+base::TimeTicks VsyncPredictor::LastVsyncAt(base::TimeTicks time) const {
+  auto const num_intervals = ::floor((ToMicroseconds(time) - phase_) /
+                                     interval_);
+  auto const vsync = FromMicroseconds(phase_ + num_intervals * interval_);
+  // Rounding to microseconds can move the vsync after |time|.
+  return vsync > time ? time : vsync;
+}
+
+base::TimeTicks VsyncPredictor::NextVsyncAfter(base::TimeTicks time) const {
+  auto const num_intervals = ::floor((ToMicroseconds(time) - phase_) /
+                                     interval_) + 1;
+  auto const vsync = FromMicroseconds(phase_ + num_intervals * interval_);
+  return vsync > time ? vsync : time + base::TimeDelta::FromMicroseconds(1);
+}
+
+double VsyncPredictor::ToMicroseconds(base::TimeTicks time) {
+  return static_cast<double>((time - base::TimeTicks()).InMicroseconds());
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameScheduler
+// Decides when frames start from predicted vsyncs. A caller sleeps until
+// |NextFrameTime()|, calls |BeginFrame()|, runs the frame, then calls
+// |DidFinishFrame()| and |DidPresent()| with the latest vsync timestamp
+// from the compositor.
+//
+// The deadline of a frame is a quarter of interval before the next vsync,
+// for the compositor to pick up the frame. A frame starting after the
+// deadline of its vsync skips to the latest vsync instead of running late.
+//
+// Frames are produced on demand. |BeginFrame()| consumes the request, and
+// callers call |RequestFrame()| during a frame to keep animating, or on
+// invalidation, input or animation start. Callers shouldn't wake up while
+// |needs_frame()| is false. A request after idle starts a frame at once if
+// it is in the first half of vsync interval, otherwise at the next vsync.
+//
+class FrameScheduler final {
+  private: base::TimeTicks last_finish_time_;
+  private: base::TimeTicks last_frame_time_;
+  private: bool needs_frame_;
+  private: uint64_t num_frames_;
+  private: uint64_t num_missed_deadlines_;
+  private: uint64_t num_skipped_vsyncs_;
+  private: VsyncPredictor predictor_;
+  private: base::TimeTicks request_time_;
+
+  public: explicit FrameScheduler(base::TimeDelta interval);
+  public: ~FrameScheduler() = default;
+
+  public: base::TimeDelta interval() const { return predictor_.interval(); }
+  public: bool needs_frame() const { return needs_frame_; }
+  public: uint64_t num_frames() const { return num_frames_; }
+  // Number of frames finished after their deadline.
+  public: uint64_t num_missed_deadlines() const {
+    return num_missed_deadlines_;
+  }
+  // Number of vsyncs without a frame while animating, because of late
+  // frames.
+  public: uint64_t num_skipped_vsyncs() const { return num_skipped_vsyncs_; }
+  public: const VsyncPredictor& predictor() const { return predictor_; }
+
+  public: BeginFrameArgs BeginFrame(base::TimeTicks now);
+  public: void DidFinishFrame(const BeginFrameArgs& args,
+                              base::TimeTicks now);
+  public: void DidPresent(base::TimeTicks vsync_time,
+                          base::TimeDelta refresh_interval);
+  // Returns the time to start the requested frame. It is in the past when
+  // we are late, callers should start a frame immediately.
+  public: base::TimeTicks NextFrameTime() const;
+  public: void RequestFrame(base::TimeTicks now);
+
+  DISALLOW_COPY_AND_ASSIGN(FrameScheduler);
+};
+
+FrameScheduler::FrameScheduler(base::TimeDelta interval)
+    : needs_frame_(true), num_frames_(0), num_missed_deadlines_(0),
+      num_skipped_vsyncs_(0), predictor_(interval) {
+}
+
+BeginFrameArgs FrameScheduler::BeginFrame(base::TimeTicks now) {
+  auto const interval = predictor_.interval();
+  auto const half_interval = base::TimeDelta::FromMicroseconds(
+      interval.InMicroseconds() / 2);
+  auto vsync = predictor_.LastVsyncAt(now);
+  // We woke up a bit before the vsync.
+  if (num_frames_ && vsync < last_frame_time_ + half_interval)
+    vsync = last_frame_time_ + interval;
+  // Vsyncs after a frame without request are idle rather than skipped.
+  if (num_frames_ && request_time_ <= last_finish_time_) {
+    auto const num_skipped = ((vsync - last_frame_time_) -
+                              half_interval).InMicroseconds() /
+                             std::max(interval.InMicroseconds(),
+                                      static_cast<int64_t>(1));
+    num_skipped_vsyncs_ += static_cast<uint64_t>(num_skipped);
+  }
+  last_frame_time_ = vsync;
+  needs_frame_ = false;
+  BeginFrameArgs args;
+  args.deadline = vsync + interval -
+                  base::TimeDelta::FromMicroseconds(
+                      interval.InMicroseconds() / 4);
+  args.frame_time = std::min(vsync, now);
+  args.interval = interval;
+  args.sequence_number = num_frames_;
+  ++num_frames_;
+  return args;
+}
+
+void FrameScheduler::DidFinishFrame(const BeginFrameArgs& args,
+                                    base::TimeTicks now) {
+  last_finish_time_ = now;
+  if (now > args.deadline)
+    ++num_missed_deadlines_;
+}
+
+void FrameScheduler::DidPresent(base::TimeTicks vsync_time,
+                                base::TimeDelta refresh_interval) {
+  predictor_.AddTimestamp(vsync_time, refresh_interval);
+}
+
+base::TimeTicks FrameScheduler::NextFrameTime() const {
+  DCHECK(needs_frame_);
+  if (!num_frames_)
+    return request_time_;
+  auto const interval = predictor_.interval();
+  auto const half_interval = base::TimeDelta::FromMicroseconds(
+      interval.InMicroseconds() / 2);
+  auto const next_vsync = predictor_.NextVsyncAfter(
+      last_frame_time_ + half_interval);
+  if (request_time_ <= last_finish_time_ || request_time_ < next_vsync)
+    return next_vsync;
+  // Request after idle.
+  auto const vsync = predictor_.LastVsyncAt(request_time_);
+  if (request_time_ < vsync + half_interval)
+    return request_time_;
+  return predictor_.NextVsyncAfter(request_time_);
+}
+
+void FrameScheduler::RequestFrame(base::TimeTicks now) {
+  if (needs_frame_)
+    return;
+  needs_frame_ = true;
+  request_time_ = now;
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_frame_scheduler_h)
@@ -0,0 +1,362 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Simulates a display with jittery vsync timestamps and a frame of 1 to 5 ms
+// work with a few long frames, then compares |ui::FrameScheduler| sleeping
+// until the predicted vsync against polling on a 1 ms timer, the |Timer|
+// method of |ui::Scheduler|. Reports wakeups, CPU use, vsyncs without a new
+// frame and distance from frame start to the nearest vsync, on a virtual
+// clock.
+//
+// The refresh rate changes from 59.94 Hz to 144 Hz in the middle, to check
+// the predictor follows it.
+//
+// Then runs an application animating only after input, and checks there is
+// no wakeup while idle.
+//
+// Returns EXIT_FAILURE if the frame scheduler misses vsyncs other than for
+// long frames, frame time of a frame is after its start, or an idle
+// application wakes up.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. ui\frame_scheduler_benchmark.cc
+//  g++ -std=c++11 -O2 -I. ui/frame_scheduler_benchmark.cc
+//
+// Usage: frame_scheduler_benchmark [num_seconds]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "ui/frame_scheduler.h"
+
+namespace {
+
+// Cost of a wakeup without work, e.g. context switch and message loop.
+const int64_t kWakeupCost = 30;
+// The compositor picks up frames committed this long before vsync.
+const int64_t kLatchTime = 1000;
+// Late wakeup of high resolution waitable timer.
+const int64_t kMaxTimerLatency = 200;
+
+base::TimeTicks ToTimeTicks(int64_t microseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(microseconds);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Display
+// Vsyncs at 59.94 Hz until |switch_time| then at 144 Hz. Timestamps
+// reported to the application have +/-300 us jitter, and one of a hundred
+// is 4 ms late.
+//
+class Display final {
+  private: int64_t switch_time_;
+  private: std::vector<int64_t> timestamps_;
+  private: std::vector<int64_t> vsyncs_;
+
+  public: Display(int64_t end_time, int64_t switch_time);
+  public: ~Display() = default;
+
+  public: const std::vector<int64_t>& vsyncs() const { return vsyncs_; }
+
+  // Returns index of the latest vsync at or before |time|.
+  public: size_t LastVsyncAt(int64_t time) const;
+  // Returns distance from |time| to the nearest vsync.
+  public: int64_t DistanceToVsync(int64_t time) const;
+  // Returns refresh interval reported by the display at vsync |index|.
+  public: base::TimeDelta IntervalOf(size_t index) const;
+  public: int64_t TimestampOf(size_t index) const {
+    return timestamps_[index];
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(Display);
+};
+
+Display::Display(int64_t end_time, int64_t switch_time)
+    : switch_time_(switch_time) {
+  uint32_t seed = 7;
+  auto vsync = static_cast<int64_t>(1000);
+  while (vsync < end_time) {
+    vsyncs_.push_back(vsync);
+    auto timestamp = vsync + base::RandomInt(&seed, -300, 300);
+    if (base::NextRandom(&seed) % 100 == 0)
+      timestamp += 4000;
+    timestamps_.push_back(timestamp);
+    vsync += IntervalOf(vsyncs_.size() - 1).InMicroseconds();
+  }
+}
+
+base::TimeDelta Display::IntervalOf(size_t index) const {
+  return base::TimeDelta::FromMicroseconds(
+      vsyncs_[index] < switch_time_ ? 16683 : 6944);
+}
+
+int64_t Display::DistanceToVsync(int64_t time) const {
+  auto const index = LastVsyncAt(time);
+  auto distance = ::llabs(time - vsyncs_[index]);
+  if (index + 1 < vsyncs_.size())
+    distance = std::min(distance, ::llabs(vsyncs_[index + 1] - time));
+  return distance;
+}
+
+size_t Display::LastVsyncAt(int64_t time) const {
+  auto const it = std::upper_bound(vsyncs_.begin(), vsyncs_.end(), time);
+  if (it == vsyncs_.begin())
+    return 0;
+  return static_cast<size_t>(it - vsyncs_.begin()) - 1;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  int64_t busy_time;
+  std::vector<int64_t> delays;
+  std::vector<int64_t> errors;
+  // Frames with frame time after their start.
+  int64_t num_future_frame_times;
+  int64_t num_frames;
+  int64_t num_missed_vsyncs;
+  int64_t num_wakeups;
+};
+
+// Returns number of vsync intervals without a frame committed before latch
+// time.
+int64_t CountMissedVsyncs(const Display& display,
+                          const std::vector<int64_t>& commit_times) {
+  auto const& vsyncs = display.vsyncs();
+  std::vector<bool> has_frame(vsyncs.size());
+  for (auto const commit_time : commit_times) {
+    auto const index = display.LastVsyncAt(commit_time + kLatchTime);
+    if (vsyncs[index] > commit_time + kLatchTime || !index)
+      continue;
+    has_frame[index - 1] = true;
+  }
+  // The last interval isn't finished.
+  return std::count(has_frame.begin(), has_frame.end() - 1, false);
+}
+
+int64_t WorkTime(uint32_t* seed, int64_t* num_long_frames) {
+  if (base::NextRandom(seed) % 200 == 0) {
+    ++*num_long_frames;
+    return 25000;
+  }
+  return base::RandomInt(seed, 1000, 5000);
+}
+
+Result RunPolling(const Display& display, int64_t end_time,
+                  int64_t* num_long_frames) {
+  Result result = Result();
+  std::vector<int64_t> commit_times;
+  uint32_t seed = 11;
+  auto last_vsync = static_cast<size_t>(0);
+  auto now = static_cast<int64_t>(0);
+  while (now < end_time) {
+    ++result.num_wakeups;
+    result.busy_time += kWakeupCost;
+    auto const vsync = display.LastVsyncAt(now);
+    if (vsync != last_vsync) {
+      last_vsync = vsync;
+      result.delays.push_back(now - display.vsyncs()[vsync]);
+      auto const work_time = WorkTime(&seed, num_long_frames);
+      result.busy_time += work_time;
+      now += work_time;
+      commit_times.push_back(now);
+      ++result.num_frames;
+    }
+    // |SetTimer()| fires on the next 1 ms tick after the handler.
+    now = (now / 1000 + 1) * 1000;
+  }
+  result.num_missed_vsyncs = CountMissedVsyncs(display, commit_times);
+  return result;
+}
+
+Result RunFrameScheduler(const Display& display, int64_t end_time,
+                         int64_t* num_long_frames) {
+  Result result = Result();
+  std::vector<int64_t> commit_times;
+  ui::FrameScheduler scheduler(base::TimeDelta::FromMicroseconds(16667));
+  uint32_t seed = 11;
+  auto now = static_cast<int64_t>(0);
+  while (now < end_time) {
+    auto const next_frame_time = (scheduler.NextFrameTime() -
+                                  base::TimeTicks()).InMicroseconds();
+    if (now < next_frame_time)
+      now = next_frame_time + base::RandomInt(&seed, 0, kMaxTimerLatency);
+    ++result.num_wakeups;
+    result.busy_time += kWakeupCost;
+
+    auto const args = scheduler.BeginFrame(ToTimeTicks(now));
+    if (args.frame_time > ToTimeTicks(now))
+      ++result.num_future_frame_times;
+    result.delays.push_back(display.DistanceToVsync(now));
+    if (scheduler.num_frames() > 60) {
+      result.errors.push_back(display.DistanceToVsync(
+          (args.frame_time - base::TimeTicks()).InMicroseconds()));
+    }
+
+    auto const work_time = WorkTime(&seed, num_long_frames);
+    result.busy_time += work_time;
+    now += work_time;
+    commit_times.push_back(now);
+    scheduler.RequestFrame(ToTimeTicks(now));
+    scheduler.DidFinishFrame(args, ToTimeTicks(now));
+    auto const presented = display.LastVsyncAt(now);
+    scheduler.DidPresent(ToTimeTicks(display.TimestampOf(presented)),
+                         display.IntervalOf(presented));
+    ++result.num_frames;
+  }
+  result.num_missed_vsyncs = CountMissedVsyncs(display, commit_times);
+  return result;
+}
+
+// Input every 2 to 4 seconds starts 500 ms animation, and the application
+// is idle otherwise. Frames are requested only while animating.
+Result RunOnDemand(const Display& display, int64_t end_time,
+                   int64_t* num_idle_wakeups) {
+  Result result = Result();
+  ui::FrameScheduler scheduler(base::TimeDelta::FromMicroseconds(16667));
+  uint32_t seed = 13;
+  auto animation_end = static_cast<int64_t>(0);
+  auto input_time = static_cast<int64_t>(-1);
+  auto next_input = base::RandomInt(&seed, 2000000, 4000000);
+  auto now = static_cast<int64_t>(0);
+  while (now < end_time) {
+    // Sleep until the requested frame or the next input, without timer
+    // when no frame is requested.
+    auto wake_time = next_input;
+    auto is_frame = false;
+    if (scheduler.needs_frame()) {
+      auto const frame_time = std::max(
+          now, (scheduler.NextFrameTime() - base::TimeTicks())
+                   .InMicroseconds() +
+               base::RandomInt(&seed, 0, kMaxTimerLatency));
+      if (frame_time < next_input) {
+        wake_time = frame_time;
+        is_frame = true;
+      }
+    }
+    now = std::max(now, wake_time);
+    ++result.num_wakeups;
+    result.busy_time += kWakeupCost;
+    if (!is_frame) {
+      input_time = now;
+      animation_end = now + 500000;
+      next_input = now + base::RandomInt(&seed, 2000000, 4000000);
+      scheduler.RequestFrame(ToTimeTicks(now));
+      continue;
+    }
+
+    // Animation ends within two frames, other frames are idle.
+    if (now > animation_end + 2 * 16683)
+      ++*num_idle_wakeups;
+
+    if (input_time >= 0) {
+      result.delays.push_back(now - input_time);
+      input_time = -1;
+    }
+    auto const args = scheduler.BeginFrame(ToTimeTicks(now));
+    auto const work_time = base::RandomInt(&seed, 1000, 5000);
+    result.busy_time += work_time;
+    now += work_time;
+    if (now < animation_end)
+      scheduler.RequestFrame(ToTimeTicks(now));
+    scheduler.DidFinishFrame(args, ToTimeTicks(now));
+    auto const presented = display.LastVsyncAt(now);
+    scheduler.DidPresent(ToTimeTicks(display.TimestampOf(presented)),
+                         display.IntervalOf(presented));
+    ++result.num_frames;
+  }
+  return result;
+}
+
+int64_t Percentile(std::vector<int64_t> values, int percent) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+void PrintResult(const char* name, const Result& result, int64_t end_time) {
+  auto const seconds = static_cast<double>(end_time) / 1000000;
+  printf("%-16s %10.1f %8.1f%% %10.1f %8lld %8lld %8lld\n", name,
+         result.num_wakeups / seconds,
+         result.busy_time * 100.0 / end_time, result.num_frames / seconds,
+         static_cast<long long>(result.num_missed_vsyncs),
+         static_cast<long long>(Percentile(result.delays, 50)),
+         static_cast<long long>(Percentile(result.delays, 99)));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_seconds = argc >= 2 ? atoi(argv[1]) : 60;
+  auto const end_time = static_cast<int64_t>(num_seconds) * 1000000;
+  Display display(end_time, end_time / 2);
+
+  int64_t num_polling_long_frames = 0;
+  auto const polling = RunPolling(display, end_time,
+                                  &num_polling_long_frames);
+  int64_t num_long_frames = 0;
+  auto const scheduled = RunFrameScheduler(display, end_time,
+                                           &num_long_frames);
+
+  printf("%d seconds, %u vsyncs\n", num_seconds,
+         static_cast<unsigned>(display.vsyncs().size()));
+  printf("%-16s %10s %9s %10s %8s %8s %8s\n", "method", "wakeups/s", "cpu",
+         "frames/s", "missed", "p50(us)", "p99(us)");
+  PrintResult("timer 1ms", polling, end_time);
+  PrintResult("frame scheduler", scheduled, end_time);
+  auto const p99_error = Percentile(scheduled.errors, 99);
+  printf("vsync prediction error p50=%lldus p99=%lldus, %lld long frames\n",
+         static_cast<long long>(Percentile(scheduled.errors, 50)),
+         static_cast<long long>(p99_error),
+         static_cast<long long>(num_long_frames));
+
+  int64_t num_idle_wakeups = 0;
+  auto const on_demand = RunOnDemand(display, end_time, &num_idle_wakeups);
+  printf("on demand: %lld wakeups, %lld frames, %lld idle wakeups,"
+         " cpu %.1f%%, input to frame p50=%lldus p99=%lldus\n",
+         static_cast<long long>(on_demand.num_wakeups),
+         static_cast<long long>(on_demand.num_frames),
+         static_cast<long long>(num_idle_wakeups),
+         on_demand.busy_time * 100.0 / end_time,
+         static_cast<long long>(Percentile(on_demand.delays, 50)),
+         static_cast<long long>(Percentile(on_demand.delays, 99)));
+
+  // Each long frame can miss two vsyncs at 59.94 Hz and four at 144 Hz.
+  auto const max_missed = num_long_frames * 4;
+  if (p99_error > 1000 || scheduled.num_missed_vsyncs > max_missed ||
+      scheduled.num_wakeups > scheduled.num_frames) {
+    printf("FAILED: frame scheduler missed %lld vsyncs, expected <= %lld\n",
+           static_cast<long long>(scheduled.num_missed_vsyncs),
+           static_cast<long long>(max_missed));
+    return EXIT_FAILURE;
+  }
+  // Animations shouldn't sample ahead of the frame presented.
+  if (scheduled.num_future_frame_times) {
+    printf("FAILED: %lld frames start with future frame time\n",
+           static_cast<long long>(scheduled.num_future_frame_times));
+    return EXIT_FAILURE;
+  }
+  // An input should be handled in the vsync interval it arrives.
+  if (num_idle_wakeups || Percentile(on_demand.delays, 99) > 16683) {
+    printf("FAILED: %lld wakeups while idle\n",
+           static_cast<long long>(num_idle_wakeups));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
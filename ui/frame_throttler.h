@@ -0,0 +1,211 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_frame_throttler_h)
+#define INCLUDE_ui_frame_throttler_h
+
+namespace ui {
+
+// Maximum frame rate of a client. Rates are rounded to a whole number of
+// vsyncs, e.g. |Hz10| is every sixth vsync at 60 Hz.
+enum class FrameRate {
+  Hz60,
+  Hz30,
+  Hz10,
+  Hz1,
+  // Ticks only in frames requested by the client, at full rate.
+  OnDemand,
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameThrottler
+// Decides which clients tick in a frame, from their frame rates and
+// policies:
+//  - A hidden client never ticks, its request waits until it is visible.
+//  - An inactive client ticks at most at |kInactiveRate|.
+//
+// A client with a rate ticks in any frame which reaches its next tick,
+// and wakes the scheduler only when it requests a frame. An |OnDemand|
+// client ticks only in frames it requested, also while inactive. The
+// throttler counts vsyncs from the first frame, and ticks are aligned to
+// multiples of vsyncs per tick, so all clients of the same rate tick in
+// the same frame, and slower clients tick in frames of faster clients,
+// e.g. a 1 Hz client ticks with 10 Hz clients. Many throttled clients
+// share wakeups instead of waking up on their own timers.
+//
+class FrameThrottler final {
+  public: typedef size_t ClientId;
+
+  public: static const FrameRate kInactiveRate = FrameRate::Hz10;
+
+  private: struct Client {
+    bool active;
+    // Vsync of the last tick.
+    uint64_t last_vsync;
+    bool needs_frame;
+    uint64_t num_ticks;
+    FrameRate rate;
+    bool registered;
+    bool ticked;
+    bool visible;
+  };
+
+  private: std::vector<Client> clients_;
+  private: base::TimeTicks frame_time_;
+  private: base::TimeDelta interval_;
+  private: uint64_t num_frames_;
+  private: uint64_t num_throttled_;
+  // Number of vsyncs from the first frame to |frame_time_|.
+  private: uint64_t vsync_;
+
+  public: FrameThrottler();
+  public: ~FrameThrottler() = default;
+
+  // Number of frames in which a client requested a tick but was throttled.
+  public: uint64_t num_throttled() const { return num_throttled_; }
+  public: uint64_t num_ticks(ClientId client_id) const {
+    return clients_[client_id].num_ticks;
+  }
+
+  public: ClientId AddClient(FrameRate rate);
+  // Called at start of a frame before |ShouldTick()|.
+  public: void BeginFrame(const BeginFrameArgs& args);
+  // Returns the rate of |client_id| after applying activation policy.
+  public: FrameRate EffectiveRate(ClientId client_id) const;
+  // Sets |time| to the earliest vsync where a client requesting a frame
+  // ticks, and returns true, or returns false if no client needs to tick.
+  // |time| is |now| if a client can tick at once.
+  public: bool NextTickTime(base::TimeTicks now,
+                            base::TimeTicks* time) const;
+  public: void RemoveClient(ClientId client_id);
+  public: void RequestFrame(ClientId client_id);
+  public: void SetActive(ClientId client_id, bool active);
+  public: void SetFrameRate(ClientId client_id, FrameRate rate);
+  public: void SetVisible(ClientId client_id, bool visible);
+  // Returns true if |client_id| ticks in the current frame, and consumes
+  // its request.
+  public: bool ShouldTick(ClientId client_id);
+
+  private: uint64_t VsyncsPerTick(FrameRate rate) const;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameThrottler);
+};
+
+FrameThrottler::FrameThrottler()
+    : num_frames_(0), num_throttled_(0), vsync_(0) {
+}
+
+FrameThrottler::ClientId FrameThrottler::AddClient(FrameRate rate) {
+  Client client = Client();
+  client.active = true;
+  client.rate = rate;
+  client.registered = true;
+  client.visible = true;
+  clients_.push_back(client);
+  return clients_.size() - 1;
+}
+
+void FrameThrottler::BeginFrame(const BeginFrameArgs& args) {
+  if (num_frames_) {
+    auto const microseconds = std::max(args.interval.InMicroseconds(),
+                                       static_cast<int64_t>(1));
+    auto const delta = (args.frame_time - frame_time_).InMicroseconds();
+    vsync_ += static_cast<uint64_t>(std::max(
+        (delta + microseconds / 2) / microseconds, static_cast<int64_t>(1)));
+  }
+  frame_time_ = args.frame_time;
+  interval_ = args.interval;
+  ++num_frames_;
+}
+
+FrameRate FrameThrottler::EffectiveRate(ClientId client_id) const {
+  auto const rate = clients_[client_id].rate;
+  if (clients_[client_id].active)
+    return rate;
+  // Rates are ordered from fast to slow, except for |OnDemand|.
+  if (rate == FrameRate::OnDemand || rate < kInactiveRate)
+    return kInactiveRate;
+  return rate;
+}
+
+bool FrameThrottler::NextTickTime(base::TimeTicks now,
+                                  base::TimeTicks* time) const {
+  auto found = false;
+  for (auto client_id = 0u; client_id < clients_.size(); ++client_id) {
+    auto const& client = clients_[client_id];
+    if (!client.registered || !client.visible || !client.needs_frame)
+      continue;
+    auto tick_time = now;
+    auto const vsyncs_per_tick = VsyncsPerTick(EffectiveRate(client_id));
+    auto const next_vsync = (client.last_vsync / vsyncs_per_tick + 1) *
+                            vsyncs_per_tick;
+    if (client.ticked && next_vsync > vsync_ + 1) {
+      tick_time = std::max(
+          frame_time_ + base::TimeDelta::FromMicroseconds(
+              static_cast<int64_t>(next_vsync - vsync_) *
+              interval_.InMicroseconds()),
+          now);
+    }
+    if (!found || tick_time < *time)
+      *time = tick_time;
+    found = true;
+  }
+  return found;
+}
+
+void FrameThrottler::RemoveClient(ClientId client_id) {
+  clients_[client_id].registered = false;
+}
+
+void FrameThrottler::RequestFrame(ClientId client_id) {
+  clients_[client_id].needs_frame = true;
+}
+
+void FrameThrottler::SetActive(ClientId client_id, bool active) {
+  clients_[client_id].active = active;
+}
+
+void FrameThrottler::SetFrameRate(ClientId client_id, FrameRate rate) {
+  clients_[client_id].rate = rate;
+}
+
+void FrameThrottler::SetVisible(ClientId client_id, bool visible) {
+  clients_[client_id].visible = visible;
+}
+
+bool FrameThrottler::ShouldTick(ClientId client_id) {
+  auto& client = clients_[client_id];
+  if (!client.registered || !client.visible)
+    return false;
+  if (client.rate == FrameRate::OnDemand && !client.needs_frame)
+    return false;
+  auto const vsyncs_per_tick = VsyncsPerTick(EffectiveRate(client_id));
+  if (client.ticked &&
+      vsync_ / vsyncs_per_tick <= client.last_vsync / vsyncs_per_tick) {
+    if (client.needs_frame)
+      ++num_throttled_;
+    return false;
+  }
+  client.last_vsync = vsync_;
+  client.needs_frame = false;
+  ++client.num_ticks;
+  client.ticked = true;
+  return true;
+}
+
+uint64_t FrameThrottler::VsyncsPerTick(FrameRate rate) const {
+  static const int64_t kTickMicroseconds[] = {
+    16667, 33333, 100000, 1000000, 0,
+  };
+  auto const microseconds = std::max(interval_.InMicroseconds(),
+                                     static_cast<int64_t>(1));
+  auto const tick = kTickMicroseconds[static_cast<int>(rate)];
+  return static_cast<uint64_t>(std::max(
+      (tick + microseconds / 2) / microseconds, static_cast<int64_t>(1)));
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_frame_throttler_h)
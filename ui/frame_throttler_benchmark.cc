@@ -0,0 +1,281 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Simulates a 60 Hz display with 200 clients: an animation for one second
+// in every five seconds, and clients updating at 30, 10 and 1 Hz, a
+// quarter of them inactive and some of them hidden. Compares clients
+// ticking on their own timers with random phase, as |DemoApp| did with
+// its 100 ms background tick, against |ui::FrameThrottler| aligning ticks
+// to shared vsyncs. Reports wakeups, ticks and CPU time per second on a
+// virtual clock.
+//
+// Returns EXIT_FAILURE if a hidden client ticks, a client ticks at other
+// than its effective rate, or an inactive on demand client ticks without
+// request.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. ui\frame_throttler_benchmark.cc
+//  g++ -std=c++11 -O2 -I. ui/frame_throttler_benchmark.cc
+//
+// Usage: frame_throttler_benchmark [num_seconds] [num_clients]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "ui/frame_scheduler.h"
+#include "ui/frame_throttler.h"
+
+namespace {
+
+const int64_t kInterval = 16667;
+// Cost of a wakeup without work, e.g. context switch and message loop.
+const int64_t kWakeupCost = 30;
+// Cost of a tick of a client.
+const int64_t kTickCost = 50;
+// The animation runs one second in every |kAnimationPeriod| seconds.
+const int kAnimationPeriod = 5;
+
+base::TimeTicks ToTimeTicks(int64_t microseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(microseconds);
+}
+
+int64_t ToMicroseconds(base::TimeTicks time) {
+  return (time - base::TimeTicks()).InMicroseconds();
+}
+
+bool IsAnimating(int64_t time) {
+  return time / 1000000 % kAnimationPeriod == 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ClientSpec
+//
+struct ClientSpec {
+  bool active;
+  ui::FrameRate rate;
+  bool visible;
+};
+
+// The first client is the animation.
+std::vector<ClientSpec> MakeClients(int num_clients) {
+  std::vector<ClientSpec> clients;
+  ClientSpec animation = {true, ui::FrameRate::OnDemand, true};
+  clients.push_back(animation);
+  for (auto index = 1; index < num_clients; ++index) {
+    ClientSpec client;
+    client.rate = index % 10 == 0 ? ui::FrameRate::Hz30 :
+                  index % 10 < 5 ? ui::FrameRate::Hz10 : ui::FrameRate::Hz1;
+    client.active = index % 4 != 0;
+    client.visible = index % 20 != 7;
+    clients.push_back(client);
+  }
+  return clients;
+}
+
+// Returns microseconds between ticks of |client| at 60 Hz.
+int64_t EffectivePeriod(const ClientSpec& client) {
+  auto rate = client.rate;
+  if (!client.active && (rate == ui::FrameRate::OnDemand ||
+                         rate < ui::FrameRate::Hz10)) {
+    rate = ui::FrameRate::Hz10;
+  }
+  switch (rate) {
+    case ui::FrameRate::Hz60:
+    case ui::FrameRate::OnDemand:
+      return kInterval;
+    case ui::FrameRate::Hz30:
+      return kInterval * 2;
+    case ui::FrameRate::Hz10:
+      return kInterval * 6;
+    case ui::FrameRate::Hz1:
+      return kInterval * 60;
+  }
+  return kInterval;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  double cpu_milliseconds;
+  uint64_t num_ticks;
+  uint64_t num_wakeups;
+  std::vector<uint64_t> ticks;
+};
+
+// Each client wakes up on its own timer with random phase. Hidden
+// clients tick too, since nobody tells them.
+Result RunTimers(const std::vector<ClientSpec>& clients, int num_seconds) {
+  auto const end_time = static_cast<int64_t>(num_seconds) * 1000000;
+  uint32_t seed = 1;
+  std::set<int64_t> wakeups;
+  Result result = Result();
+  result.ticks.resize(clients.size());
+  for (auto index = 0u; index < clients.size(); ++index) {
+    auto const period = EffectivePeriod(clients[index]);
+    for (auto time = static_cast<int64_t>(base::NextRandom(&seed) % period);
+         time < end_time; time += period) {
+      if (!index && !IsAnimating(time))
+        continue;
+      wakeups.insert(time);
+      ++result.ticks[index];
+      ++result.num_ticks;
+    }
+  }
+  result.num_wakeups = wakeups.size();
+  return result;
+}
+
+// Clients tick in frames decided by |ui::FrameThrottler|. Every client
+// requests the next tick, except for the animation between animations.
+Result RunThrottler(const std::vector<ClientSpec>& clients,
+                    int num_seconds) {
+  auto const end_time = static_cast<int64_t>(num_seconds) * 1000000;
+  ui::FrameThrottler throttler;
+  for (auto const& client : clients) {
+    auto const client_id = throttler.AddClient(client.rate);
+    throttler.SetActive(client_id, client.active);
+    throttler.SetVisible(client_id, client.visible);
+    throttler.RequestFrame(client_id);
+  }
+
+  Result result = Result();
+  auto now = static_cast<int64_t>(0);
+  auto last_frame_time = -kInterval;
+  for (;;) {
+    // The animation starts by input at start of animation period.
+    if (IsAnimating(now))
+      throttler.RequestFrame(0);
+    base::TimeTicks tick_time;
+    auto wake_time = end_time;
+    if (throttler.NextTickTime(ToTimeTicks(now), &tick_time))
+      wake_time = ToMicroseconds(tick_time);
+    auto const next_animation = (now / 1000000 / kAnimationPeriod + 1) *
+                                kAnimationPeriod * 1000000;
+    wake_time = std::min(wake_time, next_animation);
+    // A frame starts at a vsync, one frame per vsync.
+    now = std::max(wake_time, last_frame_time + kInterval);
+    if (now >= end_time)
+      break;
+    ++result.num_wakeups;
+    if (IsAnimating(now))
+      throttler.RequestFrame(0);
+    if (!throttler.NextTickTime(ToTimeTicks(now), &tick_time) ||
+        ToMicroseconds(tick_time) > now) {
+      continue;
+    }
+    ui::BeginFrameArgs args;
+    args.frame_time = ToTimeTicks(now / kInterval * kInterval);
+    args.interval = base::TimeDelta::FromMicroseconds(kInterval);
+    args.deadline = args.frame_time + args.interval;
+    args.sequence_number = 0;
+    last_frame_time = now;
+    throttler.BeginFrame(args);
+    for (auto index = 0u; index < clients.size(); ++index) {
+      if (!throttler.ShouldTick(index))
+        continue;
+      ++result.num_ticks;
+      if (index)
+        throttler.RequestFrame(index);
+      else if (IsAnimating(now + kInterval))
+        throttler.RequestFrame(index);
+    }
+  }
+  result.ticks.resize(clients.size());
+  for (auto index = 0u; index < clients.size(); ++index)
+    result.ticks[index] = throttler.num_ticks(index);
+  return result;
+}
+
+// An inactive on demand client ticks only in frames it requested, at most
+// at |kInactiveRate|, while a 60 Hz client makes a frame every vsync.
+bool VerifyInactiveOnDemand() {
+  ui::FrameThrottler throttler;
+  auto const driver = throttler.AddClient(ui::FrameRate::Hz60);
+  auto const on_demand = throttler.AddClient(ui::FrameRate::OnDemand);
+  throttler.SetActive(on_demand, false);
+  auto num_ticks = 0;
+  for (auto vsync = 0; vsync < 120; ++vsync) {
+    // Requests twice in a row, the second waits for the next 10 Hz tick.
+    if (vsync == 60 || vsync == 61)
+      throttler.RequestFrame(on_demand);
+    ui::BeginFrameArgs args;
+    args.frame_time = ToTimeTicks(vsync * kInterval);
+    args.interval = base::TimeDelta::FromMicroseconds(kInterval);
+    args.deadline = args.frame_time + args.interval;
+    args.sequence_number = static_cast<uint64_t>(vsync);
+    throttler.BeginFrame(args);
+    throttler.ShouldTick(driver);
+    if (throttler.ShouldTick(on_demand))
+      ++num_ticks;
+  }
+  return num_ticks == 2 && throttler.num_throttled() > 0;
+}
+
+void PrintResult(const char* name, Result* result, int num_seconds) {
+  result->cpu_milliseconds = static_cast<double>(
+      result->num_wakeups * kWakeupCost + result->num_ticks * kTickCost) /
+      1000 / num_seconds;
+  printf("%-16s %12.1f %12.1f %12.2f\n", name,
+         static_cast<double>(result->num_wakeups) / num_seconds,
+         static_cast<double>(result->num_ticks) / num_seconds,
+         result->cpu_milliseconds);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_seconds = argc >= 2 ? atoi(argv[1]) : 60;
+  auto const num_clients = argc >= 3 ? atoi(argv[2]) : 200;
+  std::cout << num_clients << " clients, " << num_seconds << " seconds" <<
+      std::endl;
+  auto const clients = MakeClients(num_clients);
+
+  printf("%-16s %12s %12s %12s\n", "ticks by", "wakeups/s", "ticks/s",
+         "cpu ms/s");
+  auto timers = RunTimers(clients, num_seconds);
+  PrintResult("own timers", &timers, num_seconds);
+  auto throttler = RunThrottler(clients, num_seconds);
+  PrintResult("frame throttler", &throttler, num_seconds);
+
+  auto failed = false;
+  for (auto index = 1u; index < clients.size(); ++index) {
+    auto const& client = clients[index];
+    if (!client.visible) {
+      failed |= throttler.ticks[index] != 0;
+      continue;
+    }
+    auto const expected = static_cast<double>(num_seconds) * 1000000 /
+                          EffectivePeriod(client);
+    auto const actual = static_cast<double>(throttler.ticks[index]);
+    if (::fabs(actual - expected) > expected * 0.02 + 1) {
+      printf("client %u ticked %.0f times, expected %.0f\n", index, actual,
+             expected);
+      failed = true;
+    }
+  }
+  if (failed) {
+    printf("FAILED: clients ticked at wrong rate\n");
+    return EXIT_FAILURE;
+  }
+  if (!VerifyInactiveOnDemand()) {
+    printf("FAILED: inactive on demand client ticked without request\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
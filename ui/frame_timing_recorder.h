@@ -0,0 +1,489 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_frame_timing_recorder_h)
+#define INCLUDE_ui_frame_timing_recorder_h
+
+namespace ui {
+
+enum class FramePhase {
+  Animate,
+  Physics,
+  Paint,
+  Blur,
+  TextLayout,
+  Commit,
+  Present,
+};
+
+const int kNumFramePhases = static_cast<int>(FramePhase::Present) + 1;
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameTimingRecorder
+// Time spent in each phase of a frame per layer, in a ring buffer of the
+// last |capacity| records allocated at construction, so recording never
+// allocates. A record is a frame of a layer, with self time of each phase;
+// a nested phase, e.g. blur in paint, is subtracted from its outer phase,
+// so phases of a record add up to the time of the layer in the frame.
+//
+// Times are CPU time of submitting work; Direct2D does most of the drawing
+// at |EndDraw()| or |Flush()|, in the phase calling it.
+//
+// A phase costs about 15 ns besides two reads of |base::TimeTicks|, or
+// 100 ns with them on Linux, against 120-140 ns of appending a sample to a
+// map of vectors by phase name.
+//
+// Define |ENABLE_FRAME_PHASE_COUNTERS| before including this header to also
+// count hardware counters and allocations of phases. Once
+// |mutable_perf_counters()->Open()| succeeds on the recording thread,
+// phases also read hardware counters, and records have self counts of each
+// phase, e.g. cycles and cache misses of paint, as durations. A phase then
+// costs two reads of counters, about two microseconds, which its outer
+// phases include. Records also have self allocation counts of each phase
+// when |base::AllocationTracker| hooks are compiled in. Without it, phases
+// neither check counters nor allocations, and records only have times.
+//
+// Should be used on one thread, e.g. the UI thread.
+//
+class FrameTimingRecorder final {
+  public: typedef int LayerId;
+
+  public: static const int kMaxLayers = 16;
+  private: static const int kMaxDepth = 8;
+
+  private: struct Record {
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+    base::AllocationCounts allocations[kNumFramePhases];
+    uint64_t counts[kNumFramePhases][base::kNumPerfCounters];
+#endif
+    int64_t durations[kNumFramePhases];
+    uint64_t frame_number;
+    // Microseconds of |base::TimeTicks|.
+    int64_t frame_time;
+    LayerId layer_id;
+    // Start of the earliest phase.
+    int64_t start;
+  };
+
+  // Allocations, counts and time of phases nested in each open phase.
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  private: base::AllocationCounts child_allocations_[kMaxDepth];
+  private: base::PerfCounts child_counts_[kMaxDepth];
+#endif
+  private: int64_t child_times_[kMaxDepth];
+  private: int depth_;
+  private: uint64_t frame_number_;
+  private: base::TimeTicks frame_time_;
+  // Record number of the last record of each layer.
+  private: uint64_t last_records_[kMaxLayers];
+  private: const char* layer_names_[kMaxLayers];
+  private: int num_layers_;
+  private: uint64_t num_records_;
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  private: base::PerfCounters perf_counters_;
+#endif
+  private: std::vector<Record> records_;
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  private: base::AllocationCounts start_allocations_[kMaxDepth];
+  private: base::PerfCounts start_counts_[kMaxDepth];
+#endif
+
+  public: explicit FrameTimingRecorder(size_t capacity);
+  public: ~FrameTimingRecorder() = default;
+
+  public: uint64_t frame_number() const { return frame_number_; }
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  public: const base::PerfCounters& perf_counters() const {
+    return perf_counters_;
+  }
+  public: base::PerfCounters* mutable_perf_counters() {
+    return &perf_counters_;
+  }
+#endif
+  // Number of records in the buffer.
+  public: size_t size() const;
+
+  // Returns id of layer named |name|, which must outlive the recorder, e.g.
+  // a string literal.
+  public: LayerId AddLayer(const char* name);
+  public: void BeginFrame(base::TimeTicks frame_time);
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  // Returns self allocations of |phase| in the |index|-th record from the
+  // oldest.
+  public: const base::AllocationCounts& AllocationsOf(
+      size_t index, FramePhase phase) const;
+#endif
+  // Called by |ScopedFramePhase|.
+  public: void BeginPhase();
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  // Returns self count of |counter| in |phase| in the |index|-th record
+  // from the oldest.
+  public: uint64_t CountOf(size_t index, FramePhase phase,
+                           base::PerfCounter counter) const;
+#endif
+  public: void EndPhase(LayerId layer_id, FramePhase phase,
+                        base::TimeTicks start, base::TimeTicks end);
+  // Returns self time of |phase| in the |index|-th record from the oldest.
+  public: int64_t DurationOf(size_t index, FramePhase phase) const;
+  public: static const char* NameOf(FramePhase phase);
+  // Writes a line per record with microseconds of each phase, and
+  // allocations, counts and instructions per cycle of the record if they
+  // are available.
+  public: void WriteCsv(std::ostream* stream) const;
+  public: void WriteJson(std::ostream* stream) const;
+
+  private: const Record& RecordAt(size_t index) const;
+  private: Record* RecordFor(LayerId layer_id, base::TimeTicks start);
+
+  DISALLOW_COPY_AND_ASSIGN(FrameTimingRecorder);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// ScopedFramePhase
+//
+class ScopedFramePhase final {
+  private: FrameTimingRecorder::LayerId layer_id_;
+  private: FramePhase phase_;
+  private: FrameTimingRecorder* recorder_;
+  private: base::TimeTicks start_;
+
+  public: ScopedFramePhase(FrameTimingRecorder* recorder,
+                           FrameTimingRecorder::LayerId layer_id,
+                           FramePhase phase);
+  public: ~ScopedFramePhase();
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedFramePhase);
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// FrameTimingRecorder
+//
+FrameTimingRecorder::FrameTimingRecorder(size_t capacity)
+    : depth_(0), frame_number_(0), num_layers_(0), num_records_(0),
+      records_(capacity) {
+  DCHECK(capacity);
+  for (auto& last_record : last_records_)
+    last_record = std::numeric_limits<uint64_t>::max();
+}
+
+size_t FrameTimingRecorder::size() const {
+  return static_cast<size_t>(std::min(
+      num_records_, static_cast<uint64_t>(records_.size())));
+}
+
+FrameTimingRecorder::LayerId FrameTimingRecorder::AddLayer(
+    const char* name) {
+  DCHECK(num_layers_ < kMaxLayers);
+  layer_names_[num_layers_] = name;
+  return num_layers_++;
+}
+
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+const base::AllocationCounts& FrameTimingRecorder::AllocationsOf(
+    size_t index, FramePhase phase) const {
+  return RecordAt(index).allocations[static_cast<int>(phase)];
+}
+#endif
+
+void FrameTimingRecorder::BeginFrame(base::TimeTicks frame_time) {
+  ++frame_number_;
+  frame_time_ = frame_time;
+}
+
+void FrameTimingRecorder::BeginPhase() {
+  DCHECK(depth_ < kMaxDepth);
+  child_times_[depth_] = 0;
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  if (base::AllocationTracker::enabled()) {
+    child_allocations_[depth_] = base::AllocationCounts();
+    start_allocations_[depth_] = base::AllocationTracker::counts();
+  }
+  if (perf_counters_.available()) {
+    for (auto& value : child_counts_[depth_].values)
+      value = 0;
+    perf_counters_.Read(&start_counts_[depth_]);
+  }
+#endif
+  ++depth_;
+}
+
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+uint64_t FrameTimingRecorder::CountOf(size_t index, FramePhase phase,
+                                      base::PerfCounter counter) const {
+  return RecordAt(index).counts[static_cast<int>(phase)]
+                               [static_cast<int>(counter)];
+}
+#endif
+
+int64_t FrameTimingRecorder::DurationOf(size_t index,
+                                        FramePhase phase) const {
+  return RecordAt(index).durations[static_cast<int>(phase)];
+}
+
+void FrameTimingRecorder::EndPhase(LayerId layer_id, FramePhase phase,
+                                   base::TimeTicks start,
+                                   base::TimeTicks end) {
+  DCHECK(depth_ > 0);
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  base::AllocationCounts end_allocations = base::AllocationCounts();
+  if (base::AllocationTracker::enabled())
+    end_allocations = base::AllocationTracker::counts();
+  base::PerfCounts end_counts;
+  auto const has_counts = perf_counters_.available();
+  if (has_counts)
+    perf_counters_.Read(&end_counts);
+#endif
+  --depth_;
+  auto const total = (end - start).InMicroseconds();
+  if (depth_)
+    child_times_[depth_ - 1] += total;
+  auto const record = RecordFor(layer_id, start);
+  record->durations[static_cast<int>(phase)] += total - child_times_[depth_];
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  if (base::AllocationTracker::enabled()) {
+    auto const& start_allocations = start_allocations_[depth_];
+    auto const& child_allocations = child_allocations_[depth_];
+    base::AllocationCounts allocations = end_allocations;
+    allocations.num_allocations -= start_allocations.num_allocations;
+    allocations.num_bytes -= start_allocations.num_bytes;
+    allocations.num_frees -= start_allocations.num_frees;
+    if (depth_) {
+      auto& parent = child_allocations_[depth_ - 1];
+      parent.num_allocations += allocations.num_allocations;
+      parent.num_bytes += allocations.num_bytes;
+      parent.num_frees += allocations.num_frees;
+    }
+    auto& self = record->allocations[static_cast<int>(phase)];
+    self.num_allocations += allocations.num_allocations -
+                            child_allocations.num_allocations;
+    self.num_bytes += allocations.num_bytes - child_allocations.num_bytes;
+    self.num_frees += allocations.num_frees - child_allocations.num_frees;
+  }
+  if (!has_counts)
+    return;
+  auto const counts = record->counts[static_cast<int>(phase)];
+  for (auto counter = 0; counter < base::kNumPerfCounters; ++counter) {
+    auto const count = end_counts.values[counter] -
+                       start_counts_[depth_].values[counter];
+    if (depth_)
+      child_counts_[depth_ - 1].values[counter] += count;
+    // Scaled counts of a multiplexed group may not add up.
+    auto const child_count = child_counts_[depth_].values[counter];
+    if (count > child_count)
+      counts[counter] += count - child_count;
+  }
+#endif
+}
+
+const char* FrameTimingRecorder::NameOf(FramePhase phase) {
+  static const char* const kNames[] = {
+    "animate", "physics", "paint", "blur", "text_layout", "commit",
+    "present",
+  };
+  return kNames[static_cast<int>(phase)];
+}
+
+const FrameTimingRecorder::Record& FrameTimingRecorder::RecordAt(
+    size_t index) const {
+  DCHECK(index < size());
+  return records_[(num_records_ - size() + index) % records_.size()];
+}
+
+// Returns the record of |layer_id| in the current frame, and starts a new
+// record if there isn't.
+FrameTimingRecorder::Record* FrameTimingRecorder::RecordFor(
+    LayerId layer_id, base::TimeTicks start) {
+  auto const capacity = static_cast<uint64_t>(records_.size());
+  auto const last = last_records_[layer_id];
+  // The last record may be overwritten by a record of another layer or
+  // frame.
+  if (last != std::numeric_limits<uint64_t>::max()) {
+    auto& record = records_[last % capacity];
+    if (record.frame_number == frame_number_ &&
+        record.layer_id == layer_id) {
+      // An outer phase ends after its inner phases.
+      record.start = std::min(record.start,
+                              (start - base::TimeTicks()).InMicroseconds());
+      return &record;
+    }
+  }
+  auto const number = num_records_++;
+  last_records_[layer_id] = number;
+  auto& record = records_[number % capacity];
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  for (auto& allocations : record.allocations)
+    allocations = base::AllocationCounts();
+  for (auto& counts : record.counts) {
+    for (auto& count : counts)
+      count = 0;
+  }
+#endif
+  for (auto& duration : record.durations)
+    duration = 0;
+  record.frame_number = frame_number_;
+  record.frame_time = (frame_time_ - base::TimeTicks()).InMicroseconds();
+  record.layer_id = layer_id;
+  record.start = (start - base::TimeTicks()).InMicroseconds();
+  return &record;
+}
+
+void FrameTimingRecorder::WriteCsv(std::ostream* stream) const {
+  *stream << "frame,frame_time,layer,start";
+  for (auto phase = 0; phase < kNumFramePhases; ++phase)
+    *stream << "," << NameOf(static_cast<FramePhase>(phase));
+  *stream << ",total";
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  auto const has_allocations = base::AllocationTracker::enabled();
+  if (has_allocations)
+    *stream << ",allocations,allocated_bytes";
+  auto const has_counts = perf_counters_.available();
+  if (has_counts) {
+    for (auto counter = 0; counter < base::kNumPerfCounters; ++counter) {
+      *stream << "," << base::PerfCounters::NameOf(
+          static_cast<base::PerfCounter>(counter));
+    }
+    *stream << ",ipc";
+  }
+#endif
+  *stream << std::endl;
+  auto const flags = stream->flags();
+  auto const precision = stream->precision();
+  stream->setf(std::ios::fixed, std::ios::floatfield);
+  stream->precision(2);
+  for (auto index = 0u; index < size(); ++index) {
+    auto const& record = RecordAt(index);
+    *stream << record.frame_number << "," << record.frame_time << "," <<
+        layer_names_[record.layer_id] << "," << record.start;
+    auto total = static_cast<int64_t>(0);
+    for (auto const duration : record.durations) {
+      *stream << "," << duration;
+      total += duration;
+    }
+    *stream << "," << total;
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+    if (has_allocations) {
+      base::AllocationCounts allocations = base::AllocationCounts();
+      for (auto const& phase_allocations : record.allocations) {
+        allocations.num_allocations += phase_allocations.num_allocations;
+        allocations.num_bytes += phase_allocations.num_bytes;
+      }
+      *stream << "," << allocations.num_allocations << "," <<
+          allocations.num_bytes;
+    }
+    if (has_counts) {
+      base::PerfCounts totals = {{0}};
+      for (auto const& counts : record.counts) {
+        for (auto counter = 0; counter < base::kNumPerfCounters; ++counter)
+          totals.values[counter] += counts[counter];
+      }
+      // Counters not available are empty.
+      for (auto counter = 0; counter < base::kNumPerfCounters; ++counter) {
+        *stream << ",";
+        if (perf_counters_.IsAvailable(
+                static_cast<base::PerfCounter>(counter))) {
+          *stream << totals.values[counter];
+        }
+      }
+      auto const cycles =
+          totals.values[static_cast<int>(base::PerfCounter::Cycles)];
+      *stream << ",";
+      if (cycles) {
+        *stream << static_cast<double>(totals.values[
+            static_cast<int>(base::PerfCounter::Instructions)]) / cycles;
+      }
+    }
+#endif
+    *stream << std::endl;
+  }
+  stream->flags(flags);
+  stream->precision(precision);
+}
+
+void FrameTimingRecorder::WriteJson(std::ostream* stream) const {
+  *stream << "{\"unit\":\"us\",\"phases\":[";
+  for (auto phase = 0; phase < kNumFramePhases; ++phase) {
+    *stream << (phase ? "," : "") << "\"" <<
+        NameOf(static_cast<FramePhase>(phase)) << "\"";
+  }
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  auto const has_counts = perf_counters_.available();
+  if (has_counts) {
+    *stream << "],\"counters\":[";
+    auto separator = "";
+    for (auto counter = 0; counter < base::kNumPerfCounters; ++counter) {
+      if (!perf_counters_.IsAvailable(static_cast<base::PerfCounter>(counter)))
+        continue;
+      *stream << separator << "\"" << base::PerfCounters::NameOf(
+          static_cast<base::PerfCounter>(counter)) << "\"";
+      separator = ",";
+    }
+  }
+#endif
+  *stream << "],\"records\":[";
+  for (auto index = 0u; index < size(); ++index) {
+    auto const& record = RecordAt(index);
+    *stream << (index ? ",\n" : "\n") << "{\"frame\":" <<
+        record.frame_number << ",\"frame_time\":" << record.frame_time <<
+        ",\"layer\":\"" << layer_names_[record.layer_id] << "\",\"start\":" <<
+        record.start << ",\"durations\":[";
+    for (auto phase = 0; phase < kNumFramePhases; ++phase)
+      *stream << (phase ? "," : "") << record.durations[phase];
+    *stream << "]";
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+    if (base::AllocationTracker::enabled()) {
+      *stream << ",\"allocations\":[";
+      for (auto phase = 0; phase < kNumFramePhases; ++phase) {
+        *stream << (phase ? "," : "") <<
+            record.allocations[phase].num_allocations;
+      }
+      *stream << "],\"allocated_bytes\":[";
+      for (auto phase = 0; phase < kNumFramePhases; ++phase)
+        *stream << (phase ? "," : "") << record.allocations[phase].num_bytes;
+      *stream << "]";
+    }
+    if (has_counts) {
+      // Counts of each phase, of each available counter.
+      *stream << ",\"counts\":[";
+      auto separator = "";
+      for (auto counter = 0; counter < base::kNumPerfCounters; ++counter) {
+        if (!perf_counters_.IsAvailable(
+                static_cast<base::PerfCounter>(counter))) {
+          continue;
+        }
+        *stream << separator << "[";
+        for (auto phase = 0; phase < kNumFramePhases; ++phase)
+          *stream << (phase ? "," : "") << record.counts[phase][counter];
+        *stream << "]";
+        separator = ",";
+      }
+      *stream << "]";
+    }
+#endif
+    *stream << "}";
+  }
+  *stream << "\n]}" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// ScopedFramePhase
+//
+ScopedFramePhase::ScopedFramePhase(FrameTimingRecorder* recorder,
+                                   FrameTimingRecorder::LayerId layer_id,
+                                   FramePhase phase)
+    : layer_id_(layer_id), phase_(phase), recorder_(recorder),
+      start_(base::TimeTicks::Now()) {
+  recorder_->BeginPhase();
+}
+
+ScopedFramePhase::~ScopedFramePhase() {
+  recorder_->EndPhase(layer_id_, phase_, start_, base::TimeTicks::Now());
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_frame_timing_recorder_h)
@@ -0,0 +1,329 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Records phases of frames of three layers, as |CartoonCard| and
+// |StatusLayer| do, with blur and text layout nested in paint. Reports time
+// per phase of |ui::ScopedFramePhase|, of recording without reading the
+// clock, and of appending named samples to a map of vectors, and counts
+// heap allocations while recording. Compiled with
+// |ENABLE_FRAME_PHASE_COUNTERS|, also reports time per phase with hardware
+// counters, where perf_event_open works.
+//
+// Returns EXIT_FAILURE if recording allocates, or self times of nested
+// phases on a virtual clock, wrap around of the buffer or CSV output are
+// wrong, or, with hardware counters, a nested loop isn't counted in its
+// own phase.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. ui\frame_timing_recorder_benchmark.cc
+//  g++ -std=c++11 -O2 -I. ui/frame_timing_recorder_benchmark.cc
+// and with -DENABLE_FRAME_PHASE_COUNTERS for hardware counters.
+//
+// Usage: frame_timing_recorder_benchmark [num_frames]
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/debug/allocation_tracker.h"
+#include "base/debug/perf_counters.h"
+#include "base/test/random.h"
+#include "ui/frame_timing_recorder.h"
+
+namespace {
+size_t num_allocations;
+}  // namespace
+
+void* operator new(size_t size) {
+  ++num_allocations;
+  if (auto const pointer = ::malloc(size ? size : 1))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  ::free(pointer);
+}
+
+namespace {
+
+const int kNumLayers = 3;
+const size_t kCapacity = 4096;
+
+// Keeps the compiler from removing loops.
+volatile uint32_t sink;
+
+base::TimeTicks ToTimeTicks(int64_t microseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(microseconds);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// MapRecorder
+// Appends samples to a vector per phase name.
+//
+class MapRecorder final {
+  private: std::map<std::string, std::vector<int64_t>> samples_;
+
+  public: MapRecorder() = default;
+  public: ~MapRecorder() = default;
+
+  public: void Add(const std::string& name, base::TimeTicks start);
+
+  DISALLOW_COPY_AND_ASSIGN(MapRecorder);
+};
+
+void MapRecorder::Add(const std::string& name, base::TimeTicks start) {
+  samples_[name].push_back(
+      (base::TimeTicks::Now() - start).InMicroseconds());
+}
+
+// A frame of a layer: animate, physics, paint with blur and text layout,
+// and present.
+void RecordFrame(ui::FrameTimingRecorder* recorder,
+                 ui::FrameTimingRecorder::LayerId layer_id) {
+  { ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Animate); }
+  { ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Physics); }
+  {
+    ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Paint);
+    { ui::ScopedFramePhase blur(recorder, layer_id, ui::FramePhase::Blur); }
+    {
+      ui::ScopedFramePhase text(recorder, layer_id,
+                                ui::FramePhase::TextLayout);
+    }
+  }
+  { ui::ScopedFramePhase phase(recorder, layer_id, ui::FramePhase::Present); }
+}
+
+// Same phases as above at |now|, without reading the clock, for the cost
+// of recording itself.
+void RecordFrameAt(ui::FrameTimingRecorder* recorder,
+                   ui::FrameTimingRecorder::LayerId layer_id,
+                   base::TimeTicks now) {
+  recorder->BeginPhase();
+  recorder->EndPhase(layer_id, ui::FramePhase::Animate, now, now);
+  recorder->BeginPhase();
+  recorder->EndPhase(layer_id, ui::FramePhase::Physics, now, now);
+  recorder->BeginPhase();
+  recorder->BeginPhase();
+  recorder->EndPhase(layer_id, ui::FramePhase::Blur, now, now);
+  recorder->BeginPhase();
+  recorder->EndPhase(layer_id, ui::FramePhase::TextLayout, now, now);
+  recorder->EndPhase(layer_id, ui::FramePhase::Paint, now, now);
+  recorder->BeginPhase();
+  recorder->EndPhase(layer_id, ui::FramePhase::Present, now, now);
+}
+
+void RecordFrame(MapRecorder* recorder, const std::string& layer_name) {
+  auto start = base::TimeTicks::Now();
+  recorder->Add(layer_name + ".animate", start);
+  start = base::TimeTicks::Now();
+  recorder->Add(layer_name + ".physics", start);
+  auto const paint_start = base::TimeTicks::Now();
+  start = base::TimeTicks::Now();
+  recorder->Add(layer_name + ".blur", start);
+  start = base::TimeTicks::Now();
+  recorder->Add(layer_name + ".text_layout", start);
+  recorder->Add(layer_name + ".paint", paint_start);
+  start = base::TimeTicks::Now();
+  recorder->Add(layer_name + ".present", start);
+}
+
+// Checks self times of nested phases and wrap around on a virtual clock.
+bool Verify() {
+  ui::FrameTimingRecorder recorder(4);
+  auto const layer_id = recorder.AddLayer("layer");
+  auto const other_id = recorder.AddLayer("other");
+  for (auto frame = 0; frame < 6; ++frame) {
+    auto const base = static_cast<int64_t>(frame) * 16667;
+    recorder.BeginFrame(ToTimeTicks(base));
+    // paint [100, 1100) has blur [200, 500) and text layout [600, 700).
+    recorder.BeginPhase();
+    recorder.BeginPhase();
+    recorder.EndPhase(layer_id, ui::FramePhase::Blur, ToTimeTicks(base + 200),
+                      ToTimeTicks(base + 500));
+    recorder.BeginPhase();
+    recorder.EndPhase(layer_id, ui::FramePhase::TextLayout,
+                      ToTimeTicks(base + 600), ToTimeTicks(base + 700));
+    recorder.EndPhase(layer_id, ui::FramePhase::Paint,
+                      ToTimeTicks(base + 100), ToTimeTicks(base + 1100));
+    recorder.BeginPhase();
+    recorder.EndPhase(other_id, ui::FramePhase::Commit,
+                      ToTimeTicks(base + 1100), ToTimeTicks(base + 1150));
+  }
+  // The last four records are frames 5 and 6 of both layers.
+  if (recorder.size() != 4)
+    return false;
+  for (auto index = 0u; index < recorder.size(); ++index) {
+    auto const is_other = index % 2 == 1;
+    if (recorder.DurationOf(index, ui::FramePhase::Paint) !=
+            (is_other ? 0 : 600) ||
+        recorder.DurationOf(index, ui::FramePhase::Blur) !=
+            (is_other ? 0 : 300) ||
+        recorder.DurationOf(index, ui::FramePhase::Commit) !=
+            (is_other ? 50 : 0)) {
+      return false;
+    }
+  }
+  std::ostringstream csv;
+  recorder.WriteCsv(&csv);
+  auto const text = csv.str();
+  return std::count(text.begin(), text.end(), '\n') == 5 &&
+         text.find("\n6,83335,layer,83435,0,0,600,300,100,0,0,1000\n") !=
+             std::string::npos;
+}
+
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+// Checks that instructions of a loop in blur are counted in blur, not in
+// paint, if hardware counters are available.
+bool VerifyCounts() {
+  const int kNumIterations = 1000000;
+  ui::FrameTimingRecorder recorder(4);
+  if (!recorder.mutable_perf_counters()->Open())
+    return true;
+  auto const layer_id = recorder.AddLayer("layer");
+  recorder.BeginFrame(base::TimeTicks::Now());
+  {
+    ui::ScopedFramePhase paint(&recorder, layer_id, ui::FramePhase::Paint);
+    ui::ScopedFramePhase blur(&recorder, layer_id, ui::FramePhase::Blur);
+    uint32_t seed = 1;
+    for (auto count = 0; count < kNumIterations; ++count)
+      sink = base::NextRandom(&seed);
+  }
+  auto const blur_instructions = recorder.CountOf(
+      0, ui::FramePhase::Blur, base::PerfCounter::Instructions);
+  auto const paint_instructions = recorder.CountOf(
+      0, ui::FramePhase::Paint, base::PerfCounter::Instructions);
+  printf("instructions: blur %llu, paint %llu\n",
+         static_cast<unsigned long long>(blur_instructions),
+         static_cast<unsigned long long>(paint_instructions));
+  std::ostringstream csv;
+  recorder.WriteCsv(&csv);
+  return blur_instructions >= kNumIterations &&
+         paint_instructions < kNumIterations / 10 &&
+         csv.str().find(",total,cycles,instructions,cache_misses,"
+                        "branch_misses,ipc\n") != std::string::npos;
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_frames = argc >= 2 ? atoi(argv[1]) : 200000;
+  std::cout << num_frames << " frames of " << kNumLayers << " layers" <<
+      std::endl;
+  auto const num_phases = static_cast<double>(num_frames) * kNumLayers * 6;
+
+  ui::FrameTimingRecorder recorder(kCapacity);
+  ui::FrameTimingRecorder::LayerId layer_ids[kNumLayers];
+  std::string layer_names[kNumLayers];
+  for (auto index = 0; index < kNumLayers; ++index) {
+    layer_ids[index] = recorder.AddLayer("layer");
+    layer_names[index] = "layer" + std::to_string(index);
+  }
+  auto const allocations_before = num_allocations;
+  auto start = base::TimeTicks::Now();
+  for (auto frame = 0; frame < num_frames; ++frame) {
+    recorder.BeginFrame(base::TimeTicks::Now());
+    for (auto const layer_id : layer_ids)
+      RecordFrame(&recorder, layer_id);
+  }
+  auto const recorder_ns = (base::TimeTicks::Now() - start).InMillisecondsF() *
+                           1e6 / num_phases;
+  auto const recorder_allocations = num_allocations - allocations_before;
+
+  auto const clockless_allocations_before = num_allocations;
+  start = base::TimeTicks::Now();
+  for (auto frame = 0; frame < num_frames; ++frame) {
+    recorder.BeginFrame(start);
+    for (auto const layer_id : layer_ids)
+      RecordFrameAt(&recorder, layer_id, start);
+  }
+  auto const clockless_ns = (base::TimeTicks::Now() - start)
+      .InMillisecondsF() * 1e6 / num_phases;
+  auto const clockless_allocations = num_allocations -
+                                     clockless_allocations_before;
+
+  MapRecorder map_recorder;
+  auto const map_allocations_before = num_allocations;
+  start = base::TimeTicks::Now();
+  for (auto frame = 0; frame < num_frames; ++frame) {
+    for (auto const& layer_name : layer_names)
+      RecordFrame(&map_recorder, layer_name);
+  }
+  auto const map_ns = (base::TimeTicks::Now() - start).InMillisecondsF() *
+                      1e6 / num_phases;
+  auto const map_allocations = num_allocations - map_allocations_before;
+
+  printf("%-20s %10s %12s\n", "recorder", "ns/phase", "allocations");
+  printf("%-20s %10.1f %12u\n", "frame timing", recorder_ns,
+         static_cast<unsigned>(recorder_allocations));
+  printf("%-20s %10.1f %12u\n", "without clock", clockless_ns,
+         static_cast<unsigned>(clockless_allocations));
+  printf("%-20s %10.1f %12u\n", "map of vectors", map_ns,
+         static_cast<unsigned>(map_allocations));
+
+  // Counters of this thread, of which reads don't allocate either.
+  auto counters_allocations = static_cast<size_t>(0);
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  if (recorder.mutable_perf_counters()->Open()) {
+    auto const counters_allocations_before = num_allocations;
+    start = base::TimeTicks::Now();
+    for (auto frame = 0; frame < num_frames; ++frame) {
+      recorder.BeginFrame(base::TimeTicks::Now());
+      for (auto const layer_id : layer_ids)
+        RecordFrame(&recorder, layer_id);
+    }
+    auto const counters_ns = (base::TimeTicks::Now() - start)
+        .InMillisecondsF() * 1e6 / num_phases;
+    counters_allocations = num_allocations - counters_allocations_before;
+    printf("%-20s %10.1f %12u\n", "with counters", counters_ns,
+           static_cast<unsigned>(counters_allocations));
+  } else {
+    printf("%-20s not available: %s\n", "with counters",
+           ::strerror(recorder.perf_counters().error_number()));
+  }
+#endif
+
+  auto failed = false;
+  if (recorder_allocations || clockless_allocations ||
+      counters_allocations || recorder.size() != kCapacity) {
+    printf("FAILED: recording allocates\n");
+    failed = true;
+  }
+  if (!Verify()) {
+    printf("FAILED: wrong phase times\n");
+    failed = true;
+  }
+#if defined(ENABLE_FRAME_PHASE_COUNTERS)
+  if (!VerifyCounts()) {
+    printf("FAILED: wrong counts of phases\n");
+    failed = true;
+  }
+#endif
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_idle_task_queue_h)
+#define INCLUDE_ui_idle_task_queue_h
+
+namespace ui {
+
+//////////////////////////////////////////////////////////////////////
+//
+// IdleTaskQueue
+// Runs housekeeping tasks, e.g. trimming caches, only in the time between
+// the end of a frame and the start of the next frame, like
+// requestIdleCallback() of HTML. Each task gets the deadline of the idle
+// period, and should do a small piece of work at a time and post itself
+// again when |now| reaches the deadline.
+//
+// An idle period without a requested frame is at most |kMaxIdlePeriod|
+// milliseconds, so input isn't blocked by idle tasks for long.
+//
+// A task running past the deadline delays the next frame. A frame which
+// misses its deadline after such an idle period is counted as missed
+// because of idle work.
+//
+class IdleTaskQueue final {
+  public: typedef std::function<void(base::TimeTicks deadline)> IdleTask;
+  public: typedef base::TimeTicks (*NowFunction)();
+
+  public: static const int kMaxIdlePeriod = 50;
+
+  private: bool did_overrun_;
+  private: base::TimeDelta idle_time_;
+  private: base::TimeDelta idle_time_used_;
+  private: NowFunction now_;
+  private: uint64_t num_missed_deadlines_;
+  private: uint64_t num_overruns_;
+  private: uint64_t num_tasks_run_;
+  private: std::deque<IdleTask> tasks_;
+
+  // |now| is for tests and benchmarks with a virtual clock.
+  public: explicit IdleTaskQueue(NowFunction now = base::TimeTicks::Now);
+  public: ~IdleTaskQueue() = default;
+
+  public: bool empty() const { return tasks_.empty(); }
+  // Sum of idle periods given to |RunIdleTasks()| with pending tasks.
+  public: base::TimeDelta idle_time() const { return idle_time_; }
+  // Sum of time spent in idle tasks.
+  public: base::TimeDelta idle_time_used() const { return idle_time_used_; }
+  // Number of frames which missed their deadlines after an idle task ran
+  // past the deadline of its idle period.
+  public: uint64_t num_missed_deadlines() const {
+    return num_missed_deadlines_;
+  }
+  // Number of idle periods which ended after their deadlines.
+  public: uint64_t num_overruns() const { return num_overruns_; }
+  public: uint64_t num_tasks_run() const { return num_tasks_run_; }
+  public: size_t size() const { return tasks_.size(); }
+
+  public: void DidFinishFrame(const BeginFrameArgs& args, base::TimeTicks now);
+  public: void PostIdleTask(const IdleTask& task);
+  // Runs tasks until |deadline|, and returns number of tasks run. Tasks
+  // posted by tasks run in the next idle period.
+  public: size_t RunIdleTasks(base::TimeTicks deadline);
+
+  DISALLOW_COPY_AND_ASSIGN(IdleTaskQueue);
+};
+
+IdleTaskQueue::IdleTaskQueue(NowFunction now)
+    : did_overrun_(false), now_(now), num_missed_deadlines_(0),
+      num_overruns_(0), num_tasks_run_(0) {
+}
+
+void IdleTaskQueue::DidFinishFrame(const BeginFrameArgs& args,
+                                   base::TimeTicks now) {
+  if (did_overrun_ && now > args.deadline)
+    ++num_missed_deadlines_;
+  did_overrun_ = false;
+}
+
+void IdleTaskQueue::PostIdleTask(const IdleTask& task) {
+  tasks_.push_back(task);
+}
+
+size_t IdleTaskQueue::RunIdleTasks(base::TimeTicks deadline) {
+  if (tasks_.empty())
+    return 0;
+  auto const start = now_();
+  deadline = std::min(deadline, start + base::TimeDelta::FromMilliseconds(
+      kMaxIdlePeriod));
+  if (deadline <= start)
+    return 0;
+  idle_time_ = idle_time_ + (deadline - start);
+  auto const num_tasks = tasks_.size();
+  auto num_run = static_cast<size_t>(0);
+  auto now = start;
+  while (num_run < num_tasks && now < deadline) {
+    IdleTask task;
+    task.swap(tasks_.front());
+    tasks_.pop_front();
+    task(deadline);
+    ++num_run;
+    now = now_();
+  }
+  idle_time_used_ = idle_time_used_ + (now - start);
+  num_tasks_run_ += num_run;
+  if (now > deadline) {
+    did_overrun_ = true;
+    ++num_overruns_;
+  }
+  return num_run;
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_idle_task_queue_h)
@@ -0,0 +1,201 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Simulates continuous animation at 60 Hz with 3 to 9 ms frame work and a
+// long frame once in 50 frames, and housekeeping every second: trimming a
+// cache, rebuilding an index and rescanning samples, 16 ms of work in
+// total. Compares running housekeeping in the frame which requests it with
+// running it on |ui::IdleTaskQueue| in pieces until the idle deadline, on
+// a virtual clock. Reports missed frame deadlines, missed deadlines because
+// of idle work, idle time used and time to finish housekeeping.
+//
+// Returns EXIT_FAILURE if idle tasks make any frame miss its deadline or
+// housekeeping doesn't finish.
+//
+// Compile by using:
+//  cl /EHsc /O2 /I. ui\idle_task_queue_benchmark.cc
+//  g++ -std=c++11 -O2 -I. ui/idle_task_queue_benchmark.cc
+//
+// Usage: idle_task_queue_benchmark [num_seconds]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time/time.h"
+#include "base/test/random.h"
+#include "ui/frame_scheduler.h"
+#include "ui/idle_task_queue.h"
+
+namespace {
+
+const int kFramesPerHousekeeping = 60;
+const int64_t kInterval = 16667;
+
+// Microseconds on the virtual clock.
+int64_t virtual_now;
+
+base::TimeTicks ToTimeTicks(int64_t microseconds) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(microseconds);
+}
+
+base::TimeTicks VirtualNow() {
+  return ToTimeTicks(virtual_now);
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// Job
+// Housekeeping of |num_items| items of |item_cost| microseconds.
+//
+struct Job {
+  int64_t finish_time;
+  int64_t item_cost;
+  int num_items;
+  int64_t post_time;
+};
+
+const Job kJobs[] = {
+  // Trimming cache
+  {0, 2, 2000, 0},
+  // Rebuilding index
+  {0, 3, 3000, 0},
+  // Rescanning samples
+  {0, 5, 600, 0},
+};
+
+// Processes items until |deadline| and posts the rest to |queue|.
+void RunJob(ui::IdleTaskQueue* queue, Job* job, base::TimeTicks deadline) {
+  while (job->num_items && VirtualNow() < deadline) {
+    virtual_now += job->item_cost;
+    --job->num_items;
+  }
+  if (!job->num_items) {
+    job->finish_time = virtual_now;
+    return;
+  }
+  queue->PostIdleTask([queue, job](base::TimeTicks next_deadline) {
+    RunJob(queue, job, next_deadline);
+  });
+}
+
+enum class Mode {
+  None,
+  InFrame,
+  Idle,
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// Result
+//
+struct Result {
+  double finish_milliseconds;
+  double idle_milliseconds;
+  double idle_used_milliseconds;
+  uint64_t num_idle_missed_deadlines;
+  uint64_t num_missed_deadlines;
+  int num_unfinished_jobs;
+};
+
+Result Run(Mode mode, int num_seconds) {
+  ui::FrameScheduler scheduler(base::TimeDelta::FromMicroseconds(kInterval));
+  ui::IdleTaskQueue queue(VirtualNow);
+  std::deque<Job> jobs;
+  uint32_t seed = 1;
+  virtual_now = 0;
+  auto const num_frames = num_seconds * 60;
+  // We don't post housekeeping near the end, to finish it in the run.
+  auto const last_post_frame = num_frames - kFramesPerHousekeeping;
+  for (auto frame = 0; frame < num_frames; ++frame) {
+    virtual_now = std::max(virtual_now, (scheduler.NextFrameTime() -
+                                         base::TimeTicks()).InMicroseconds());
+    auto const args = scheduler.BeginFrame(VirtualNow());
+    auto work = frame % 50 == 49 ? 13000 : base::RandomInt(&seed, 3000, 9000);
+    auto const posts_housekeeping = frame % kFramesPerHousekeeping == 0 &&
+                                    frame < last_post_frame;
+    if (posts_housekeeping && mode != Mode::None) {
+      for (auto job : kJobs) {
+        job.post_time = virtual_now;
+        if (mode == Mode::InFrame) {
+          work += job.item_cost * job.num_items;
+          job.finish_time = virtual_now + work;
+          job.num_items = 0;
+          jobs.push_back(job);
+          continue;
+        }
+        jobs.push_back(job);
+        auto const pointer = &jobs.back();
+        auto const queue_pointer = &queue;
+        queue.PostIdleTask([queue_pointer, pointer](base::TimeTicks deadline) {
+          RunJob(queue_pointer, pointer, deadline);
+        });
+      }
+    }
+    virtual_now += work;
+    scheduler.RequestFrame(VirtualNow());
+    scheduler.DidFinishFrame(args, VirtualNow());
+    queue.DidFinishFrame(args, VirtualNow());
+    queue.RunIdleTasks(scheduler.NextFrameTime());
+  }
+
+  Result result = Result();
+  auto finish_time = 0.0;
+  for (auto const& job : jobs) {
+    if (job.num_items) {
+      ++result.num_unfinished_jobs;
+      continue;
+    }
+    finish_time += static_cast<double>(job.finish_time - job.post_time);
+  }
+  result.finish_milliseconds = jobs.empty() ? 0 :
+      finish_time / jobs.size() / 1000;
+  result.idle_milliseconds = queue.idle_time().InMillisecondsF();
+  result.idle_used_milliseconds = queue.idle_time_used().InMillisecondsF();
+  result.num_idle_missed_deadlines = queue.num_missed_deadlines();
+  result.num_missed_deadlines = scheduler.num_missed_deadlines();
+  return result;
+}
+
+void PrintResult(const char* name, const Result& result) {
+  printf("%-16s %8llu %8llu %10.1f %10.1f %10.2f %10d\n", name,
+         static_cast<unsigned long long>(result.num_missed_deadlines),
+         static_cast<unsigned long long>(result.num_idle_missed_deadlines),
+         result.idle_used_milliseconds, result.idle_milliseconds,
+         result.finish_milliseconds, result.num_unfinished_jobs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto const num_seconds = argc >= 2 ? atoi(argv[1]) : 60;
+  std::cout << num_seconds << " seconds at 60 Hz" << std::endl;
+
+  printf("%-16s %8s %8s %10s %10s %10s %10s\n", "housekeeping", "missed",
+         "by idle", "idle used", "idle ms", "finish ms", "unfinished");
+  auto const none = Run(Mode::None, num_seconds);
+  PrintResult("none", none);
+  auto const in_frame = Run(Mode::InFrame, num_seconds);
+  PrintResult("in frame", in_frame);
+  auto const idle = Run(Mode::Idle, num_seconds);
+  PrintResult("idle tasks", idle);
+
+  if (idle.num_idle_missed_deadlines ||
+      idle.num_missed_deadlines != none.num_missed_deadlines ||
+      idle.num_unfinished_jobs) {
+    printf("FAILED: idle tasks delayed frames or didn't finish\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
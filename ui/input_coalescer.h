@@ -0,0 +1,123 @@
+// Copyright (c) 2014 Project Vogue. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#if !defined(INCLUDE_ui_input_coalescer_h)
+#define INCLUDE_ui_input_coalescer_h
+
+namespace ui {
+
+//////////////////////////////////////////////////////////////////////
+//
+// InputEvent
+//
+struct InputEvent {
+  enum class Type {
+    KeyDown,
+    KeyUp,
+    PointerDown,
+    PointerMove,
+    PointerUp,
+    Wheel,
+  };
+
+  // Key code or pointer button.
+  int code;
+  // Number of events merged into this event.
+  int num_coalesced;
+  // Time of the oldest merged event, for measuring latency.
+  base::TimeTicks time_stamp;
+  Type type;
+  // Sum of wheel deltas of merged events.
+  float wheel_delta_x;
+  float wheel_delta_y;
+  // Pointer position of the latest merged event.
+  float x;
+  float y;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// InputCoalescer
+// Keeps input events until the next frame, and merges pointer moves and
+// wheel events arriving at a higher rate than frames into one event per
+// frame. A merged event has the latest pointer position and the sum of
+// wheel deltas.
+//
+// Other events are discrete. They are never merged, and events are never
+// merged across them, so a click sees the pointer position before it.
+// Callers should dispatch discrete events at once rather than at the next
+// frame.
+//
+class InputCoalescer final {
+  public: typedef std::function<void(const InputEvent& event)> Dispatcher;
+
+  private: std::vector<InputEvent> events_;
+  private: bool has_discrete_event_;
+  private: uint64_t num_events_;
+
+  public: InputCoalescer();
+  public: ~InputCoalescer() = default;
+
+  public: bool empty() const { return events_.empty(); }
+  public: bool has_discrete_event() const { return has_discrete_event_; }
+  // Number of events given to |Add()|.
+  public: uint64_t num_events() const { return num_events_; }
+  public: size_t size() const { return events_.size(); }
+
+  public: void Add(const InputEvent& event);
+  // Dispatches pending events in order.
+  public: void Flush(const Dispatcher& dispatcher);
+  public: static bool IsContinuous(InputEvent::Type type);
+
+  DISALLOW_COPY_AND_ASSIGN(InputCoalescer);
+};
+
+InputCoalescer::InputCoalescer()
+    : has_discrete_event_(false), num_events_(0) {
+}
+
+void InputCoalescer::Add(const InputEvent& event) {
+  ++num_events_;
+  if (!IsContinuous(event.type)) {
+    events_.push_back(event);
+    has_discrete_event_ = true;
+    return;
+  }
+  // Pointer moves and wheel events between the same discrete events can be
+  // reordered among themselves.
+  for (auto it = events_.rbegin(); it != events_.rend(); ++it) {
+    if (!IsContinuous(it->type))
+      break;
+    if (it->type != event.type)
+      continue;
+    it->num_coalesced += event.num_coalesced;
+    it->wheel_delta_x += event.wheel_delta_x;
+    it->wheel_delta_y += event.wheel_delta_y;
+    it->x = event.x;
+    it->y = event.y;
+    return;
+  }
+  events_.push_back(event);
+}
+
+void InputCoalescer::Flush(const Dispatcher& dispatcher) {
+  std::vector<InputEvent> events;
+  events.swap(events_);
+  has_discrete_event_ = false;
+  for (auto const& event : events)
+    dispatcher(event);
+  // Keep capacity for the next frame, unless |dispatcher| added events.
+  events.clear();
+  if (events_.empty())
+    events_.swap(events);
+}
+
+bool InputCoalescer::IsContinuous(InputEvent::Type type) {
+  return type == InputEvent::Type::PointerMove ||
+         type == InputEvent::Type::Wheel;
+}
+
+}  // namespace ui
+
+#endif //!defined(INCLUDE_ui_input_coalescer_h)